@@ -0,0 +1,33 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char *argv[])
+{
+  int n = atoi(argv[1]);
+  uint32_t table[256];
+
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; ++k)
+      c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    table[i] = c;
+  }
+
+  unsigned char *data = malloc(n);
+  if (!data)
+    return EXIT_FAILURE;
+
+  for (int i = 0; i < n; ++i)
+    data[i] = (unsigned char)(i * 31);
+
+  uint32_t crc = 0xFFFFFFFFu;
+  for (int i = 0; i < n; ++i)
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+  printf("%08x\n", (unsigned)(crc ^ 0xFFFFFFFFu));
+
+  free(data);
+
+  return 0;
+}
@@ -0,0 +1,16 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+static long fib(int n)
+{
+  return n < 2 ? n : fib(n - 1) + fib(n - 2);
+}
+
+int main(int argc, char *argv[])
+{
+  int n = atoi(argv[1]);
+
+  printf("%ld\n", fib(n));
+
+  return 0;
+}
@@ -0,0 +1,38 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char *argv[])
+{
+  int n = atoi(argv[1]);
+  double *a = malloc(n * n * sizeof(double));
+  double *b = malloc(n * n * sizeof(double));
+  double *c = malloc(n * n * sizeof(double));
+  if (!a || !b || !c)
+    return EXIT_FAILURE;
+
+  for (int i = 0; i < n * n; ++i) {
+    a[i] = (i % 7) * 0.5;
+    b[i] = (i % 11) * 0.25;
+  }
+
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      double sum = 0.0;
+      for (int k = 0; k < n; ++k)
+        sum += a[i * n + k] * b[k * n + j];
+      c[i * n + j] = sum;
+    }
+  }
+
+  double trace = 0.0;
+  for (int i = 0; i < n; ++i)
+    trace += c[i * n + i];
+
+  printf("%f\n", trace);
+
+  free(a);
+  free(b);
+  free(c);
+
+  return 0;
+}
@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+static void swap(int *a, int *b)
+{
+  int t = *a;
+  *a = *b;
+  *b = t;
+}
+
+static void sort(int *values, int lo, int hi)
+{
+  while (lo < hi) {
+    int pivot = values[(lo + hi) / 2];
+    int i = lo;
+    int j = hi;
+
+    while (i <= j) {
+      while (values[i] < pivot)
+        ++i;
+      while (values[j] > pivot)
+        --j;
+      if (i <= j)
+        swap(&values[i++], &values[j--]);
+    }
+
+    // Recurse into the smaller side, to bound the stack depth.
+    if (j - lo < hi - i) {
+      sort(values, lo, j);
+      lo = i;
+    }
+    else {
+      sort(values, i, hi);
+      hi = j;
+    }
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  int n = atoi(argv[1]);
+  int *values = malloc(n * sizeof(int));
+  if (!values)
+    return EXIT_FAILURE;
+
+  unsigned seed = 12345;
+  for (int i = 0; i < n; ++i) {
+    seed = seed * 1103515245u + 12345u;
+    values[i] = (int)((seed >> 16) % 100000);
+  }
+
+  sort(values, 0, n - 1);
+
+  for (int i = 1; i < n; ++i)
+    if (values[i - 1] > values[i])
+      return EXIT_FAILURE;
+
+  printf("%d %d\n", values[0], values[n - 1]);
+
+  free(values);
+
+  return 0;
+}
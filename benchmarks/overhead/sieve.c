@@ -0,0 +1,28 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char *argv[])
+{
+  int n = atoi(argv[1]);
+  char *composite = calloc(n + 1, 1);
+  if (!composite)
+    return EXIT_FAILURE;
+
+  int count = 0;
+
+  for (int i = 2; i <= n; ++i) {
+    if (composite[i])
+      continue;
+
+    ++count;
+
+    for (long j = (long)i * i; j <= n; j += i)
+      composite[j] = 1;
+  }
+
+  printf("%d\n", count);
+
+  free(composite);
+
+  return 0;
+}
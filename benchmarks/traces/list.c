@@ -0,0 +1,46 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+struct node {
+  int value;
+  struct node *next;
+};
+
+int main(int argc, char *argv[])
+{
+  int n = atoi(argv[1]);
+  struct node *head = NULL;
+
+  for (int i = 0; i < n; ++i) {
+    struct node *added = malloc(sizeof(struct node));
+    if (!added)
+      return EXIT_FAILURE;
+
+    added->value = i;
+    added->next = head;
+    head = added;
+  }
+
+  // Reverse the list, so that every node's next pointer is rewritten.
+  struct node *reversed = NULL;
+
+  while (head) {
+    struct node *next = head->next;
+    head->next = reversed;
+    reversed = head;
+    head = next;
+  }
+
+  long sum = 0;
+
+  while (reversed) {
+    struct node *next = reversed->next;
+    sum += reversed->value;
+    free(reversed);
+    reversed = next;
+  }
+
+  printf("%ld\n", sum);
+
+  return 0;
+}
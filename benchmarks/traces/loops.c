@@ -0,0 +1,20 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char *argv[])
+{
+  int n = atoi(argv[1]);
+  int values[64];
+  long sum = 0;
+
+  for (int i = 0; i < 64; ++i)
+    values[i] = i * 7 % 13;
+
+  for (int i = 0; i < n; ++i)
+    for (int j = 0; j < 64; ++j)
+      sum += values[j] * (i % 5);
+
+  printf("%ld\n", sum);
+
+  return 0;
+}
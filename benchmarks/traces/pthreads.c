@@ -0,0 +1,38 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define THREADS 4
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static long counter = 0;
+
+static void *work(void *arg)
+{
+  int n = *(int *)arg;
+
+  for (int i = 0; i < n; ++i) {
+    pthread_mutex_lock(&mutex);
+    ++counter;
+    pthread_mutex_unlock(&mutex);
+  }
+
+  return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+  int n = atoi(argv[1]);
+  pthread_t threads[THREADS];
+
+  for (int i = 0; i < THREADS; ++i)
+    if (pthread_create(&threads[i], NULL, work, &n))
+      return EXIT_FAILURE;
+
+  for (int i = 0; i < THREADS; ++i)
+    pthread_join(threads[i], NULL);
+
+  printf("%ld\n", counter);
+
+  return 0;
+}
@@ -0,0 +1,29 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char *argv[])
+{
+  int n = atoi(argv[1]);
+  char line[64];
+  char text[256];
+  int total = 0;
+
+  for (int i = 0; i < n; ++i) {
+    snprintf(line, sizeof(line), "line %d of %d", i, n);
+
+    strcpy(text, "[");
+    strncat(text, line, sizeof(text) - strlen(text) - 2);
+    strcat(text, "]");
+
+    int number = 0;
+    if (sscanf(text, "[line %d", &number) == 1)
+      total += number;
+
+    puts(text);
+  }
+
+  printf("%d\n", total);
+
+  return 0;
+}
@@ -72,6 +72,9 @@ class SeeCCodeGenAction : public clang::CodeGenAction {
   llvm::DenseMap<clang::Decl const *, uint64_t> DeclMap;
   llvm::DenseMap<clang::Stmt const *, uint64_t> StmtMap;
 
+  /// The AST of the main file in Clang's AST file format (if requested).
+  std::string SerializedAST;
+
 public:
   SeeCCodeGenAction(const char * const *WithArgBegin,
                     const char * const *WithArgEnd,
@@ -84,7 +87,8 @@ public:
     NextDeclIndex(0),
     NextStmtIndex(0),
     DeclMap(),
-    StmtMap()
+    StmtMap(),
+    SerializedAST()
   {}
 
   virtual
@@ -107,6 +111,11 @@ public:
   decltype(DeclMap) const &getDeclMap() { return DeclMap; }
 
   decltype(StmtMap) const &getStmtMap() { return StmtMap; }
+
+  /// \brief Serialize the completed AST, so that it can be stored in the
+  ///        Module and loaded instead of reparsing the sources.
+  ///
+  void serializeAST();
 };
 
 class SeeCEmitAssemblyAction : public SeeCCodeGenAction {
@@ -284,11 +293,15 @@ void GenerateSerializableMappings(SeeCCodeGenAction &Action,
                                   llvm::StringRef MainFilename);
 
 /// \brief Store all source files in SrcManager into the given llvm::Module.
+/// If SerializedAST is not empty, then it is also stored, keyed by the hash
+/// of the compile information (see MappedCompileInfo::getHash()).
 ///
 void StoreCompileInformationInModule(llvm::Module *Mod,
                                      clang::CompilerInstance &Compiler,
                                      const char * const *ArgBegin,
-                                     const char * const *ArgEnd);
+                                     const char * const *ArgEnd,
+                                     llvm::StringRef SerializedAST
+                                       = llvm::StringRef());
 
 } // namespace clang (in seec)
 
@@ -82,6 +82,11 @@ public:
 };
 
 
+/// \brief Check if a canonical type is, or contains, a pointer type.
+///
+bool containsPointerType(clang::Type const *CanonTy);
+
+
 /// \brief Reduce a set of references to the most informative types.
 ///
 void reduceReferences(std::vector<std::shared_ptr<ValueOfPointer const>> &Refs);
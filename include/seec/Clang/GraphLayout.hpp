@@ -26,6 +26,7 @@
 #include <chrono>
 #include <map>
 #include <memory>
+#include <string>
 #include <vector>
 
 
@@ -42,6 +43,8 @@ class Value;
 namespace graph {
 
 class Expansion;
+class LayeredLayoutEngine;
+class LayoutCache;
 class LayoutHandler;
 
 
@@ -157,26 +160,45 @@ public:
 };
 
 
+/// \brief Get the dot statement for a node with an HTML-like label.
+///
+inline std::string getDotStringForNode(std::string const &ID,
+                                       std::string const &Label)
+{
+  return ID + " [ label = <" + Label + "> ];\n";
+}
+
+
 /// \brief Represents the layout of an area.
 ///
 class LayoutOfArea {
   std::string ID;
   
+  std::string Label;
+  
   std::string DotString;
   
   ValuePortMap Ports;
   
 public:
+  /// \brief Constructor.
+  /// \param WithLabel the node's HTML-like label (a TABLE).
+  ///
   LayoutOfArea(std::string WithID,
-               std::string WithDotString,
+               std::string WithLabel,
                ValuePortMap WithPorts)
   : ID(std::move(WithID)),
-    DotString(std::move(WithDotString)),
+    Label(std::move(WithLabel)),
+    DotString(getDotStringForNode(ID, Label)),
     Ports(std::move(WithPorts))
   {}
   
   std::string const &getID() const { return ID; }
   
+  /// \brief Get the node's HTML-like label.
+  ///
+  std::string const &getLabel() const { return Label; }
+  
   std::string const &getDotString() const { return DotString; }
   
   decltype(Ports) const &getPorts() const { return Ports; }
@@ -188,17 +210,31 @@ public:
 class LayoutOfProcess {
   std::string DotString;
   
+  /// The rendered graph, if it was laid out by the builtin layered engine.
+  std::string SVGString;
+  
   std::chrono::nanoseconds TimeTaken;
   
 public:
   LayoutOfProcess(std::string WithDotString,
                   std::chrono::nanoseconds TimeTakenToGenerate)
   : DotString(std::move(WithDotString)),
+    SVGString(),
+    TimeTaken(std::move(TimeTakenToGenerate))
+  {}
+  
+  LayoutOfProcess(std::string WithDotString,
+                  std::string WithSVGString,
+                  std::chrono::nanoseconds TimeTakenToGenerate)
+  : DotString(std::move(WithDotString)),
+    SVGString(std::move(WithSVGString)),
     TimeTaken(std::move(TimeTakenToGenerate))
   {}
   
   std::string const &getDotString() const { return DotString; }
   
+  std::string const &getSVGString() const { return SVGString; }
+  
   std::chrono::nanoseconds const &getTimeTaken() const { return TimeTaken; }
 };
 
@@ -346,17 +382,32 @@ class LayoutHandler final {
   
   /// @}
   
+  /// Layouts of values and areas from previous states, which are reused when
+  /// the values and the pointers that reference them have not changed.
+  std::unique_ptr<LayoutCache> Cache;
+  
+  /// The builtin layout engine used by doLayeredLayout(), which remembers
+  /// node placements from the previous state.
+  std::unique_ptr<LayeredLayoutEngine> Layered;
+  
+  /// \brief Select the engine to use for a Value.
+  ///
+  LayoutEngineForValue const *getLayoutEngine(Value const &ForValue) const;
+  
+  /// \brief Select the engine to use for an Area and Pointer.
+  ///
+  LayoutEngineForArea const *
+  getLayoutEngine(seec::MemoryArea const &ForArea,
+                  seec::cm::ValueOfPointer const &ForReference) const;
+  
 public:
   /// \brief Default constructor.
   ///
-  LayoutHandler()
-  : ValueEngines(),
-    ValueEngineDefault(nullptr),
-    ValueEngineOverride(),
-    AreaEngines(),
-    AreaEngineOverride(),
-    AreaReferenceOverride()
-  {}
+  LayoutHandler();
+  
+  /// \brief Destructor.
+  ///
+  ~LayoutHandler();
   
   
   /// \name Layout Engine Handling
@@ -438,6 +489,21 @@ public:
            seec::cm::ValueOfPointer const &Reference,
            Expansion const &Exp) const;
   
+  /// \brief Perform the layout for a value, reusing the layout from a
+  ///        previous state if the value and its references are unchanged.
+  ///
+  seec::Maybe<LayoutOfValue>
+  doLayout(std::shared_ptr<Value const> const &State,
+           Expansion const &Exp) const;
+  
+  /// \brief Perform the layout for an area, reusing the layout from a
+  ///        previous state if the area and its references are unchanged.
+  ///
+  seec::Maybe<LayoutOfArea>
+  doLayout(seec::MemoryArea const &Area,
+           std::shared_ptr<ValueOfPointer const> const &Reference,
+           Expansion const &Exp) const;
+  
   /// \brief Perform expansion and layout for a process state.
   ///
   /// Cancel expansion and layout if \c CancelIfFalse is false.
@@ -451,6 +517,22 @@ public:
   LayoutOfProcess
   doLayout(seec::cm::ProcessState const &State) const;
   
+  /// \brief Perform expansion and layout for a process state, and render it
+  ///        to SVG using the builtin layered layout engine.
+  ///
+  /// Nodes that were in the previous state's layout keep their positions
+  /// where possible. Cancel expansion and layout if \c CancelIfFalse is false.
+  ///
+  LayoutOfProcess
+  doLayeredLayout(seec::cm::ProcessState const &State,
+                  std::atomic_bool &CancelIfFalse) const;
+  
+  /// \brief Perform expansion and layout for a process state, and render it
+  ///        to SVG using the builtin layered layout engine.
+  ///
+  LayoutOfProcess
+  doLayeredLayout(seec::cm::ProcessState const &State) const;
+  
   /// @}
 };
 
@@ -0,0 +1,178 @@
+//===- include/seec/Clang/GraphLayoutLayered.hpp --------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// A builtin layered (Sugiyama-style) layout engine that renders the graphs
+/// produced by LayoutHandler directly to SVG, without using Graphviz.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef SEEC_LIB_CLANG_GRAPHLAYOUTLAYERED_HPP
+#define SEEC_LIB_CLANG_GRAPHLAYOUTLAYERED_HPP
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+namespace seec {
+
+namespace cm {
+
+namespace graph {
+
+
+/// \brief The style of an arrow at the end of a LayeredEdge.
+///
+enum class LayeredArrowType {
+  None,
+  Normal,  ///< A filled arrowhead (dot's "normal").
+  Open,    ///< An unfilled arrowhead (dot's "onormal").
+  OpenDot  ///< An unfilled circle (dot's "odot").
+};
+
+
+/// \brief The point of a node (or port) that an edge's head is attached to.
+///
+enum class LayeredAnchor {
+  Side,      ///< The middle of the node's nearest side.
+  NorthWest  ///< The top left corner.
+};
+
+
+/// \brief A node to be laid out by the LayeredLayoutEngine.
+///
+struct LayeredNode {
+  /// Identifies this node between successive layouts.
+  std::string ID;
+
+  /// The node's contents, using the same HTML-like label format that is
+  /// produced for dot (i.e. a TABLE containing rows of cells).
+  std::string Label;
+};
+
+
+/// \brief An edge to be laid out by the LayeredLayoutEngine.
+///
+struct LayeredEdge {
+  /// Index of the tail node.
+  std::size_t Tail;
+
+  /// Port (cell) of the tail node, or empty to use the whole node.
+  std::string TailPort;
+
+  /// Index of the head node.
+  std::size_t Head;
+
+  /// Port (cell) of the head node, or empty to use the whole node.
+  std::string HeadPort;
+
+  /// Where the edge attaches to the head port (or node).
+  LayeredAnchor HeadAnchor;
+
+  /// Arrow drawn at the tail.
+  LayeredArrowType TailArrow;
+
+  /// Arrow drawn at the head.
+  LayeredArrowType HeadArrow;
+
+  /// If not empty, the edge is a link with this HREF.
+  std::string HREF;
+
+  /// Colour of the edge, or empty for the default.
+  std::string Color;
+
+  /// Draw the edge dashed.
+  bool Dashed;
+};
+
+
+/// \brief A graph to be laid out by the LayeredLayoutEngine.
+///
+class LayeredGraph {
+  std::vector<LayeredNode> Nodes;
+
+  std::vector<LayeredEdge> Edges;
+
+public:
+  /// \brief Add a node.
+  /// \return the index of the new node.
+  ///
+  std::size_t addNode(std::string ID, std::string Label) {
+    Nodes.emplace_back(LayeredNode{std::move(ID), std::move(Label)});
+    return Nodes.size() - 1;
+  }
+
+  /// \brief Add an edge between two previously added nodes.
+  ///
+  void addEdge(LayeredEdge Edge) {
+    Edges.emplace_back(std::move(Edge));
+  }
+
+  std::vector<LayeredNode> const &getNodes() const { return Nodes; }
+
+  std::vector<LayeredEdge> const &getEdges() const { return Edges; }
+};
+
+
+/// \brief Lays out LayeredGraphs and renders them to SVG.
+///
+/// Nodes are assigned to layers from left to right following their edges,
+/// ordered within each layer to reduce crossings, and then placed so that
+/// edges are as straight as possible. Every stage is (close to) linear in the
+/// size of the graph.
+///
+/// The engine remembers where each node (by ID) was placed by the previous
+/// layout. If most of the nodes in a new graph were in the previous layout,
+/// then they keep their previous layers and vertical positions where possible,
+/// and new nodes are inserted around them, so that stepping through a trace
+/// does not move unchanged nodes.
+///
+/// The SVG uses the same structure as Graphviz's SVG output (node and edge
+/// groups, links for HREFs, polygons for cells), so that it can be displayed
+/// by the same viewers.
+///
+class LayeredLayoutEngine {
+  /// \brief Where a node was placed.
+  ///
+  struct Placement {
+    unsigned Layer;
+
+    double Y;
+  };
+
+  /// Placements of nodes in the previous layout.
+  llvm::StringMap<Placement> Previous;
+
+public:
+  /// \brief Lay out a graph and render it to SVG.
+  /// \param CancelIfFalse if this is not null and becomes false, the layout
+  ///        is abandoned.
+  /// \return the SVG, or an empty string if the layout was cancelled.
+  ///
+  std::string render(LayeredGraph const &Graph,
+                     std::atomic_bool const *CancelIfFalse = nullptr);
+
+  /// \brief Forget all previous node placements.
+  ///
+  void clear() { Previous.clear(); }
+};
+
+
+} // namespace graph (in cm in seec)
+
+} // namespace cm (in seec)
+
+} // namespace seec
+
+#endif // SEEC_LIB_CLANG_GRAPHLAYOUTLAYERED_HPP
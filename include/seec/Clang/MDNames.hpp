@@ -31,6 +31,8 @@ char const * const MDGlobalLocalMapStr = "seec.clang.map.local.idxs";
 
 char const * const MDCompileInfo = "seec.clang.compile.info";
 
+char const * const MDSerializedAST = "seec.clang.serialized.ast";
+
 }
 
 }
@@ -24,6 +24,7 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -38,6 +39,8 @@ namespace clang {
 
 namespace seec {
 
+class FormattedStmtCacheForAST;
+
 /// Contains classes to assist with SeeC's usage of Clang.
 namespace seec_clang {
 
@@ -67,6 +70,12 @@ private:
   
   /// All Decls that are referred to by non-system code.
   llvm::DenseSet<clang::Decl const *> const DeclsReferenced;
+
+  /// Tokens and formatted Stmts used by seec::formatStmtSource().
+  mutable std::unique_ptr<seec::FormattedStmtCacheForAST> FormattedStmtCache;
+
+  /// Ensures that \c FormattedStmtCache is only created once.
+  mutable std::once_flag FormattedStmtCacheFlag;
   
   /// \brief Constructor.
   MappedAST(MappedCompileInfo const &FromCompileInfo,
@@ -100,6 +109,11 @@ public:
   ///
   clang::ASTUnit &getASTUnit() const { return *AST; }
   
+  /// \brief Get the cache used by seec::formatStmtSource(), creating it if
+  ///        necessary.
+  ///
+  seec::FormattedStmtCacheForAST &getFormattedStmtCache() const;
+
   /// \brief Get all mapped clang::Decl pointers.
   ///
   decltype(Decls) const &getAllDecls() const { return Decls; }
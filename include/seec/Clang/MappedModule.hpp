@@ -22,6 +22,7 @@
 
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Instruction.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
@@ -377,6 +378,12 @@ public:
     return InvocationArguments;
   }
 
+  /// \brief Get a hash of the files, arguments, and header search entries
+  ///        used in this compilation.
+  /// This identifies the compilation that a serialized AST was created for.
+  ///
+  std::string getHash() const;
+
   /// \brief Create a \c CompilerInvocation for this compilation.
   ///
   std::shared_ptr<clang::CompilerInvocation>
@@ -430,6 +437,10 @@ class MappedModule {
   
   /// Compile information for each main file in this Module.
   std::map<std::string, std::unique_ptr<MappedCompileInfo>> CompileInfo;
+
+  /// Serialized AST nodes for each main file in this Module (if seec-cc was
+  /// asked to embed ASTs).
+  std::map<std::string, llvm::MDNode const *> SerializedASTs;
   
   /// Lookup from clang::Stmt pointer to MappedStmt objects.
   std::multimap<clang::Stmt const *,
@@ -445,9 +456,11 @@ class MappedModule {
   MappedModule(MappedModule const &Other) = delete;
   MappedModule &operator=(MappedModule const &RHS) = delete;
 
-  /// \brief Get or create the AST for the given file.
+  /// \brief Create the ASTs for the given files, concurrently.
+  /// The ASTs are added to \c ASTLookup and \c ASTList in the order of
+  /// \c FileNodes, and files that already have an AST are skipped.
   ///
-  MappedAST const *createASTForFile(llvm::MDNode const *FileNode);
+  void createASTsForFiles(llvm::ArrayRef<llvm::MDNode const *> FileNodes);
   
   /// \brief Get a reference to a path string stored in \c FilePathStrings.
   ///
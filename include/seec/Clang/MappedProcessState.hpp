@@ -84,6 +84,10 @@ class ProcessState {
   
   /// Currently open DIRs.
   llvm::DenseMap<stateptr_ty, DIRState> Dirs;
+
+  /// \brief Regenerate the information for open streams and DIRs.
+  ///
+  void generateStreamsAndDirs();
   
 public:
   /// \brief Constructor.
@@ -115,6 +119,14 @@ public:
   /// generate new information.
   ///
   void cacheClear();
+
+  /// \brief Update cached information following movement.
+  ///
+  /// Must be called following updates to the underlying state. Only the
+  /// Values that overlap memory changed by the movement are discarded, and
+  /// only the threads that moved regenerate their call stacks.
+  ///
+  void cacheUpdate();
   
   /// \brief Print a textual description of the state.
   ///
@@ -19,6 +19,7 @@
 #include "seec/Clang/MappedAST.hpp"
 #include "seec/Clang/MappedModule.hpp"
 #include "seec/Clang/MappedStateCommon.hpp"
+#include "seec/Clang/TypeMatch.hpp"
 #include "seec/ICU/LazyMessage.hpp"
 #include "seec/Util/Error.hpp"
 #include "seec/Util/ModuleIndex.hpp"
@@ -74,6 +75,9 @@ class ProcessTrace {
   
   /// SeeC-Clang mapping.
   seec::seec_clang::MappedModule Mapping;
+
+  /// Results of matching types from the mapping's different ASTs.
+  mutable TypeMatchCache TypeMatches;
   
   /// \brief Constructor.
   ///
@@ -93,7 +97,8 @@ class ProcessTrace {
                                              &*DiagOpts,
                                              &DiagConsumer,
                                              false)),
-    Mapping(*ModuleIndex, Diagnostics)
+    Mapping(*ModuleIndex, Diagnostics),
+    TypeMatches()
   {}
   
 public:
@@ -124,6 +129,12 @@ public:
   seec::seec_clang::MappedModule const &getMapping() const {
     return Mapping;
   }
+
+  /// \brief Get the cache of type matches between the mapping's ASTs.
+  ///
+  TypeMatchCache &getTypeMatchCache() const {
+    return TypeMatches;
+  }
   
   /// @} (Access underlying information)
   
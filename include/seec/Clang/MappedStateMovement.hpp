@@ -54,6 +54,9 @@ MovementResult moveForward(ThreadState &Thread);
 
 /// \brief Move Thread's state forward to the end of the trace.
 ///
+/// The whole process is moved to the end of the trace, as with
+/// moveForwardToEnd(ProcessState &), so every other thread is also at its end.
+///
 MovementResult moveForwardToEnd(ThreadState &Thread);
 
 /// \brief Move Thread's state forward until the next time that a top-level Stmt
@@ -67,6 +70,9 @@ MovementResult moveBackward(ThreadState &Thread);
 
 /// \brief Move Thread's state backward to the end of the trace.
 ///
+/// The whole process is moved to the start of the trace, as with
+/// moveBackwardToStart(ProcessState &).
+///
 MovementResult moveBackwardToEnd(ThreadState &Thread);
 
 /// \brief Move Thread's state backward until the most recent preceding time
@@ -106,6 +112,34 @@ MovementResult moveForward(ProcessState &Process);
 ///
 MovementResult moveBackward(ProcessState &Process);
 
+/// \brief Move forwards by one step.
+///
+/// For a single-threaded process this moves the thread to its next logical
+/// time (as with moveForward(ThreadState &)). Otherwise it moves to the next
+/// process time.
+///
+MovementResult moveForwardOneStep(ProcessState &Process);
+
+/// \brief Move backwards by one step.
+///
+/// The reverse of moveForwardOneStep().
+///
+MovementResult moveBackwardOneStep(ProcessState &Process);
+
+/// \brief Move forwards to the end of the trace.
+///
+/// Threads move over shared events that are independent of each other without
+/// waiting for their process times (see seec::trace::moveForwardToEnd()).
+///
+MovementResult moveForwardToEnd(ProcessState &Process);
+
+/// \brief Move backwards to the start of the trace.
+///
+/// As with moveForwardToEnd(ProcessState &), independent shared events are not
+/// ordered.
+///
+MovementResult moveBackwardToStart(ProcessState &Process);
+
 /// @} (Process-level movement.)
 //===----------------------------------------------------------------------===//
 
@@ -17,6 +17,9 @@
 #define SEEC_CLANG_MAPPEDTHREADSTATE_HPP
 
 #include "seec/ICU/Augmenter.hpp"
+#include "seec/Trace/TraceReader.hpp"
+
+#include "llvm/ADT/Optional.h"
 
 #include <functional>
 #include <memory>
@@ -60,6 +63,10 @@ class ThreadState {
   /// the function states to clients without exposing details of the storage
   /// implementation (i.e. unique_ptr).
   std::vector<std::reference_wrapper<FunctionState const>> CallStackRefs;
+
+  /// The next event of the underlying state when the call stack was last
+  /// generated.
+  llvm::Optional<seec::trace::EventReference> CallStackEvent;
   
 public:
   /// \brief Constructor.
@@ -90,6 +97,13 @@ public:
   /// generate new information.
   ///
   void cacheClear();
+
+  /// \brief Update cached information following movement.
+  ///
+  /// Cached information is only regenerated if the underlying state has moved
+  /// since it was last generated.
+  ///
+  void cacheUpdate();
   
   /// \brief Print a textual description of the state.
   ///
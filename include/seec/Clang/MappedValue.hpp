@@ -18,15 +18,18 @@
 #include "seec/Clang/MappedStateCommon.hpp"
 #include "seec/Trace/MemoryState.hpp"
 #include "seec/Util/Fallthrough.hpp"
+#include "seec/Util/Maybe.hpp"
 
 #include "clang/AST/CharUnits.h"
 #include "clang/AST/Type.h"
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/Support/Casting.h"
 
 #include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 
 namespace clang {
@@ -204,6 +207,137 @@ public:
 };
 
 
+/// \brief A run of consecutive array elements whose bytes (and byte
+///        initialization) are identical.
+///
+class ArrayElementRun {
+  /// Index of the first element in the run.
+  unsigned First;
+
+  /// Number of elements in the run.
+  unsigned Count;
+
+  /// \c true iff every byte of these elements is initialized.
+  bool Initialized : 1;
+
+  /// \c true iff no byte of these elements is initialized.
+  bool Uninitialized : 1;
+
+  /// \c true iff every byte of these elements is zero (uninitialized bytes
+  /// are zero).
+  bool Zero : 1;
+
+public:
+  /// \brief Constructor.
+  ///
+  ArrayElementRun(unsigned const WithFirst,
+                  unsigned const WithCount,
+                  bool const IsInitialized,
+                  bool const IsUninitialized,
+                  bool const IsZero)
+  : First(WithFirst),
+    Count(WithCount),
+    Initialized(IsInitialized),
+    Uninitialized(IsUninitialized),
+    Zero(IsZero)
+  {}
+
+  /// \brief Get the index of the first element in the run.
+  ///
+  unsigned getFirst() const { return First; }
+
+  /// \brief Get the number of elements in the run.
+  ///
+  unsigned getCount() const { return Count; }
+
+  /// \brief Get the index following the last element in the run.
+  ///
+  unsigned getEnd() const { return First + Count; }
+
+  /// \brief Check if every byte of these elements is initialized.
+  ///
+  bool isInitialized() const { return Initialized; }
+
+  /// \brief Check if no byte of these elements is initialized.
+  ///
+  bool isUninitialized() const { return Uninitialized; }
+
+  /// \brief Check if every byte of these elements is zero.
+  ///
+  bool isZero() const { return Zero; }
+
+  /// \brief Check if these elements are uninitialized or zero.
+  ///
+  bool isEmpty() const { return Uninitialized || Zero; }
+
+  /// \brief Extend the run by one element.
+  ///
+  void extend() { ++Count; }
+};
+
+
+/// \brief Summarizes the elements of an in-memory array.
+///
+/// This is computed directly from the array's memory, so it does not create
+/// a \c Value for each element (see \c ValueOfArray::getSummary()).
+///
+class ArraySummary {
+  /// Number of elements in the array.
+  unsigned ElementCount;
+
+  /// Number of elements that are completely initialized.
+  unsigned InitializedCount;
+
+  /// Maximal runs of identical elements, in order, covering every element.
+  std::vector<ArrayElementRun> Runs;
+
+  /// For arrays of arithmetic type, the index of an initialized element with
+  /// the least value.
+  seec::Maybe<unsigned> MinIndex;
+
+  /// For arrays of arithmetic type, the index of an initialized element with
+  /// the greatest value.
+  seec::Maybe<unsigned> MaxIndex;
+
+public:
+  /// \brief Constructor.
+  ///
+  ArraySummary(unsigned const WithElementCount,
+               unsigned const WithInitializedCount,
+               std::vector<ArrayElementRun> WithRuns,
+               seec::Maybe<unsigned> WithMinIndex,
+               seec::Maybe<unsigned> WithMaxIndex)
+  : ElementCount(WithElementCount),
+    InitializedCount(WithInitializedCount),
+    Runs(std::move(WithRuns)),
+    MinIndex(std::move(WithMinIndex)),
+    MaxIndex(std::move(WithMaxIndex))
+  {}
+
+  /// \brief Get the number of elements in the array.
+  ///
+  unsigned getElementCount() const { return ElementCount; }
+
+  /// \brief Get the number of completely initialized elements.
+  ///
+  unsigned getInitializedCount() const { return InitializedCount; }
+
+  /// \brief Get the runs of identical elements.
+  ///
+  std::vector<ArrayElementRun> const &getRuns() const { return Runs; }
+
+  /// \brief Get the index of an element with the least value (if the element
+  ///        type is arithmetic and any element is initialized).
+  ///
+  seec::Maybe<unsigned> const &getMinIndex() const { return MinIndex; }
+
+  /// \brief Get the index of an element with the greatest value (if the
+  ///        element type is arithmetic and any element is initialized).
+  ///
+  seec::Maybe<unsigned> const &getMaxIndex() const { return MaxIndex; }
+};
+
+
 /// \brief Represents an aggregate's runtime value.
 ///
 class ValueOfArray : public Value {
@@ -235,6 +369,11 @@ public:
   /// \brief Get the size of each child in this value.
   ///
   std::size_t getChildSize() const { return getChildSizeImpl(); }
+
+  /// \brief Summarize the children of this value from its memory.
+  /// \return the summary, or nothing if this value is not in memory.
+  ///
+  seec::Maybe<ArraySummary> getSummary() const;
 };
 
 
@@ -320,6 +459,7 @@ public:
 
 
 // Forward-declare for ValueStore.
+class TypeMatchCache;
 class ValueStoreImpl;
 
 
@@ -331,7 +471,8 @@ class ValueStore final {
   
   /// \brief Constructor.
   ///
-  ValueStore(seec::seec_clang::MappedModule const &WithMapping);
+  ValueStore(seec::seec_clang::MappedModule const &WithMapping,
+             TypeMatchCache &WithTypeMatches);
   
   // Don't allow copying or moving.
   ValueStore(ValueStore const &) = delete;
@@ -341,10 +482,15 @@ class ValueStore final {
   
 public:
   /// \brief Create a new ValueStore.
+  /// \param WithMapping SeeC-Clang mapping information.
+  /// \param WithTypeMatches the type match cache shared by all of the stores
+  ///                        for WithMapping.
   ///
   static std::shared_ptr<ValueStore const>
-  create(seec::seec_clang::MappedModule const &WithMapping) {
-    return std::shared_ptr<ValueStore const>(new ValueStore(WithMapping));
+  create(seec::seec_clang::MappedModule const &WithMapping,
+         TypeMatchCache &WithTypeMatches) {
+    return std::shared_ptr<ValueStore const>(new ValueStore(WithMapping,
+                                                            WithTypeMatches));
   }
   
   /// \brief Destructor.
@@ -359,6 +505,14 @@ public:
   ///
   std::shared_ptr<Value const>
   findFromAddressAndType(stateptr_ty Address, llvm::StringRef TypeString) const;
+
+  /// \brief Remove all stored Values that overlap the given areas of memory.
+  ///
+  /// Subsequent requests for these Values will create new Value objects that
+  /// reflect the current state of memory. Existing references to the removed
+  /// Values remain valid, but they may describe outdated state.
+  ///
+  void invalidate(llvm::ArrayRef<MemoryArea> Areas) const;
 };
 
 
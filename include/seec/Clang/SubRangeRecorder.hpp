@@ -10,16 +10,25 @@
 #ifndef SEEC_CLANG_SUBRANGERECORDER_HPP
 #define SEEC_CLANG_SUBRANGERECORDER_HPP
 
+#include "clang/Basic/SourceLocation.h"
+#include "clang/Lex/Token.h"
+
 #include "llvm/ADT/DenseMap.h"
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace llvm {
   class raw_ostream;
 }
 namespace clang {
   class ASTUnit;
+  class CompilerInstance;
+  class Preprocessor;
   struct PrintingPolicy;
   class Stmt;
 }
@@ -141,9 +150,84 @@ public:
   FormattedStmtRange const *getStmtRange(clang::Stmt const * const S) const;
 };
 
+/// \brief Holds the tokens used to format \c clang::Stmt s from a single
+///        \c MappedAST, and the formatted results.
+///
+/// Each \c MappedAST owns one of these (see
+/// \c MappedAST::getFormattedStmtCache()), so that the main file is only
+/// preprocessed once. All access is serialized by \c getLock().
+///
+class FormattedStmtCacheForAST final
+{
+  /// The AST that this cache is for.
+  seec::seec_clang::MappedAST const &MappedAST;
+
+  /// Used to preprocess and lex the source files.
+  std::unique_ptr<clang::CompilerInstance> Clang;
+
+  /// All preprocessed tokens of the main file.
+  std::vector<clang::Token> PreprocessedTokens;
+
+  /// Raw tokens for each file, generated lazily.
+  std::map<clang::FileID, std::vector<clang::Token>> RawTokens;
+
+  /// Formatted results for each top-level \c clang::Stmt.
+  std::map<clang::Stmt const *, FormattedStmt> Formatted;
+
+  /// Serializes access to the cache.
+  std::mutex Mutex;
+
+public:
+  /// \brief Constructor.
+  /// Preprocesses the main file of \c ForMappedAST.
+  ///
+  FormattedStmtCacheForAST(seec::seec_clang::MappedAST const &ForMappedAST);
+
+  /// \brief Destructor.
+  ///
+  ~FormattedStmtCacheForAST();
+
+  FormattedStmtCacheForAST(FormattedStmtCacheForAST const &) = delete;
+  FormattedStmtCacheForAST &operator=(FormattedStmtCacheForAST const &) =
+    delete;
+
+  /// \brief Get the mutex that must be held while using this cache.
+  ///
+  std::mutex &getLock() { return Mutex; }
+
+  seec::seec_clang::MappedAST const &getMappedAST() const { return MappedAST; }
+
+  bool hasCompilerInstance() const { return Clang != nullptr; }
+
+  clang::Preprocessor const &getPreprocessor() const;
+
+  std::vector<clang::Token> const &getPreprocessedTokens() const {
+    return PreprocessedTokens;
+  }
+
+  /// \brief Get the raw tokens for a file, lexing them if necessary.
+  ///
+  std::vector<clang::Token> const *getRawTokens(clang::FileID const FID);
+
+  /// \brief Get the formatted result for a \c clang::Stmt, if it has already
+  ///        been generated.
+  ///
+  FormattedStmt const *getFormatted(clang::Stmt const *S) const {
+    auto const It = Formatted.find(S);
+    return It != Formatted.end() ? &(It->second) : nullptr;
+  }
+
+  /// \brief Store the formatted result for a \c clang::Stmt.
+  ///
+  FormattedStmt const &addFormatted(clang::Stmt const *S, FormattedStmt F) {
+    return Formatted.insert(std::make_pair(S, std::move(F))).first->second;
+  }
+};
+
 /// \brief Generate a formatted \c clang::Stmt with ranges of sub-statements.
 ///
-/// See \c FormattedStmt for more information.
+/// See \c FormattedStmt for more information. Results are cached by the
+/// \c MappedAST, so repeated calls for the same \c clang::Stmt are cheap.
 ///
 FormattedStmt formatStmtSource(clang::Stmt const *S,
                                seec::seec_clang::MappedAST const &MappedAST);
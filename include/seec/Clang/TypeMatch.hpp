@@ -11,8 +11,20 @@
 ///
 //===----------------------------------------------------------------------===//
 
+#ifndef SEEC_CLANG_TYPEMATCH_HPP
+#define SEEC_CLANG_TYPEMATCH_HPP
+
+#include "seec/Util/Maybe.hpp"
+
 #include "clang/AST/Type.h"
 
+#include "llvm/ADT/DenseMap.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
 namespace clang {
   class ASTContext;
 }
@@ -21,14 +33,96 @@ namespace seec {
 
 namespace cm {
 
+/// \brief Remembers the results of matching types from different contexts.
+///
+/// Relating values from different translation units may compare the same
+/// pair of types many times, and each comparison recurses through pointees
+/// and fields. A single cache should be shared by all users of the types
+/// (e.g. one per MappedModule). It is safe to use from multiple threads.
+///
+/// Querying an ASTContext (e.g. with getTypeInfo()) lazily fills its caches,
+/// so the cache also holds a lock for each ASTContext, which must be held by
+/// any user that queries the context while other threads may be doing so.
+///
+class TypeMatchCache {
+  /// A pair of canonical types, ordered so that the lesser pointer is first.
+  using KeyTy = std::pair< ::clang::Type const *, ::clang::Type const *>;
+
+  /// Control access to Results and ContextAccess.
+  mutable std::mutex Access;
+
+  /// The result of each completed match.
+  llvm::DenseMap<KeyTy, bool> Results;
+
+  /// The lock for each ASTContext.
+  mutable std::map< ::clang::ASTContext const *,
+                    std::unique_ptr<std::recursive_mutex>> ContextAccess;
+
+  static KeyTy makeKey(::clang::Type const *A, ::clang::Type const *B) {
+    return std::less< ::clang::Type const *>()(B, A) ? KeyTy(B, A)
+                                                      : KeyTy(A, B);
+  }
+
+public:
+  /// \brief Constructor.
+  ///
+  TypeMatchCache()
+  : Access(),
+    Results(),
+    ContextAccess()
+  {}
+
+  /// \brief Get the result of a previous match of two canonical types.
+  ///
+  seec::Maybe<bool> find(::clang::Type const *A, ::clang::Type const *B) const
+  {
+    std::lock_guard<std::mutex> Lock(Access);
+
+    auto const It = Results.find(makeKey(A, B));
+    if (It == Results.end())
+      return seec::Maybe<bool>();
+
+    return bool(It->second);
+  }
+
+  /// \brief Record the result of matching two canonical types.
+  ///
+  void add(::clang::Type const *A, ::clang::Type const *B, bool Result) {
+    std::lock_guard<std::mutex> Lock(Access);
+    Results[makeKey(A, B)] = Result;
+  }
+
+  /// \brief Get the lock that controls access to an ASTContext.
+  ///
+  /// The lock is recursive, so that a user holding it may call other code
+  /// (such as matchImpl()) that takes it.
+  ///
+  std::recursive_mutex &
+  getContextAccess(::clang::ASTContext const &Context) const {
+    std::lock_guard<std::mutex> Lock(Access);
+
+    auto &Entry = ContextAccess[&Context];
+    if (!Entry)
+      Entry.reset(new std::recursive_mutex());
+
+    return *Entry;
+  }
+};
+
 /// \brief Check if two types are equivalent, possibly from different contexts.
 ///
 /// \return true if the types are equivalent.
 ///
+/// \param Cache if not null, used to find and store the results of matching
+///              these types and the types that they are composed of. The
+///              contexts are queried while holding their locks from the
+///              cache.
+///
 bool matchImpl(::clang::ASTContext const &AContext,
                ::clang::Type const *AType,
                ::clang::ASTContext const &BContext,
-               ::clang::Type const *BType);
+               ::clang::Type const *BType,
+               TypeMatchCache *Cache = nullptr);
 
 /// \brief Check if two types are equivalent, possibly from different contexts.
 ///
@@ -41,13 +135,15 @@ bool matchImpl(::clang::ASTContext const &AContext,
 inline bool match(::clang::ASTContext const &AContext,
                   ::clang::Type const &AType,
                   ::clang::ASTContext const &BContext,
-                  ::clang::Type const &BType)
+                  ::clang::Type const &BType,
+                  TypeMatchCache *Cache = nullptr)
 {
   auto const ACanon = AType.getCanonicalTypeInternal().getTypePtr();
   auto const BCanon = BType.getCanonicalTypeInternal().getTypePtr();
   
-  return &AContext == &BContext ? (ACanon == BCanon)
-                                : matchImpl(AContext, ACanon, BContext, BCanon);
+  return &AContext == &BContext
+         ? (ACanon == BCanon)
+         : matchImpl(AContext, ACanon, BContext, BCanon, Cache);
 }
 
 /// \brief Wrap a \c Type and \c ASTContext for comparison.
@@ -56,16 +152,21 @@ class MatchType {
   ::clang::ASTContext const *Context;
   
   ::clang::Type const *Type;
+
+  TypeMatchCache *Cache;
   
 public:
   MatchType(::clang::ASTContext const &WithContext,
-            ::clang::Type const &WithType)
+            ::clang::Type const &WithType,
+            TypeMatchCache *WithCache = nullptr)
   : Context(&WithContext),
-    Type(&WithType)
+    Type(&WithType),
+    Cache(WithCache)
   {}
   
   bool operator==(MatchType const &RHS) const {
-    return match(*Context, *Type, *RHS.Context, *RHS.Type);
+    return match(*Context, *Type, *RHS.Context, *RHS.Type,
+                 Cache ? Cache : RHS.Cache);
   }
   
   bool operator!=(MatchType const &RHS) const {
@@ -78,3 +179,5 @@ public:
 } // namespace cm
 
 } // namespace seec
+
+#endif // SEEC_CLANG_TYPEMATCH_HPP
@@ -0,0 +1,138 @@
+//===- include/seec/DSA/MemoryAreaOwnerIndex.hpp -------------------- C++ -===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef SEEC_DSA_MEMORYAREAOWNERINDEX_HPP
+#define SEEC_DSA_MEMORYAREAOWNERINDEX_HPP
+
+#include "seec/DSA/IntervalMapVector.hpp"
+#include "seec/DSA/MemoryArea.hpp"
+#include "seec/Util/Maybe.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace seec {
+
+
+/// \brief Finds the owners of memory addresses, given a list of areas.
+///
+/// Areas may overlap, in which case an address is owned by the first area (in
+/// the order given to the constructor) that contains it. The index is built in
+/// O(n log n), and each lookup is O(log n).
+///
+class MemoryAreaOwnerIndex {
+  /// Disjoint (inclusive) address ranges, and the index of their owner.
+  IntervalMapVector<uint64_t, std::size_t> Owners;
+
+  /// Start addresses of empty areas, and the index of the first such area.
+  std::map<uint64_t, std::size_t> EmptyAreas;
+
+public:
+  /// \brief Build the index for a list of areas.
+  ///
+  MemoryAreaOwnerIndex(std::vector<MemoryArea> const &Areas)
+  : Owners(),
+    EmptyAreas()
+  {
+    // Sweep over the start and end of every area, tracking the areas that
+    // contain the current address. Each range between consecutive boundaries
+    // is owned by the first of those areas.
+    struct Boundary {
+      uint64_t Address;
+      bool IsStart;
+      std::size_t Area;
+    };
+
+    std::vector<Boundary> Boundaries;
+    Boundaries.reserve(Areas.size() * 2);
+
+    for (std::size_t i = 0; i < Areas.size(); ++i) {
+      auto const &Area = Areas[i];
+
+      if (Area.length() == 0) {
+        EmptyAreas.insert(std::make_pair(Area.start(), i));
+        continue;
+      }
+
+      Boundaries.push_back(Boundary{Area.start(), true, i});
+      Boundaries.push_back(Boundary{Area.end(), false, i});
+    }
+
+    std::sort(Boundaries.begin(), Boundaries.end(),
+              [] (Boundary const &L, Boundary const &R) {
+                return L.Address < R.Address;
+              });
+
+    std::set<std::size_t> Active;
+
+    for (auto It = Boundaries.begin(), End = Boundaries.end(); It != End; ) {
+      auto const Address = It->Address;
+
+      for (; It != End && It->Address == Address; ++It) {
+        if (It->IsStart)
+          Active.insert(It->Area);
+        else
+          Active.erase(It->Area);
+      }
+
+      if (Active.empty() || It == End)
+        continue;
+
+      auto const Owner = *Active.begin();
+      auto const Last = It->Address - 1;
+
+      // Extend the previous range if it is adjacent and has the same owner.
+      if (!Owners.empty()) {
+        auto &Previous = *Owners.rbegin();
+        if (Previous.Value == Owner && Previous.End + 1 == Address) {
+          Previous.End = Last;
+          continue;
+        }
+      }
+
+      Owners.insert(Address, Last, Owner);
+    }
+  }
+
+  /// \brief Find the first area that contains \c Address.
+  ///
+  Maybe<std::size_t> findContaining(uint64_t const Address) const {
+    auto const It = Owners.find(Address);
+    if (It == Owners.end())
+      return Maybe<std::size_t>();
+    return It->Value;
+  }
+
+  /// \brief Find the first area that contains \c Address, or is empty and
+  ///        starts at \c Address.
+  ///
+  Maybe<std::size_t> findContainingOrAt(uint64_t const Address) const {
+    auto Owner = findContaining(Address);
+
+    auto const EmptyIt = EmptyAreas.find(Address);
+    if (EmptyIt != EmptyAreas.end()
+        && (!Owner.assigned() || EmptyIt->second < Owner.get<std::size_t>()))
+      return EmptyIt->second;
+
+    return Owner;
+  }
+};
+
+
+} // namespace seec
+
+#endif // SEEC_DSA_MEMORYAREAOWNERINDEX_HPP
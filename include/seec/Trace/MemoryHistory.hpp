@@ -0,0 +1,125 @@
+//===- include/seec/Trace/MemoryHistory.hpp ------------------------- C++ -===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Rebuilds the state of memory from the trace, so that the saved state of
+/// MemoryAllocation objects can be discarded (see
+/// MemoryState::setHistoryLimit()).
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef SEEC_TRACE_MEMORYHISTORY_HPP
+#define SEEC_TRACE_MEMORYHISTORY_HPP
+
+#include "seec/DSA/Interval.hpp"
+#include "seec/DSA/MemoryArea.hpp"
+#include "seec/Trace/MemoryState.hpp"
+#include "seec/Trace/TraceReader.hpp"
+
+#include "llvm/ADT/ArrayRef.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace seec {
+
+namespace trace {
+
+
+/// \brief Rebuilds the value and initialization of memory areas by searching
+///        backwards through the trace.
+///
+/// Every change to shared memory is recorded in the trace with a unique
+/// process time, so the state of an area at a given process time is
+/// determined by the most recent events that changed each of its \c chars.
+///
+class MemoryHistoryRebuilder {
+public:
+  /// \brief Records the position of an event in a thread's trace, and
+  ///        summarizes the memory changed by the events that follow it (up
+  ///        to the next entry).
+  ///
+  struct TimeIndexEntry {
+    /// The process time of the event.
+    uint64_t ProcessTime;
+
+    /// The event.
+    EventReference Event;
+
+    /// Covers all areas that are changed or created by the events that
+    /// follow \c Event, up to the next entry's event. This holds at most
+    /// \c MaxTouchedAreas intervals, so it may also cover unchanged areas.
+    std::vector<Interval<stateptr_ty>> Touched;
+
+    TimeIndexEntry(uint64_t const WithProcessTime,
+                   EventReference WithEvent)
+    : ProcessTime(WithProcessTime),
+      Event(WithEvent),
+      Touched()
+    {}
+
+    /// \brief Add an area to \c Touched.
+    ///
+    void addTouched(stateptr_ty const Address, std::size_t const Length);
+
+    /// \brief Check if the events in this entry could change an area.
+    ///
+    bool mayTouch(MemoryArea const &Area) const;
+  };
+
+private:
+  /// The trace that memory is rebuilt from.
+  ProcessTrace const &Trace;
+
+  /// The state of memory before any events occurred (i.e. the initial state
+  /// of global variables).
+  MemoryState const InitialMemory;
+
+  /// For each thread, a sample of its events in order of process time, which
+  /// is used to find where searches should start, and to skip the events
+  /// that could not have changed the area being rebuilt. Each thread's index
+  /// is created the first time that the thread is searched.
+  std::vector<std::vector<TimeIndexEntry>> TimeIndex;
+
+  /// Indicates which threads have had their index created.
+  std::vector<bool> TimeIndexCreated;
+
+  /// \brief Get the index for a thread, creating it if necessary.
+  ///
+  std::vector<TimeIndexEntry> const &getTimeIndex(ThreadTrace const &Thread);
+
+public:
+  /// \brief Constructor.
+  /// \param ForTrace the trace that memory will be rebuilt from.
+  /// \param WithInitialMemory the state of memory before any events occurred.
+  ///
+  MemoryHistoryRebuilder(ProcessTrace const &ForTrace,
+                         MemoryState WithInitialMemory);
+
+  /// \brief Get the value and initialization of an area immediately before
+  ///        the given process time.
+  /// Chars whose most recent change was a copy are rebuilt from the copy's
+  /// source, iteratively, so long chains of copies do not exhaust the stack.
+  /// \param Area the area to rebuild.
+  /// \param ProcessTime only events prior to this process time are applied.
+  /// \param Data receives the value of each \c char in the area.
+  /// \param Init receives the initialization of each \c char in the area.
+  ///
+  void getAreaBefore(MemoryArea const &Area,
+                     uint64_t const ProcessTime,
+                     llvm::MutableArrayRef<char> Data,
+                     llvm::MutableArrayRef<unsigned char> Init);
+};
+
+
+} // namespace trace (in seec)
+
+} // namespace seec
+
+#endif // SEEC_TRACE_MEMORYHISTORY_HPP
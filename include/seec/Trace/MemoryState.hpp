@@ -20,9 +20,9 @@
 
 #include "llvm/ADT/ArrayRef.h"
 
-#include <stack>
+#include <deque>
+#include <memory>
 #include <thread>
-#include <map>
 #include <vector>
 
 namespace llvm {
@@ -43,12 +43,21 @@ class MemoryAllocation {
   /// The size of this allocation (in \c char units).
   std::size_t Size;
 
-  /// The value of each \c char in this allocation.
-  std::vector<char> Data;
+  /// \brief The value and initialization of each \c char in an allocation.
+  ///
+  struct Contents {
+    /// The value of each \c char in the allocation.
+    std::vector<char> Data;
+
+    /// The initialization of each \c char in the allocation (truth indicates
+    /// initialization, i.e. a 1 bit is initialized and a 0 is uninitialized).
+    std::vector<unsigned char> Init;
 
-  /// The initialization of each \c char in this allocation (truth indicates
-  /// initialization, i.e. a 1 bit is initialized and a 0 is uninitialized).
-  std::vector<unsigned char> Init;
+    explicit Contents(std::size_t const Size)
+    : Data(Size),
+      Init(Size)
+    {}
+  };
 
   /// Determines the initialization of a "saved" area (overwritten or cleared).
   enum class EPreviousAreaType : uint8_t {
@@ -57,24 +66,57 @@ class MemoryAllocation {
     Complete
   };
 
-  /// Determines the initialization of all "saved" areas, in order from oldest
-  /// to most recent (i.e. the most recent is at the end of the vector).
-  std::vector<EPreviousAreaType> PreviousType;
+  /// \brief The "saved" areas of an allocation, used to rewind it.
+  ///
+  struct History {
+    /// Determines the initialization of all "saved" areas, in order from
+    /// oldest to most recent (i.e. the most recent is at the end of the
+    /// vector).
+    std::vector<EPreviousAreaType> PreviousType;
+
+    /// Holds the value of "saved" areas, in order from oldest to most recent.
+    /// For example, if the most recently saved area was 4 chars, then the
+    /// final 4 chars of this vector will hold the saved chars (if the type is
+    /// either \c EPreviousAreaType::Partial or \c EPreviousAreaType::Complete.
+    std::vector<char> PreviousData;
+
+    /// Holds the initialization of "saved" areas, in order from oldest to
+    /// most recent. For example, if the most recently saved area was 4 chars,
+    /// then the final 4 chars of this vector will hold its initialization (if
+    /// the type is \c EPreviousAreaType::Partial.
+    std::vector<unsigned char> PreviousInit;
+
+    /// Holds the length of all "saved" areas, in order from oldest to most
+    /// recent. This is used to discard the oldest areas.
+    std::vector<std::size_t> PreviousLength;
+
+    /// The number of "saved" areas that were discarded, which preceded the
+    /// oldest area that is still held.
+    std::size_t Discarded = 0;
+
+    /// \brief Get the number of \c chars used to hold the "saved" areas.
+    ///
+    std::size_t getSavedSize() const {
+      return PreviousData.size() + PreviousInit.size();
+    }
+  };
 
-  /// Holds the value of "saved" areas, in order from oldest to most recent.
-  /// For example, if the most recently saved area was 4 chars, then the final
-  /// 4 chars of this vector will hold the saved chars (if the type is either
-  /// \c EPreviousAreaType::Partial or \c EPreviousAreaType::Complete.
-  std::vector<char> PreviousData;
+  /// The current contents of this allocation. This may be shared with copies
+  /// of this allocation, in which case it is duplicated before modification.
+  std::shared_ptr<Contents> Current;
 
-  /// Holds the initialization of "saved" areas, in order from oldest to most
-  /// recent. For example, if the most recently saved area was 4 chars, then
-  /// the final 4 chars of this vector will hold its initialization (if the
-  /// type is \c EPreviousAreaType::Partial.
-  std::vector<unsigned char> PreviousInit;
+  /// The saved areas of this allocation (nullptr if none have been saved).
+  /// This may be shared with copies of this allocation, in which case it is
+  /// duplicated before modification.
+  std::shared_ptr<History> Previous;
 
-  MemoryAllocation(MemoryAllocation const &) = delete;
-  MemoryAllocation &operator=(MemoryAllocation const &) = delete;
+  /// \brief Get the current contents for modification.
+  ///
+  Contents &modifyContents();
+
+  /// \brief Get the saved areas for modification.
+  ///
+  History &modifyHistory();
 
 public:
   /// \brief Construct a new \c MemoryAllocation.
@@ -83,13 +125,20 @@ public:
                             std::size_t const WithSize)
   : Address(WithAddress),
     Size(WithSize),
-    Data(Size),
-    Init(Size),
-    PreviousType(),
-    PreviousData(),
-    PreviousInit()
+    Current(std::make_shared<Contents>(Size)),
+    Previous()
   {}
 
+  /// \brief Copy a \c MemoryAllocation.
+  /// The copy shares its contents with the original, until either of them is
+  /// modified, so copying is cheap regardless of the allocation's size. The
+  /// first modification of shared contents duplicates all of them (and the
+  /// saved areas, if the modification saves an area), however small the
+  /// modified area is.
+  ///
+  MemoryAllocation(MemoryAllocation const &) = default;
+  MemoryAllocation &operator=(MemoryAllocation const &) = default;
+
   MemoryAllocation(MemoryAllocation &&Other) = default;
   MemoryAllocation &operator=(MemoryAllocation &&RHS) = default;
 
@@ -145,8 +194,48 @@ public:
 
   /// \brief Rewind the given memory area, restoring its value and
   ///        initialization from the most recently saved state.
+  /// \return true if the area was restored, or false if its saved state was
+  ///         discarded by \c discardHistory(). In the latter case the area is
+  ///         not modified, and it must be restored using \c restoreArea().
+  ///
+  bool rewindArea(MemoryArea const &Area);
+
+  /// \brief Set the raw values and initialization of the memory starting at
+  ///        the given address, without saving the current state. This is
+  ///        used to restore an area whose saved state was discarded.
+  ///
+  void restoreArea(stateptr_ty const AtAddress,
+                   llvm::ArrayRef<char> WithData,
+                   llvm::ArrayRef<unsigned char> WithInitialization);
+
+  /// \brief Discard the oldest saved states, if they use more than \c Limit
+  ///        chars. Enough states are discarded to leave half of the limit
+  ///        free, so that the cost of discarding is amortized over many
+  ///        subsequent saves.
+  ///
+  void discardHistory(std::size_t const Limit);
+
+  /// \brief Discard the contents and all saved states of this allocation.
+  /// This is used to release the memory held by deallocated allocations. If
+  /// the allocation is restored, it must call \c resetDiscardedContents(),
+  /// and the caller must restore its contents using \c restoreArea().
+  ///
+  void discardContents();
+
+  /// \brief Check if \c discardContents() was called.
+  ///
+  bool hasDiscardedContents() const { return !Current; }
+
+  /// \brief Give this allocation new (uninitialized) contents, after they
+  ///        were discarded by \c discardContents(). Rewinding any area will
+  ///        fail until the area has been saved again.
   ///
-  void rewindArea(MemoryArea const &Area);
+  void resetDiscardedContents();
+
+  /// \brief Get the number of \c chars used to hold this allocation's
+  ///        contents and saved states.
+  ///
+  std::size_t getRetainedSize() const;
 
   /// \brief Change the size of this allocation.
   ///        If the \c NewSize is larger than the current size, the added chars
@@ -234,31 +323,101 @@ public:
 /// memory allocation (e.g. an alloca or a dynamically allocated area).
 ///
 class MemoryState {
-  /// Map allocation start addresses to the allocations themselves.
-  std::map<stateptr_ty, MemoryAllocation> Allocations;
+  /// Start addresses of the current allocations, in ascending order. These are
+  /// held apart from the allocations, so that searches only touch a compact
+  /// array of addresses.
+  std::vector<stateptr_ty> AllocationStarts;
+
+  /// The current allocations, in the same order as \c AllocationStarts.
+  std::vector<MemoryAllocation> Allocations;
+
+  /// Historical allocations (that were deallocated), in order from oldest to
+  /// most recent.
+  std::deque<MemoryAllocation> PreviousAllocations;
+
+  /// The number of \c PreviousAllocations (the oldest) whose contents were
+  /// discarded because they exceeded the history limit.
+  std::size_t PreviousAllocationsDiscarded;
+
+  /// The number of \c chars held by \c PreviousAllocations whose contents
+  /// were not discarded.
+  std::size_t PreviousAllocationsSize;
 
-  /// Historical allocations (that were deallocated).
-  std::stack<MemoryAllocation> PreviousAllocations;
+  /// Maximum number of \c chars of saved state to hold for each allocation
+  /// (zero for no limit).
+  std::size_t HistoryLimit;
 
-  // Don't allow copying
-  MemoryState(MemoryState const &) = delete;
-  MemoryState &operator=(MemoryState const &) = delete;
+  /// Areas that have been modified since the changes were last taken (see
+  /// \c takeChangedAreas()).
+  std::vector<MemoryArea> ChangedAreas;
+
+  /// Whether or not modified areas are recorded in \c ChangedAreas.
+  bool TrackChanges;
+
+  /// Set when too many areas were modified to record them all.
+  bool ChangesOverflowed;
+
+  /// \brief Discard the contents of the oldest \c PreviousAllocations, if
+  ///        they hold more than the history limit.
+  ///
+  void discardPreviousAllocations();
+
+  /// \brief Record that an area has been modified, if changes are tracked.
+  ///
+  void recordChange(stateptr_ty const Address, std::size_t const Size);
+
+  /// \brief Find the position of the allocation that starts at or most
+  ///        closely precedes the given address.
+  /// \return the position, or \c Allocations.size() if all allocations start
+  ///         after \c Address.
+  ///
+  std::size_t findPreceding(stateptr_ty const Address) const;
+
+  /// \brief Find the position of the allocation that contains the given
+  ///        \c MemoryArea.
+  /// \return the position, or \c Allocations.size() if no allocation
+  ///         contains \c Area.
+  ///
+  std::size_t findContaining(MemoryArea const &Area) const;
 
 public:
   /// \brief Construct an empty MemoryState.
   ///
   MemoryState()
-  : Allocations(),
-    PreviousAllocations()
+  : AllocationStarts(),
+    Allocations(),
+    PreviousAllocations(),
+    PreviousAllocationsDiscarded(0),
+    PreviousAllocationsSize(0),
+    HistoryLimit(0),
+    ChangedAreas(),
+    TrackChanges(false),
+    ChangesOverflowed(false)
   {}
 
+  /// \brief Copy a MemoryState.
+  /// The copy shares the contents of each allocation with the original, until
+  /// the allocation is modified in one of them. A copy can be taken as a
+  /// snapshot, and will only cost memory for the allocations that are
+  /// subsequently modified (each of which is duplicated in full).
+  /// Nothing copies a MemoryState yet: forking a whole ProcessState also
+  /// requires copying the thread and function states.
+  ///
+  MemoryState(MemoryState const &) = default;
+  MemoryState &operator=(MemoryState const &) = default;
+
+  MemoryState(MemoryState &&) = default;
+  MemoryState &operator=(MemoryState &&) = default;
+
 
   /// \name Accessors
   /// @{
 
-  /// \brief Get the map of current allocations.
+  /// \brief Get the current allocations, in order of their start address.
   ///
-  decltype(Allocations) const &getAllocations() const { return Allocations; }
+  llvm::ArrayRef<MemoryAllocation> getAllocations() const {
+    return Allocations;
+  }
 
   /// \brief Get the \c MemoryAllocation that contains the given \c MemoryArea.
   ///        This method will assert if no such allocation exists.
@@ -275,12 +434,44 @@ public:
   ///
   MemoryAllocation const *findAllocation(stateptr_ty const ForAddress) const;
 
+  /// \brief Get the maximum size of each allocation's saved state.
+  ///
+  std::size_t getHistoryLimit() const { return HistoryLimit; }
+
   /// @} (Accessors)
 
 
   /// \name Mutators
   /// @{
 
+  /// \brief Limit the size of the saved state held by each allocation.
+  /// When an allocation's saved state exceeds \c Limit chars, the oldest
+  /// saved areas are discarded. Rewinding one of those areas will then fail,
+  /// and the caller must restore the area from the trace. Similarly, when
+  /// deallocated allocations hold more than \c Limit chars in total, the
+  /// contents of the oldest are discarded, and restoring one of them will
+  /// fail (see \c allocationUnremove()). A \c Limit of zero (the default)
+  /// holds all saved state.
+  ///
+  /// The limit applies to each current allocation separately, so the total
+  /// saved state can still grow to \c Limit chars for every current
+  /// allocation (plus \c Limit chars for all deallocated allocations).
+  ///
+  void setHistoryLimit(std::size_t const Limit);
+
+  /// \brief Enable or disable recording of the areas modified by mutators.
+  ///
+  void setChangeTracking(bool const Enable);
+
+  /// \brief Take the areas modified since the previous call.
+  /// Modifications to allocations (adding, removing, and resizing) report the
+  /// entire area of the allocation.
+  /// \param Areas receives the modified areas (which may overlap).
+  /// \return false if too many areas were modified to record them, in which
+  ///         case \c Areas is not updated and any area may have changed.
+  ///
+  bool takeChangedAreas(std::vector<MemoryArea> &Areas);
+
   /// \brief Add a new allocation (moving forward).
   ///
   void allocationAdd(stateptr_ty const Address, std::size_t const Size);
@@ -296,16 +487,23 @@ public:
                         std::size_t const NewSize);
 
   /// \brief Unremove an allocation (moving backward).
+  /// \return false iff the contents of the allocation were discarded (see
+  ///         \c setHistoryLimit()), in which case the caller must restore
+  ///         them using \c restoreArea().
   ///
-  void allocationUnremove(stateptr_ty const Address, std::size_t const Size);
+  bool allocationUnremove(stateptr_ty const Address, std::size_t const Size);
 
   /// \brief Unadd an allocation (moving backward).
   ///
   void allocationUnadd(stateptr_ty const Address, std::size_t const Size);
 
   /// \brief Resize an allocation (moving backward).
+  /// \return false iff the saved state of the restored area was discarded
+  ///         (see \c setHistoryLimit()). The restored area is the area that
+  ///         the allocation originally lost (which is the whole allocation
+  ///         if it was removed).
   ///
-  void allocationUnresize(stateptr_ty const Address,
+  bool allocationUnresize(stateptr_ty const Address,
                           std::size_t const CurrentSize,
                           std::size_t const NewSize);
 
@@ -317,8 +515,10 @@ public:
 
   /// \brief Remove the current state from the given \c MemoryArea, rewinding
   ///        its values and initialization to the previous state.
+  /// \return false iff the previous state was discarded (see
+  ///         \c setHistoryLimit()).
   ///
-  void removeBlock(MemoryArea Area);
+  bool removeBlock(MemoryArea Area);
 
   /// \brief Copy the value and initialization of memory beginning at \c Source
   ///        to the memory beginning at \c Destination. \c Size \c char units
@@ -331,8 +531,10 @@ public:
   /// \brief Rewind a previous copy from \c Source to \c Destination. The value
   ///        and initialization of memory at \c Destination will be rewound to
   ///        its state prior to the copy.
+  /// \return false iff the previous state was discarded (see
+  ///         \c setHistoryLimit()).
   ///
-  void removeCopy(stateptr_ty const Source,
+  bool removeCopy(stateptr_ty const Source,
                   stateptr_ty const Destination,
                   std::size_t const Size);
 
@@ -342,8 +544,18 @@ public:
 
   /// \brief Rewind a clear to the given \c MemoryArea, restoring its
   ///        initialization to its state prior to the clear.
+  /// \return false iff the previous state was discarded (see
+  ///         \c setHistoryLimit()).
+  ///
+  bool removeClear(MemoryArea Area);
+
+  /// \brief Set the value and initialization of the given \c MemoryArea,
+  ///        without saving its current state. This is used to restore an
+  ///        area when rewinding failed because its saved state was discarded.
   ///
-  void removeClear(MemoryArea Area);
+  void restoreArea(MemoryArea Area,
+                   llvm::ArrayRef<char> WithData,
+                   llvm::ArrayRef<unsigned char> WithInitialization);
 
   /// @} (Mutators)
 
@@ -30,6 +30,7 @@
 #include <map>
 #include <memory>
 #include <thread>
+#include <vector>
 
 namespace llvm {
   class raw_ostream; // Forward-declaration for operator<<.
@@ -41,6 +42,7 @@ class ModuleIndex;
 
 namespace trace {
 
+class MemoryHistoryRebuilder;
 class ProcessTrace;
 
 namespace value_store {
@@ -110,6 +112,7 @@ public:
 ///
 class ProcessState {
   friend class ThreadState; // Allow child threads to update the shared state.
+  friend class ThreadedStateMovementHelper; // Allow out-of-order movement.
 
   /// \name Constants
   /// @{
@@ -126,6 +129,13 @@ class ProcessState {
   /// DataLayout for the llvm::Module that this trace was created from.
   llvm::DataLayout DL;
 
+  /// Areas occupied by global variables, in order of their start address.
+  std::vector<MemoryArea> GlobalAreas;
+
+  /// For each position in \c GlobalAreas, the greatest end address of the
+  /// areas up to and including that position.
+  std::vector<stateptr_ty> GlobalAreasReach;
+
   /// @} (Constants.)
 
 
@@ -147,6 +157,9 @@ private:
 
   /// Current state of memory.
   MemoryState Memory;
+
+  /// Rebuilds discarded memory history (if the history is limited).
+  std::unique_ptr<MemoryHistoryRebuilder> MemoryRebuilder;
   
   /// Known, but unowned, regions of memory.
   IntervalMapVector<stateptr_ty, MemoryPermission> KnownMemory;
@@ -259,6 +272,24 @@ public:
   /// \brief Get the memory state.
   ///
   decltype(Memory) const &getMemory() const { return Memory; }
+
+  /// \brief Limit the memory used to rewind each allocation.
+  /// The rewind history of each allocation is limited to \c Limit chars (see
+  /// \c MemoryState::setHistoryLimit()). Discarded history is rebuilt from
+  /// the trace when it is required, by searching backwards through the
+  /// events of all threads. A \c Limit of zero removes the limit. This does
+  /// not bound the total history, which may hold \c Limit chars for each
+  /// current allocation.
+  ///
+  void setMemoryHistoryLimit(std::size_t const Limit);
+
+  /// \brief Restore an area whose rewind history was discarded.
+  /// \param Area the area to restore.
+  /// \param BeforeProcessTime the area is restored to its state immediately
+  ///        prior to this process time.
+  ///
+  void rebuildMemoryArea(MemoryArea const &Area,
+                         uint64_t const BeforeProcessTime);
   
   /// \brief Add a region of known memory.
   ///
@@ -279,6 +310,12 @@ public:
   ///
   decltype(KnownMemory) const &getKnownMemory() const { return KnownMemory; }
   
+  /// \brief Find the area of the global variable that contains an address.
+  /// \return the area, or \c nullptr if no global variable contains the
+  ///         address.
+  ///
+  MemoryArea const *findGlobalVariableArea(stateptr_ty const Address) const;
+
   /// \brief Check if an address is contained in a global variable.
   ///
   bool isContainedByGlobalVariable(stateptr_ty const Address) const;
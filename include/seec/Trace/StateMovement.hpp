@@ -65,6 +65,20 @@ MovementResult moveForwardUntil(ProcessState &State, ProcessPredTy Predicate);
 ///
 MovementResult moveBackwardUntil(ProcessState &State, ProcessPredTy Predicate);
 
+/// \brief Move State forward to the end of the trace.
+///
+/// Threads do not wait for each other to move over shared events that use
+/// different memory allocations, so this scales with the number of threads
+/// when their accesses to memory are independent.
+///
+MovementResult moveForwardToEnd(ProcessState &State);
+
+/// \brief Move State backward to the start of the trace.
+///
+/// As with moveForwardToEnd(), independent shared events are not ordered.
+///
+MovementResult moveBackwardToStart(ProcessState &State);
+
 /// \brief Move State forward to the next process time.
 ///
 MovementResult moveForward(ProcessState &State);
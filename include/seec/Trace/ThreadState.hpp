@@ -154,6 +154,22 @@ private:
   void setPreviousViewOfProcessTime(EventReference PriorTo);
   void setPreviousViewOfProcessTime(EventRecordBase const &PriorTo);
 
+  /// \brief Restore a deallocated area to the memory state (moving
+  ///        backward), rebuilding its contents from the trace if they were
+  ///        discarded (see \c MemoryState::setHistoryLimit()).
+  /// \param BeforeProcessTime the contents are rebuilt as they were
+  ///        immediately prior to this process time.
+  ///
+  void unremoveAllocation(stateptr_ty const Address,
+                          std::size_t const Size,
+                          uint64_t const BeforeProcessTime);
+
+  /// \brief Restore a deallocated local area (an alloca, byval or known
+  ///        region) to the memory state (moving backward), rebuilding its
+  ///        contents as of the process state's current process time.
+  ///
+  void unremoveAllocation(stateptr_ty const Address, std::size_t const Size);
+
   void removeEvent(EventRecord<EventType::None> const &);
   void removeEvent(EventRecord<EventType::TraceEnd> const &);
   void removeEvent(EventRecord<EventType::FunctionStart> const &);
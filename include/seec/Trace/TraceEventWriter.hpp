@@ -38,6 +38,9 @@ class EventWriter {
   
   /// Offset of the last-written event for each EventType.
   offset_uint PreviousOffsets[static_cast<std::size_t>(EventType::Highest)];
+
+  /// Number of events written (not including rewrites).
+  uint64_t EventCount;
   
   // Don't allow copying.
   EventWriter(EventWriter const &) = delete;
@@ -66,7 +69,8 @@ public:
   EventWriter()
   : Out(),
     PreviousEventSize(0),
-    PreviousOffsets()
+    PreviousOffsets(),
+    EventCount(0)
   {
     constexpr auto NumEventTypes = static_cast<std::size_t>(EventType::Highest);
     for (std::size_t i = 0; i < NumEventTypes; ++i) {
@@ -86,6 +90,9 @@ public:
     assert(Type != EventType::Highest);
     return PreviousOffsets[static_cast<std::size_t>(Type)];
   }
+
+  /// \brief Get the number of events written.
+  uint64_t getEventCount() const { return EventCount; }
   
   /// @} (Accessors)
   
@@ -153,6 +160,7 @@ public:
         PreviousEventSize = sizeof(Record);
         PreviousOffsets[static_cast<std::size_t>(ET)] =
           WriteRecord->getOffset();
+        ++EventCount;
       }
     }
     
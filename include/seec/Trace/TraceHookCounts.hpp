@@ -0,0 +1,114 @@
+//===- include/seec/Trace/TraceHookCounts.hpp ----------------------- C++ -===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Counts of the notifications received by TraceThreadListener, which show
+/// where the tracing runtime spends its time.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef SEEC_TRACE_TRACEHOOKCOUNTS_HPP
+#define SEEC_TRACE_TRACEHOOKCOUNTS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace seec {
+
+namespace trace {
+
+
+/// \brief Enumerates the notifications counted by TraceThreadListener.
+///
+enum class TraceHook : uint8_t {
+#define SEEC_TRACE_HOOK(NAME) NAME,
+#include "seec/Trace/TraceHooks.def"
+  Highest
+};
+
+
+/// \brief Get the name of a TraceHook.
+///
+inline char const *getTraceHookName(TraceHook const Hook) {
+  switch (Hook) {
+#define SEEC_TRACE_HOOK(NAME)                                                  \
+    case TraceHook::NAME: return #NAME;
+#include "seec/Trace/TraceHooks.def"
+    case TraceHook::Highest: break;
+  }
+
+  return "<unknown>";
+}
+
+
+/// \brief Counts notifications and the events that they wrote.
+///
+/// Each TraceThreadListener keeps its own counts, so no synchronization is
+/// required to update them.
+///
+class TraceHookCounts {
+public:
+  /// The number of distinct TraceHook values.
+  static constexpr std::size_t NumHooks =
+    static_cast<std::size_t>(TraceHook::Highest);
+
+private:
+  /// Number of notifications received for each TraceHook.
+  uint64_t Hooks[NumHooks];
+
+  /// Number of events written.
+  uint64_t Events;
+
+public:
+  /// \brief Construct with all counts zero.
+  ///
+  TraceHookCounts()
+  : Hooks(),
+    Events(0)
+  {}
+
+  /// \brief Count one notification.
+  ///
+  void count(TraceHook const Hook) {
+    ++Hooks[static_cast<std::size_t>(Hook)];
+  }
+
+  /// \brief Count written events.
+  ///
+  void addEvents(uint64_t const Count) {
+    Events += Count;
+  }
+
+  /// \brief Add all of the counts from another TraceHookCounts.
+  ///
+  void add(TraceHookCounts const &Other) {
+    for (std::size_t i = 0; i < NumHooks; ++i)
+      Hooks[i] += Other.Hooks[i];
+
+    Events += Other.Events;
+  }
+
+  /// \brief Get the number of notifications received for a TraceHook.
+  ///
+  uint64_t get(TraceHook const Hook) const {
+    return Hooks[static_cast<std::size_t>(Hook)];
+  }
+
+  /// \brief Get the number of events written.
+  ///
+  uint64_t getEvents() const { return Events; }
+};
+
+
+} // namespace trace (in seec)
+
+} // namespace seec
+
+#endif // SEEC_TRACE_TRACEHOOKCOUNTS_HPP
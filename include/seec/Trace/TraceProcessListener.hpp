@@ -18,6 +18,7 @@
 #include "seec/DSA/MemoryArea.hpp"
 #include "seec/Trace/DetectCallsLookup.hpp"
 #include "seec/Trace/TraceFormat.hpp"
+#include "seec/Trace/TraceHookCounts.hpp"
 #include "seec/Trace/TraceMemory.hpp"
 #include "seec/Trace/TracePointer.hpp"
 #include "seec/Trace/TraceStorage.hpp"
@@ -182,6 +183,12 @@ class TraceProcessListener {
   
   /// Number of active threads.
   std::atomic<int> ActiveThreadCount;
+
+  /// Combined notification counts of all finished threads.
+  TraceHookCounts FinishedHookCounts;
+
+  /// Controls access to FinishedHookCounts.
+  mutable std::mutex FinishedHookCountsMutex;
   
   
   /// Synchronize setup of the environ table.
@@ -377,6 +384,21 @@ public:
   int countThreadListeners() const {
     return ActiveThreadCount;
   }
+
+  /// \brief Add the notification counts of a finished TraceThreadListener.
+  ///
+  void addHookCounts(TraceHookCounts const &Counts) {
+    std::lock_guard<std::mutex> Lock(FinishedHookCountsMutex);
+    FinishedHookCounts.add(Counts);
+  }
+
+  /// \brief Get the combined notification counts of all finished
+  ///        TraceThreadListener objects.
+  ///
+  TraceHookCounts getHookCounts() const {
+    std::lock_guard<std::mutex> Lock(FinishedHookCountsMutex);
+    return FinishedHookCounts;
+  }
   
   /// @}
 
@@ -358,6 +358,18 @@ public:
 
   EventRecordBase const *operator->() const { return Record; }
 
+  /// Get the block that contains the referenced event record.
+  ThreadEventBlockSequence::ThreadEventBlock const &getBlock() const {
+    return *m_BlockAndState.getPointer();
+  }
+
+  /// Check if this reference is past the final event record of its thread.
+  bool isPastEnd() const {
+    return m_BlockAndState.getInt() == EState::PastEnd;
+  }
+
+  /// @} (Access)
+
 
   /// \name Comparison operators
   /// @{
@@ -21,6 +21,9 @@
 
 #include "llvm/ADT/ArrayRef.h"
 
+#include <array>
+#include <cstdint>
+
 namespace seec {
 
 namespace trace {
@@ -47,6 +50,64 @@ bool typeInList(EventType Type) {
   return typeInList<Tail...>(Type);
 }
 
+/// \brief A set of EventTypes, represented as a bitmap over the type byte.
+///
+class EventTypeSet {
+  /// One bit for each possible value of the type byte.
+  std::array<uint64_t, 4> Bits;
+
+public:
+  /// Construct an empty set.
+  EventTypeSet()
+  : Bits()
+  {}
+
+  /// Add Type to this set.
+  void insert(EventType Type) {
+    auto const Value = static_cast<uint8_t>(Type);
+    Bits[Value / 64] |= uint64_t(1) << (Value % 64);
+  }
+
+  /// Check if Type is in this set.
+  bool contains(EventType Type) const {
+    auto const Value = static_cast<uint8_t>(Type);
+    return (Bits[Value / 64] >> (Value % 64)) & 1;
+  }
+};
+
+/// Create an EventTypeSet containing a static list of EventTypes.
+template<EventType... Types>
+EventTypeSet makeEventTypeSet() {
+  EventTypeSet Set;
+  int Expand[] = {0, (Set.insert(Types), 0)...};
+  (void)Expand;
+  return Set;
+}
+
+/// \brief Find the first event record of a type in Types in a contiguous
+///        sequence of event records.
+///
+/// Runs of consecutive records that share a type are skipped in bulk, using
+/// vector compares of their type bytes where the target supports it.
+///
+/// \param First the first record to check.
+/// \param Stop the first byte following the final record to check.
+/// \param Types the EventTypes that will be accepted.
+/// \return the first record in [First, Stop) with type in Types, or Stop if
+///         no such record exists.
+///
+char const *scanForEventTypes(char const *First,
+                              char const *Stop,
+                              EventTypeSet const &Types);
+
+/// Find the first Event in a range that has a type in a set of EventTypes.
+/// \param Range the range of Events to search over.
+/// \param Types the EventTypes that will be accepted.
+/// \return a reference to the first Event in Range with type in Types, or an
+///         unassigned Maybe if no such Event exists.
+seec::Maybe<EventReference> findFirstOf(EventRange Range,
+                                        EventTypeSet const &Types);
+
 /// Find the first Event in a range that matches a set of EventTypes.
 /// \tparam SearchFor the EventTypes that will be accepted.
 /// \param Range the range of Events to search over.
@@ -54,9 +115,21 @@ bool typeInList(EventType Type) {
 ///         nullptr if no such Event exists.
 template<EventType... SearchFor>
 seec::Maybe<EventReference> find(EventRange Range) {
-  for (auto &&Ev : Range) {
-    if (typeInList<SearchFor...>(Ev.getType())) {
-      return seec::Maybe<EventReference>(Ev);
+  return findFirstOf(Range, makeEventTypeSet<SearchFor...>());
+}
+
+/// Find the first Event in a range that matches a set of EventTypes, checking
+/// each Event in turn. This gives the same result as find(), and is retained
+/// for verifying and benchmarking it.
+/// \tparam SearchFor the EventTypes that will be accepted.
+/// \param Range the range of Events to search over.
+/// \return a pointer to the first Event in Range with type in SearchFor, or
+///         nullptr if no such Event exists.
+template<EventType... SearchFor>
+seec::Maybe<EventReference> findLinear(EventRange Range) {
+  for (auto It = Range.begin(); It != Range.end(); ++It) {
+    if (typeInList<SearchFor...>(It->getType())) {
+      return seec::Maybe<EventReference>(It);
     }
   }
 
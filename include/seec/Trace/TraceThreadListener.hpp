@@ -20,6 +20,7 @@
 #include "seec/Trace/TracedFunction.hpp"
 #include "seec/Trace/TraceEventWriter.hpp"
 #include "seec/Trace/TraceFormat.hpp"
+#include "seec/Trace/TraceHookCounts.hpp"
 #include "seec/Trace/TraceProcessListener.hpp"
 #include "seec/Trace/TraceStorage.hpp"
 #include "seec/Util/Maybe.hpp"
@@ -132,6 +133,9 @@ class TraceThreadListener
   /// DIR pointers lock owned by this thread.
   std::unique_lock<std::mutex> DirsLock;
 
+  /// Counts of the notifications received by this thread.
+  TraceHookCounts HookCounts;
+
 
   /// \name Current instruction information.
   /// @{
@@ -422,6 +426,10 @@ public:
   ///
   EventWriter &getEventsOut() { return EventsOut; }
 
+  /// \brief Get the counts of notifications received by this thread.
+  ///
+  TraceHookCounts const &getHookCounts() const { return HookCounts; }
+
   /// \brief Get the \c llvm::DataLayout for the \c llvm::Module.
   ///
   llvm::DataLayout const &getDataLayout() const {
@@ -0,0 +1,134 @@
+//===- include/seec/Util/TaskScheduler.hpp -------------------------- C++ -===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// A fixed-size pool of worker threads that run chunks of indexed tasks.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef SEEC_UTIL_TASKSCHEDULER_HPP
+#define SEEC_UTIL_TASKSCHEDULER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace seec {
+
+
+/// \brief Runs tasks on a fixed number of worker threads.
+///
+/// Each call to \c parallelFor() splits its tasks into chunks, which are
+/// distributed between the workers' queues. A worker takes chunks from the
+/// back of its own queue and, when that is empty, steals from the front of
+/// other workers' queues. The thread that called \c parallelFor() also runs
+/// chunks while it waits, so tasks may themselves call \c parallelFor().
+///
+class TaskScheduler {
+  struct Group;
+
+  /// \brief A contiguous range of a group's tasks.
+  ///
+  struct Chunk {
+    Group *ForGroup;
+
+    std::size_t Begin;
+
+    std::size_t End;
+  };
+
+  /// \brief The queue of chunks held by a single worker.
+  ///
+  struct WorkerQueue {
+    std::mutex Access;
+
+    std::deque<Chunk> Chunks;
+  };
+
+  /// The worker threads.
+  std::vector<std::thread> Workers;
+
+  /// The queue for each worker.
+  std::vector<std::unique_ptr<WorkerQueue>> Queues;
+
+  /// Number of chunks in all queues.
+  std::atomic<std::size_t> Queued;
+
+  /// Queue to receive the next submitted chunk.
+  std::atomic<std::size_t> NextQueue;
+
+  /// Control access to \c Stopping and wake idle workers.
+  std::mutex IdleAccess;
+
+  /// Notified when chunks are submitted, or when stopping.
+  std::condition_variable IdleCV;
+
+  /// Set when the scheduler is being destroyed.
+  bool Stopping;
+
+  /// \brief Take a chunk, preferring the back of the given queue.
+  /// \return true iff a chunk was taken.
+  ///
+  bool take(std::size_t Preferred, Chunk &Out);
+
+  /// \brief Run a chunk and notify its group if it was the last.
+  ///
+  void run(Chunk const &C);
+
+  /// \brief The main loop of a worker thread.
+  ///
+  void work(std::size_t Index);
+
+public:
+  /// \brief Create a scheduler with the given number of workers.
+  ///
+  explicit TaskScheduler(unsigned WorkerCount);
+
+  TaskScheduler(TaskScheduler const &) = delete;
+
+  TaskScheduler &operator=(TaskScheduler const &) = delete;
+
+  /// \brief Destructor. Waits for the workers to finish their current chunks.
+  ///
+  ~TaskScheduler();
+
+  /// \brief Get a scheduler shared by the whole process, with one worker for
+  ///        each hardware thread.
+  ///
+  static TaskScheduler &getShared();
+
+  /// \brief Get the number of workers.
+  ///
+  std::size_t getWorkerCount() const { return Workers.size(); }
+
+  /// \brief Run Task(i) for each i in [0, Count), returning when all tasks are
+  ///        complete.
+  ///
+  /// \param ChunkSize the number of tasks in each chunk. If this is zero then
+  ///        a size is chosen to give each worker several chunks.
+  /// \param CancelIfFalse if this is not null, then chunks that have not
+  ///        started are skipped once it becomes false.
+  /// \return true iff every task was run.
+  ///
+  bool parallelFor(std::size_t Count,
+                   std::size_t ChunkSize,
+                   std::function<void (std::size_t)> const &Task,
+                   std::atomic_bool const *CancelIfFalse = nullptr);
+};
+
+
+} // namespace seec
+
+#endif // SEEC_UTIL_TASKSCHEDULER_HPP
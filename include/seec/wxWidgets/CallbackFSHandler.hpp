@@ -25,6 +25,7 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <type_traits>
 #include <vector>
@@ -339,14 +340,39 @@ public:
 /// then the returned file would contain:
 ///   "foo({ success: true, result: <result> })"
 ///
+/// The handler can also serve fixed content, added using setContent(). This
+/// is intended for large generated files, which are served without being
+/// copied or escaped. Content is matched against the whole location (ignoring
+/// any query string), and takes precedence over callbacks.
+///
 class CallbackFSHandler final : public wxFileSystemHandler
 {
+  /// \brief Fixed content served by this handler.
+  ///
+  struct ContentInfo {
+    /// The file contents.
+    std::shared_ptr<std::string const> Data;
+    
+    /// The MIME type of the contents.
+    wxString MimeType;
+  };
+  
   /// The protocol to be server by this handler.
   wxString Protocol;
   
   /// A map from identifiers to callbacks.
   std::map<wxString, std::unique_ptr<seec::callbackfs::CallbackBase>> Callbacks;
   
+  /// A map from paths to fixed content.
+  std::map<wxString, ContentInfo> Contents;
+  
+  /// Control access to Contents.
+  std::mutex ContentsAccess;
+  
+  /// \brief Get the fixed content for a location, if there is any.
+  ///
+  ContentInfo getContent(wxString const &Location);
+  
 public:
   /// \brief Constructor.
   /// \param ForProtocol the protocol that this handler will service.
@@ -372,6 +398,15 @@ public:
                        llvm::make_unique<ImplTy>(std::move(Callback)));
   }
   
+  /// \brief Set fixed content to be served for a path.
+  ///
+  /// The content is shared rather than copied, so it must not be modified
+  /// after it is set. Setting null content removes the path.
+  ///
+  void setContent(wxString const &Path,
+                  std::shared_ptr<std::string const> Data,
+                  wxString const &MimeType);
+  
   /// \brief Check if this handler can open a file location.
   ///
   virtual bool CanOpen(wxString const &Location) override;
@@ -12,14 +12,17 @@
 //===----------------------------------------------------------------------===//
 
 #include "seec/Clang/Compile.hpp"
+#include "seec/Clang/MappedModule.hpp"
 #include "seec/Clang/MDNames.hpp"
 #include "seec/Transforms/BreakConstantGEPs/BreakConstantGEPs.h"
 #include "seec/Util/ModuleIndex.hpp"
+#include "seec/Util/ScopeExit.hpp"
 
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/Decl.h"
 #include "clang/AST/Expr.h"
 #include "clang/AST/Stmt.h"
+#include "clang/Basic/MemoryBufferCache.h"
 #include "clang/Basic/Version.h"
 #include "clang/CodeGen/SeeCMapping.h"
 #include "clang/Driver/Compilation.h"
@@ -29,6 +32,7 @@
 #include "clang/Lex/DirectoryLookup.h"
 #include "clang/Lex/HeaderSearch.h"
 #include "clang/Lex/Preprocessor.h"
+#include "clang/Sema/Sema.h"
 #include "clang/Serialization/ASTWriter.h"
 
 #include "llvm/ADT/SmallString.h"
@@ -47,6 +51,7 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <cstdlib>
 #include <vector>
 
 using namespace clang;
@@ -105,7 +110,48 @@ void SeeCCodeGenAction::ModuleComplete(llvm::Module *Mod) {
   GenerateSerializableMappings(*this, Mod, SM, File);
   
   // Store all used source files into the LLVM Module.
-  StoreCompileInformationInModule(Mod, *Compiler, ArgBegin, ArgEnd);
+  StoreCompileInformationInModule(Mod, *Compiler, ArgBegin, ArgEnd,
+                                  SerializedAST);
+}
+
+void SeeCCodeGenAction::serializeAST() {
+  if (!Compiler || !Compiler->hasSema())
+    return;
+
+  if (Compiler->getDiagnostics().hasErrorOccurred())
+    return;
+
+  // Mark all files as overridden while the AST is written, so that the AST
+  // file contains copies of their contents and does not need to validate them
+  // against the filesystem when it is loaded. The original flags are restored
+  // before CodeGen runs, so it sees the SourceManager unchanged. The buffers
+  // themselves are never changed.
+  auto &SrcManager = Compiler->getSourceManager();
+  std::vector<std::pair<SrcMgr::ContentCache *, bool>> Overridden;
+  for (auto It = SrcManager.fileinfo_begin(), End = SrcManager.fileinfo_end();
+       It != End;
+       ++It) {
+    Overridden.emplace_back(It->second, It->second->BufferOverridden);
+    It->second->BufferOverridden = true;
+  }
+
+  auto const RestoreOverridden = seec::scopeExit([&] () {
+    for (auto const &Entry : Overridden)
+      Entry.first->BufferOverridden = Entry.second;
+  });
+
+  llvm::SmallVector<char, 0> Buffer;
+  llvm::BitstreamWriter Stream(Buffer);
+  ::clang::MemoryBufferCache PCMCache;
+  ::clang::ASTWriter Writer(Stream, Buffer, PCMCache, {},
+                            /* IncludeTimestamps */ false);
+
+  Writer.WriteAST(Compiler->getSema(),
+                  /* OutputFile */ "",
+                  /* WritingModule */ nullptr,
+                  /* isysroot */ "");
+
+  SerializedAST.assign(Buffer.begin(), Buffer.end());
 }
 
 void SeeCEmitAssemblyAction::anchor() {}
@@ -165,6 +211,10 @@ void SeeCASTConsumer::HandleTranslationUnit(ASTContext &Ctx) {
   for (auto const VAType : VATypes)
     TraverseStmt(VAType->getSizeExpr());
 
+  // Serialize the AST before CodeGen, if the user requested it.
+  if (std::getenv("SEEC_EMBED_AST"))
+    Action.serializeAST();
+
   Child->HandleTranslationUnit(Ctx);
 }
 
@@ -794,7 +844,8 @@ Metadata *getMDForCharacteristicKind(LLVMContext &Context,
 void StoreCompileInformationInModule(llvm::Module *Mod,
                                      ::clang::CompilerInstance &Compiler,
                                      const char * const *ArgBegin,
-                                     const char * const *ArgEnd)
+                                     const char * const *ArgEnd,
+                                     llvm::StringRef SerializedAST)
 {
   assert(Mod && "No module?");
   
@@ -893,6 +944,28 @@ void StoreCompileInformationInModule(llvm::Module *Mod,
   auto CompileInfoNode = llvm::MDNode::get(LLVMContext, CompileInfoOperands);
   auto GlobalCompileInfo = Mod->getOrInsertNamedMetadata(MDCompileInfo);
   GlobalCompileInfo->addOperand(CompileInfoNode);
+
+  if (SerializedAST.empty())
+    return;
+
+  // Store the serialized AST, keyed by the hash of the compile info so that
+  // it will not be used with different sources or arguments.
+  auto const MappedInfo = MappedCompileInfo::get(CompileInfoNode);
+  if (!MappedInfo)
+    return;
+
+  auto const ASTStart = reinterpret_cast<uint8_t const *>(SerializedAST.data());
+  llvm::ArrayRef<uint8_t> ASTRef(ASTStart, SerializedAST.size());
+
+  llvm::Metadata *SerializedASTOperands[] = {
+    llvm::MDString::get(LLVMContext, MainFileEntry->getName()),
+    llvm::MDString::get(LLVMContext, MappedInfo->getHash()),
+    ConstantAsMetadata::get(llvm::ConstantDataArray::get(LLVMContext, ASTRef))
+  };
+
+  auto GlobalSerializedAST = Mod->getOrInsertNamedMetadata(MDSerializedAST);
+  GlobalSerializedAST->addOperand(llvm::MDNode::get(LLVMContext,
+                                                    SerializedASTOperands));
 }
 
 } // namespace clang (in seec)
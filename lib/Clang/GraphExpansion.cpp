@@ -23,12 +23,16 @@
 #include "seec/Trace/StateCommon.hpp"
 #include "seec/Util/Fallthrough.hpp"
 #include "seec/Util/Range.hpp"
+#include "seec/Util/TaskScheduler.hpp"
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 
 #include <algorithm>
+#include <iterator>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <utility>
 #include <vector>
 
@@ -45,20 +49,39 @@ namespace graph {
 //===----------------------------------------------------------------------===//
 
 class ExpansionImpl final {
-  /// Contains a true entry if the \c seec::cm::Value is directly referenced.
+  using PtrEntryTy = std::pair<stateptr_ty,
+                               std::shared_ptr<ValueOfPointer const>>;
+
+  /// Number of shards used while the expansion is being built.
   ///
-  llvm::DenseMap<Value const *, bool> DirectlyReferenced;
-  
-  /// Used for all unreferenced \c Value objects.
+  static constexpr std::size_t ShardCount = 64;
+
+  /// \brief Part of the expansion that can be built concurrently.
   ///
-  std::vector<Value const *> EmptyReferences;
+  /// Values and pointers are assigned to shards by their address, so that
+  /// threads expanding different values rarely contend.
+  ///
+  struct Shard {
+    /// Control access to this shard.
+    std::mutex Access;
+
+    /// Values that are directly referenced.
+    llvm::DenseSet<Value const *> DirectlyReferenced;
+
+    /// Pointers that have been expanded.
+    llvm::DenseSet<ValueOfPointer const *> ExpandedPointers;
 
-  /// Set of all pointers that have been expanded.
+    /// Pointers, keyed by the address that they reference.
+    std::vector<PtrEntryTy> Pointers;
+  };
+
+  /// Shards used while the expansion is being built (until finalize()).
   ///
-  llvm::DenseSet<ValueOfPointer const *> ExpandedPointers;
+  std::unique_ptr<Shard[]> Shards;
 
-  using PtrEntryTy = std::pair<stateptr_ty,
-                               std::shared_ptr<ValueOfPointer const>>;
+  /// Contains a true entry if the \c seec::cm::Value is directly referenced.
+  ///
+  llvm::DenseMap<Value const *, bool> DirectlyReferenced;
 
   /// Map from address to pointers that reference that address.
   ///
@@ -70,34 +93,72 @@ class ExpansionImpl final {
     return Entry.first < Address;
   }
 
+  static Shard &getShard(std::unique_ptr<Shard[]> const &Shards,
+                         void const *ForObject)
+  {
+    auto const Hash = llvm::DenseMapInfo<void const *>::getHashValue(ForObject);
+    return Shards[Hash % ShardCount];
+  }
+
 public:
   ExpansionImpl()
-  : DirectlyReferenced(),
-    ExpandedPointers(),
+  : Shards(new Shard[ShardCount]),
+    DirectlyReferenced(),
     Pointers()
   {}
   
+  /// \brief Record that a \c Value is directly referenced by a pointer.
+  ///
+  /// This may be called concurrently, prior to finalize().
+  ///
   void addDirectReference(Value const &ToValue, Value const &FromPointer)
   {
-    DirectlyReferenced[&ToValue] = true;
+    auto &S = getShard(Shards, &ToValue);
+    std::lock_guard<std::mutex> Lock(S.Access);
+    S.DirectlyReferenced.insert(&ToValue);
   }
   
   /// \brief Add the given pointer if it doesn't already exist.
   ///
+  /// This may be called concurrently, prior to finalize().
+  ///
   /// \return true iff the Pointer didn't already exist and was added.
   ///
   bool addPointer(std::shared_ptr<ValueOfPointer const> const &Pointer)
   {
-    auto const NewExpansion = ExpandedPointers.insert(Pointer.get());
+    auto &S = getShard(Shards, Pointer.get());
+    std::lock_guard<std::mutex> Lock(S.Access);
+
+    auto const NewExpansion = S.ExpandedPointers.insert(Pointer.get());
     if (!NewExpansion.second)
       return false;
 
-    Pointers.emplace_back(Pointer->getRawValue(), Pointer);
+    S.Pointers.emplace_back(Pointer->getRawValue(), Pointer);
     return true;
   }
 
+  /// \brief Combine the shards, after which the expansion may be queried.
+  ///
   void finalize()
   {
+    std::size_t PointerCount = 0;
+    for (std::size_t i = 0; i < ShardCount; ++i)
+      PointerCount += Shards[i].Pointers.size();
+
+    Pointers.reserve(PointerCount);
+
+    for (std::size_t i = 0; i < ShardCount; ++i) {
+      auto &S = Shards[i];
+
+      for (auto const Referenced : S.DirectlyReferenced)
+        DirectlyReferenced[Referenced] = true;
+
+      std::move(S.Pointers.begin(), S.Pointers.end(),
+                std::back_inserter(Pointers));
+    }
+
+    Shards.reset();
+
     std::sort(begin(Pointers), end(Pointers));
   }
   
@@ -156,7 +217,7 @@ bool ExpansionImpl::isAreaReferenced(stateptr_ty Start, stateptr_ty End) const
 // expand
 //===----------------------------------------------------------------------===//
 
-static bool containsPointerType(clang::Type const *CanonTy)
+bool containsPointerType(clang::Type const *CanonTy)
 {
   if (!CanonTy)
     return false;
@@ -183,7 +244,14 @@ static bool containsPointerType(clang::Type const *CanonTy)
   return false;
 }
 
-void expand(ExpansionImpl &EI, std::shared_ptr<Value const> const &State)
+/// \brief Expand a single \c Value.
+///
+/// Rather than recursively expanding the values that \c State contains or
+/// references, they are added to \c Pending.
+///
+static void expand(ExpansionImpl &EI,
+                   std::shared_ptr<Value const> const &State,
+                   std::vector<std::shared_ptr<Value const>> &Pending)
 {
   assert(State);
   
@@ -200,7 +268,7 @@ void expand(ExpansionImpl &EI, std::shared_ptr<Value const> const &State)
           unsigned const ChildCount = Array.getChildCount();
           
           for (unsigned i = 0; i < ChildCount; ++i)
-            expand(EI, Array.getChildAt(i));
+            Pending.emplace_back(Array.getChildAt(i));
         }
       }
       break;
@@ -211,7 +279,7 @@ void expand(ExpansionImpl &EI, std::shared_ptr<Value const> const &State)
         unsigned const ChildCount = Record.getChildCount();
         
         for (unsigned i = 0; i < ChildCount; ++i)
-          expand(EI, Record.getChildAt(i));
+          Pending.emplace_back(Record.getChildAt(i));
       }
       break;
     
@@ -238,61 +306,89 @@ void expand(ExpansionImpl &EI, std::shared_ptr<Value const> const &State)
         }
         
         for (unsigned i = 0; i < Limit; ++i) {
-          auto const Pointee = Ptr->getDereferenced(i);
+          auto Pointee = Ptr->getDereferenced(i);
           if (i == 0)
             EI.addDirectReference(*Pointee, *Ptr);
-          expand(EI, Pointee);
+          Pending.emplace_back(std::move(Pointee));
         }
       }
       break;
   }
 }
 
-void expand(ExpansionImpl &EI, seec::cm::LocalState const &State)
+/// \brief Expand a set of root values and everything that they reference.
+///
+/// The expansion proceeds in rounds. Each round expands all of the pending
+/// values in parallel on the shared \c TaskScheduler. Each task expands its
+/// value depth-first, up to a fixed budget, and then leaves the remainder of
+/// its work to the next round. Thus wide structures (many roots, trees) are
+/// split between threads, while long lists don't need one round per node.
+///
+static void expand(ExpansionImpl &EI,
+                   std::vector<std::shared_ptr<Value const>> Frontier)
 {
-  auto const Value = State.getValue();
-  if (Value)
-    expand(EI, Value);
+  // Number of values that a task will expand in a single round.
+  std::size_t const TaskBudget = 1024;
+  
+  auto &Scheduler = seec::TaskScheduler::getShared();
+  
+  while (!Frontier.empty()) {
+    std::vector<std::vector<std::shared_ptr<Value const>>>
+      Remaining(Frontier.size());
+    
+    Scheduler.parallelFor(Frontier.size(),
+                          /* ChunkSize */ 0,
+                          [&] (std::size_t const Index) {
+                            auto &Stack = Remaining[Index];
+                            Stack.emplace_back(std::move(Frontier[Index]));
+                            
+                            for (std::size_t Expanded = 0;
+                                 Expanded < TaskBudget && !Stack.empty();
+                                 ++Expanded)
+                            {
+                              auto const Current = std::move(Stack.back());
+                              Stack.pop_back();
+                              expand(EI, Current, Stack);
+                            }
+                          },
+                          /* CancelIfFalse */ nullptr);
+    
+    Frontier.clear();
+    
+    for (auto &Values : Remaining)
+      std::move(Values.begin(), Values.end(), std::back_inserter(Frontier));
+  }
 }
 
-void expand(ExpansionImpl &EI, seec::cm::ParamState const &State)
-{
-  auto const Value = State.getValue();
-  if (Value)
-    expand(EI, Value);
-}
+//===----------------------------------------------------------------------===//
+// collectRoots
+//===----------------------------------------------------------------------===//
 
-void expand(ExpansionImpl &EI, seec::cm::FunctionState const &State)
+static void collectRoots(std::vector<std::shared_ptr<Value const>> &Roots,
+                         seec::cm::FunctionState const &State)
 {
   for (auto const &Parameter : State.getParameters())
-    expand(EI, Parameter);
+    if (auto Value = Parameter.getValue())
+      Roots.emplace_back(std::move(Value));
   
   for (auto const &Local : State.getLocals())
-    expand(EI, Local);
+    if (auto Value = Local.getValue())
+      Roots.emplace_back(std::move(Value));
   
   if (auto const ActiveStmt = State.getActiveStmt())
-    if (auto const Value = State.getStmtValue(ActiveStmt))
-      expand(EI, Value);
+    if (auto Value = State.getStmtValue(ActiveStmt))
+      Roots.emplace_back(std::move(Value));
 }
 
-void expand(ExpansionImpl &EI, seec::cm::ThreadState const &State)
-{
-  for (auto const &FunctionState : State.getCallStack())
-    expand(EI, FunctionState);
-}
-
-void expand(ExpansionImpl &EI, seec::cm::GlobalVariable const &State)
-{
-  expand(EI, State.getValue());
-}
-
-void expand(ExpansionImpl &EI, seec::cm::ProcessState const &State)
+static void collectRoots(std::vector<std::shared_ptr<Value const>> &Roots,
+                         seec::cm::ProcessState const &State)
 {
   for (std::size_t i = 0; i < State.getThreadCount(); ++i)
-    expand(EI, State.getThread(i));
+    for (auto const &FunctionState : State.getThread(i).getCallStack())
+      collectRoots(Roots, FunctionState);
   
   for (auto const &Global : State.getGlobalVariables())
-    expand(EI, *Global);
+    Roots.emplace_back(Global->getValue());
 }
 
 
@@ -310,7 +406,10 @@ Expansion Expansion::from(seec::cm::ProcessState const &State)
 {
   std::unique_ptr<ExpansionImpl> EI {new ExpansionImpl()};
   
-  expand(*EI, State);
+  std::vector<std::shared_ptr<Value const>> Roots;
+  collectRoots(Roots, State);
+  
+  expand(*EI, std::move(Roots));
   EI->finalize();
   
   Expansion E;
@@ -14,6 +14,7 @@
 
 #include "seec/Clang/GraphExpansion.hpp"
 #include "seec/Clang/GraphLayout.hpp"
+#include "seec/Clang/GraphLayoutLayered.hpp"
 #include "seec/Clang/MappedMallocState.hpp"
 #include "seec/Clang/MappedFunctionState.hpp"
 #include "seec/Clang/MappedGlobalVariable.hpp"
@@ -21,15 +22,21 @@
 #include "seec/Clang/MappedProcessTrace.hpp"
 #include "seec/Clang/MappedThreadState.hpp"
 #include "seec/Clang/MappedValue.hpp"
+#include "seec/DSA/MemoryAreaOwnerIndex.hpp"
 #include "seec/ICU/Format.hpp"
 #include "seec/ICU/LazyMessage.hpp"
 #include "seec/ICU/Resources.hpp"
 #include "seec/ICU/Output.hpp"
+#include "seec/Trace/FunctionState.hpp"
 #include "seec/Trace/ProcessState.hpp"
+#include "seec/Trace/ThreadState.hpp"
 #include "seec/Util/Fallthrough.hpp"
+#include "seec/Util/TaskScheduler.hpp"
 
 #include "clang/AST/Decl.h"
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -37,7 +44,10 @@
 #include "unicode/unistr.h"
 
 #include <algorithm>
-#include <future>
+#include <functional>
+#include <mutex>
+#include <tuple>
+#include <vector>
 
 
 namespace seec {
@@ -166,6 +176,71 @@ public:
   }
 };
 
+/// \brief Represents a pointer that has been resolved to an edge between two
+///        nodes.
+///
+class EdgeInfo {
+  ValueOfPointer const &Pointer;
+  
+  /// Index of the node that contains the pointer.
+  std::size_t Tail;
+  
+  /// Port of the pointer in the tail node, if any.
+  std::string TailPort;
+  
+  /// True if the tail node has no port for the pointer.
+  bool TailPunned;
+  
+  /// Index of the node that contains the pointee.
+  std::size_t Head;
+  
+  /// Port of the pointee in the head node, if any.
+  std::string HeadPort;
+  
+  /// True if the edge should attach to the north west corner of the head.
+  bool HeadNorthWest;
+  
+  /// True if the head node has no port for the pointee.
+  bool HeadPunned;
+  
+public:
+  EdgeInfo(ValueOfPointer const &ForPointer,
+           std::size_t WithTail,
+           std::string WithTailPort,
+           bool WithTailPunned,
+           std::size_t WithHead,
+           std::string WithHeadPort,
+           bool WithHeadNorthWest,
+           bool WithHeadPunned)
+  : Pointer(ForPointer),
+    Tail(WithTail),
+    TailPort(std::move(WithTailPort)),
+    TailPunned(WithTailPunned),
+    Head(WithHead),
+    HeadPort(std::move(WithHeadPort)),
+    HeadNorthWest(WithHeadNorthWest),
+    HeadPunned(WithHeadPunned)
+  {}
+  
+  ValueOfPointer const &getPointer() const { return Pointer; }
+  
+  std::size_t getTail() const { return Tail; }
+  
+  std::string const &getTailPort() const { return TailPort; }
+  
+  bool isTailPunned() const { return TailPunned; }
+  
+  std::size_t getHead() const { return Head; }
+  
+  std::string const &getHeadPort() const { return HeadPort; }
+  
+  bool isHeadNorthWest() const { return HeadNorthWest; }
+  
+  bool isHeadPunned() const { return HeadPunned; }
+  
+  bool isPunned() const { return TailPunned || HeadPunned; }
+};
+
 /// \brief Represents an edge that has been laid out.
 ///
 class LayoutOfPointer {
@@ -217,6 +292,8 @@ public:
 class LayoutOfFunction {
   std::string ID;
   
+  std::string Label;
+  
   std::string DotString;
   
   MemoryArea Area;
@@ -225,17 +302,20 @@ class LayoutOfFunction {
   
 public:
   LayoutOfFunction(std::string WithID,
-                   std::string WithDotString,
+                   std::string WithLabel,
                    MemoryArea WithArea,
                    ValuePortMap WithPorts)
   : ID(std::move(WithID)),
-    DotString(std::move(WithDotString)),
+    Label(std::move(WithLabel)),
+    DotString(getDotStringForNode(ID, Label)),
     Area(std::move(WithArea)),
     Ports(std::move(WithPorts))
   {}
   
   std::string const &getID() const { return ID; }
   
+  std::string const &getLabel() const { return Label; }
+  
   std::string const &getDotString() const { return DotString; }
   
   decltype(Area) const &getArea() const { return Area; }
@@ -249,17 +329,25 @@ public:
 class LayoutOfThread {
   std::string DotString;
   
+  std::vector<LayoutOfFunction> Functions;
+  
   std::vector<NodeInfo> Nodes;
   
 public:
   LayoutOfThread(std::string WithDotString,
+                 std::vector<LayoutOfFunction> WithFunctions,
                  std::vector<NodeInfo> WithNodes)
   : DotString(std::move(WithDotString)),
+    Functions(std::move(WithFunctions)),
     Nodes(std::move(WithNodes))
   {}
   
   std::string const &getDotString() const { return DotString; }
   
+  /// \brief Get the layouts of the call stack, from the outermost function.
+  ///
+  decltype(Functions) const &getFunctions() const { return Functions; }
+  
   decltype(Nodes) const &getNodes() const { return Nodes; }
 };
 
@@ -269,6 +357,8 @@ public:
 class LayoutOfGlobalVariable {
   std::string ID;
   
+  std::string Label;
+  
   std::string DotString;
   
   MemoryArea Area;
@@ -277,17 +367,20 @@ class LayoutOfGlobalVariable {
   
 public:
   LayoutOfGlobalVariable(std::string WithID,
-                         std::string WithDotString,
+                         std::string WithLabel,
                          MemoryArea WithArea,
                          ValuePortMap WithPorts)
   : ID(std::move(WithID)),
-    DotString(std::move(WithDotString)),
+    Label(std::move(WithLabel)),
+    DotString(getDotStringForNode(ID, Label)),
     Area(std::move(WithArea)),
     Ports(std::move(WithPorts))
   {}
   
   std::string const &getID() const { return ID; }
   
+  std::string const &getLabel() const { return Label; }
+  
   std::string const &getDotString() const { return DotString; }
   
   decltype(Area) const &getArea() const { return Area; }
@@ -1065,103 +1158,102 @@ LEVElideUninitOrZeroElements::doLayoutImpl(Value const &V,
   auto const FirstAddress = Array.getAddress();
   auto const ChildCount   = Array.getChildCount();
   auto const ChildSize    = Array.getChildSize();
-  auto const Region       = Array.getUnmappedMemoryRegion().get<0>();
 
-  assert(Region.getByteValues().size() >= ChildCount * ChildSize);
+  // Summarize the elements directly from memory, so that we only create
+  // Values for the elements that are displayed.
+  auto const MaybeSummary = Array.getSummary();
 
   // Exit early if the array has no children, or if the memory region isn't
   // sufficiently large to contain all of the children.
-  if (ChildCount == 0) {
+  if (ChildCount == 0 || !MaybeSummary.assigned()) {
     Stream << "</TD>";
     Stream.flush();
     return LayoutOfValue(std::move(DotString), std::move(Ports));
   }
+
+  auto const &Summary = MaybeSummary.get<ArraySummary>();
   
   Stream << "<TABLE BORDER=\"0\" CELLSPACING=\"0\" CELLBORDER=\"1\">";
   
   bool Eliding = false;
   std::size_t ElidingFrom = 0;
   std::string ElidedPort;
-  
-  for (unsigned i = 0; i < ChildCount; ++i) {
-    auto const Start = FirstAddress + (i * ChildSize);
-    auto const SubRegion = Region.getState().getRegion(MemoryArea(Start,
-                                                                  ChildSize));
-
-    auto const Data = SubRegion.getByteValues();
-    auto const IsEmpty = SubRegion.isUninitialized()
-      || std::all_of(Data.begin(), Data.end(),
-                     [] (char const C) { return C == 0; });
-
-    auto const IsReferenced = E.isAreaReferenced(Start, Start + ChildSize);
-    
-    if (IsEmpty && !IsReferenced) {
-      if (!Eliding) {
-        Eliding = true;
-        ElidingFrom = i;
-        ElidedPort = getStandardPortFor(V) + "_elided_" +
-                     std::to_string(ElidingFrom);
-      }
-      
-      continue;
-    }
-    
-    if (Eliding) {
-      // This element is non-zero or referenced, so stop eliding.
-      Eliding = false;
-      
-      // Write a row for the elided elements.
-      Stream << "<TR><TD PORT=\"" << ElidedPort
-             << "\">&#91;" << ElidingFrom;
-      if (ElidingFrom < i - 1)
-        Stream << " &#45; " << (i - 1);
-      Stream << "&#93;</TD><TD>";
-      
-      // Attempt to format and insert the elision placeholder text.
-      UErrorCode Status = U_ZERO_ERROR;
-      auto const Formatted = seec::format(ElidedText, Status,
-                                          int64_t(i - ElidingFrom));
-      if (U_SUCCESS(Status))
-        Stream << EscapeForHTML(Formatted);
-      
-      Stream << "</TD></TR>";
-    }
-    
-    // Layout this referenced value.
-    auto const ChildValue = Array.getChildAt(i);
-    if (!ChildValue)
-      continue;
-    
-    Stream << "<TR><TD>&#91;" << i << "&#93;</TD>";
-    
-    auto const MaybeLayout = Handler.doLayout(*ChildValue, E);
-    if (MaybeLayout.assigned<LayoutOfValue>()) {
-      auto const &Layout = MaybeLayout.get<LayoutOfValue>();
-      Stream << Layout.getDotString() << "</TR>";
-      Ports.addAllFrom(Layout.getPorts());
-    }
-    else {
-      Stream << "<TD> </TD></TR>";
-    }
-  }
-  
-  // Write one final row for the trailing elided elements.
-  if (Eliding) {
+
+  auto const StartEliding = [&] (std::size_t const From) {
+    if (Eliding)
+      return;
+
+    Eliding = true;
+    ElidingFrom = From;
+    ElidedPort = getStandardPortFor(V) + "_elided_" +
+                 std::to_string(ElidingFrom);
+  };
+
+  // Write a row for the elided elements preceding Until.
+  auto const StopEliding = [&] (std::size_t const Until) {
+    if (!Eliding)
+      return;
+
+    Eliding = false;
+
     Stream << "<TR><TD PORT=\"" << ElidedPort << "\">&#91;" << ElidingFrom;
-    if (ElidingFrom < ChildCount - 1)
-      Stream << " &#45; " << (ChildCount - 1);
+    if (ElidingFrom < Until - 1)
+      Stream << " &#45; " << (Until - 1);
     Stream << "&#93;</TD><TD>";
-    
+
     // Attempt to format and insert the elision placeholder text.
     UErrorCode Status = U_ZERO_ERROR;
     auto const Formatted = seec::format(ElidedText, Status,
-                                        int64_t(ChildCount - ElidingFrom));
+                                        int64_t(Until - ElidingFrom));
     if (U_SUCCESS(Status))
       Stream << EscapeForHTML(Formatted);
-    
+
     Stream << "</TD></TR>";
+  };
+  
+  for (auto const &Run : Summary.getRuns()) {
+    auto const RunStart = FirstAddress + (Run.getFirst() * ChildSize);
+    auto const RunEnd   = FirstAddress + (Run.getEnd() * ChildSize);
+
+    // Elide whole runs of empty elements that are not referenced.
+    if (Run.isEmpty() && !E.isAreaReferenced(RunStart, RunEnd)) {
+      StartEliding(Run.getFirst());
+      continue;
+    }
+
+    for (unsigned i = Run.getFirst(); i < Run.getEnd(); ++i) {
+      auto const Start = FirstAddress + (i * ChildSize);
+
+      if (Run.isEmpty() && !E.isAreaReferenced(Start, Start + ChildSize)) {
+        StartEliding(i);
+        continue;
+      }
+
+      // This element is non-zero or referenced, so stop eliding.
+      StopEliding(i);
+
+      // Layout this referenced value.
+      auto const ChildValue = Array.getChildAt(i);
+      if (!ChildValue)
+        continue;
+
+      Stream << "<TR><TD>&#91;" << i << "&#93;</TD>";
+
+      auto const MaybeLayout = Handler.doLayout(*ChildValue, E);
+      if (MaybeLayout.assigned<LayoutOfValue>()) {
+        auto const &Layout = MaybeLayout.get<LayoutOfValue>();
+        Stream << Layout.getDotString() << "</TR>";
+        Ports.addAllFrom(Layout.getPorts());
+      }
+      else {
+        Stream << "<TD> </TD></TR>";
+      }
+    }
   }
   
+  // Write one final row for the trailing elided elements.
+  StopEliding(ChildCount);
+  
   Stream << "</TABLE></TD>";
   Stream.flush();
   
@@ -1208,14 +1300,12 @@ LEAStandard::doLayoutImpl(seec::MemoryArea const &Area,
   auto const IDString = std::string{"area_at_"} + std::to_string(Area.start());
   auto const &Handler = this->getHandler();
   
-  std::string DotString;
-  llvm::raw_string_ostream DotStream {DotString};
+  std::string Label;
+  llvm::raw_string_ostream DotStream {Label};
   
   ValuePortMap Ports;
   
-  DotStream << IDString
-            << " [ label = <"
-               "<TABLE BORDER=\"0\" CELLBORDER=\"1\" CELLPADDING=\"2\"";
+  DotStream << "<TABLE BORDER=\"0\" CELLBORDER=\"1\" CELLPADDING=\"2\"";
   Handler.writeHREF(DotStream, Area, Reference);
   DotStream << "><TR><TD>"
                "<TABLE"
@@ -1258,11 +1348,11 @@ LEAStandard::doLayoutImpl(seec::MemoryArea const &Area,
     DotStream << "<TR><TD> </TD></TR>";
   }
   
-  DotStream << "</TABLE></TD></TR></TABLE>> ];\n";
+  DotStream << "</TABLE></TD></TR></TABLE>";
   DotStream.flush();
   
   return LayoutOfArea{std::move(IDString),
-                      std::move(DotString),
+                      std::move(Label),
                       std::move(Ports)};
 }
 
@@ -1309,17 +1399,15 @@ LEACString::doLayoutImpl(seec::MemoryArea const &Area,
   auto const IDString = std::string{"area_at_"} + std::to_string(Area.start());
   auto const &Handler = this->getHandler();
   
-  std::string DotString;
-  llvm::raw_string_ostream Stream {DotString};
+  std::string Label;
+  llvm::raw_string_ostream Stream {Label};
   
   ValuePortMap Ports;
 
   if (E.isReferencedDirectly(Reference))
     Ports.add(Reference, ValuePort{EdgeEndType::Standard});
   
-  Stream << IDString
-         << " [ label = <"
-            "<TABLE BORDER=\"0\" CELLBORDER=\"1\" CELLPADDING=\"2\"";
+  Stream << "<TABLE BORDER=\"0\" CELLBORDER=\"1\" CELLPADDING=\"2\"";
   Handler.writeHREF(Stream, Area, Reference);
   Stream << "><TR><TD>"
             "<TABLE"
@@ -1392,11 +1480,11 @@ LEACString::doLayoutImpl(seec::MemoryArea const &Area,
     }
   }
   
-  Stream << "</TR></TABLE></TD></TR></TABLE>> ];\n";
+  Stream << "</TR></TABLE></TD></TR></TABLE>";
   Stream.flush();
   
   return LayoutOfArea{std::move(IDString),
-                      std::move(DotString),
+                      std::move(Label),
                       std::move(Ports)};
 }
 
@@ -1429,7 +1517,7 @@ doLayout(LayoutHandler const &Handler,
             << "</TD>";
   
   // Attempt to layout the value.
-  auto MaybeLayout = Handler.doLayout(*Value, Expansion);
+  auto MaybeLayout = Handler.doLayout(Value, Expansion);
   if (MaybeLayout.assigned<LayoutOfValue>()) {
     auto const &Layout = MaybeLayout.get<LayoutOfValue>();
     DotStream << Layout.getDotString();
@@ -1480,7 +1568,7 @@ doLayout(LayoutHandler const &Handler,
             << "</TD>";
   
   // Attempt to layout the value.
-  auto MaybeLayout = Handler.doLayout(*Value, Expansion);
+  auto MaybeLayout = Handler.doLayout(Value, Expansion);
   if (MaybeLayout.assigned<LayoutOfValue>()) {
     auto const &Layout = MaybeLayout.get<LayoutOfValue>();
     DotStream << Layout.getDotString();
@@ -1521,16 +1609,14 @@ doLayout(LayoutHandler const &Handler,
     IDStream << "function_at_" << reinterpret_cast<uintptr_t>(&State);
   }
   
-  std::string DotString;
-  llvm::raw_string_ostream DotStream {DotString};
+  std::string Label;
+  llvm::raw_string_ostream DotStream {Label};
   
   MemoryArea Area;
   
   ValuePortMap Ports;
   
-  DotStream << IDString
-            << " [ label = <"
-            << "<TABLE BORDER=\"0\" "
+  DotStream << "<TABLE BORDER=\"0\" "
                "CELLSPACING=\"0\" CELLBORDER=\"1\" HREF=\"function "
             << reinterpret_cast<uintptr_t>(&State)
             << "\">"
@@ -1566,11 +1652,11 @@ doLayout(LayoutHandler const &Handler,
       Area.setStart(AllocaArea.start());
   }
   
-  DotStream << "</TABLE>> ];\n";
+  DotStream << "</TABLE>";
   DotStream.flush();
   
   return LayoutOfFunction{std::move(IDString),
-                          std::move(DotString),
+                          std::move(Label),
                           std::move(Area),
                           std::move(Ports)};
 }
@@ -1634,7 +1720,9 @@ doLayout(LayoutHandler const &Handler,
   DotStream << "}\n";
   DotStream.flush();
   
-  return LayoutOfThread{std::move(DotString), std::move(FunctionNodes)};
+  return LayoutOfThread{std::move(DotString),
+                        std::move(FunctionLayouts),
+                        std::move(FunctionNodes)};
 }
 
 
@@ -1657,12 +1745,10 @@ doLayout(LayoutHandler const &Handler,
   }
   
   auto const TheDecl = State.getClangValueDecl();
-  std::string DotString;
-  llvm::raw_string_ostream DotStream {DotString};
+  std::string Label;
+  llvm::raw_string_ostream DotStream {Label};
   
-  DotStream << IDString
-            << " [ label = <"
-            << "<TABLE BORDER=\"0\" "
+  DotStream << "<TABLE BORDER=\"0\" "
                 "CELLSPACING=\"0\" CELLBORDER=\"1\" HREF=\"global "
             << reinterpret_cast<uintptr_t>(&State) << "\"><TR><TD>";
 
@@ -1684,7 +1770,7 @@ doLayout(LayoutHandler const &Handler,
   
   auto const Value = State.getValue();
   if (Value) {
-    auto const MaybeLayout = Handler.doLayout(*Value, Expansion);
+    auto const MaybeLayout = Handler.doLayout(Value, Expansion);
     if (MaybeLayout.assigned<LayoutOfValue>()) {
       auto const &Layout = MaybeLayout.get<LayoutOfValue>();
       DotStream << Layout.getDotString();
@@ -1697,11 +1783,11 @@ doLayout(LayoutHandler const &Handler,
     }
   }
   
-  DotStream << "</TR></TABLE>> ];\n";
+  DotStream << "</TR></TABLE>";
   DotStream.flush();
   
   return LayoutOfGlobalVariable{std::move(IDString),
-                                std::move(DotString),
+                                std::move(Label),
                                 std::move(Area),
                                 std::move(Ports)};
 }
@@ -1731,14 +1817,12 @@ layoutUnreferencedArea(LayoutHandler const &Handler,
   // Generate the identifier for this node.
   auto const IDString = std::string{"area_at_"} + std::to_string(Area.start());
   
-  std::string DotString;
-  llvm::raw_string_ostream Stream {DotString};
+  std::string Label;
+  llvm::raw_string_ostream Stream {Label};
   
   ValuePortMap Ports;
   
-  Stream << IDString
-         << " [ label = <"
-            "<TABLE BORDER=\"0\" CELLBORDER=\"1\" CELLPADDING=\"2\"";
+  Stream << "<TABLE BORDER=\"0\" CELLBORDER=\"1\" CELLPADDING=\"2\"";
   // TODO: Make a href for unreferenced areas.
   Stream << "><TR><TD COLOR=\"#dc322f\">";
   
@@ -1757,12 +1841,12 @@ layoutUnreferencedArea(LayoutHandler const &Handler,
       Stream << EscapeForHTML(Formatted);
   }
   
-  Stream << "</TD></TR></TABLE>> ];\n";
+  Stream << "</TD></TR></TABLE>";
   Stream.flush();
   
   return std::make_pair(seec::Maybe<LayoutOfArea>
                                    (LayoutOfArea{std::move(IDString),
-                                    std::move(DotString),
+                                    std::move(Label),
                                     ValuePortMap{}}),
                         Area);
 }
@@ -1787,7 +1871,7 @@ doLayout(LayoutHandler const &Handler,
     return layoutUnreferencedArea(Handler, Area, Type);
   
   if (Refs.size() == 1)
-    return std::make_pair(Handler.doLayout(Area, *Refs.front(), Expansion),
+    return std::make_pair(Handler.doLayout(Area, Refs.front(), Expansion),
                           Area);
   
   // Use the user-selected ref, if there is one.
@@ -1800,7 +1884,7 @@ doLayout(LayoutHandler const &Handler,
                     });
     
     if (OverrideIt != Refs.end())
-      return std::make_pair(Handler.doLayout(Area, **OverrideIt, Expansion),
+      return std::make_pair(Handler.doLayout(Area, *OverrideIt, Expansion),
                             Area);
   }
   
@@ -1810,12 +1894,12 @@ doLayout(LayoutHandler const &Handler,
   assert(!Refs.empty());
   
   if (Refs.size() == 1)
-    return std::make_pair(Handler.doLayout(Area, *Refs.front(), Expansion),
+    return std::make_pair(Handler.doLayout(Area, Refs.front(), Expansion),
                           Area);
   
   // TODO: Layout as type-punned (or pass to a layout engine that supports
   //       multiple references).
-  return std::make_pair(Handler.doLayout(Area, *Refs.front(), Expansion), Area);
+  return std::make_pair(Handler.doLayout(Area, Refs.front(), Expansion), Area);
 }
 
 
@@ -1836,14 +1920,12 @@ doLayout(StreamState const &State, Expansion const &Expansion)
   // Generate the identifier for this node.
   auto const IDString = std::string{"area_at_"} + std::to_string(Address);
   
-  std::string DotString;
-  llvm::raw_string_ostream Stream {DotString};
+  std::string Label;
+  llvm::raw_string_ostream Stream {Label};
   
   ValuePortMap Ports;
   
-  Stream << IDString
-         << " [ label = <"
-            "<TABLE BORDER=\"0\" CELLBORDER=\"1\" CELLPADDING=\"2\"";
+  Stream << "<TABLE BORDER=\"0\" CELLBORDER=\"1\" CELLPADDING=\"2\"";
   // TODO: Make a href for unreferenced Streams?
   Stream << "><TR><TD PORT=\"opaque\">";
   
@@ -1861,12 +1943,12 @@ doLayout(StreamState const &State, Expansion const &Expansion)
       Stream << EscapeForHTML(Formatted);
   }
   
-  Stream << "</TD></TR></TABLE>> ];\n";
+  Stream << "</TD></TR></TABLE>";
   Stream.flush();
   
   return std::make_pair(Maybe<LayoutOfArea>
                              (LayoutOfArea{std::move(IDString),
-                              std::move(DotString),
+                              std::move(Label),
                               ValuePortMap{}}),
                         MemoryArea{Address, 1});
 }
@@ -1885,14 +1967,12 @@ doLayout(DIRState const &State, Expansion const &Expansion)
   // Generate the identifier for this node.
   auto const IDString = std::string{"area_at_"} + std::to_string(Address);
   
-  std::string DotString;
-  llvm::raw_string_ostream Stream {DotString};
+  std::string Label;
+  llvm::raw_string_ostream Stream {Label};
   
   ValuePortMap Ports;
   
-  Stream << IDString
-         << " [ label = <"
-            "<TABLE BORDER=\"0\" CELLBORDER=\"1\" CELLPADDING=\"2\"";
+  Stream << "<TABLE BORDER=\"0\" CELLBORDER=\"1\" CELLPADDING=\"2\"";
   // TODO: Make a href for unreferenced DIRs?
   Stream << "><TR><TD PORT=\"opaque\">";
   
@@ -1910,12 +1990,12 @@ doLayout(DIRState const &State, Expansion const &Expansion)
       Stream << EscapeForHTML(Formatted);
   }
   
-  Stream << "</TD></TR></TABLE>> ];\n";
+  Stream << "</TD></TR></TABLE>";
   Stream.flush();
   
   return std::make_pair(Maybe<LayoutOfArea>
                              (LayoutOfArea{std::move(IDString),
-                              std::move(DotString),
+                              std::move(Label),
                               ValuePortMap{}}),
                         MemoryArea{Address, 1});
 }
@@ -1925,11 +2005,21 @@ doLayout(DIRState const &State, Expansion const &Expansion)
 // Render Pointers
 //===----------------------------------------------------------------------===//
 
-static void renderEdges(llvm::raw_string_ostream &DotStream,
-                        std::vector<NodeInfo> const &AllNodeInfo,
-                        Expansion const &Expansion)
+/// \brief Resolve all pointers to edges between the nodes that contain them.
+///
+static std::vector<EdgeInfo>
+resolveEdges(std::vector<NodeInfo> const &AllNodeInfo,
+             Expansion const &Expansion)
 {
-  // Layout all pointers.
+  std::vector<EdgeInfo> Edges;
+  
+  std::vector<MemoryArea> Areas;
+  Areas.reserve(AllNodeInfo.size());
+  for (auto const &Node : AllNodeInfo)
+    Areas.push_back(Node.getArea());
+  
+  seec::MemoryAreaOwnerIndex const Index (Areas);
+  
   for (auto const &Pointer : Expansion.getAllPointers()) {
     if (!Pointer->isInMemory())
       continue;
@@ -1940,111 +2030,131 @@ static void renderEdges(llvm::raw_string_ostream &DotStream,
       continue;
     
     // Find the node that owns the pointee address.
-    auto const HeadIt =
-      std::find_if(AllNodeInfo.begin(),
-                   AllNodeInfo.end(),
-                   [=] (NodeInfo const &NI) {
-                     auto Area = NI.getArea();
-                     return Area.contains(HeadAddress)
-                         || (Area.length() == 0 && Area.start() == HeadAddress);
-                   });
-    
-    if (HeadIt == AllNodeInfo.end())
+    auto const MaybeHead = Index.findContainingOrAt(HeadAddress);
+    if (!MaybeHead.assigned())
       continue;
     
+    auto const HeadIt = AllNodeInfo.begin() + MaybeHead.get<std::size_t>();
+    
     // Find the node that owns the pointer's memory.
     auto const TailAddress = Pointer->getAddress();
-    auto const TailIt =
-      std::find_if(AllNodeInfo.begin(),
-                   AllNodeInfo.end(),
-                   [=] (NodeInfo const &NI) { return NI.getArea()
-                                                       .contains(TailAddress);
-                                            });
-    
-    if (TailIt == AllNodeInfo.end())
+    auto const MaybeTail = Index.findContaining(TailAddress);
+    if (!MaybeTail.assigned())
       continue;
     
-    auto const MaybeTailPort = TailIt->getPortForValue(*Pointer);
+    auto const TailIt = AllNodeInfo.begin() + MaybeTail.get<std::size_t>();
     
-    // Accumulate all attributes.
-    std::string EdgeAttributes = "href=\"dereference "
-                               + std::to_string(reinterpret_cast<uintptr_t>
-                                                                (Pointer.get()))
-                               + "\" ";
-    bool IsPunned = false;
+    // Find the tail port.
+    std::string TailPort;
+    bool TailPunned = false;
     
-    // Write the tail.
-    DotStream << TailIt->getID();
+    auto const MaybeTailPort = TailIt->getPortForValue(*Pointer);
     
     if (MaybeTailPort.assigned<ValuePort>()) {
       // Tail port was explicitly defined during layout.
-      auto const &TailPort = MaybeTailPort.get<ValuePort>();
-      
-      if (TailPort.getEdgeEnd() == EdgeEndType::Standard)
-        DotStream << ':'
-                  << getStandardPortFor(*Pointer)
-                  << ":c";
-      
-      EdgeAttributes += "tailclip=false ";
+      if (MaybeTailPort.get<ValuePort>().getEdgeEnd() == EdgeEndType::Standard)
+        TailPort = getStandardPortFor(*Pointer);
     }
     else {
       // The tail port wasn't found, we must consider it punned.
-      EdgeAttributes += "dir=both arrowtail=odot ";
-      IsPunned = true;
+      TailPunned = true;
     }
     
-    // Write the arrow.
-    DotStream << " -> ";
+    // Find the head port.
+    std::string HeadPort;
+    bool HeadNorthWest = false;
+    bool HeadPunned = false;
     
-    // Write the head.
-    DotStream << HeadIt->getID();
+    auto const HeadIsStart = HeadAddress == HeadIt->getArea().start();
     
     if (Pointer->getDereferenceIndexLimit() != 0) {
       auto const Pointee = Pointer->getDereferenced(0);
       auto const MaybeHeadPort = HeadIt->getPortForValue(*Pointee);
       
       if (MaybeHeadPort.assigned<ValuePort>()) {
-        // Tail port was explicitly defined during layout.
-        auto const &HeadPort = MaybeHeadPort.get<ValuePort>();
+        // Head port was explicitly defined during layout.
+        auto const &Port = MaybeHeadPort.get<ValuePort>();
         
-        if (HeadPort.getEdgeEnd() == EdgeEndType::Standard)
-          DotStream << ':'
-                    << getStandardPortFor(*Pointee)
-                    << ":nw";
+        if (Port.getEdgeEnd() == EdgeEndType::Standard) {
+          HeadPort = getStandardPortFor(*Pointee);
+          HeadNorthWest = true;
+        }
       }
       else {
-        if (HeadAddress == HeadIt->getArea().start())
-          DotStream << ":nw";
-        
-        EdgeAttributes += "arrowhead=onormal ";
-        IsPunned = true;
+        HeadNorthWest = HeadIsStart;
+        HeadPunned = true;
       }
     }
     else if (Pointer->isValidOpaque()) {
-      if (HeadAddress == HeadIt->getArea().start())
-        DotStream << ":opaque:nw";
+      if (HeadIsStart) {
+        HeadPort = "opaque";
+        HeadNorthWest = true;
+      }
     }
     else {
       // There's no pointee value. Either the memory area is too small, or the
       // pointer's element type is incomplete. For now, make this look like a
       // punned pointer.
-      if (HeadAddress == HeadIt->getArea().start())
-        DotStream << ":nw";
-      
-      EdgeAttributes += "arrowhead=onormal ";
-      IsPunned = true;
+      HeadNorthWest = HeadIsStart;
+      HeadPunned = true;
     }
     
-    if (IsPunned)
+    Edges.emplace_back(*Pointer,
+                       TailIt - AllNodeInfo.begin(),
+                       std::move(TailPort),
+                       TailPunned,
+                       HeadIt - AllNodeInfo.begin(),
+                       std::move(HeadPort),
+                       HeadNorthWest,
+                       HeadPunned);
+  }
+  
+  return Edges;
+}
+
+static void renderEdges(llvm::raw_string_ostream &DotStream,
+                        std::vector<NodeInfo> const &AllNodeInfo,
+                        std::vector<EdgeInfo> const &Edges)
+{
+  for (auto const &Edge : Edges) {
+    // Accumulate all attributes.
+    std::string EdgeAttributes = "href=\"dereference "
+                               + std::to_string(reinterpret_cast<uintptr_t>
+                                                  (&Edge.getPointer()))
+                               + "\" ";
+    
+    // Write the tail.
+    DotStream << AllNodeInfo[Edge.getTail()].getID();
+    
+    if (!Edge.getTailPort().empty())
+      DotStream << ':' << Edge.getTailPort() << ":c";
+    
+    if (Edge.isTailPunned())
+      EdgeAttributes += "dir=both arrowtail=odot ";
+    else
+      EdgeAttributes += "tailclip=false ";
+    
+    // Write the arrow.
+    DotStream << " -> ";
+    
+    // Write the head.
+    DotStream << AllNodeInfo[Edge.getHead()].getID();
+    
+    if (!Edge.getHeadPort().empty())
+      DotStream << ':' << Edge.getHeadPort();
+    
+    if (Edge.isHeadNorthWest())
+      DotStream << ":nw";
+    
+    if (Edge.isHeadPunned())
+      EdgeAttributes += "arrowhead=onormal ";
+    
+    if (Edge.isPunned())
       EdgeAttributes += "style=dashed ";
 
     // Write attributes.
-    if (!EdgeAttributes.empty()) {
-      EdgeAttributes.pop_back();
-      DotStream << " [" << EdgeAttributes << "]";
-    }
-    
-    DotStream << ";\n";
+    EdgeAttributes.pop_back();
+    DotStream << " [" << EdgeAttributes << "];\n";
   }
 }
 
@@ -2053,60 +2163,86 @@ static void renderEdges(llvm::raw_string_ostream &DotStream,
 // Layout Process State
 //===----------------------------------------------------------------------===//
 
+/// \brief The layouts of all nodes in a seec::cm::ProcessState.
+///
+struct LayoutOfProcessNodes {
+  typedef std::pair<seec::Maybe<LayoutOfArea>, MemoryArea> AreaLayoutTy;
+  
+  std::vector<std::unique_ptr<LayoutOfGlobalVariable>> GlobalVariableLayouts;
+  
+  std::vector<std::unique_ptr<LayoutOfThread>> ThreadLayouts;
+  
+  std::vector<std::unique_ptr<AreaLayoutTy>> AreaLayouts;
+};
+
+/// \brief Generate the layouts of all nodes in a process state.
+/// \return true iff all layouts were generated (i.e. not cancelled).
+///
 static
-LayoutOfProcess
-doLayout(LayoutHandler const &Handler,
-         seec::cm::ProcessState const &State,
-         seec::cm::graph::Expansion const &Expansion,
-         std::atomic_bool &CancelIfFalse)
+bool
+layoutNodes(LayoutHandler const &Handler,
+            seec::cm::ProcessState const &State,
+            seec::cm::graph::Expansion const &Expansion,
+            std::atomic_bool &CancelIfFalse,
+            LayoutOfProcessNodes &Nodes)
 {
-  auto const TimeStart = std::chrono::steady_clock::now();
+  typedef LayoutOfProcessNodes::AreaLayoutTy AreaLayoutTy;
   
-  // Create tasks to generate global variable layouts.
-  std::vector<std::future<LayoutOfGlobalVariable>> GlobalVariableLayouts;
+  // Each task generates a single layout into its own slot of one of these.
+  auto &GlobalVariableLayouts = Nodes.GlobalVariableLayouts;
+  auto &ThreadLayouts = Nodes.ThreadLayouts;
+  auto &AreaLayouts = Nodes.AreaLayouts;
   
+  std::vector<std::function<void ()>> Tasks;
+  
+  // Create tasks to generate global variable layouts.
   auto const &Globals = State.getGlobalVariables();
   for (auto It = Globals.begin(), End = Globals.end(); It != End; ++It) {
     if ((*It)->isInSystemHeader() && !(*It)->isReferenced())
       continue;
     
-    GlobalVariableLayouts.emplace_back(
-      std::async( [&, It] () {
-                    return doLayout(Handler, **It, Expansion);
-                  } ));
+    auto const Index = GlobalVariableLayouts.size();
+    GlobalVariableLayouts.emplace_back();
+    Tasks.emplace_back([&, It, Index] () {
+      GlobalVariableLayouts[Index] =
+        llvm::make_unique<LayoutOfGlobalVariable>(
+          doLayout(Handler, **It, Expansion));
+    });
   }
   
   // Create tasks to generate thread layouts.
   auto const ThreadCount = State.getThreadCount();
-  
-  std::vector<std::future<LayoutOfThread>> ThreadLayouts;
-  ThreadLayouts.reserve(ThreadCount);
+  ThreadLayouts.resize(ThreadCount);
   
   for (std::size_t i = 0; i < ThreadCount; ++i) {
-    ThreadLayouts.emplace_back(
-      std::async( [&, i] () {
-                    return doLayout(Handler, State.getThread(i), Expansion);
-                  } ));
+    Tasks.emplace_back([&, i] () {
+      ThreadLayouts[i] =
+        llvm::make_unique<LayoutOfThread>(
+          doLayout(Handler, State.getThread(i), Expansion));
+    });
   }
   
-  // This will hold all of the general area layouts.
-  std::vector<std::future<std::pair<seec::Maybe<LayoutOfArea>, MemoryArea>>>
-    AreaLayouts;
+  // This adds a task to generate a general area layout.
+  auto const AddAreaTask = [&] (std::function<AreaLayoutTy ()> Layout) {
+    auto const Index = AreaLayouts.size();
+    AreaLayouts.emplace_back();
+    Tasks.emplace_back([&, Index, Layout] () {
+      AreaLayouts[Index] = llvm::make_unique<AreaLayoutTy>(Layout());
+    });
+  };
   
   // Generate layouts for unmapped static areas (unmapped globals).
   for (auto const &Area : State.getUnmappedStaticAreas()) {
-    AreaLayouts.emplace_back(
-      std::async([&, Area] () {
-        return doLayout(Handler, Area, Expansion, AreaType::Static); }));
+    AddAreaTask([&, Area] () {
+      return doLayout(Handler, Area, Expansion, AreaType::Static); });
   }
   
   // Create tasks to generate malloc area layouts.
   for (auto const &Malloc : State.getDynamicMemoryAllocations()) {
     auto const Area = seec::MemoryArea(Malloc.getAddress(), Malloc.getSize());
     
-    AreaLayouts.emplace_back(
-      std::async([&, Area] () {
-        return doLayout(Handler, Area, Expansion, AreaType::Dynamic); } ));
+    AddAreaTask([&, Area] () {
+      return doLayout(Handler, Area, Expansion, AreaType::Dynamic); });
   }
   
   // Create tasks to generate known memory area layouts.
@@ -2115,26 +2251,50 @@ doLayout(LayoutHandler const &Handler,
                                        (Known.End - Known.Begin) + 1,
                                        Known.Value);
     
-    AreaLayouts.emplace_back(
-      std::async([&, Area] () {
-        return doLayout(Handler, Area, Expansion, AreaType::Static); } ));
+    AddAreaTask([&, Area] () {
+      return doLayout(Handler, Area, Expansion, AreaType::Static); });
   }
   
   // Generate stream layouts.
   for (auto const &Stream : State.getStreams()) {
-    AreaLayouts.emplace_back(
-      std::async([&, Stream] () {
-        return doLayout(Stream.second, Expansion); } ));
+    auto const StreamPtr = &Stream.second;
+    AddAreaTask([&, StreamPtr] () { return doLayout(*StreamPtr, Expansion); });
   }
   
   // Generate DIR layouts.
   for (auto const &Dir : State.getDIRs()) {
-    AreaLayouts.emplace_back(
-      std::async([&, Dir] () {
-        return doLayout(Dir.second, Expansion); } ));
+    auto const DirPtr = &Dir.second;
+    AddAreaTask([&, DirPtr] () { return doLayout(*DirPtr, Expansion); });
   }
   
-  // Retrieve results and combine layouts.
+  // Run the tasks on the shared scheduler. A heap with many allocations
+  // produces many small tasks, so they are run in chunks, and cancellation
+  // stops any chunks that have not yet started.
+  auto const Completed =
+    seec::TaskScheduler::getShared().parallelFor(
+      Tasks.size(),
+      /* ChunkSize */ 0,
+      [&] (std::size_t const Index) { Tasks[Index](); },
+      &CancelIfFalse);
+  
+  return Completed && CancelIfFalse;
+}
+
+static
+LayoutOfProcess
+doLayout(LayoutHandler const &Handler,
+         seec::cm::ProcessState const &State,
+         seec::cm::graph::Expansion const &Expansion,
+         std::atomic_bool &CancelIfFalse)
+{
+  auto const TimeStart = std::chrono::steady_clock::now();
+  
+  LayoutOfProcessNodes Nodes;
+  
+  if (!layoutNodes(Handler, State, Expansion, CancelIfFalse, Nodes))
+    return LayoutOfProcess{std::string{}, std::chrono::nanoseconds{0}};
+  
+  // Combine layouts.
   std::string DotString;
   llvm::raw_string_ostream DotStream {DotString};
   
@@ -2145,40 +2305,25 @@ doLayout(LayoutHandler const &Handler,
             // << "penwidth=0.5;\n"
             << "rankdir=LR;\n";
   
-  for (auto &GlobalFuture : GlobalVariableLayouts) {
-    if (CancelIfFalse == false)
-      return LayoutOfProcess{std::string{}, std::chrono::nanoseconds{0}};
-
-    auto const Layout = GlobalFuture.get();
-
-    DotStream << Layout.getDotString();
+  for (auto const &Layout : Nodes.GlobalVariableLayouts) {
+    DotStream << Layout->getDotString();
     
     AllNodeInfo.emplace_back(NodeType::Global,
-                             Layout.getID(),
-                             Layout.getArea(),
-                             Layout.getPorts());
+                             Layout->getID(),
+                             Layout->getArea(),
+                             Layout->getPorts());
   }
   
-  for (auto &ThreadFuture : ThreadLayouts) {
-    if (CancelIfFalse == false)
-      return LayoutOfProcess{std::string{}, std::chrono::nanoseconds{0}};
-
-    auto const Layout = ThreadFuture.get();
-    
-    DotStream << Layout.getDotString();
+  for (auto const &Layout : Nodes.ThreadLayouts) {
+    DotStream << Layout->getDotString();
     
     AllNodeInfo.insert(AllNodeInfo.end(),
-                       Layout.getNodes().begin(),
-                       Layout.getNodes().end());
+                       Layout->getNodes().begin(),
+                       Layout->getNodes().end());
   }
   
-  for (auto &AreaFuture : AreaLayouts) {
-    if (CancelIfFalse == false)
-      return LayoutOfProcess{std::string{}, std::chrono::nanoseconds{0}};
-
-    auto const Result = AreaFuture.get();
-
-    auto const &MaybeLayout = Result.first;
+  for (auto const &Result : Nodes.AreaLayouts) {
+    auto const &MaybeLayout = Result->first;
     if (!MaybeLayout.assigned<LayoutOfArea>())
       continue;
     
@@ -2188,12 +2333,12 @@ doLayout(LayoutHandler const &Handler,
     
     AllNodeInfo.emplace_back(NodeType::None,
                              Layout.getID(),
-                             Result.second,
+                             Result->second,
                              Layout.getPorts());
   }
   
   // Render all of the pointers.
-  renderEdges(DotStream, AllNodeInfo, Expansion);
+  renderEdges(DotStream, AllNodeInfo, resolveEdges(AllNodeInfo, Expansion));
   
   DotStream << "}\n"; // Close the digraph.
   DotStream.flush();
@@ -2207,10 +2352,439 @@ doLayout(LayoutHandler const &Handler,
 }
 
 
+//===----------------------------------------------------------------------===//
+// Layered Layout Process State
+//===----------------------------------------------------------------------===//
+
+static
+LayoutOfProcess
+doLayeredLayout(LayoutHandler const &Handler,
+                seec::cm::ProcessState const &State,
+                seec::cm::graph::Expansion const &Expansion,
+                LayeredLayoutEngine &Engine,
+                std::atomic_bool &CancelIfFalse)
+{
+  auto const TimeStart = std::chrono::steady_clock::now();
+  
+  LayoutOfProcessNodes Nodes;
+  
+  if (!layoutNodes(Handler, State, Expansion, CancelIfFalse, Nodes))
+    return LayoutOfProcess{std::string{}, std::chrono::nanoseconds{0}};
+  
+  // Combine layouts. Nodes are added to the graph in the same order as they
+  // are added to AllNodeInfo, so that edges can use the same indices.
+  LayeredGraph Graph;
+  
+  std::vector<NodeInfo> AllNodeInfo;
+  
+  for (auto const &Layout : Nodes.GlobalVariableLayouts) {
+    Graph.addNode(Layout->getID(), Layout->getLabel());
+    
+    AllNodeInfo.emplace_back(NodeType::Global,
+                             Layout->getID(),
+                             Layout->getArea(),
+                             Layout->getPorts());
+  }
+  
+  for (auto const &Layout : Nodes.ThreadLayouts) {
+    auto const FirstFunction = AllNodeInfo.size();
+    
+    for (auto const &Function : Layout->getFunctions())
+      Graph.addNode(Function.getID(), Function.getLabel());
+    
+    AllNodeInfo.insert(AllNodeInfo.end(),
+                       Layout->getNodes().begin(),
+                       Layout->getNodes().end());
+    
+    // Add edges to force function nodes to appear in order (matching those
+    // in the thread's dot layout).
+    for (auto i = FirstFunction + 1; i < AllNodeInfo.size(); ++i)
+      Graph.addEdge(LayeredEdge{i, "fname", i - 1, "fname",
+                                LayeredAnchor::Side,
+                                LayeredArrowType::Normal,
+                                LayeredArrowType::None,
+                                std::string{},
+                                "#268bd2",
+                                true});
+  }
+  
+  for (auto const &Result : Nodes.AreaLayouts) {
+    auto const &MaybeLayout = Result->first;
+    if (!MaybeLayout.assigned<LayoutOfArea>())
+      continue;
+    
+    auto const &Layout = MaybeLayout.get<LayoutOfArea>();
+    
+    Graph.addNode(Layout.getID(), Layout.getLabel());
+    
+    AllNodeInfo.emplace_back(NodeType::None,
+                             Layout.getID(),
+                             Result->second,
+                             Layout.getPorts());
+  }
+  
+  // Add all of the pointers.
+  for (auto const &Edge : resolveEdges(AllNodeInfo, Expansion)) {
+    auto const HREF = "dereference "
+                    + std::to_string(reinterpret_cast<uintptr_t>
+                                       (&Edge.getPointer()));
+    
+    Graph.addEdge(LayeredEdge{Edge.getTail(),
+                              Edge.getTailPort(),
+                              Edge.getHead(),
+                              Edge.getHeadPort(),
+                              Edge.isHeadNorthWest() ? LayeredAnchor::NorthWest
+                                                     : LayeredAnchor::Side,
+                              Edge.isTailPunned() ? LayeredArrowType::OpenDot
+                                                  : LayeredArrowType::None,
+                              Edge.isHeadPunned() ? LayeredArrowType::Open
+                                                  : LayeredArrowType::Normal,
+                              HREF,
+                              std::string{},
+                              Edge.isPunned()});
+  }
+  
+  auto SVGString = Engine.render(Graph, &CancelIfFalse);
+  if (SVGString.empty())
+    return LayoutOfProcess{std::string{}, std::chrono::nanoseconds{0}};
+  
+  auto const TimeEnd = std::chrono::steady_clock::now();
+  auto const TimeTaken = TimeEnd - TimeStart;
+  
+  return LayoutOfProcess{std::string{},
+                         std::move(SVGString),
+                         std::chrono::duration_cast<std::chrono::nanoseconds>
+                                                   (TimeTaken)};
+}
+
+
+//===----------------------------------------------------------------------===//
+// LayoutCache
+//===----------------------------------------------------------------------===//
+
+/// \brief Get the pointers that point into an area, ordered by identity.
+///
+static std::vector<std::shared_ptr<ValueOfPointer const>>
+getOrderedReferences(Expansion const &E, stateptr_ty Start, stateptr_ty End)
+{
+  auto Refs = E.getReferencesOfArea(Start, End);
+  std::sort(Refs.begin(), Refs.end());
+  return Refs;
+}
+
+/// \brief Get a hash of the areas that pointers may be dereferenced into.
+///
+/// Whether or not a pointer is valid depends on these areas, rather than on
+/// the memory that the pointer occupies. The order of iteration differs for
+/// some of the underlying containers, so the areas are sorted before they are
+/// combined.
+///
+static llvm::hash_code hashAllocations(seec::cm::ProcessState const &State)
+{
+  /// Kind of area, and the two values that identify it.
+  typedef std::tuple<unsigned, uint64_t, uint64_t> AreaTy;
+
+  auto const &Unmapped = State.getUnmappedProcessState();
+  std::vector<AreaTy> Areas;
+  
+  for (auto const &Malloc : Unmapped.getMallocs())
+    Areas.emplace_back(0, Malloc.first, Malloc.second.getSize());
+  
+  for (auto const &Known : Unmapped.getKnownMemory())
+    Areas.emplace_back(1, Known.Begin, Known.End);
+  
+  for (auto const &Stream : Unmapped.getStreams())
+    Areas.emplace_back(2, Stream.first, 0);
+  
+  for (auto const &Dir : Unmapped.getDirs())
+    Areas.emplace_back(3, Dir.first, 0);
+  
+  for (auto const &Thread : Unmapped.getThreadStates()) {
+    for (auto const &Function : Thread->getCallStack()) {
+      for (auto const &Alloca : Function->getAllocas())
+        Areas.emplace_back(4, Alloca.getAddress(), Alloca.getTotalSize());
+      
+      for (auto const &ParamByVal : Function->getParamByValStates())
+        Areas.emplace_back(5, ParamByVal.getArea().start(),
+                           ParamByVal.getArea().length());
+    }
+  }
+  
+  std::sort(Areas.begin(), Areas.end());
+  
+  auto Hash = llvm::hash_value(Areas.size());
+  for (auto const &Area : Areas)
+    Hash = llvm::hash_combine(Hash,
+                              std::get<0>(Area),
+                              std::get<1>(Area),
+                              std::get<2>(Area));
+  
+  return Hash;
+}
+
+/// \brief Holds layouts from previous states.
+///
+/// A Value is only replaced by its ValueStore when the memory it occupies
+/// changes, so a layout can be reused if the Value (kept alive by the cache)
+/// is still in use, the same engine is selected, and the same pointers refer
+/// into its memory. Pointers are laid out differently when the areas that they
+/// point to are (de)allocated, so layouts that contain pointers are discarded
+/// whenever the allocations change.
+///
+class LayoutCache {
+  /// \brief A cached layout of a Value.
+  ///
+  struct ValueEntry {
+    std::shared_ptr<Value const> ForValue;
+    
+    LayoutEngineForValue const *Engine;
+    
+    std::vector<std::shared_ptr<ValueOfPointer const>> References;
+    
+    bool ContainsPointers;
+    
+    uint64_t LastUsed;
+    
+    LayoutOfValue Layout;
+  };
+  
+  /// \brief A cached layout of an area.
+  ///
+  struct AreaEntry {
+    MemoryArea Area;
+    
+    std::shared_ptr<ValueOfPointer const> Reference;
+    
+    LayoutEngineForArea const *Engine;
+    
+    std::vector<std::shared_ptr<ValueOfPointer const>> References;
+    
+    bool IsReferenceReferenced;
+    
+    std::vector<std::shared_ptr<Value const>> Pointees;
+    
+    bool ContainsPointers;
+    
+    uint64_t LastUsed;
+    
+    LayoutOfArea Layout;
+  };
+  
+  /// Control access to all members.
+  mutable std::mutex Access;
+  
+  /// Incremented for each process state that is laid out.
+  uint64_t Generation;
+  
+  /// The value of \c hashAllocations() for the most recent state.
+  llvm::hash_code Allocations;
+  
+  /// Value layouts, by the Value.
+  llvm::DenseMap<Value const *, std::unique_ptr<ValueEntry>> Values;
+  
+  /// Area layouts, by the reference used to lay out the area.
+  llvm::DenseMap<ValueOfPointer const *, std::unique_ptr<AreaEntry>> Areas;
+  
+  /// \brief Remove entries that don't satisfy a predicate.
+  ///
+  template<typename MapT, typename PredT>
+  static void retainIf(MapT &Map, PredT Pred) {
+    for (auto It = Map.begin(), End = Map.end(); It != End; ++It)
+      if (!Pred(*It->second))
+        Map.erase(It);
+  }
+  
+public:
+  /// \brief Constructor.
+  ///
+  LayoutCache()
+  : Access(),
+    Generation(0),
+    Allocations(0),
+    Values(),
+    Areas()
+  {}
+  
+  /// \brief Discard all layouts (e.g. when the user changes an engine).
+  ///
+  void clear() {
+    std::lock_guard<std::mutex> Lock(Access);
+    Values.clear();
+    Areas.clear();
+  }
+  
+  /// \brief Start using the cache for a new process state.
+  ///
+  void beginState(seec::cm::ProcessState const &State) {
+    auto const NewAllocations = hashAllocations(State);
+    
+    std::lock_guard<std::mutex> Lock(Access);
+    ++Generation;
+    
+    if (NewAllocations != Allocations) {
+      Allocations = NewAllocations;
+      retainIf(Values, [] (ValueEntry const &E) { return !E.ContainsPointers; });
+      retainIf(Areas, [] (AreaEntry const &E) { return !E.ContainsPointers; });
+    }
+  }
+  
+  /// \brief Finish using the cache for a process state, discarding the
+  ///        layouts that it did not use.
+  ///
+  /// If the layout was cancelled then nothing is discarded, because the
+  /// unfinished layout may not have used all of the reusable layouts.
+  ///
+  void endState(bool const Completed) {
+    if (!Completed)
+      return;
+    
+    std::lock_guard<std::mutex> Lock(Access);
+    auto const Current = Generation;
+    retainIf(Values, [=] (ValueEntry const &E) { return E.LastUsed == Current; });
+    retainIf(Areas, [=] (AreaEntry const &E) { return E.LastUsed == Current; });
+  }
+  
+  /// \brief Find a reusable layout for a Value.
+  ///
+  seec::Maybe<LayoutOfValue>
+  find(Value const &ForValue,
+       LayoutEngineForValue const *Engine,
+       std::vector<std::shared_ptr<ValueOfPointer const>> const &References)
+  {
+    std::lock_guard<std::mutex> Lock(Access);
+    
+    auto const It = Values.find(&ForValue);
+    if (It == Values.end())
+      return seec::Maybe<LayoutOfValue>();
+    
+    auto &Entry = *It->second;
+    if (Entry.Engine != Engine || Entry.References != References)
+      return seec::Maybe<LayoutOfValue>();
+    
+    Entry.LastUsed = Generation;
+    return seec::Maybe<LayoutOfValue>(LayoutOfValue{Entry.Layout});
+  }
+  
+  /// \brief Find a reusable layout for an area.
+  ///
+  seec::Maybe<LayoutOfArea>
+  find(MemoryArea const &Area,
+       ValueOfPointer const &Reference,
+       LayoutEngineForArea const *Engine,
+       std::vector<std::shared_ptr<ValueOfPointer const>> const &References,
+       bool const IsReferenceReferenced)
+  {
+    std::unique_lock<std::mutex> Lock(Access);
+    
+    auto const It = Areas.find(&Reference);
+    if (It == Areas.end())
+      return seec::Maybe<LayoutOfArea>();
+    
+    auto &Entry = *It->second;
+    if (!(Entry.Area == Area)
+        || Entry.Engine != Engine
+        || Entry.References != References
+        || Entry.IsReferenceReferenced != IsReferenceReferenced)
+      return seec::Maybe<LayoutOfArea>();
+    
+    // The pointees are only replaced if their memory changed. Checking them
+    // is much cheaper than generating their layouts, but it doesn't require
+    // the lock, so release it while they are retrieved.
+    auto const Pointees = Entry.Pointees;
+    Lock.unlock();
+    
+    if (Reference.getDereferenceIndexLimit() != int(Pointees.size()))
+      return seec::Maybe<LayoutOfArea>();
+    
+    for (std::size_t i = 0; i < Pointees.size(); ++i)
+      if (Reference.getDereferenced(int(i)) != Pointees[i])
+        return seec::Maybe<LayoutOfArea>();
+    
+    Lock.lock();
+    
+    // Ensure that the entry was not replaced while unlocked.
+    auto const Check = Areas.find(&Reference);
+    if (Check == Areas.end() || Check->second.get() != &Entry)
+      return seec::Maybe<LayoutOfArea>();
+    
+    Entry.LastUsed = Generation;
+    return seec::Maybe<LayoutOfArea>(LayoutOfArea{Entry.Layout});
+  }
+  
+  /// \brief Add the layout of a Value.
+  ///
+  void add(std::shared_ptr<Value const> ForValue,
+           LayoutEngineForValue const *Engine,
+           std::vector<std::shared_ptr<ValueOfPointer const>> References,
+           LayoutOfValue const &Layout)
+  {
+    auto const ContainsPointers =
+      containsPointerType(ForValue->getCanonicalType());
+    
+    auto const Key = ForValue.get();
+    
+    std::lock_guard<std::mutex> Lock(Access);
+    Values[Key].reset(new ValueEntry{std::move(ForValue),
+                                     Engine,
+                                     std::move(References),
+                                     ContainsPointers,
+                                     Generation,
+                                     Layout});
+  }
+  
+  /// \brief Add the layout of an area.
+  ///
+  void add(MemoryArea const &Area,
+           std::shared_ptr<ValueOfPointer const> Reference,
+           LayoutEngineForArea const *Engine,
+           std::vector<std::shared_ptr<ValueOfPointer const>> References,
+           bool const IsReferenceReferenced,
+           LayoutOfArea const &Layout)
+  {
+    auto const PointeeTy = Reference->getCanonicalType()->getPointeeType();
+    auto const ContainsPointers =
+      containsPointerType(PointeeTy.getCanonicalType().getTypePtrOrNull());
+    
+    std::vector<std::shared_ptr<Value const>> Pointees;
+    
+    auto const Limit = Reference->getDereferenceIndexLimit();
+    Pointees.reserve(Limit > 0 ? Limit : 0);
+    for (int i = 0; i < Limit; ++i)
+      Pointees.emplace_back(Reference->getDereferenced(i));
+    
+    auto const Key = Reference.get();
+    
+    std::lock_guard<std::mutex> Lock(Access);
+    Areas[Key].reset(new AreaEntry{Area,
+                                   std::move(Reference),
+                                   Engine,
+                                   std::move(References),
+                                   IsReferenceReferenced,
+                                   std::move(Pointees),
+                                   ContainsPointers,
+                                   Generation,
+                                   Layout});
+  }
+};
+
+
 //===----------------------------------------------------------------------===//
 // LayoutHandler - Layout Engine Handling
 //===----------------------------------------------------------------------===//
 
+LayoutHandler::LayoutHandler()
+: ValueEngines(),
+  ValueEngineDefault(nullptr),
+  ValueEngineOverride(),
+  AreaEngines(),
+  AreaEngineOverride(),
+  AreaReferenceOverride(),
+  Cache(llvm::make_unique<LayoutCache>()),
+  Layered(llvm::make_unique<LayeredLayoutEngine>())
+{}
+
+LayoutHandler::~LayoutHandler() = default;
+
 void LayoutHandler::addBuiltinLayoutEngines() {
   // LayoutEngineForValue:
   addLayoutEngine(llvm::make_unique<LEVCString>(*this));
@@ -2264,6 +2838,9 @@ LayoutHandler::setLayoutEngine(Value const &ForValue, uintptr_t EngineID) {
   
   ValueEngineOverride[std::make_pair(ForValue.getAddress(),
                                      ForValue.getCanonicalType())] = Ptr;
+  
+  // The value may be part of any cached layout.
+  Cache->clear();
 
   return true;
 }
@@ -2301,6 +2878,8 @@ LayoutHandler::setLayoutEngine(MemoryArea const &ForArea,
   
   AreaEngineOverride[std::make_pair(ForArea.start(),
                                     ForReference.getCanonicalType())] = Ptr;
+  
+  Cache->clear();
 
   return true;
 }
@@ -2308,6 +2887,7 @@ LayoutHandler::setLayoutEngine(MemoryArea const &ForArea,
 bool LayoutHandler::setAreaReference(ValueOfPointer const &Reference)
 {
   AreaReferenceOverride[Reference.getRawValue()] = Reference.getCanonicalType();
+  Cache->clear();
   return true;
 }
 
@@ -2362,60 +2942,135 @@ void LayoutHandler::writeStandardProperties(llvm::raw_ostream &Out,
   }
 }
 
-seec::Maybe<LayoutOfValue>
-LayoutHandler::doLayout(seec::cm::Value const &State, Expansion const &E) const
+LayoutEngineForValue const *
+LayoutHandler::getLayoutEngine(Value const &ForValue) const
 {
   // If there's an engine for this exact Value, try to use that.
-  if (State.isInMemory()) {
+  if (ForValue.isInMemory()) {
     auto const It =
-      ValueEngineOverride.find(std::make_pair(State.getAddress(),
-                                              State.getCanonicalType()));
+      ValueEngineOverride.find(std::make_pair(ForValue.getAddress(),
+                                              ForValue.getCanonicalType()));
     
-    if (It != ValueEngineOverride.end() && It->second->canLayout(State))
-      return It->second->doLayout(State, E);
+    if (It != ValueEngineOverride.end() && It->second->canLayout(ForValue))
+      return It->second;
   }
   
   // Otherwise try to use the user-selected global default.
-  if (ValueEngineDefault && ValueEngineDefault->canLayout(State))
-    return ValueEngineDefault->doLayout(State, E);
+  if (ValueEngineDefault && ValueEngineDefault->canLayout(ForValue))
+    return ValueEngineDefault;
   
   // Otherwise try to use any engine that will work.
   for (auto const &EnginePtr : ValueEngines)
-    if (EnginePtr->canLayout(State))
-      return EnginePtr->doLayout(State, E);
+    if (EnginePtr->canLayout(ForValue))
+      return EnginePtr.get();
   
-  return seec::Maybe<LayoutOfValue>();
+  return nullptr;
 }
 
-seec::Maybe<LayoutOfArea>
-LayoutHandler::doLayout(seec::MemoryArea const &Area,
-                        seec::cm::ValueOfPointer const &Reference,
-                        Expansion const &Exp) const
+LayoutEngineForArea const *
+LayoutHandler::getLayoutEngine(seec::MemoryArea const &ForArea,
+                               ValueOfPointer const &ForReference) const
 {
   // If there's a user-selected engine, try to use that.
   auto const It =
-    AreaEngineOverride.find(std::make_pair(Area.start(),
-                                           Reference.getCanonicalType()));
+    AreaEngineOverride.find(std::make_pair(ForArea.start(),
+                                           ForReference.getCanonicalType()));
   
-  if (It != AreaEngineOverride.end() && It->second->canLayout(Area, Reference))
-    return It->second->doLayout(Area, Reference, Exp);
+  if (It != AreaEngineOverride.end()
+      && It->second->canLayout(ForArea, ForReference))
+    return It->second;
   
   // Otherwise try to use any engine that will work.
   for (auto const &EnginePtr : AreaEngines)
-    if (EnginePtr->canLayout(Area, Reference))
-      return EnginePtr->doLayout(Area, Reference, Exp);
+    if (EnginePtr->canLayout(ForArea, ForReference))
+      return EnginePtr.get();
+  
+  return nullptr;
+}
+
+seec::Maybe<LayoutOfValue>
+LayoutHandler::doLayout(seec::cm::Value const &State, Expansion const &E) const
+{
+  if (auto const Engine = getLayoutEngine(State))
+    return Engine->doLayout(State, E);
+  
+  return seec::Maybe<LayoutOfValue>();
+}
+
+seec::Maybe<LayoutOfArea>
+LayoutHandler::doLayout(seec::MemoryArea const &Area,
+                        seec::cm::ValueOfPointer const &Reference,
+                        Expansion const &Exp) const
+{
+  if (auto const Engine = getLayoutEngine(Area, Reference))
+    return Engine->doLayout(Area, Reference, Exp);
   
   return seec::Maybe<LayoutOfArea>();
 }
 
+seec::Maybe<LayoutOfValue>
+LayoutHandler::doLayout(std::shared_ptr<Value const> const &State,
+                        Expansion const &E) const
+{
+  // Values that aren't in memory don't persist between states.
+  if (!State->isInMemory())
+    return doLayout(*State, E);
+  
+  auto const Engine = getLayoutEngine(*State);
+  if (!Engine)
+    return seec::Maybe<LayoutOfValue>();
+  
+  auto const Start = State->getAddress();
+  auto const End = Start + State->getTypeSizeInChars().getQuantity();
+  auto References = getOrderedReferences(E, Start, End);
+  
+  auto Cached = Cache->find(*State, Engine, References);
+  if (Cached.assigned<LayoutOfValue>())
+    return Cached;
+  
+  auto Layout = Engine->doLayout(*State, E);
+  Cache->add(State, Engine, std::move(References), Layout);
+  return seec::Maybe<LayoutOfValue>(std::move(Layout));
+}
+
+seec::Maybe<LayoutOfArea>
+LayoutHandler::doLayout(seec::MemoryArea const &Area,
+                        std::shared_ptr<ValueOfPointer const> const &Reference,
+                        Expansion const &Exp) const
+{
+  auto const Engine = getLayoutEngine(Area, *Reference);
+  if (!Engine)
+    return seec::Maybe<LayoutOfArea>();
+  
+  auto const End = Area.length() ? Area.end() : Area.start() + 1;
+  auto References = getOrderedReferences(Exp, Area.start(), End);
+  auto const IsReferenceReferenced = Exp.isReferencedDirectly(*Reference);
+  
+  auto Cached = Cache->find(Area, *Reference, Engine, References,
+                            IsReferenceReferenced);
+  if (Cached.assigned<LayoutOfArea>())
+    return Cached;
+  
+  auto Layout = Engine->doLayout(Area, *Reference, Exp);
+  Cache->add(Area, Reference, Engine, std::move(References),
+             IsReferenceReferenced, Layout);
+  return seec::Maybe<LayoutOfArea>(std::move(Layout));
+}
+
 LayoutOfProcess
 LayoutHandler::doLayout(seec::cm::ProcessState const &State,
                         std::atomic_bool &CancelIfFalse) const
 {
-  return seec::cm::graph::doLayout(*this,
-                                   State,
-                                   Expansion::from(State),
-                                   CancelIfFalse);
+  Cache->beginState(State);
+  
+  auto Layout = seec::cm::graph::doLayout(*this,
+                                          State,
+                                          Expansion::from(State),
+                                          CancelIfFalse);
+  
+  Cache->endState(CancelIfFalse);
+  
+  return Layout;
 }
 
 LayoutOfProcess
@@ -2425,6 +3080,30 @@ LayoutHandler::doLayout(seec::cm::ProcessState const &State) const
   return doLayout(State, CancelIfFalse);
 }
 
+LayoutOfProcess
+LayoutHandler::doLayeredLayout(seec::cm::ProcessState const &State,
+                               std::atomic_bool &CancelIfFalse) const
+{
+  Cache->beginState(State);
+  
+  auto Layout = seec::cm::graph::doLayeredLayout(*this,
+                                                 State,
+                                                 Expansion::from(State),
+                                                 *Layered,
+                                                 CancelIfFalse);
+  
+  Cache->endState(CancelIfFalse);
+  
+  return Layout;
+}
+
+LayoutOfProcess
+LayoutHandler::doLayeredLayout(seec::cm::ProcessState const &State) const
+{
+  std::atomic_bool CancelIfFalse (true);
+  return doLayeredLayout(State, CancelIfFalse);
+}
+
 
 } // namespace graph (in cm in seec)
 
@@ -0,0 +1,1686 @@
+//===- lib/Clang/GraphLayoutLayered.cpp -----------------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#include "seec/Clang/GraphLayoutLayered.hpp"
+#include "seec/Util/Fallthrough.hpp"
+#include "seec/Util/TaskScheduler.hpp"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <utility>
+
+
+namespace seec {
+
+namespace cm {
+
+namespace graph {
+
+namespace {
+
+
+//===----------------------------------------------------------------------===//
+// Dimensions
+//===----------------------------------------------------------------------===//
+
+/// Font size of all text, matching the "Monospace" font used for dot.
+constexpr double FontSize = 14.0;
+
+/// Approximate advance of a single character in the monospace font.
+constexpr double CharWidth = FontSize * 0.6;
+
+/// Height of a line of text.
+constexpr double LineHeight = FontSize * 1.2;
+
+/// Space around the whole graph.
+constexpr double Margin = 4.0;
+
+/// Vertical space between adjacent nodes in a layer.
+constexpr double NodeSeparation = 18.0;
+
+/// Vertical space between adjacent nodes when either is an edge bend.
+constexpr double BendSeparation = 6.0;
+
+/// Horizontal space between layers.
+constexpr double LayerSeparation = 54.0;
+
+/// Height reserved for an edge passing through a layer.
+constexpr double BendHeight = 4.0;
+
+/// Minimum horizontal extent of the curve leaving or entering a point.
+constexpr double MinimumCurve = 36.0;
+
+/// Length of an arrowhead.
+constexpr double ArrowLength = 10.0;
+
+/// Half of the width of an arrowhead.
+constexpr double ArrowHalfWidth = 3.5;
+
+/// Radius of an "odot" arrow.
+constexpr double DotRadius = 4.0;
+
+/// Number of barycentre sweeps used to reduce crossings.
+constexpr unsigned CrossingSweeps = 4;
+
+
+/// \brief A rectangle, in points.
+///
+struct Rect {
+  double X;
+
+  double Y;
+
+  double Width;
+
+  double Height;
+};
+
+
+//===----------------------------------------------------------------------===//
+// Labels
+//===----------------------------------------------------------------------===//
+
+struct LabelTable;
+
+/// \brief A cell in a node's label.
+///
+struct LabelCell {
+  std::string Port;
+
+  std::string HREF;
+
+  std::string Color;
+
+  std::string BGColor;
+
+  /// The cell's text, still containing HTML entities.
+  std::string Text;
+
+  /// The number of characters in Text.
+  unsigned TextLength = 0;
+
+  unsigned ColSpan = 1;
+
+  unsigned Column = 0;
+
+  /// A table nested in this cell, if any.
+  std::unique_ptr<LabelTable> Table;
+
+  /// The minimum size of this cell.
+  double Width = 0;
+
+  double Height = 0;
+
+  /// The area assigned to this cell, relative to the node.
+  Rect Area = Rect{0, 0, 0, 0};
+};
+
+/// \brief A row of cells in a node's label.
+///
+struct LabelRow {
+  std::vector<LabelCell> Cells;
+};
+
+/// \brief A table in a node's label.
+///
+struct LabelTable {
+  std::string HREF;
+
+  std::string Color;
+
+  double Border = 1;
+
+  double CellBorder = 1;
+
+  double CellSpacing = 2;
+
+  double CellPadding = 2;
+
+  std::vector<LabelRow> Rows;
+
+  std::vector<double> ColumnWidths;
+
+  std::vector<double> RowHeights;
+
+  /// The minimum size of this table.
+  double Width = 0;
+
+  double Height = 0;
+
+  /// The area assigned to this table, relative to the node.
+  Rect Area = Rect{0, 0, 0, 0};
+};
+
+
+/// \brief Check if a name matches an upper-case name, ignoring case.
+///
+bool equalsUpper(llvm::StringRef Name, char const *Upper)
+{
+  auto const Length = std::strlen(Upper);
+  if (Name.size() != Length)
+    return false;
+
+  for (std::size_t i = 0; i < Length; ++i)
+    if (std::toupper(static_cast<unsigned char>(Name[i])) != Upper[i])
+      return false;
+
+  return true;
+}
+
+/// \brief Count the characters in HTML text, treating each entity as one.
+///
+unsigned countCharacters(llvm::StringRef Text)
+{
+  unsigned Count = 0;
+
+  for (std::size_t i = 0; i < Text.size(); ++i) {
+    auto const Char = static_cast<unsigned char>(Text[i]);
+
+    if (Char == '&') {
+      auto const End = Text.find(';', i);
+      if (End != llvm::StringRef::npos)
+        i = End;
+    }
+    else if ((Char & 0xC0) == 0x80) {
+      continue; // UTF-8 continuation byte.
+    }
+
+    ++Count;
+  }
+
+  return Count;
+}
+
+
+/// \brief Parses the HTML-like labels that are generated for dot.
+///
+/// Only TABLE, TR and TD elements are interpreted; other elements are
+/// ignored, but their text is kept.
+///
+class LabelParser {
+  /// \brief An opening or closing tag.
+  ///
+  struct Tag {
+    llvm::StringRef Name;
+
+    bool Closing = false;
+
+    bool SelfClosing = false;
+
+    llvm::SmallVector<std::pair<llvm::StringRef, llvm::StringRef>, 4>
+      Attributes;
+
+    bool is(char const *Upper) const { return equalsUpper(Name, Upper); }
+
+    bool get(char const *Upper, llvm::StringRef &Value) const {
+      for (auto const &Attribute : Attributes) {
+        if (equalsUpper(Attribute.first, Upper)) {
+          Value = Attribute.second;
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    void get(char const *Upper, std::string &Value) const {
+      llvm::StringRef Found;
+      if (get(Upper, Found))
+        Value = Found.str();
+    }
+
+    void get(char const *Upper, double &Value) const {
+      llvm::StringRef Found;
+      unsigned Number;
+      if (get(Upper, Found) && !Found.getAsInteger(10, Number))
+        Value = Number;
+    }
+  };
+
+  llvm::StringRef Text;
+
+  std::size_t Pos;
+
+  bool atEnd() const { return Pos >= Text.size(); }
+
+  bool atTag() const { return !atEnd() && Text[Pos] == '<'; }
+
+  void skipSpace() {
+    while (!atEnd() && std::isspace(static_cast<unsigned char>(Text[Pos])))
+      ++Pos;
+  }
+
+  /// \brief Read text up to the next tag.
+  ///
+  llvm::StringRef readText() {
+    auto const Start = Pos;
+    Pos = std::min(Text.find('<', Pos), Text.size());
+    return Text.slice(Start, Pos);
+  }
+
+  /// \brief Read the tag that starts at the current position.
+  ///
+  bool readTag(Tag &Out) {
+    ++Pos; // '<'
+
+    if (!atEnd() && Text[Pos] == '/') {
+      Out.Closing = true;
+      ++Pos;
+    }
+
+    auto const NameStart = Pos;
+    while (!atEnd() && std::isalnum(static_cast<unsigned char>(Text[Pos])))
+      ++Pos;
+    Out.Name = Text.slice(NameStart, Pos);
+
+    while (true) {
+      skipSpace();
+      if (atEnd())
+        return false;
+
+      auto const Char = Text[Pos];
+
+      if (Char == '>') {
+        ++Pos;
+        return true;
+      }
+
+      if (Char == '/') {
+        Out.SelfClosing = true;
+        ++Pos;
+        continue;
+      }
+
+      auto const AttrStart = Pos;
+      while (!atEnd()
+             && !std::isspace(static_cast<unsigned char>(Text[Pos]))
+             && Text[Pos] != '=' && Text[Pos] != '>' && Text[Pos] != '/')
+        ++Pos;
+
+      auto const AttrName = Text.slice(AttrStart, Pos);
+      if (AttrName.empty())
+        return false;
+
+      llvm::StringRef AttrValue;
+
+      skipSpace();
+      if (!atEnd() && Text[Pos] == '=') {
+        ++Pos;
+        skipSpace();
+        if (atEnd())
+          return false;
+
+        auto const Quote = Text[Pos];
+        if (Quote == '"' || Quote == '\'') {
+          auto const End = Text.find(Quote, Pos + 1);
+          if (End == llvm::StringRef::npos)
+            return false;
+
+          AttrValue = Text.slice(Pos + 1, End);
+          Pos = End + 1;
+        }
+        else {
+          auto const ValueStart = Pos;
+          while (!atEnd()
+                 && !std::isspace(static_cast<unsigned char>(Text[Pos]))
+                 && Text[Pos] != '>')
+            ++Pos;
+          AttrValue = Text.slice(ValueStart, Pos);
+        }
+      }
+
+      Out.Attributes.emplace_back(AttrName, AttrValue);
+    }
+  }
+
+  bool parseCell(Tag const &Open, LabelCell &Cell) {
+    Open.get("PORT", Cell.Port);
+    Open.get("HREF", Cell.HREF);
+    Open.get("COLOR", Cell.Color);
+    Open.get("BGCOLOR", Cell.BGColor);
+
+    double ColSpan = 1;
+    Open.get("COLSPAN", ColSpan);
+    Cell.ColSpan = std::max(1u, static_cast<unsigned>(ColSpan));
+
+    if (Open.SelfClosing)
+      return true;
+
+    while (!atEnd()) {
+      if (!atTag()) {
+        Cell.Text += readText();
+        continue;
+      }
+
+      Tag Next;
+      if (!readTag(Next))
+        return false;
+
+      if (Next.is("TD") && Next.Closing) {
+        Cell.TextLength = countCharacters(Cell.Text);
+        return true;
+      }
+
+      if (Next.is("TABLE") && !Next.Closing) {
+        Cell.Table = parseTable(Next);
+        if (!Cell.Table)
+          return false;
+      }
+    }
+
+    return false;
+  }
+
+  bool parseRow(LabelRow &Row) {
+    while (!atEnd()) {
+      if (!atTag()) {
+        readText();
+        continue;
+      }
+
+      Tag Next;
+      if (!readTag(Next))
+        return false;
+
+      if (Next.is("TR") && Next.Closing)
+        return true;
+
+      if (Next.is("TD") && !Next.Closing) {
+        Row.Cells.emplace_back();
+        if (!parseCell(Next, Row.Cells.back()))
+          return false;
+      }
+    }
+
+    return false;
+  }
+
+  std::unique_ptr<LabelTable> parseTable(Tag const &Open) {
+    auto Table = llvm::make_unique<LabelTable>();
+
+    Open.get("HREF", Table->HREF);
+    Open.get("COLOR", Table->Color);
+    Open.get("BORDER", Table->Border);
+    Open.get("CELLSPACING", Table->CellSpacing);
+    Open.get("CELLPADDING", Table->CellPadding);
+
+    // Cells have the table's border unless otherwise specified.
+    Table->CellBorder = Table->Border;
+    Open.get("CELLBORDER", Table->CellBorder);
+
+    if (Open.SelfClosing)
+      return Table;
+
+    while (!atEnd()) {
+      if (!atTag()) {
+        readText();
+        continue;
+      }
+
+      Tag Next;
+      if (!readTag(Next))
+        return nullptr;
+
+      if (Next.is("TABLE") && Next.Closing)
+        return Table;
+
+      if (Next.is("TR") && !Next.Closing && !Next.SelfClosing) {
+        Table->Rows.emplace_back();
+        if (!parseRow(Table->Rows.back()))
+          return nullptr;
+      }
+    }
+
+    return nullptr;
+  }
+
+public:
+  LabelParser(llvm::StringRef WithText)
+  : Text(WithText),
+    Pos(0)
+  {}
+
+  /// \brief Parse the label.
+  /// \return the outermost table, or nullptr if the label is not a table.
+  ///
+  std::unique_ptr<LabelTable> parse() {
+    skipSpace();
+    if (!atTag())
+      return nullptr;
+
+    Tag Open;
+    if (!readTag(Open) || !Open.is("TABLE") || Open.Closing)
+      return nullptr;
+
+    return parseTable(Open);
+  }
+};
+
+
+/// \brief Calculate the minimum size of a table and its cells.
+///
+void measure(LabelTable &Table)
+{
+  std::size_t ColumnCount = 0;
+
+  for (auto &Row : Table.Rows) {
+    unsigned Column = 0;
+
+    for (auto &Cell : Row.Cells) {
+      Cell.Column = Column;
+      Column += Cell.ColSpan;
+
+      double ContentWidth = Cell.TextLength * CharWidth;
+      double ContentHeight = LineHeight;
+
+      if (Cell.Table) {
+        measure(*Cell.Table);
+        ContentWidth = Cell.Table->Width;
+        ContentHeight = Cell.Table->Height;
+      }
+
+      auto const Inset = 2 * (Table.CellPadding + Table.CellBorder);
+      Cell.Width = ContentWidth + Inset;
+      Cell.Height = ContentHeight + Inset;
+    }
+
+    ColumnCount = std::max<std::size_t>(ColumnCount, Column);
+  }
+
+  Table.ColumnWidths.assign(ColumnCount, 0);
+  Table.RowHeights.assign(Table.Rows.size(), 0);
+
+  // Columns are at least as wide as their single-column cells.
+  for (std::size_t RowIndex = 0; RowIndex < Table.Rows.size(); ++RowIndex) {
+    for (auto const &Cell : Table.Rows[RowIndex].Cells) {
+      Table.RowHeights[RowIndex] = std::max(Table.RowHeights[RowIndex],
+                                            Cell.Height);
+
+      if (Cell.ColSpan == 1)
+        Table.ColumnWidths[Cell.Column] = std::max(Table.ColumnWidths
+                                                     [Cell.Column],
+                                                   Cell.Width);
+    }
+  }
+
+  // Widen the spanned columns for cells that don't fit.
+  for (auto const &Row : Table.Rows) {
+    for (auto const &Cell : Row.Cells) {
+      if (Cell.ColSpan == 1)
+        continue;
+
+      double Available = (Cell.ColSpan - 1) * Table.CellSpacing;
+      for (unsigned i = 0; i < Cell.ColSpan; ++i)
+        Available += Table.ColumnWidths[Cell.Column + i];
+
+      if (Cell.Width > Available) {
+        auto const Extra = (Cell.Width - Available) / Cell.ColSpan;
+        for (unsigned i = 0; i < Cell.ColSpan; ++i)
+          Table.ColumnWidths[Cell.Column + i] += Extra;
+      }
+    }
+  }
+
+  Table.Width = 2 * Table.Border + (ColumnCount + 1) * Table.CellSpacing;
+  for (auto const Width : Table.ColumnWidths)
+    Table.Width += Width;
+
+  Table.Height = 2 * Table.Border
+               + (Table.Rows.size() + 1) * Table.CellSpacing;
+  for (auto const Height : Table.RowHeights)
+    Table.Height += Height;
+}
+
+/// \brief Assign an area to a measured table, and to its cells.
+///
+/// Any space beyond the table's minimum size is shared between its columns and
+/// rows, so that nested tables fill their cells.
+///
+void place(LabelTable &Table, Rect const &Area)
+{
+  Table.Area = Area;
+
+  if (!Table.ColumnWidths.empty() && Area.Width > Table.Width) {
+    auto const Extra = (Area.Width - Table.Width) / Table.ColumnWidths.size();
+    for (auto &Width : Table.ColumnWidths)
+      Width += Extra;
+  }
+
+  if (!Table.RowHeights.empty() && Area.Height > Table.Height) {
+    auto const Extra = (Area.Height - Table.Height) / Table.RowHeights.size();
+    for (auto &Height : Table.RowHeights)
+      Height += Extra;
+  }
+
+  std::vector<double> ColumnX;
+  ColumnX.reserve(Table.ColumnWidths.size());
+
+  auto X = Area.X + Table.Border + Table.CellSpacing;
+  for (auto const Width : Table.ColumnWidths) {
+    ColumnX.push_back(X);
+    X += Width + Table.CellSpacing;
+  }
+
+  auto Y = Area.Y + Table.Border + Table.CellSpacing;
+
+  for (std::size_t RowIndex = 0; RowIndex < Table.Rows.size(); ++RowIndex) {
+    auto const Height = Table.RowHeights[RowIndex];
+
+    for (auto &Cell : Table.Rows[RowIndex].Cells) {
+      double Width = (Cell.ColSpan - 1) * Table.CellSpacing;
+      for (unsigned i = 0; i < Cell.ColSpan; ++i)
+        Width += Table.ColumnWidths[Cell.Column + i];
+
+      Cell.Area = Rect{ColumnX[Cell.Column], Y, Width, Height};
+
+      if (Cell.Table) {
+        auto const Inset = Table.CellPadding + Table.CellBorder;
+        place(*Cell.Table, Rect{Cell.Area.X + Inset,
+                                Cell.Area.Y + Inset,
+                                Cell.Area.Width - 2 * Inset,
+                                Cell.Area.Height - 2 * Inset});
+      }
+    }
+
+    Y += Height + Table.CellSpacing;
+  }
+}
+
+/// \brief Get the areas of all cells that have ports.
+///
+void collectPorts(LabelTable const &Table,
+                  std::vector<std::pair<std::string, Rect>> &Ports)
+{
+  for (auto const &Row : Table.Rows) {
+    for (auto const &Cell : Row.Cells) {
+      if (!Cell.Port.empty())
+        Ports.emplace_back(Cell.Port, Cell.Area);
+      if (Cell.Table)
+        collectPorts(*Cell.Table, Ports);
+    }
+  }
+}
+
+
+//===----------------------------------------------------------------------===//
+// SVG output
+//===----------------------------------------------------------------------===//
+
+/// \brief Escape text for use in XML.
+///
+std::string escapeXML(llvm::StringRef Text)
+{
+  std::string Escaped;
+  Escaped.reserve(Text.size());
+
+  for (auto const Char : Text) {
+    switch (Char) {
+      case '&':  Escaped += "&amp;";  break;
+      case '<':  Escaped += "&lt;";   break;
+      case '>':  Escaped += "&gt;";   break;
+      case '"':  Escaped += "&quot;"; break;
+      case '\'': Escaped += "&#39;";  break;
+      default:   Escaped.push_back(Char); break;
+    }
+  }
+
+  return Escaped;
+}
+
+std::string lowercase(std::string Text)
+{
+  for (auto &Char : Text)
+    Char = std::tolower(static_cast<unsigned char>(Char));
+  return Text;
+}
+
+/// \brief Get a colour for use in SVG (Graphviz writes colours in lower case).
+///
+std::string getColor(std::string const &Color, char const *Default)
+{
+  return Color.empty() ? std::string(Default) : escapeXML(lowercase(Color));
+}
+
+/// \brief Write a number with two decimal places.
+///
+void writeNumber(llvm::raw_ostream &Out, double const Value)
+{
+  auto Hundredths = std::llround(Value * 100);
+  if (Hundredths < 0) {
+    Out << '-';
+    Hundredths = -Hundredths;
+  }
+
+  auto const Fraction = Hundredths % 100;
+  Out << (Hundredths / 100) << '.'
+      << static_cast<char>('0' + Fraction / 10)
+      << static_cast<char>('0' + Fraction % 10);
+}
+
+void writePoint(llvm::raw_ostream &Out, double const X, double const Y)
+{
+  writeNumber(Out, X);
+  Out << ',';
+  writeNumber(Out, Y);
+}
+
+void writePolygon(llvm::raw_ostream &Out,
+                  llvm::StringRef Fill,
+                  llvm::StringRef Stroke,
+                  Rect const &Area)
+{
+  auto const Right = Area.X + Area.Width;
+  auto const Bottom = Area.Y + Area.Height;
+
+  Out << "<polygon fill=\"" << Fill << "\" stroke=\"" << Stroke
+      << "\" points=\"";
+  writePoint(Out, Area.X, Area.Y);
+  Out << ' ';
+  writePoint(Out, Right, Area.Y);
+  Out << ' ';
+  writePoint(Out, Right, Bottom);
+  Out << ' ';
+  writePoint(Out, Area.X, Bottom);
+  Out << ' ';
+  writePoint(Out, Area.X, Area.Y);
+  Out << "\"/>\n";
+}
+
+/// \brief Write the start of a link, in the same form as Graphviz.
+///
+void writeLinkStart(llvm::raw_ostream &Out,
+                    llvm::StringRef GroupID,
+                    llvm::StringRef HREF)
+{
+  Out << "<g id=\"" << GroupID << "\"><a xlink:href=\"" << escapeXML(HREF)
+      << "\">\n";
+}
+
+void writeLinkEnd(llvm::raw_ostream &Out)
+{
+  Out << "</a>\n</g>\n";
+}
+
+void writeTable(llvm::raw_ostream &Out,
+                LabelTable const &Table,
+                double X,
+                double Y,
+                std::size_t NodeNumber,
+                unsigned &LinkCount);
+
+void writeCell(llvm::raw_ostream &Out,
+               LabelTable const &Table,
+               LabelCell const &Cell,
+               double X,
+               double Y,
+               std::size_t NodeNumber,
+               unsigned &LinkCount)
+{
+  auto const Area = Rect{X + Cell.Area.X, Y + Cell.Area.Y,
+                         Cell.Area.Width, Cell.Area.Height};
+
+  if (!Cell.HREF.empty()) {
+    std::string GroupID;
+    llvm::raw_string_ostream GroupIDStream {GroupID};
+    GroupIDStream << "a_node" << NodeNumber << '_' << LinkCount++;
+    writeLinkStart(Out, GroupIDStream.str(), Cell.HREF);
+  }
+
+  if (!Cell.BGColor.empty())
+    writePolygon(Out, getColor(Cell.BGColor, "none"), "transparent", Area);
+
+  if (Table.CellBorder > 0)
+    writePolygon(Out, "none", getColor(Cell.Color, "black"), Area);
+
+  auto const Text = llvm::StringRef(Cell.Text).trim();
+  if (!Cell.Table && !Text.empty()) {
+    Out << "<text text-anchor=\"middle\" x=\"";
+    writeNumber(Out, Area.X + Area.Width / 2);
+    Out << "\" y=\"";
+    writeNumber(Out, Area.Y + Area.Height / 2 + FontSize * 0.3);
+    Out << "\" font-family=\"Monospace\" font-size=\"";
+    writeNumber(Out, FontSize);
+    Out << "\">" << Text << "</text>\n";
+  }
+
+  // SVG doesn't allow links to be nested, so the cell's link is closed
+  // before any nested table is written.
+  if (!Cell.HREF.empty())
+    writeLinkEnd(Out);
+
+  if (Cell.Table)
+    writeTable(Out, *Cell.Table, X, Y, NodeNumber, LinkCount);
+}
+
+void writeTable(llvm::raw_ostream &Out,
+                LabelTable const &Table,
+                double X,
+                double Y,
+                std::size_t NodeNumber,
+                unsigned &LinkCount)
+{
+  auto const Area = Rect{X + Table.Area.X, Y + Table.Area.Y,
+                         Table.Area.Width, Table.Area.Height};
+
+  if (!Table.HREF.empty()) {
+    std::string GroupID;
+    llvm::raw_string_ostream GroupIDStream {GroupID};
+    GroupIDStream << "a_node" << NodeNumber << '_' << LinkCount++;
+    writeLinkStart(Out, GroupIDStream.str(), Table.HREF);
+    writePolygon(Out, "none", "transparent", Area);
+    writeLinkEnd(Out);
+  }
+
+  if (Table.Border > 0)
+    writePolygon(Out, "none", getColor(Table.Color, "black"), Area);
+
+  for (auto const &Row : Table.Rows)
+    for (auto const &Cell : Row.Cells)
+      writeCell(Out, Table, Cell, X, Y, NodeNumber, LinkCount);
+}
+
+
+//===----------------------------------------------------------------------===//
+// Nodes
+//===----------------------------------------------------------------------===//
+
+/// \brief The parsed and measured label of a node.
+///
+struct NodeGeometry {
+  std::unique_ptr<LabelTable> Table;
+
+  /// Areas of the node's ports, sorted by name.
+  std::vector<std::pair<std::string, Rect>> Ports;
+
+  double Width = 0;
+
+  double Height = 0;
+
+  /// \brief Get the area of a port, or of the whole node if the port is not
+  ///        found.
+  ///
+  Rect getPort(llvm::StringRef Name) const {
+    if (!Name.empty()) {
+      auto const It = std::lower_bound(Ports.begin(), Ports.end(), Name,
+                        [] (std::pair<std::string, Rect> const &Port,
+                            llvm::StringRef const Key) {
+                          return llvm::StringRef(Port.first) < Key;
+                        });
+
+      if (It != Ports.end() && It->first == Name)
+        return It->second;
+    }
+
+    return Rect{0, 0, Width, Height};
+  }
+};
+
+/// \brief Parse, measure and place the label of a node.
+///
+NodeGeometry layoutLabel(LayeredNode const &Node)
+{
+  NodeGeometry Geometry;
+
+  Geometry.Table = LabelParser(Node.Label).parse();
+
+  // If the label can't be understood, show the node's ID instead.
+  if (!Geometry.Table) {
+    Geometry.Table = llvm::make_unique<LabelTable>();
+    Geometry.Table->Border = 0;
+    Geometry.Table->Rows.emplace_back();
+    Geometry.Table->Rows.back().Cells.emplace_back();
+
+    auto &Cell = Geometry.Table->Rows.back().Cells.back();
+    Cell.Text = escapeXML(Node.ID);
+    Cell.TextLength = countCharacters(Cell.Text);
+  }
+
+  measure(*Geometry.Table);
+  place(*Geometry.Table,
+        Rect{0, 0, Geometry.Table->Width, Geometry.Table->Height});
+
+  collectPorts(*Geometry.Table, Geometry.Ports);
+  std::sort(Geometry.Ports.begin(), Geometry.Ports.end(),
+            [] (std::pair<std::string, Rect> const &A,
+                std::pair<std::string, Rect> const &B) {
+              return A.first < B.first;
+            });
+
+  Geometry.Width = Geometry.Table->Width;
+  Geometry.Height = Geometry.Table->Height;
+
+  return Geometry;
+}
+
+
+//===----------------------------------------------------------------------===//
+// Edges
+//===----------------------------------------------------------------------===//
+
+/// \brief A point on an edge's route, with the horizontal direction that the
+///        edge travels through it (+1 for rightwards, -1 for leftwards).
+///
+struct RoutePoint {
+  double X;
+
+  double Y;
+
+  double Direction;
+};
+
+/// \brief Write the arrow at one end of an edge.
+/// \param Tip the end of the edge.
+/// \param Outward the horizontal direction from the edge to the tip.
+/// \return the point where the edge's path should end.
+///
+std::pair<double, double> writeArrow(llvm::raw_ostream &Out,
+                                     LayeredArrowType const Type,
+                                     std::string const &Color,
+                                     double const TipX,
+                                     double const TipY,
+                                     double const Outward)
+{
+  switch (Type) {
+    case LayeredArrowType::None:
+      return std::make_pair(TipX, TipY);
+
+    case LayeredArrowType::Normal: SEEC_FALLTHROUGH;
+    case LayeredArrowType::Open:
+    {
+      auto const BaseX = TipX - Outward * ArrowLength;
+      auto const Fill = Type == LayeredArrowType::Normal ? Color
+                                                         : std::string("none");
+
+      Out << "<polygon fill=\"" << Fill << "\" stroke=\"" << Color
+          << "\" points=\"";
+      writePoint(Out, BaseX, TipY - ArrowHalfWidth);
+      Out << ' ';
+      writePoint(Out, TipX, TipY);
+      Out << ' ';
+      writePoint(Out, BaseX, TipY + ArrowHalfWidth);
+      Out << ' ';
+      writePoint(Out, BaseX, TipY - ArrowHalfWidth);
+      Out << "\"/>\n";
+
+      return std::make_pair(BaseX, TipY);
+    }
+
+    case LayeredArrowType::OpenDot:
+    {
+      Out << "<ellipse fill=\"none\" stroke=\"" << Color << "\" cx=\"";
+      writeNumber(Out, TipX - Outward * DotRadius);
+      Out << "\" cy=\"";
+      writeNumber(Out, TipY);
+      Out << "\" rx=\"";
+      writeNumber(Out, DotRadius);
+      Out << "\" ry=\"";
+      writeNumber(Out, DotRadius);
+      Out << "\"/>\n";
+
+      return std::make_pair(TipX - Outward * 2 * DotRadius, TipY);
+    }
+  }
+
+  return std::make_pair(TipX, TipY);
+}
+
+/// \brief Write an edge that follows a route.
+///
+void writeEdge(llvm::raw_ostream &Out,
+               std::size_t const EdgeNumber,
+               LayeredEdge const &Edge,
+               LayeredNode const &Tail,
+               LayeredNode const &Head,
+               std::vector<RoutePoint> Route)
+{
+  auto const Color = getColor(Edge.Color, "black");
+
+  Out << "<g id=\"edge" << EdgeNumber << "\" class=\"edge\">\n<title>"
+      << escapeXML(Tail.ID) << "&#45;&gt;" << escapeXML(Head.ID)
+      << "</title>\n";
+
+  if (!Edge.HREF.empty()) {
+    std::string GroupID;
+    llvm::raw_string_ostream GroupIDStream {GroupID};
+    GroupIDStream << "a_edge" << EdgeNumber;
+    writeLinkStart(Out, GroupIDStream.str(), Edge.HREF);
+  }
+
+  // Draw the arrows, and shorten the route to meet them.
+  std::string Arrows;
+  llvm::raw_string_ostream ArrowStream {Arrows};
+
+  auto &First = Route.front();
+  auto const TailEnd = writeArrow(ArrowStream, Edge.TailArrow, Color,
+                                  First.X, First.Y, -First.Direction);
+  First.X = TailEnd.first;
+
+  auto &Last = Route.back();
+  auto const HeadEnd = writeArrow(ArrowStream, Edge.HeadArrow, Color,
+                                  Last.X, Last.Y, Last.Direction);
+  Last.X = HeadEnd.first;
+
+  // Each step of the route is a cubic Bézier curve that leaves and enters
+  // horizontally.
+  Out << "<path fill=\"none\" stroke=\"" << Color << "\"";
+  if (Edge.Dashed)
+    Out << " stroke-dasharray=\"5,2\"";
+  Out << " d=\"M";
+  writePoint(Out, Route.front().X, Route.front().Y);
+
+  for (std::size_t i = 1; i < Route.size(); ++i) {
+    auto const &From = Route[i - 1];
+    auto const &To = Route[i];
+    auto const Reach = std::max(std::abs(To.X - From.X) / 2, MinimumCurve);
+
+    Out << 'C';
+    writePoint(Out, From.X + From.Direction * Reach, From.Y);
+    Out << ' ';
+    writePoint(Out, To.X - To.Direction * Reach, To.Y);
+    Out << ' ';
+    writePoint(Out, To.X, To.Y);
+  }
+
+  Out << "\"/>\n" << ArrowStream.str();
+
+  if (!Edge.HREF.empty())
+    writeLinkEnd(Out);
+
+  Out << "</g>\n";
+}
+
+
+//===----------------------------------------------------------------------===//
+// Layout
+//===----------------------------------------------------------------------===//
+
+/// \brief A part of an edge that connects vertices in adjacent layers.
+///
+struct Segment {
+  std::size_t Upper;
+
+  std::size_t Lower;
+
+  /// Vertical position of the segment's end, relative to the upper vertex.
+  double UpperOffset;
+
+  /// Vertical position of the segment's end, relative to the lower vertex.
+  double LowerOffset;
+};
+
+/// \brief Build a compressed adjacency list.
+/// \param Key gets the vertex that an item belongs to (or VertexCount to
+///        exclude the item).
+///
+template<typename KeyFnT>
+void buildAdjacency(std::size_t const VertexCount,
+                    std::size_t const ItemCount,
+                    KeyFnT Key,
+                    std::vector<std::size_t> &Start,
+                    std::vector<std::size_t> &Items)
+{
+  Start.assign(VertexCount + 1, 0);
+
+  for (std::size_t i = 0; i < ItemCount; ++i) {
+    auto const Vertex = Key(i);
+    if (Vertex < VertexCount)
+      ++Start[Vertex + 1];
+  }
+
+  for (std::size_t i = 0; i < VertexCount; ++i)
+    Start[i + 1] += Start[i];
+
+  Items.resize(Start[VertexCount]);
+
+  auto Next = Start;
+  for (std::size_t i = 0; i < ItemCount; ++i) {
+    auto const Vertex = Key(i);
+    if (Vertex < VertexCount)
+      Items[Next[Vertex]++] = i;
+  }
+}
+
+
+} // anonymous namespace
+
+
+//===----------------------------------------------------------------------===//
+// LayeredLayoutEngine
+//===----------------------------------------------------------------------===//
+
+std::string LayeredLayoutEngine::render(LayeredGraph const &Graph,
+                                        std::atomic_bool const *CancelIfFalse)
+{
+  auto const IsCancelled = [=] () {
+    return CancelIfFalse && *CancelIfFalse == false;
+  };
+
+  auto &Scheduler = seec::TaskScheduler::getShared();
+
+  auto const &Nodes = Graph.getNodes();
+  auto const &Edges = Graph.getEdges();
+  auto const NodeCount = Nodes.size();
+  auto const EdgeCount = Edges.size();
+
+  // Parse and measure all labels.
+  std::vector<NodeGeometry> Geometry(NodeCount);
+
+  // If the loop was cancelled then some nodes have no geometry, so stop even
+  // if CancelIfFalse has since been reset.
+  auto const Measured =
+    Scheduler.parallelFor(NodeCount, 0,
+                          [&] (std::size_t const i) {
+                            Geometry[i] = layoutLabel(Nodes[i]);
+                          },
+                          CancelIfFalse);
+
+  if (!Measured || IsCancelled())
+    return std::string();
+
+  // Find the placements of nodes from the previous layout. If most nodes are
+  // unchanged then we lay out incrementally, around the existing nodes.
+  std::vector<Placement const *> Prior(NodeCount, nullptr);
+  std::size_t PriorCount = 0;
+
+  for (std::size_t i = 0; i < NodeCount; ++i) {
+    auto const It = Previous.find(Nodes[i].ID);
+    if (It != Previous.end()) {
+      Prior[i] = &It->second;
+      ++PriorCount;
+    }
+  }
+
+  auto const Incremental = PriorCount != 0 && PriorCount * 2 >= NodeCount;
+  if (!Incremental)
+    std::fill(Prior.begin(), Prior.end(), nullptr);
+
+  // Ignore edges that refer to non-existent nodes.
+  auto const IsValid = [&] (LayeredEdge const &Edge) {
+    return Edge.Tail < NodeCount && Edge.Head < NodeCount;
+  };
+
+  // Break cycles by reversing the edges that a depth-first search finds
+  // going back to a node on the stack. When laying out incrementally, visit
+  // nodes in their previous layer order, so that the same edges are reversed.
+  std::vector<std::size_t> OutStart, OutEdges;
+  buildAdjacency(NodeCount, EdgeCount,
+                 [&] (std::size_t const i) {
+                   auto const &Edge = Edges[i];
+                   return IsValid(Edge) && Edge.Tail != Edge.Head ? Edge.Tail
+                                                                  : NodeCount;
+                 },
+                 OutStart, OutEdges);
+
+  std::vector<std::size_t> Roots(NodeCount);
+  for (std::size_t i = 0; i < NodeCount; ++i)
+    Roots[i] = i;
+
+  if (Incremental) {
+    std::stable_sort(Roots.begin(), Roots.end(),
+      [&] (std::size_t const A, std::size_t const B) {
+        auto const LayerA = Prior[A] ? Prior[A]->Layer : ~0u;
+        auto const LayerB = Prior[B] ? Prior[B]->Layer : ~0u;
+        return LayerA < LayerB;
+      });
+  }
+
+  std::vector<bool> Reversed(EdgeCount, false);
+
+  {
+    enum class Visit : unsigned char { None, Active, Done };
+    std::vector<Visit> Visited(NodeCount, Visit::None);
+    std::vector<std::pair<std::size_t, std::size_t>> Stack;
+
+    for (auto const Root : Roots) {
+      if (Visited[Root] != Visit::None)
+        continue;
+
+      Visited[Root] = Visit::Active;
+      Stack.emplace_back(Root, OutStart[Root]);
+
+      while (!Stack.empty()) {
+        auto const Node = Stack.back().first;
+        auto const Next = Stack.back().second;
+
+        if (Next == OutStart[Node + 1]) {
+          Visited[Node] = Visit::Done;
+          Stack.pop_back();
+          continue;
+        }
+
+        ++Stack.back().second;
+
+        auto const EdgeIndex = OutEdges[Next];
+        auto const Head = Edges[EdgeIndex].Head;
+
+        if (Visited[Head] == Visit::Active) {
+          Reversed[EdgeIndex] = true;
+        }
+        else if (Visited[Head] == Visit::None) {
+          Visited[Head] = Visit::Active;
+          Stack.emplace_back(Head, OutStart[Head]);
+        }
+      }
+    }
+  }
+
+  auto const getUpper = [&] (std::size_t const i) {
+    return Reversed[i] ? Edges[i].Head : Edges[i].Tail;
+  };
+
+  auto const getLower = [&] (std::size_t const i) {
+    return Reversed[i] ? Edges[i].Tail : Edges[i].Head;
+  };
+
+  // Assign layers using the longest path from the sources. Nodes from the
+  // previous layout don't move to earlier layers.
+  std::vector<unsigned> Layer(NodeCount, 0);
+
+  {
+    std::vector<std::size_t> DownStart, DownEdges;
+    buildAdjacency(NodeCount, EdgeCount,
+                   [&] (std::size_t const i) {
+                     auto const &Edge = Edges[i];
+                     return IsValid(Edge) && Edge.Tail != Edge.Head
+                            ? getUpper(i) : NodeCount;
+                   },
+                   DownStart, DownEdges);
+
+    std::vector<std::size_t> InCount(NodeCount, 0);
+    for (auto const EdgeIndex : DownEdges)
+      ++InCount[getLower(EdgeIndex)];
+
+    std::vector<std::size_t> Queue;
+    Queue.reserve(NodeCount);
+
+    for (std::size_t i = 0; i < NodeCount; ++i) {
+      if (Prior[i])
+        Layer[i] = Prior[i]->Layer;
+      if (InCount[i] == 0)
+        Queue.push_back(i);
+    }
+
+    for (std::size_t QueueIndex = 0; QueueIndex < Queue.size(); ++QueueIndex) {
+      auto const Node = Queue[QueueIndex];
+
+      for (auto i = DownStart[Node]; i < DownStart[Node + 1]; ++i) {
+        auto const Lower = getLower(DownEdges[i]);
+        Layer[Lower] = std::max(Layer[Lower], Layer[Node] + 1);
+        if (--InCount[Lower] == 0)
+          Queue.push_back(Lower);
+      }
+    }
+
+    // Remove empty layers.
+    unsigned MaxLayer = 0;
+    for (auto const L : Layer)
+      MaxLayer = std::max(MaxLayer, L);
+
+    std::vector<unsigned> Compacted(MaxLayer + 1, 0);
+    for (auto const L : Layer)
+      Compacted[L] = 1;
+
+    unsigned Used = 0;
+    for (auto &L : Compacted) {
+      auto const IsUsed = L;
+      L = Used;
+      Used += IsUsed;
+    }
+
+    for (auto &L : Layer)
+      L = Compacted[L];
+  }
+
+  // Find where each edge attaches to its nodes.
+  std::vector<Rect> TailPorts(EdgeCount), HeadPorts(EdgeCount);
+  std::vector<double> TailOffsets(EdgeCount), HeadOffsets(EdgeCount);
+
+  for (std::size_t i = 0; i < EdgeCount; ++i) {
+    auto const &Edge = Edges[i];
+    if (!IsValid(Edge))
+      continue;
+
+    TailPorts[i] = Geometry[Edge.Tail].getPort(Edge.TailPort);
+    HeadPorts[i] = Geometry[Edge.Head].getPort(Edge.HeadPort);
+
+    TailOffsets[i] = TailPorts[i].Y + TailPorts[i].Height / 2;
+    HeadOffsets[i] = Edge.HeadAnchor == LayeredAnchor::NorthWest
+                   ? HeadPorts[i].Y
+                   : HeadPorts[i].Y + HeadPorts[i].Height / 2;
+  }
+
+  // Create vertices for the nodes, and for the bends where edges cross
+  // layers. The number of bends is limited, so that a few very long edges
+  // can't dominate the layout; edges without bends are drawn directly.
+  std::vector<unsigned> VertexLayer(Layer);
+  std::vector<double> Width(NodeCount), Height(NodeCount);
+
+  for (std::size_t i = 0; i < NodeCount; ++i) {
+    Width[i] = Geometry[i].Width;
+    Height[i] = Geometry[i].Height;
+  }
+
+  std::vector<std::size_t> BendStart(EdgeCount + 1, 0);
+  std::vector<Segment> Segments;
+  std::size_t BendBudget = 4 * (NodeCount + EdgeCount) + 1024;
+
+  for (std::size_t i = 0; i < EdgeCount; ++i) {
+    auto const &Edge = Edges[i];
+    BendStart[i + 1] = BendStart[i];
+
+    if (!IsValid(Edge) || Edge.Tail == Edge.Head)
+      continue;
+
+    auto const Upper = getUpper(i);
+    auto const Lower = getLower(i);
+    auto const UpperOffset = Reversed[i] ? HeadOffsets[i] : TailOffsets[i];
+    auto const LowerOffset = Reversed[i] ? TailOffsets[i] : HeadOffsets[i];
+    auto const Span = Layer[Lower] - Layer[Upper];
+
+    if (Span == 1) {
+      Segments.emplace_back(Segment{Upper, Lower, UpperOffset, LowerOffset});
+      continue;
+    }
+
+    if (Span - 1 > BendBudget)
+      continue;
+
+    BendBudget -= Span - 1;
+
+    auto Last = Upper;
+    auto LastOffset = UpperOffset;
+
+    for (unsigned L = Layer[Upper] + 1; L < Layer[Lower]; ++L) {
+      auto const Bend = VertexLayer.size();
+      VertexLayer.push_back(L);
+      Width.push_back(0);
+      Height.push_back(BendHeight);
+
+      Segments.emplace_back(Segment{Last, Bend, LastOffset, BendHeight / 2});
+      Last = Bend;
+      LastOffset = BendHeight / 2;
+    }
+
+    Segments.emplace_back(Segment{Last, Lower, LastOffset, LowerOffset});
+
+    BendStart[i + 1] = VertexLayer.size() - NodeCount;
+  }
+
+  auto const VertexCount = VertexLayer.size();
+  auto const isBend = [=] (std::size_t const V) { return V >= NodeCount; };
+
+  std::vector<std::size_t> UpStart, UpSegments, DownStart, DownSegments;
+  buildAdjacency(VertexCount, Segments.size(),
+                 [&] (std::size_t const i) { return Segments[i].Lower; },
+                 UpStart, UpSegments);
+  buildAdjacency(VertexCount, Segments.size(),
+                 [&] (std::size_t const i) { return Segments[i].Upper; },
+                 DownStart, DownSegments);
+
+  if (IsCancelled())
+    return std::string();
+
+  // Order the vertices in each layer.
+  unsigned LayerCount = 0;
+  for (auto const L : VertexLayer)
+    LayerCount = std::max(LayerCount, L + 1);
+
+  std::vector<std::vector<std::size_t>> Layers(LayerCount);
+  for (std::size_t V = 0; V < VertexCount; ++V)
+    Layers[VertexLayer[V]].push_back(V);
+
+  std::vector<double> Position(VertexCount, 0);
+  std::vector<double> Key(VertexCount, 0);
+
+  auto const sortLayer = [&] (std::vector<std::size_t> &Vertices) {
+    std::stable_sort(Vertices.begin(), Vertices.end(),
+                     [&] (std::size_t const A, std::size_t const B) {
+                       return Key[A] < Key[B];
+                     });
+
+    for (std::size_t i = 0; i < Vertices.size(); ++i)
+      Position[Vertices[i]] = i;
+  };
+
+  auto const Unplaced = std::numeric_limits<double>::infinity();
+
+  if (Incremental) {
+    // Keep the previous vertical order of existing nodes, and insert new
+    // vertices at the mean of the (estimated) positions of their neighbours
+    // in the previous layer.
+    std::vector<double> EstimatedY(VertexCount, 0);
+
+    for (auto &Vertices : Layers) {
+      for (auto const V : Vertices) {
+        if (V < NodeCount && Prior[V]) {
+          Key[V] = Prior[V]->Y + Height[V] / 2;
+          EstimatedY[V] = Prior[V]->Y;
+          continue;
+        }
+
+        double Total = 0;
+        auto const Count = UpStart[V + 1] - UpStart[V];
+
+        for (auto i = UpStart[V]; i < UpStart[V + 1]; ++i) {
+          auto const &S = Segments[UpSegments[i]];
+          Total += EstimatedY[S.Upper] + S.UpperOffset;
+        }
+
+        Key[V] = Count ? Total / Count : Unplaced;
+        EstimatedY[V] = Count ? Key[V] - Height[V] / 2 : 0;
+      }
+
+      sortLayer(Vertices);
+    }
+  }
+  else {
+    // Initial order from a single sweep, then reduce crossings by sweeping
+    // down and up the layers, ordering each layer by the barycentre of its
+    // neighbours' ports in the adjacent layer.
+    auto const sweep = [&] (std::vector<std::size_t> &Vertices,
+                            std::vector<std::size_t> const &AdjStart,
+                            std::vector<std::size_t> const &AdjSegments,
+                            bool const Up) {
+      for (auto const V : Vertices) {
+        double Total = 0;
+        auto const Count = AdjStart[V + 1] - AdjStart[V];
+
+        for (auto i = AdjStart[V]; i < AdjStart[V + 1]; ++i) {
+          auto const &S = Segments[AdjSegments[i]];
+          auto const Other = Up ? S.Upper : S.Lower;
+          auto const Offset = Up ? S.UpperOffset : S.LowerOffset;
+          Total += Position[Other] + Offset / std::max(Height[Other], 1.0);
+        }
+
+        Key[V] = Count ? Total / Count : Position[V];
+      }
+
+      sortLayer(Vertices);
+    };
+
+    for (auto &Vertices : Layers)
+      for (std::size_t i = 0; i < Vertices.size(); ++i)
+        Position[Vertices[i]] = i;
+
+    for (unsigned L = 1; L < LayerCount; ++L)
+      sweep(Layers[L], UpStart, UpSegments, true);
+
+    for (unsigned Iteration = 0; Iteration < CrossingSweeps; ++Iteration) {
+      if (IsCancelled())
+        return std::string();
+
+      for (unsigned L = LayerCount; L-- > 1; )
+        sweep(Layers[L - 1], DownStart, DownSegments, false);
+
+      for (unsigned L = 1; L < LayerCount; ++L)
+        sweep(Layers[L], UpStart, UpSegments, true);
+    }
+  }
+
+  if (IsCancelled())
+    return std::string();
+
+  // Assign vertical positions. Each vertex is placed level with its
+  // neighbours in the previous layer (or at its previous position), unless it
+  // must be pushed down to make room for the vertex above it.
+  std::vector<double> Y(VertexCount, 0);
+
+  auto const getSeparation = [&] (std::size_t const A, std::size_t const B) {
+    return isBend(A) || isBend(B) ? BendSeparation : NodeSeparation;
+  };
+
+  auto const isAnchored = [&] (std::size_t const V) {
+    return V < NodeCount && Prior[V] != nullptr;
+  };
+
+  for (auto const &Vertices : Layers) {
+    for (std::size_t i = 0; i < Vertices.size(); ++i) {
+      auto const V = Vertices[i];
+
+      auto Desired = Unplaced;
+
+      if (isAnchored(V)) {
+        Desired = Prior[V]->Y;
+      }
+      else if (UpStart[V] != UpStart[V + 1]) {
+        double Total = 0;
+        for (auto j = UpStart[V]; j < UpStart[V + 1]; ++j) {
+          auto const &S = Segments[UpSegments[j]];
+          Total += Y[S.Upper] + S.UpperOffset - S.LowerOffset;
+        }
+        Desired = Total / (UpStart[V + 1] - UpStart[V]);
+      }
+
+      auto const Minimum = i == 0 ? Margin
+                         : Y[Vertices[i - 1]] + Height[Vertices[i - 1]]
+                           + getSeparation(Vertices[i - 1], V);
+
+      Y[V] = Desired == Unplaced ? Minimum : std::max(Desired, Minimum);
+    }
+  }
+
+  // Move new vertices towards the centre of their neighbours in the next
+  // layer, without disturbing the order, so that trees are balanced.
+  for (unsigned L = LayerCount; L-- > 0; ) {
+    auto const &Vertices = Layers[L];
+
+    for (std::size_t i = Vertices.size(); i-- > 0; ) {
+      auto const V = Vertices[i];
+      if (isAnchored(V) || DownStart[V] == DownStart[V + 1])
+        continue;
+
+      double Total = 0;
+      for (auto j = DownStart[V]; j < DownStart[V + 1]; ++j) {
+        auto const &S = Segments[DownSegments[j]];
+        Total += Y[S.Lower] + S.LowerOffset - S.UpperOffset;
+      }
+
+      auto const Target = Total / (DownStart[V + 1] - DownStart[V]);
+
+      auto const Lowest = i == 0 ? Margin
+                        : Y[Vertices[i - 1]] + Height[Vertices[i - 1]]
+                          + getSeparation(Vertices[i - 1], V);
+
+      auto const Highest = i + 1 == Vertices.size()
+                         ? std::numeric_limits<double>::max()
+                         : Y[Vertices[i + 1]] - Height[V]
+                           - getSeparation(V, Vertices[i + 1]);
+
+      if (Lowest <= Highest)
+        Y[V] = std::min(std::max(Target, Lowest), Highest);
+    }
+  }
+
+  // Assign horizontal positions: nodes are aligned to the left of their
+  // layer, and bends are in the middle.
+  std::vector<double> LayerX(LayerCount, Margin), LayerWidth(LayerCount, 0);
+
+  for (std::size_t V = 0; V < VertexCount; ++V)
+    LayerWidth[VertexLayer[V]] = std::max(LayerWidth[VertexLayer[V]],
+                                          Width[V]);
+
+  for (unsigned L = 1; L < LayerCount; ++L)
+    LayerX[L] = LayerX[L - 1] + LayerWidth[L - 1] + LayerSeparation;
+
+  auto const getX = [&] (std::size_t const V) {
+    auto const L = VertexLayer[V];
+    return isBend(V) ? LayerX[L] + LayerWidth[L] / 2 : LayerX[L];
+  };
+
+  double GraphWidth = 2 * Margin + MinimumCurve;
+  double GraphHeight = 2 * Margin;
+
+  if (LayerCount)
+    GraphWidth += LayerX[LayerCount - 1] + LayerWidth[LayerCount - 1];
+
+  for (std::size_t V = 0; V < VertexCount; ++V)
+    GraphHeight = std::max(GraphHeight, Y[V] + Height[V] + Margin);
+
+  // Remember the placements for the next layout.
+  Previous.clear();
+  for (std::size_t i = 0; i < NodeCount; ++i)
+    Previous[Nodes[i].ID] = Placement{Layer[i], Y[i]};
+
+  if (IsCancelled())
+    return std::string();
+
+  // Render the nodes and edges.
+  std::vector<std::string> NodeSVG(NodeCount), EdgeSVG(EdgeCount);
+
+  auto const RenderedNodes = Scheduler.parallelFor(NodeCount, 0,
+    [&] (std::size_t const i) {
+      llvm::raw_string_ostream Out {NodeSVG[i]};
+      unsigned LinkCount = 0;
+
+      Out << "<g id=\"node" << (i + 1) << "\" class=\"node\">\n<title>"
+          << escapeXML(Nodes[i].ID) << "</title>\n";
+      writeTable(Out, *Geometry[i].Table, getX(i), Y[i], i + 1, LinkCount);
+      Out << "</g>\n";
+    },
+    CancelIfFalse);
+
+  if (!RenderedNodes)
+    return std::string();
+
+  auto const RenderedEdges = Scheduler.parallelFor(EdgeCount, 0,
+    [&] (std::size_t const i) {
+      auto const &Edge = Edges[i];
+      if (!IsValid(Edge))
+        return;
+
+      auto const TailX = getX(Edge.Tail);
+      auto const TailY = Y[Edge.Tail];
+      auto const HeadX = getX(Edge.Head);
+      auto const HeadY = Y[Edge.Head];
+      auto const &TailPort = TailPorts[i];
+      auto const &HeadPort = HeadPorts[i];
+
+      std::vector<RoutePoint> Route;
+
+      // Bends are listed from the upper vertex to the lower vertex.
+      std::vector<RoutePoint> Bends;
+      auto const Direction = Reversed[i] ? -1.0 : 1.0;
+
+      for (auto j = BendStart[i]; j < BendStart[i + 1]; ++j) {
+        auto const Bend = NodeCount + j;
+        Bends.emplace_back(RoutePoint{getX(Bend), Y[Bend] + BendHeight / 2,
+                                      Direction});
+      }
+
+      if (Reversed[i])
+        std::reverse(Bends.begin(), Bends.end());
+
+      // The point that the edge heads for after leaving the tail.
+      auto const HeadCentre = HeadX + HeadPort.X + HeadPort.Width / 2;
+      auto const NextX = Bends.empty() ? HeadCentre : Bends.front().X;
+
+      // Start from the centre of the tail port (as for dot's tailclip=false),
+      // or from the side of the tail node.
+      auto const TailCentre = TailX + TailPort.X + TailPort.Width / 2;
+      auto const IsLoop = Edge.Tail == Edge.Head;
+      auto const TailDirection = IsLoop || NextX >= TailCentre ? 1.0 : -1.0;
+
+      if (!Edge.TailPort.empty()) {
+        Route.emplace_back(RoutePoint{TailCentre, TailY + TailOffsets[i],
+                                      TailDirection});
+      }
+      else {
+        auto const Side = TailDirection > 0 ? TailX + TailPort.Width : TailX;
+        Route.emplace_back(RoutePoint{Side, TailY + TailOffsets[i],
+                                      TailDirection});
+      }
+
+      Route.insert(Route.end(), Bends.begin(), Bends.end());
+
+      // Edges from a node to itself loop over the top of the node.
+      if (IsLoop) {
+        auto const Top = std::max(TailY - NodeSeparation / 2, 0.0);
+        Route.emplace_back(RoutePoint{TailX + Geometry[Edge.Tail].Width / 2,
+                                      Top,
+                                      -1.0});
+      }
+
+      // Finish at the head's anchor.
+      auto const PreviousX = Route.back().X;
+
+      if (Edge.HeadAnchor == LayeredAnchor::NorthWest
+          || PreviousX <= HeadCentre)
+        Route.emplace_back(RoutePoint{HeadX + HeadPort.X,
+                                      HeadY + HeadOffsets[i],
+                                      1.0});
+      else
+        Route.emplace_back(RoutePoint{HeadX + HeadPort.X + HeadPort.Width,
+                                      HeadY + HeadOffsets[i],
+                                      -1.0});
+
+      llvm::raw_string_ostream Out {EdgeSVG[i]};
+      writeEdge(Out, i + 1, Edge, Nodes[Edge.Tail], Nodes[Edge.Head],
+                std::move(Route));
+    },
+    CancelIfFalse);
+
+  if (!RenderedEdges || IsCancelled())
+    return std::string();
+
+  std::size_t Size = 1024;
+  for (auto const &Node : NodeSVG)
+    Size += Node.size();
+  for (auto const &Edge : EdgeSVG)
+    Size += Edge.size();
+
+  std::string SVG;
+  SVG.reserve(Size);
+
+  llvm::raw_string_ostream Out {SVG};
+
+  Out << "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n"
+      << "<svg width=\"" << static_cast<unsigned long>(std::ceil(GraphWidth))
+      << "pt\" height=\"" << static_cast<unsigned long>(std::ceil(GraphHeight))
+      << "pt\"\n viewBox=\"0.00 0.00 ";
+  writeNumber(Out, GraphWidth);
+  Out << ' ';
+  writeNumber(Out, GraphHeight);
+  Out << "\" xmlns=\"http://www.w3.org/2000/svg\""
+         " xmlns:xlink=\"http://www.w3.org/1999/xlink\">\n"
+      << "<g id=\"graph0\" class=\"graph\">\n"
+      << "<title>Process</title>\n";
+
+  writePolygon(Out, "white", "transparent",
+               Rect{0, 0, GraphWidth, GraphHeight});
+
+  for (auto const &Node : NodeSVG)
+    Out << Node;
+
+  for (auto const &Edge : EdgeSVG)
+    Out << Edge;
+
+  Out << "</g>\n</svg>\n";
+  Out.flush();
+
+  return SVG;
+}
+
+
+} // namespace graph (in cm in seec)
+
+} // namespace cm (in seec)
+
+} // namespace seec
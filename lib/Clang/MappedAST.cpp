@@ -15,6 +15,7 @@
 #include "seec/Clang/MappedAST.hpp"
 #include "seec/Clang/MappedStmt.hpp"
 #include "seec/Clang/MDNames.hpp"
+#include "seec/Clang/SubRangeRecorder.hpp"
 #include "seec/Util/ModuleIndex.hpp"
 
 #include "clang/AST/RecursiveASTVisitor.h"
@@ -192,10 +193,14 @@ MappedAST::MappedAST(MappedCompileInfo const &FromCompileInfo,
   AST(ForAST),
   Decls(std::move(WithMapping.getDecls())),
   Stmts(std::move(WithMapping.getStmts())),
-  DeclsReferenced(std::move(WithMapping.getDeclsReferenced()))
+  DeclsReferenced(std::move(WithMapping.getDeclsReferenced())),
+  FormattedStmtCache(),
+  FormattedStmtCacheFlag()
 {}
 
 MappedAST::~MappedAST() {
+  // The cache refers to this AST, so destroy it first.
+  FormattedStmtCache.reset();
   delete AST;
 }
 
@@ -224,6 +229,15 @@ MappedAST::FromASTUnit(MappedCompileInfo const &FromCompileInfo,
   return Mapped;
 }
 
+seec::FormattedStmtCacheForAST &MappedAST::getFormattedStmtCache() const
+{
+  std::call_once(FormattedStmtCacheFlag, [this] () {
+    FormattedStmtCache.reset(new seec::FormattedStmtCacheForAST(*this));
+  });
+
+  return *FormattedStmtCache;
+}
+
 seec::Maybe<uint64_t> MappedAST::getIdxForDecl(clang::Decl const *Decl) const
 {
   auto const It = std::find(Decls.begin(), Decls.end(), Decl);
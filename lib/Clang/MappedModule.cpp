@@ -22,7 +22,9 @@
 #include "seec/Util/ModuleIndex.hpp"
 
 #include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/Basic/DiagnosticOptions.h"
 #include "clang/Frontend/PCHContainerOperations.h"
+#include "clang/Frontend/TextDiagnosticBuffer.h"
 #include "clang/Lex/HeaderSearch.h"
 #include "clang/Lex/Preprocessor.h"
 
@@ -30,9 +32,15 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 
 #include <algorithm>
+#include <atomic>
+#include <future>
+#include <thread>
 
 using namespace clang;
 using namespace llvm;
@@ -283,6 +291,38 @@ MappedCompileInfo::createCompilerInvocation(DiagnosticsEngine &Diags) const
   return CI;
 }
 
+std::string MappedCompileInfo::getHash() const
+{
+  llvm::MD5 Hash;
+
+  // Prefix each string with its length, so that the boundaries between
+  // strings are part of the hash.
+  auto const Add = [&] (llvm::StringRef Str) {
+    Hash.update(std::to_string(Str.size()));
+    Hash.update(":");
+    Hash.update(Str);
+  };
+
+  Add(MainDirectory);
+  Add(MainFileName);
+
+  for (auto const &FI : SourceFiles) {
+    Add(FI.getName());
+    Add(FI.getContents().getBuffer());
+  }
+
+  for (auto const &Arg : InvocationArguments)
+    Add(Arg);
+
+  for (auto const &HS : HeaderSearchEntries)
+    Add(HS.getPath());
+
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+
+  return Result.digest().str();
+}
+
 void MappedCompileInfo::createVirtualFiles(clang::FileManager &FM,
                                            clang::SourceManager &SM) const
 {
@@ -387,38 +427,105 @@ static std::string getPathFromFileNode(llvm::MDNode const *FileNode) {
   return FilePath.str().str();
 }
 
-MappedAST const *
-MappedModule::createASTForFile(llvm::MDNode const *FileNode) {
+/// \brief Load the AST that seec-cc serialized for a compilation.
+/// \return the loaded ASTUnit, or nullptr if the serialized AST was created
+///         for different compile information or could not be loaded.
+///
+static std::unique_ptr<ASTUnit>
+loadSerializedAST(MappedCompileInfo const &CompileInfo,
+                  llvm::MDNode const *ASTNode,
+                  PCHContainerOperations const &PCHContainerOps,
+                  llvm::IntrusiveRefCntPtr<DiagnosticsEngine> Diags)
+{
+  if (!ASTNode || ASTNode->getNumOperands() != 3u)
+    return nullptr;
+
+  auto const Hash = dyn_cast<MDString>(ASTNode->getOperand(1u));
+  if (!Hash || Hash->getString() != CompileInfo.getHash())
+    return nullptr;
+
+  auto const Data =
+    getConstantFrom<ConstantDataSequential>(ASTNode->getOperand(2u).get());
+  if (!Data)
+    return nullptr;
+
+  // ASTUnit only loads AST files from disk, so write a temporary copy.
+  int FD = -1;
+  llvm::SmallString<256> Path;
+  if (llvm::sys::fs::createTemporaryFile("seec-ast", "ast", FD, Path))
+    return nullptr;
+
+  {
+    llvm::raw_fd_ostream Out(FD, /* shouldClose */ true);
+    Out << Data->getRawDataValues();
+    Out.close();
+
+    if (Out.has_error()) {
+      Out.clear_error();
+      llvm::sys::fs::remove(Path);
+      return nullptr;
+    }
+  }
+
+  // A stale or incompatible AST file is not an error: the caller will reparse
+  // the sources instead, so don't report the failure to the user.
+  auto const WasSuppressed = Diags->getSuppressAllDiagnostics();
+  Diags->setSuppressAllDiagnostics(true);
+
+  auto Unit = ASTUnit::LoadFromASTFile(Path.str(),
+                                       PCHContainerOps.getRawReader(),
+                                       ASTUnit::LoadEverything,
+                                       Diags,
+                                       FileSystemOptions());
+
+  Diags->setSuppressAllDiagnostics(WasSuppressed);
+
+  llvm::sys::fs::remove(Path);
+
+  return Unit;
+}
+
+/// \brief Create the AST for a single main file.
+/// This does not modify any shared state, so ASTs for different files may be
+/// created concurrently, provided that each uses its own DiagnosticsEngine.
+/// \return the MappedAST, or nullptr if it could not be created.
+///
+static std::unique_ptr<MappedAST>
+createAST(MappedCompileInfo const &FileCompileInfo,
+          llvm::MDNode const *SerializedAST,
+          llvm::IntrusiveRefCntPtr<DiagnosticsEngine> Diags)
+{
   // TODO: We should return a seec::Error when this is unsuccessful, so that
   //       we can describe the problem to the user rather than asserting.
-  
-  // Check lookup to see if we've already loaded the AST.
-  auto It = ASTLookup.find(FileNode);
-  if (It != ASTLookup.end())
-    return It->second;
-
-  // If not, we will try to load the AST from the source file.
-  auto const FilenameStr = dyn_cast<MDString>(FileNode->getOperand(0u));
-  auto const FileCompileInfo =
-    getCompileInfoForMainFile(FilenameStr->getString());
-  
-  if (!FileCompileInfo) {
-    ASTLookup[FileNode] = nullptr;
-    return nullptr;
+
+  // Create PCHContainerOperations for the ASTUnit load.
+  auto PCHContainerOps = std::make_shared<PCHContainerOperations>();
+
+  // If seec-cc embedded the AST for this file, then try to deserialize it
+  // rather than reparsing the sources.
+  if (SerializedAST) {
+    auto SerializedUnit = loadSerializedAST(FileCompileInfo,
+                                            SerializedAST,
+                                            *PCHContainerOps,
+                                            Diags);
+    if (SerializedUnit) {
+      auto AST = MappedAST::FromASTUnit(FileCompileInfo,
+                                        SerializedUnit.release());
+      if (AST)
+        return AST;
+    }
+
+    DEBUG(llvm::dbgs() << "reparsing " << FileCompileInfo.getMainFileName()
+                       << ": serialized AST could not be used.\n");
   }
   
-  auto CI = FileCompileInfo->createCompilerInvocation(*Diags);
-  if (!CI) {
-    ASTLookup[FileNode] = nullptr;
+  auto CI = FileCompileInfo.createCompilerInvocation(*Diags);
+  if (!CI)
     return nullptr;
-  }
   
   // Add header search options.
   auto &HSOpts = CI->getHeaderSearchOpts();
-  FileCompileInfo->setHeaderSearchOpts(HSOpts);
-
-  // Create PCHContainerOperations for the ASTUnit load.
-  auto PCHContainerOps = std::make_shared<PCHContainerOperations>();
+  FileCompileInfo.setHeaderSearchOpts(HSOpts);
   
   // Create a new ASTUnit.
   auto ASTUnit =
@@ -427,14 +534,12 @@ MappedModule::createASTForFile(llvm::MDNode const *FileNode) {
                     false /* CaptureDiagnostics */,
                     false /* UserFilesAreVolatile */);
   
-  if (!ASTUnit) {
-    ASTLookup[FileNode] = nullptr;
+  if (!ASTUnit)
     return nullptr;
-  }
   
   // Override files in ASTUnit using compile info.
-  FileCompileInfo->createVirtualFiles(ASTUnit->getFileManager(),
-                                      ASTUnit->getSourceManager());
+  FileCompileInfo.createVirtualFiles(ASTUnit->getFileManager(),
+                                     ASTUnit->getSourceManager());
   
   // Load the ASTUnit.
   auto const LoadedASTUnit =
@@ -445,25 +550,110 @@ MappedModule::createASTForFile(llvm::MDNode const *FileNode) {
                                                        ASTUnit.get(),
                                                        true /* Persistent */);
   
-  if (!LoadedASTUnit) {
-    ASTLookup[FileNode] = nullptr;
+  if (!LoadedASTUnit)
     return nullptr;
-  }
   
   // Create MappedAST from ASTUnit.
-  auto AST = MappedAST::FromASTUnit(*FileCompileInfo, ASTUnit.release());
-  if (!AST) {
+  return MappedAST::FromASTUnit(FileCompileInfo, ASTUnit.release());
+}
+
+void
+MappedModule::createASTsForFiles(llvm::ArrayRef<llvm::MDNode const *> FileNodes)
+{
+  /// \brief A single file's AST creation.
+  ///
+  struct ASTTask {
+    llvm::MDNode const *FileNode;
+
+    MappedCompileInfo const *CompileInfo;
+
+    llvm::MDNode const *SerializedAST;
+
+    /// Diagnostics for this file only, because DiagnosticsEngine is not
+    /// thread-safe.
+    llvm::IntrusiveRefCntPtr<DiagnosticsEngine> Diags;
+
+    /// Holds this file's diagnostics until they can be reported in order.
+    TextDiagnosticBuffer *DiagBuffer;
+
+    std::unique_ptr<MappedAST> AST;
+  };
+
+  std::vector<ASTTask> Tasks;
+
+  for (auto const FileNode : FileNodes) {
+    // Check lookup to see if we've already loaded the AST.
+    if (ASTLookup.count(FileNode))
+      continue;
+
+    auto const FilenameStr = dyn_cast<MDString>(FileNode->getOperand(0u));
+    auto const FileCompileInfo =
+      getCompileInfoForMainFile(FilenameStr->getString());
+
+    // Mark the node as handled, even if we fail to create its AST.
     ASTLookup[FileNode] = nullptr;
-    return nullptr;
+
+    if (!FileCompileInfo)
+      continue;
+
+    auto const SerializedIt = SerializedASTs.find(FilenameStr->getString());
+
+    // Create the diagnostics engine here, because the reference counts of
+    // the options are not thread-safe.
+    auto const DiagBuffer = new TextDiagnosticBuffer();
+    llvm::IntrusiveRefCntPtr<DiagnosticsEngine> FileDiags(
+      new DiagnosticsEngine(new DiagnosticIDs(),
+                            new DiagnosticOptions(Diags->getDiagnosticOptions()),
+                            DiagBuffer,
+                            /* ShouldOwnClient */ true));
+
+    Tasks.emplace_back(ASTTask{FileNode,
+                               FileCompileInfo,
+                               SerializedIt != SerializedASTs.end()
+                                 ? SerializedIt->second
+                                 : nullptr,
+                               std::move(FileDiags),
+                               DiagBuffer,
+                               nullptr});
   }
 
-  // Get the raw pointer, because we have to push the unique_ptr onto the list.
-  auto const ASTRaw = AST.get();
+  // Each file is parsed independently, so parse them concurrently. The
+  // calling thread also takes tasks.
+  std::atomic<std::size_t> NextTask {0};
+
+  auto const Worker = [&] () {
+    for (auto i = NextTask++; i < Tasks.size(); i = NextTask++) {
+      auto &Task = Tasks[i];
+      Task.AST = createAST(*Task.CompileInfo, Task.SerializedAST, Task.Diags);
+    }
+  };
+
+  auto const Concurrency = std::max(1u, std::thread::hardware_concurrency());
+  auto const WorkerCount = std::min<std::size_t>(Tasks.size(), Concurrency);
+
+  std::vector<std::future<void>> Workers;
+  for (std::size_t i = 1; i < WorkerCount; ++i)
+    Workers.emplace_back(std::async(std::launch::async, Worker));
 
-  ASTLookup[FileNode] = ASTRaw;
-  ASTList.emplace_back(std::move(AST));
+  Worker();
+
+  for (auto &W : Workers)
+    W.get();
+
+  // Publish the ASTs in the original order.
+  for (auto &Task : Tasks) {
+    Task.DiagBuffer->FlushDiagnostics(*Diags);
+
+    // Send any later diagnostics directly to the shared consumer. This
+    // deletes the buffer.
+    Task.Diags->setClient(Diags->getClient(), /* ShouldOwnClient */ false);
+
+    if (!Task.AST)
+      continue;
 
-  return ASTRaw;
+    ASTLookup[Task.FileNode] = Task.AST.get();
+    ASTList.emplace_back(std::move(Task.AST));
+  }
 }
 
 std::string const &
@@ -490,6 +680,7 @@ MappedModule::MappedModule(
   FunctionLookup(),
   GlobalVariableLookup(),
   CompileInfo(),
+  SerializedASTs(),
   StmtToMappedStmt(),
   ValueToMappedStmt(),
   FilePathStrings()
@@ -511,10 +702,29 @@ MappedModule::MappedModule(
                                         std::move(MappedInfo)));
     }
   }
+
+  // Find serialized ASTs, which will be used in preference to reparsing.
+  auto GlobalSerializedAST = Module.getNamedMetadata(MDSerializedAST);
+  if (GlobalSerializedAST) {
+    for (std::size_t i = 0u; i < GlobalSerializedAST->getNumOperands(); ++i) {
+      auto const Node = GlobalSerializedAST->getOperand(i);
+      if (!Node || Node->getNumOperands() != 3u)
+        continue;
+
+      auto const MainFileName = dyn_cast<MDString>(Node->getOperand(0u));
+      if (!MainFileName)
+        continue;
+
+      SerializedASTs.insert(std::make_pair(MainFileName->getString().str(),
+                                           Node));
+    }
+  }
   
   // Create the ASTs for all files. These are required in the following steps.
   auto GlobalIdxMD = Module.getNamedMetadata(MDGlobalDeclIdxsStr);
   if (GlobalIdxMD) {
+    std::vector<llvm::MDNode const *> FileNodes;
+
     for (std::size_t i = 0u; i < GlobalIdxMD->getNumOperands(); ++i) {
       auto Node = GlobalIdxMD->getOperand(i);
       assert(Node && Node->getNumOperands() == 3);
@@ -523,9 +733,14 @@ MappedModule::MappedModule(
       assert(FileNode);
 
       FilePathStrings.emplace(FileNode, getPathFromFileNode(FileNode));
+      FileNodes.push_back(FileNode);
+    }
+
+    createASTsForFiles(FileNodes);
 
-      auto AST = createASTForFile(FileNode);
-      assert(AST);
+    for (auto const FileNode : FileNodes) {
+      assert(ASTLookup.lookup(FileNode) && "Failed to create AST.");
+      (void)FileNode;
     }
   }
   
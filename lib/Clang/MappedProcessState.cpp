@@ -81,9 +81,7 @@ ProcessState::ProcessState(seec::cm::ProcessTrace const &ForTrace)
 
 ProcessState::~ProcessState() = default;
 
-void ProcessState::cacheClear() {
-  // Clear process-level cached information.
-  CurrentValueStore = seec::cm::ValueStore::create(Trace.getMapping());
+void ProcessState::generateStreamsAndDirs() {
   Streams.clear();
   Dirs.clear();
   
@@ -94,12 +92,41 @@ void ProcessState::cacheClear() {
   // Generate DIR information.
   for (auto const &Pair : UnmappedState->getDirs())
     Dirs.insert(std::make_pair(Pair.first, DIRState(Pair.second)));
+}
+
+void ProcessState::cacheClear() {
+  // Start tracking changes to memory from this state.
+  UnmappedState->getMemory().setChangeTracking(true);
+
+  // Clear process-level cached information.
+  CurrentValueStore = seec::cm::ValueStore::create(Trace.getMapping(),
+                                                   Trace.getTypeMatchCache());
+  generateStreamsAndDirs();
   
   // Clear thread-level cached information.
   for (auto &ThreadPtr : ThreadStates)
     ThreadPtr->cacheClear();
 }
 
+void ProcessState::cacheUpdate() {
+  // If too much memory changed to track, then clear everything.
+  std::vector<MemoryArea> Changed;
+  if (!UnmappedState->getMemory().takeChangedAreas(Changed)) {
+    cacheClear();
+    return;
+  }
+
+  // Discard the Values that overlap changed memory.
+  if (!Changed.empty())
+    CurrentValueStore->invalidate(Changed);
+
+  generateStreamsAndDirs();
+
+  // Update thread-level cached information.
+  for (auto &ThreadPtr : ThreadStates)
+    ThreadPtr->cacheUpdate();
+}
+
 void ProcessState::print(llvm::raw_ostream &Out,
                          seec::util::IndentationGuide &Indentation,
                          AugmentationCallbackFn Augmenter)
@@ -120,23 +120,14 @@ MovementResult moveForward(ThreadState &Thread)
                           return isLogicalPoint(T, MappedModule);
                         });
   
-  Thread.getParent().cacheClear();
+  Thread.getParent().cacheUpdate();
   
   return toCMResult(Moved);
 }
 
 MovementResult moveForwardToEnd(ThreadState &Thread)
 {
-  auto &Unmapped = Thread.getUnmappedState();
-  
-  auto const Moved = seec::trace::moveForwardUntil(Unmapped,
-                        [] (seec::trace::ThreadState const &T) {
-                          return T.isAtEnd();
-                        });
-  
-  Thread.getParent().cacheClear();
-  
-  return toCMResult(Moved);
+  return moveForwardToEnd(Thread.getParent());
 }
 
 /// \brief Check if the given \c clang::Stmt is "top-level" (does not have a
@@ -200,7 +191,7 @@ MovementResult moveForwardToCompleteTopLevelStmt(ThreadState &Thread)
       return false;
     });
 
-  Thread.getParent().cacheClear();
+  Thread.getParent().cacheUpdate();
 
   return toCMResult(Moved);
 }
@@ -216,23 +207,14 @@ MovementResult moveBackward(ThreadState &Thread)
                           return isLogicalPoint(T, MappedModule);
                         });
   
-  Thread.getParent().cacheClear();
+  Thread.getParent().cacheUpdate();
   
   return toCMResult(Moved);
 }
 
 MovementResult moveBackwardToEnd(ThreadState &Thread)
 {
-  auto &Unmapped = Thread.getUnmappedState();
-  
-  auto const Moved = seec::trace::moveBackwardUntil(Unmapped,
-                        [] (seec::trace::ThreadState const &T) {
-                          return T.isAtStart();
-                        });
-  
-  Thread.getParent().cacheClear();
-  
-  return toCMResult(Moved);
+  return moveBackwardToStart(Thread.getParent());
 }
 
 MovementResult moveBackwardToCompleteTopLevelStmt(ThreadState &Thread)
@@ -267,7 +249,7 @@ MovementResult moveBackwardToCompleteTopLevelStmt(ThreadState &Thread)
       return false;
     });
 
-  Thread.getParent().cacheClear();
+  Thread.getParent().cacheUpdate();
 
   return toCMResult(Moved);
 }
@@ -340,7 +322,7 @@ MovementResult moveToFunctionFinished(FunctionState &Function)
                                   && isLogicalPoint(T, MappedModule);
                         });
   
-  Process.cacheClear();
+  Process.cacheUpdate();
   
   return toCMResult(Moved);
 }
@@ -357,7 +339,7 @@ MovementResult moveForward(ProcessState &Process)
 {
   auto &Unmapped = Process.getUnmappedProcessState();
   auto const Moved = seec::trace::moveForward(Unmapped);
-  Process.cacheClear();
+  Process.cacheUpdate();
   return toCMResult(Moved);
 }
 
@@ -365,7 +347,37 @@ MovementResult moveBackward(ProcessState &Process)
 {
   auto &Unmapped = Process.getUnmappedProcessState();
   auto const Moved = seec::trace::moveBackward(Unmapped);
-  Process.cacheClear();
+  Process.cacheUpdate();
+  return toCMResult(Moved);
+}
+
+MovementResult moveForwardOneStep(ProcessState &Process)
+{
+  return Process.getThreadCount() == 1
+    ? moveForward(Process.getThread(0))
+    : moveForward(Process);
+}
+
+MovementResult moveBackwardOneStep(ProcessState &Process)
+{
+  return Process.getThreadCount() == 1
+    ? moveBackward(Process.getThread(0))
+    : moveBackward(Process);
+}
+
+MovementResult moveForwardToEnd(ProcessState &Process)
+{
+  auto &Unmapped = Process.getUnmappedProcessState();
+  auto const Moved = seec::trace::moveForwardToEnd(Unmapped);
+  Process.cacheUpdate();
+  return toCMResult(Moved);
+}
+
+MovementResult moveBackwardToStart(ProcessState &Process)
+{
+  auto &Unmapped = Process.getUnmappedProcessState();
+  auto const Moved = seec::trace::moveBackwardToStart(Unmapped);
+  Process.cacheUpdate();
   return toCMResult(Moved);
 }
 
@@ -398,7 +410,7 @@ MovementResult moveToAllocation(ProcessState &Process,
       });
   }
   
-  Process.cacheClear();
+  Process.cacheUpdate();
   
   return toCMResult(Moved);
 }
@@ -425,7 +437,7 @@ MovementResult moveToDeallocation(ProcessState &Process,
       });
   }
   
-  Process.cacheClear();
+  Process.cacheUpdate();
   
   return toCMResult(Moved);
 }
@@ -436,7 +448,7 @@ MovementResult moveForwardUntilMemoryChanges(ProcessState &State,
   auto &Unmapped = State.getUnmappedProcessState();
   auto const Moved = seec::trace::moveForwardUntilMemoryChanges(Unmapped, Area);
   
-  State.cacheClear();
+  State.cacheUpdate();
   
   return toCMResult(Moved);
 }
@@ -448,7 +460,7 @@ MovementResult moveBackwardUntilMemoryChanges(ProcessState &State,
   auto const Moved = seec::trace::moveBackwardUntilMemoryChanges(Unmapped,
                                                                  Area);
   
-  State.cacheClear();
+  State.cacheUpdate();
   
   return toCMResult(Moved);
 }
@@ -459,7 +471,7 @@ MovementResult moveBackwardUntilAllocated(ProcessState &State,
   auto &Unmapped = State.getUnmappedProcessState();
   auto const Moved = seec::trace::moveBackwardUntilAllocated(Unmapped, Address);
 
-  State.cacheClear();
+  State.cacheUpdate();
 
   return toCMResult(Moved);
 }
@@ -481,7 +493,7 @@ MovementResult moveBackwardToStreamWriteAt(ProcessState &MappedState,
   auto const Moved =
     seec::trace::moveBackwardToStreamWriteAt(State, Stream, Position);
 
-  MappedState.cacheClear();
+  MappedState.cacheUpdate();
 
   return toCMResult(Moved);
 }
@@ -525,7 +537,7 @@ MovementResult moveForwardUntilEvaluated(ThreadState &Thread,
       return false;
     });
 
-  Thread.getParent().cacheClear();
+  Thread.getParent().cacheUpdate();
 
   return toCMResult(Moved);
 }
@@ -562,7 +574,7 @@ MovementResult moveBackwardUntilEvaluated(ThreadState &Thread,
       return false;
     });
 
-  Thread.getParent().cacheClear();
+  Thread.getParent().cacheUpdate();
 
   return toCMResult(Moved);
 }
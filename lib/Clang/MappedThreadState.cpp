@@ -32,7 +32,9 @@ ThreadState::ThreadState(ProcessState &WithParent,
                          seec::trace::ThreadState &ForState)
 : Parent(WithParent),
   UnmappedState(ForState),
-  CallStack()
+  CallStack(),
+  CallStackRefs(),
+  CallStackEvent()
 {
   cacheClear();
 }
@@ -43,6 +45,13 @@ void ThreadState::cacheClear() {
   generateCallStack();
 }
 
+void ThreadState::cacheUpdate() {
+  if (CallStackEvent && *CallStackEvent == UnmappedState.getNextEvent())
+    return;
+
+  generateCallStack();
+}
+
 void ThreadState::print(llvm::raw_ostream &Out,
                         seec::util::IndentationGuide &Indentation,
                         AugmentationCallbackFn Augmenter)
@@ -96,6 +105,7 @@ bool ThreadState::isAtEnd() const {
 void ThreadState::generateCallStack() {
   CallStack.clear();
   CallStackRefs.clear();
+  CallStackEvent = UnmappedState.getNextEvent();
   
   for (auto const &RawFunctionStatePtr : UnmappedState.getCallStack()) {
     CallStack.emplace_back(new FunctionState(*this, *RawFunctionStatePtr));
@@ -36,12 +36,29 @@
 #include "clang/Frontend/ASTUnit.h"
 
 #include "llvm/ADT/APFloat.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Host.h"
+#include "llvm/Support/SwapByteOrder.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
+#include <array>
 #include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 
 using namespace std;
@@ -68,24 +85,193 @@ enum class InitializationState {
 Value::~Value() = default;
 
 
+//===----------------------------------------------------------------------===//
+// ValueOfArray
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+/// \brief Tracks the least and greatest of a sequence of arithmetic elements.
+///
+template<typename T>
+class ElementRangeFinder {
+  T Min;
+  T Max;
+  seec::Maybe<unsigned> MinIndex;
+  seec::Maybe<unsigned> MaxIndex;
+
+public:
+  ElementRangeFinder()
+  : Min(),
+    Max(),
+    MinIndex(),
+    MaxIndex()
+  {}
+
+  void add(char const *Bytes, unsigned Index) {
+    T Element;
+    std::memcpy(&Element, Bytes, sizeof(T));
+
+    // Ignore NaN values, which are not ordered.
+    if (std::is_floating_point<T>::value && std::isnan(double(Element)))
+      return;
+
+    if (!MinIndex.assigned() || Element < Min) {
+      Min = Element;
+      MinIndex = Index;
+    }
+
+    if (!MaxIndex.assigned() || Max < Element) {
+      Max = Element;
+      MaxIndex = Index;
+    }
+  }
+
+  seec::Maybe<unsigned> const &getMinIndex() const { return MinIndex; }
+
+  seec::Maybe<unsigned> const &getMaxIndex() const { return MaxIndex; }
+};
+
+/// \brief Find the least and greatest initialized elements of type \c T.
+///
+template<typename T>
+std::pair<seec::Maybe<unsigned>, seec::Maybe<unsigned>>
+findElementRange(llvm::ArrayRef<char> const Data,
+                 std::vector<ArrayElementRun> const &Runs)
+{
+  ElementRangeFinder<T> Finder;
+
+  // Elements within a run are identical, so check one from each run.
+  for (auto const &Run : Runs)
+    if (Run.isInitialized())
+      Finder.add(Data.data() + Run.getFirst() * sizeof(T), Run.getFirst());
+
+  return std::make_pair(Finder.getMinIndex(), Finder.getMaxIndex());
+}
+
+} // anonymous namespace
+
+seec::Maybe<ArraySummary> ValueOfArray::getSummary() const
+{
+  if (!isInMemory())
+    return seec::Maybe<ArraySummary>();
+
+  auto const MaybeRegion = getUnmappedMemoryRegion();
+  if (!MaybeRegion.assigned())
+    return seec::Maybe<ArraySummary>();
+
+  auto const &Region = MaybeRegion.get<seec::trace::MemoryStateRegion>();
+  auto const Count = getChildCount();
+  auto const Size = getChildSize();
+
+  auto const Data = Region.getByteValues();
+  auto const Init = Region.getByteInitialization();
+  if (Size == 0 || Data.size() < Count * Size || Init.size() < Count * Size)
+    return seec::Maybe<ArraySummary>();
+
+  auto const CompleteByte = std::numeric_limits<unsigned char>::max();
+
+  std::vector<ArrayElementRun> Runs;
+  unsigned InitializedCount = 0;
+
+  for (unsigned i = 0; i < Count; ++i) {
+    auto const ElemData = Data.slice(i * Size, Size);
+    auto const ElemInit = Init.slice(i * Size, Size);
+
+    // Extend the current run if this element is identical to the previous.
+    if (i && std::equal(ElemData.begin(), ElemData.end(),
+                        ElemData.begin() - Size)
+          && std::equal(ElemInit.begin(), ElemInit.end(),
+                        ElemInit.begin() - Size))
+    {
+      Runs.back().extend();
+      if (Runs.back().isInitialized())
+        ++InitializedCount;
+      continue;
+    }
+
+    auto const IsInitialized =
+      std::all_of(ElemInit.begin(), ElemInit.end(),
+                  [=] (unsigned char const C) { return C == CompleteByte; });
+    auto const IsUninitialized =
+      std::all_of(ElemInit.begin(), ElemInit.end(),
+                  [] (unsigned char const C) { return C == 0; });
+    auto const IsZero =
+      std::all_of(ElemData.begin(), ElemData.end(),
+                  [] (char const C) { return C == 0; });
+
+    Runs.emplace_back(i, 1, IsInitialized, IsUninitialized, IsZero);
+    if (IsInitialized)
+      ++InitializedCount;
+  }
+
+  // Find the least and greatest elements of arithmetic arrays.
+  std::pair<seec::Maybe<unsigned>, seec::Maybe<unsigned>> Range;
+
+  auto const ArrayTy = llvm::dyn_cast< ::clang::ArrayType>(getCanonicalType());
+  auto const ElemTy = ArrayTy ? ArrayTy->getElementType().getTypePtrOrNull()
+                              : nullptr;
+
+  if (ElemTy && ElemTy->isIntegerType()) {
+    auto const IsSigned = ElemTy->isSignedIntegerOrEnumerationType();
+    switch (Size) {
+      case 1: Range = IsSigned ? findElementRange<int8_t>(Data, Runs)
+                               : findElementRange<uint8_t>(Data, Runs);
+              break;
+      case 2: Range = IsSigned ? findElementRange<int16_t>(Data, Runs)
+                               : findElementRange<uint16_t>(Data, Runs);
+              break;
+      case 4: Range = IsSigned ? findElementRange<int32_t>(Data, Runs)
+                               : findElementRange<uint32_t>(Data, Runs);
+              break;
+      case 8: Range = IsSigned ? findElementRange<int64_t>(Data, Runs)
+                               : findElementRange<uint64_t>(Data, Runs);
+              break;
+      default: break;
+    }
+  }
+  else if (ElemTy && ElemTy->isSpecificBuiltinType(::clang::BuiltinType::Float)
+           && Size == sizeof(float)) {
+    Range = findElementRange<float>(Data, Runs);
+  }
+  else if (ElemTy && ElemTy->isSpecificBuiltinType(::clang::BuiltinType::Double)
+           && Size == sizeof(double)) {
+    Range = findElementRange<double>(Data, Runs);
+  }
+
+  return ArraySummary(Count,
+                      InitializedCount,
+                      std::move(Runs),
+                      std::move(Range.first),
+                      std::move(Range.second));
+}
+
+
 //===----------------------------------------------------------------------===//
 // ValueStoreImpl
 //===----------------------------------------------------------------------===//
 
+/// \brief The Values at a single address, with their types.
+///
+/// Matching the types may query their ASTContexts (see MatchType), so it is
+/// done by the user with \c getItems(), outside of any store lock.
+///
 class TypedValueSet {
-  std::vector<std::pair<MatchType, std::shared_ptr<Value const>>> Items;
+public:
+  typedef std::pair<MatchType, std::shared_ptr<Value const>> ItemTy;
+
+private:
+  std::vector<ItemTy> Items;
 
 public:
   TypedValueSet()
   : Items()
   {}
 
-  std::shared_ptr<Value const> getShared(MatchType const &ForType) const {
-    for (auto const &Pair : Items)
-      if (Pair.first == ForType)
-        return Pair.second;
+  std::size_t size() const { return Items.size(); }
 
-    return std::shared_ptr<Value const>{};
+  void getItems(llvm::SmallVectorImpl<ItemTy> &Out) const {
+    Out.append(Items.begin(), Items.end());
   }
 
   std::shared_ptr<Value const> getSharedFromTypeString(llvm::StringRef TS) const
@@ -97,43 +283,398 @@ public:
     return std::shared_ptr<Value const>();
   }
 
-  Value const *get(MatchType const &ForType) const {
-    for (auto const &Pair : Items)
-      if (Pair.first == ForType)
-        return Pair.second.get();
+  void add(MatchType const &ForType, std::shared_ptr<Value const> Val) {
+    Items.emplace_back(ForType, std::move(Val));
+  }
+};
+
+/// \brief How the value of a scalar type can be decoded.
+///
+enum class ScalarKind : uint8_t {
+  None,         ///< Not a scalar, or one that must be decoded by clang/APInt.
+  CharSigned,   ///< A signed plain char.
+  CharUnsigned, ///< An unsigned plain char.
+  Signed,       ///< A signed integer of at most 64 bits.
+  Unsigned,     ///< An unsigned integer (or bool) of at most 64 bits.
+  Pointer,      ///< A pointer of at most 64 bits.
+  Float,        ///< An IEEE single precision float.
+  Double        ///< An IEEE double precision float.
+};
+
+/// \brief The layout of a single field in a record.
+///
+struct FieldLayout {
+  /// The field's declaration.
+  ::clang::FieldDecl const *Decl;
+
+  /// The offset of the field from the start of the record, in chars.
+  uint64_t Offset;
+
+  /// True iff the field is not char-aligned (i.e. it is a bitfield).
+  bool IsUnaligned;
+};
+
+/// \brief Flattened layout information for a canonical type.
+///
+/// Creating and displaying a Value otherwise queries the ASTContext for the
+/// same sizes and offsets repeatedly, so they are computed once per type.
+///
+struct TypeLayout {
+  /// The number of chars used by values of this type. For x87 long doubles
+  /// this counts only the used chars.
+  ::clang::CharUnits Size;
+
+  /// How scalar values of this type are decoded.
+  ScalarKind Kind = ScalarKind::None;
+
+  /// True iff the recording target's byte order differs from the host's.
+  bool SwapBytes = false;
+
+  /// For pointers, the size of the pointee type (zero if incomplete).
+  ::clang::CharUnits PointeeSize;
+
+  /// For arrays, the size of an element (zero if not statically known).
+  ::clang::CharUnits ElementSize;
+
+  /// For records, the layout of each field (indexed by field index).
+  std::vector<FieldLayout> Fields;
+};
+
+/// \brief Caches the TypeLayout of types from a single ASTContext.
+///
+class TypeLayoutCache final {
+  /// The ASTContext that types are from.
+  ::clang::ASTContext const &AST;
+
+  /// True iff the target's byte order differs from the host's.
+  bool const SwapBytes;
+
+  /// Control access to Layouts, and to the ASTContext (whose layout caches
+  /// are filled lazily when we query them). This is the context's lock from
+  /// the TypeMatchCache, so it is shared with everything else that queries
+  /// the context.
+  std::recursive_mutex &Access;
+
+  /// Previously computed layouts, keyed by canonical type.
+  llvm::DenseMap< ::clang::Type const *, std::shared_ptr<TypeLayout const>>
+    Layouts;
+
+  /// \brief Get the ScalarKind for a canonical type.
+  ///
+  ScalarKind getScalarKind(::clang::Type const *Type) const {
+    switch (Type->getTypeClass()) {
+      case ::clang::Type::Builtin:
+      {
+        auto const BT = llvm::cast< ::clang::BuiltinType>(Type);
+        auto const Size = AST.getTypeSizeInChars(BT).getQuantity();
+
+        if (BT->getKind() == ::clang::BuiltinType::Char_S)
+          return ScalarKind::CharSigned;
+        if (BT->getKind() == ::clang::BuiltinType::Char_U)
+          return ScalarKind::CharUnsigned;
+
+        if (BT->isInteger()) {
+          if (Size > int64_t(sizeof(uint64_t)) || AST.getTypeSize(BT) % 8)
+            return ScalarKind::None;
+          return BT->isSignedInteger() ? ScalarKind::Signed
+                                       : ScalarKind::Unsigned;
+        }
+
+        if (BT->isFloatingPoint()) {
+          auto const &Semantics =
+            AST.getFloatTypeSemantics(::clang::QualType(BT, 0));
+          if (&Semantics == &llvm::APFloat::IEEEsingle()
+              && Size == sizeof(float))
+            return ScalarKind::Float;
+          if (&Semantics == &llvm::APFloat::IEEEdouble()
+              && Size == sizeof(double))
+            return ScalarKind::Double;
+        }
 
-    return nullptr;
+        return ScalarKind::None;
+      }
+
+      case ::clang::Type::Atomic:
+      {
+        auto const AT = llvm::cast< ::clang::AtomicType>(Type);
+        return getScalarKind(AT->getValueType().getCanonicalType()
+                                               .getTypePtr());
+      }
+
+      case ::clang::Type::Enum:
+      {
+        auto const ET = llvm::cast< ::clang::EnumType>(Type);
+        auto const IntegerTy = ET->getDecl()->getIntegerType();
+        if (IntegerTy.isNull())
+          return ScalarKind::None;
+        return getScalarKind(IntegerTy.getCanonicalType().getTypePtr());
+      }
+
+      case ::clang::Type::Pointer:
+        return AST.getTypeSizeInChars(Type).getQuantity()
+               <= int64_t(sizeof(uint64_t)) ? ScalarKind::Pointer
+                                            : ScalarKind::None;
+
+      default:
+        return ScalarKind::None;
+    }
   }
 
-  void add(MatchType const &ForType, std::shared_ptr<Value const> Val) {
-    Items.emplace_back(ForType, std::move(Val));
+  /// \brief Compute the layout of a complete canonical type.
+  ///
+  std::shared_ptr<TypeLayout const>
+  computeLayout(::clang::Type const *Type) const {
+    auto Layout = std::make_shared<TypeLayout>();
+    Layout->SwapBytes = SwapBytes;
+    Layout->Size = AST.getTypeSizeInChars(Type);
+    Layout->Kind = getScalarKind(Type);
+
+    switch (Type->getTypeClass()) {
+      case ::clang::Type::Builtin:
+      {
+        // Only consider the used bytes of x87 long doubles.
+        auto const BT = llvm::cast< ::clang::BuiltinType>(Type);
+        if (BT->getKind() == ::clang::BuiltinType::LongDouble) {
+          auto const &Semantics =
+            AST.getFloatTypeSemantics(::clang::QualType(BT, 0));
+          if (&Semantics == &llvm::APFloat::x87DoubleExtended())
+            Layout->Size = ::clang::CharUnits::fromQuantity(10);
+        }
+        break;
+      }
+
+      case ::clang::Type::Pointer:
+      {
+        auto const PointeeTy = Type->getPointeeType().getCanonicalType();
+        if (!PointeeTy->isIncompleteType())
+          Layout->PointeeSize = AST.getTypeSizeInChars(PointeeTy);
+        break;
+      }
+
+      case ::clang::Type::ConstantArray:   SEEC_FALLTHROUGH;
+      case ::clang::Type::IncompleteArray: SEEC_FALLTHROUGH;
+      case ::clang::Type::VariableArray:
+      {
+        auto const ElementTy = llvm::cast< ::clang::ArrayType>(Type)
+                                 ->getElementType().getCanonicalType();
+        if (!ElementTy->isIncompleteType())
+          Layout->ElementSize = AST.getTypeSizeInChars(ElementTy);
+        break;
+      }
+
+      case ::clang::Type::Record:
+      {
+        auto const RecordTy = llvm::cast< ::clang::RecordType>(Type);
+        auto const Decl = RecordTy->getDecl()->getDefinition();
+        if (!Decl)
+          break;
+
+        auto const &RecordLayout = AST.getASTRecordLayout(Decl);
+        Layout->Fields.reserve(RecordLayout.getFieldCount());
+
+        for (auto const Field : seec::range(Decl->field_begin(),
+                                            Decl->field_end()))
+        {
+          auto const BitOffset =
+            RecordLayout.getFieldOffset(Field->getFieldIndex());
+
+          Layout->Fields.push_back(FieldLayout{Field,
+                                               BitOffset / CHAR_BIT,
+                                               BitOffset % CHAR_BIT != 0});
+        }
+        break;
+      }
+
+      default:
+        break;
+    }
+
+    return std::move(Layout);
+  }
+
+public:
+  /// \brief Constructor.
+  ///
+  TypeLayoutCache(::clang::ASTContext const &ForAST,
+                  std::recursive_mutex &WithAccess)
+  : AST(ForAST),
+    SwapBytes(ForAST.getTargetInfo().isBigEndian()
+              != llvm::sys::IsBigEndianHost),
+    Access(WithAccess),
+    Layouts()
+  {}
+
+  /// \brief Get the layout of a complete canonical type.
+  ///
+  std::shared_ptr<TypeLayout const> get(::clang::Type const *CanonicalType) {
+    std::lock_guard<std::recursive_mutex> Lock(Access);
+
+    auto &Layout = Layouts[CanonicalType];
+    if (!Layout)
+      Layout = computeLayout(CanonicalType);
+
+    return Layout;
+  }
+};
+
+/// \brief Holds the memory for the in-memory Values of part of a ValueStore.
+///
+/// Values are allocated from large blocks and are never freed individually.
+/// Instead, all of the Values are destroyed together when the arena is. The
+/// store hands out aliasing shared_ptrs that share ownership of the arena, so
+/// creating a Value needs no allocation of its own, and a Value remains valid
+/// while it is referenced, even after the store has discarded it.
+///
+class ValueArena final {
+  /// Size of each block.
+  static constexpr std::size_t BlockSize = 64 * 1024;
+
+  /// Values are created by multiple threads.
+  std::mutex Access;
+
+  /// All blocks.
+  std::vector<std::unique_ptr<char[]>> Blocks;
+
+  /// Next unused memory in the current block.
+  char *Next;
+
+  /// End of the current block.
+  char *End;
+
+  /// All Values created in this arena, in order of creation.
+  std::vector<Value const *> Values;
+
+  /// \brief Get memory for an object.
+  ///
+  void *allocate(std::size_t const Size, std::size_t const Align) {
+    assert(Size <= BlockSize && "Value too large for arena.");
+
+    auto const Padding = (Align - reinterpret_cast<uintptr_t>(Next) % Align)
+                         % Align;
+
+    if (!Next || std::size_t(End - Next) < Padding + Size) {
+      Blocks.emplace_back(new char[BlockSize]);
+      Next = Blocks.back().get();
+      End = Next + BlockSize;
+      return allocate(Size, Align);
+    }
+
+    auto const Memory = Next + Padding;
+    Next = Memory + Size;
+    return Memory;
+  }
+
+public:
+  ValueArena()
+  : Access(),
+    Blocks(),
+    Next(nullptr),
+    End(nullptr),
+    Values()
+  {}
+
+  ValueArena(ValueArena const &) = delete;
+  ValueArena &operator=(ValueArena const &) = delete;
+
+  ~ValueArena() {
+    for (auto It = Values.rbegin(), End = Values.rend(); It != End; ++It)
+      (*It)->~Value();
+  }
+
+  /// \brief Create a Value in this arena.
+  /// \param Construct constructs the Value in the memory that it is given,
+  ///        and returns a pointer to it. This allows classes with private
+  ///        constructors to use this from their own create() functions.
+  ///
+  template<typename T, typename ConstructFnT>
+  T *create(ConstructFnT Construct) {
+    std::lock_guard<std::mutex> Lock(Access);
+
+    auto const Object = Construct(allocate(sizeof(T), alignof(T)));
+    Values.push_back(Object);
+    return Object;
   }
 };
 
 class ValueStoreImpl final {
-  /// Control access to the Store variable.
-  mutable std::mutex StoreAccess;
+  /// \brief A part of the store, holding the Values at some addresses.
+  ///
+  struct Shard {
+    /// Control access to this shard's members.
+    std::mutex Access;
+
+    // Two-stage lookup to find previously created Value objects.
+    // The first stage is the in-memory address of the object.
+    // The second stage is the canonical type of the object.
+    llvm::DenseMap<stateptr_ty, TypedValueSet> Store;
+
+    /// For each address in \c Store, the greatest end address of the Values
+    /// at that address. Used to find the Values that overlap a changed area.
+    std::map<stateptr_ty, stateptr_ty> StoreExtents;
+
+    /// The size of the largest Value in \c Store.
+    std::size_t MaxValueSize = 0;
+
+    /// Holds the memory for the Values created at this shard's addresses.
+    std::shared_ptr<ValueArena> Arena = std::make_shared<ValueArena>();
+
+    /// The number of Values in \c Store.
+    std::size_t ValueCount = 0;
 
-  // Two-stage lookup to find previously created Value objects.
-  // The first stage is the in-memory address of the object.
-  // The second stage is the canonical type of the object.
-  mutable llvm::DenseMap<stateptr_ty, TypedValueSet> Store;
+    /// The number of Values in \c Arena that have been removed from
+    /// \c Store, whose memory is held until the arena is released.
+    std::size_t DiscardedCount = 0;
+  };
+
+  /// When a shard has discarded at least this many Values, and more than it
+  /// holds, it releases its arena and starts again.
+  static constexpr std::size_t MinDiscardedToRelease = 1024;
+
+  /// Number of shards. Layout tasks look up Values concurrently, so the
+  /// store is divided to keep them from contending on a single lock.
+  static constexpr std::size_t ShardCount = 64;
+
+  /// The shards, selected by \c getShard().
+  mutable std::array<Shard, ShardCount> Shards;
 
   /// SeeC-Clang mapping information.
   seec::seec_clang::MappedModule const &Mapping;
 
+  /// Results of matching types from different ASTs (shared by all stores for
+  /// this mapping).
+  TypeMatchCache &TypeMatches;
+
+  /// Control access to LayoutCaches.
+  mutable std::mutex LayoutCachesAccess;
+
+  /// The type layout cache for each ASTContext.
+  mutable std::map< ::clang::ASTContext const *,
+                    std::unique_ptr<TypeLayoutCache>> LayoutCaches;
+
   // Disable copying and moving.
   ValueStoreImpl(ValueStoreImpl const &) = delete;
   ValueStoreImpl(ValueStoreImpl &&) = delete;
   ValueStoreImpl &operator=(ValueStoreImpl const &) = delete;
   ValueStoreImpl &operator=(ValueStore &&) = delete;
 
+  /// \brief Get the shard that holds Values at the given address.
+  ///
+  Shard &getShard(stateptr_ty const Address) const {
+    // Neighbouring objects are usually at least a few chars apart, so
+    // discard the low bits and mix the rest.
+    auto const Hash = (uint64_t(Address) >> 3) * UINT64_C(0x9E3779B97F4A7C15);
+    return Shards[(Hash >> 32) % ShardCount];
+  }
+
 public:
   /// \brief Constructor.
-  ValueStoreImpl(seec::seec_clang::MappedModule const &WithMapping)
-  : StoreAccess(),
-    Store(),
-    Mapping(WithMapping)
+  ValueStoreImpl(seec::seec_clang::MappedModule const &WithMapping,
+                 TypeMatchCache &WithTypeMatches)
+  : Shards(),
+    Mapping(WithMapping),
+    TypeMatches(WithTypeMatches),
+    LayoutCachesAccess(),
+    LayoutCaches()
   {}
 
   /// \brief Find or construct a Value for the given type.
@@ -150,62 +691,176 @@ public:
   ///
   seec::seec_clang::MappedModule const &getMapping() const { return Mapping; }
 
+  /// \brief Get the layout of a complete canonical type.
+  ///
+  std::shared_ptr<TypeLayout const>
+  getTypeLayout(::clang::ASTContext const &ASTContext,
+                ::clang::Type const *CanonicalType) const
+  {
+    TypeLayoutCache *Cache = nullptr;
+
+    {
+      std::lock_guard<std::mutex> Lock(LayoutCachesAccess);
+      auto &Entry = LayoutCaches[&ASTContext];
+      if (!Entry)
+        Entry = llvm::make_unique<TypeLayoutCache>
+                  (ASTContext, TypeMatches.getContextAccess(ASTContext));
+      Cache = Entry.get();
+    }
+
+    return Cache->get(CanonicalType);
+  }
+
+  /// \brief Get the arena that holds Values created at the given address.
+  ///
+  std::shared_ptr<ValueArena> getArena(stateptr_ty const Address) const {
+    auto &S = getShard(Address);
+    std::lock_guard<std::mutex> LockShard(S.Access);
+    return S.Arena;
+  }
+
   /// \brief Find first \c Value matching the given predicate.
   ///
   std::shared_ptr<Value const>
   findFromAddressAndType(stateptr_ty Address, llvm::StringRef TypeString) const
   {
-    auto const It = Store.find(Address);
+    auto &S = getShard(Address);
+    std::lock_guard<std::mutex> LockShard(S.Access);
+
+    auto const It = S.Store.find(Address);
 
-    if (It == Store.end())
+    if (It == S.Store.end())
       return std::shared_ptr<Value const>();
 
     return It->second.getSharedFromTypeString(TypeString);
   }
+
+  /// \brief Remove all Values that overlap the given areas of memory.
+  ///
+  void invalidate(llvm::ArrayRef<MemoryArea> Areas) const
+  {
+    for (auto &S : Shards) {
+      std::lock_guard<std::mutex> LockShard(S.Access);
+
+      if (S.StoreExtents.empty())
+        continue;
+
+      for (auto const &Area : Areas) {
+        // Values that start before the area may extend into it.
+        auto const First = Area.start() > S.MaxValueSize
+                         ? Area.start() - S.MaxValueSize
+                         : stateptr_ty(0);
+
+        auto It = S.StoreExtents.lower_bound(First);
+        while (It != S.StoreExtents.end() && It->first < Area.end()) {
+          if (It->second > Area.start()) {
+            auto const StoreIt = S.Store.find(It->first);
+            if (StoreIt != S.Store.end()) {
+              S.ValueCount -= StoreIt->second.size();
+              S.DiscardedCount += StoreIt->second.size();
+              S.Store.erase(StoreIt);
+            }
+            It = S.StoreExtents.erase(It);
+          }
+          else {
+            ++It;
+          }
+        }
+      }
+
+      // The discarded Values' memory is only reclaimed when the arena is
+      // released, so once they outnumber the remaining Values, discard those
+      // too and start a new arena. The old arena is released when the last
+      // reference to one of its Values is.
+      if (S.DiscardedCount >= MinDiscardedToRelease
+          && S.DiscardedCount > S.ValueCount)
+      {
+        S.Store.clear();
+        S.StoreExtents.clear();
+        S.MaxValueSize = 0;
+        S.Arena = std::make_shared<ValueArena>();
+        S.ValueCount = 0;
+        S.DiscardedCount = 0;
+      }
+    }
+  }
 };
 
+/// \brief Create a Value in the arena for its address in the given store.
+/// \param Construct constructs the Value (see ValueArena::create()).
+/// \return an aliasing shared_ptr that shares ownership of the arena.
+///
+template<typename T, typename ConstructFnT>
+std::shared_ptr<T> makeValueInArena(ValueStore const &Store,
+                                    stateptr_ty const Address,
+                                    ConstructFnT Construct)
+{
+  auto const Arena = Store.getImpl().getArena(Address);
+  return std::shared_ptr<T>(Arena, Arena->create<T>(Construct));
+}
+
 
 //===----------------------------------------------------------------------===//
 // readAPIntFromMemory()
 //===----------------------------------------------------------------------===//
 
+/// \brief Read a value of native type T from recorded memory.
+///
+template<typename T>
+T readNative(char const *Data, bool const SwapBytes)
+{
+  T Value;
+  std::memcpy(&Value, Data, sizeof(T));
+  return SwapBytes ? llvm::sys::getSwappedBytes(Value) : Value;
+}
+
+/// \brief Read an unsigned integer of 1, 2, 4, or 8 chars from memory.
+/// \return the value, if the memory is completely initialized.
+///
+Maybe<uint64_t> readUIntFromMemory(stateptr_ty const Address,
+                                   unsigned const Size,
+                                   bool const SwapBytes,
+                                   seec::trace::MemoryState const &Memory)
+{
+  auto const Region = Memory.getRegion(MemoryArea(Address, Size));
+  if (!Region.isAllocated() || !Region.isCompletelyInitialized())
+    return Maybe<uint64_t>();
+
+  auto const Data = Region.getByteValues().data();
+
+  switch (Size) {
+    case 1: return uint64_t(readNative<uint8_t >(Data, SwapBytes));
+    case 2: return uint64_t(readNative<uint16_t>(Data, SwapBytes));
+    case 4: return uint64_t(readNative<uint32_t>(Data, SwapBytes));
+    case 8: return uint64_t(readNative<uint64_t>(Data, SwapBytes));
+  }
+
+  return Maybe<uint64_t>();
+}
+
 Maybe<llvm::APInt> readAPIntFromMemory(clang::ASTContext const &AST,
                                        clang::Type const *Type,
                                        stateptr_ty const Address,
                                        seec::trace::MemoryState const &Memory)
 {
-  auto const Size = AST.getTypeSizeInChars(Type);
-  auto const Region = Memory.getRegion(MemoryArea(Address, Size.getQuantity()));
-  if (!Region.isAllocated() || !Region.isCompletelyInitialized())
-    return Maybe<llvm::APInt>();
-
   auto const BitWidth = AST.getTypeSize(Type);
-  auto const RawBytes = Region.getByteValues();
-  auto const Data = RawBytes.data();
-
-  if (AST.getTargetInfo().isBigEndian() == llvm::sys::IsBigEndianHost) {
-    switch (BitWidth) {
-    case 8:  return llvm::APInt(8,  *reinterpret_cast<uint8_t  const *>(Data));
-    case 16: return llvm::APInt(16, *reinterpret_cast<uint16_t const *>(Data));
-    case 32: return llvm::APInt(32, *reinterpret_cast<uint32_t const *>(Data));
-    case 64: return llvm::APInt(64, *reinterpret_cast<uint64_t const *>(Data));
-    }
-  }
-  else {
-    switch (BitWidth) {
-    case 8:  return llvm::APInt(8,  *reinterpret_cast<uint8_t  const *>(Data));
-    case 16: return llvm::APInt(16, *reinterpret_cast<uint16_t const *>(Data))
-                          .byteSwap();
-    case 32: return llvm::APInt(32, *reinterpret_cast<uint32_t const *>(Data))
-                          .byteSwap();
-    case 64: return llvm::APInt(64, *reinterpret_cast<uint64_t const *>(Data))
-                          .byteSwap();
-    }
+  if (BitWidth != 8 && BitWidth != 16 && BitWidth != 32 && BitWidth != 64) {
+    llvm::errs() << "readAPIntFromMemory: unsupported bitwidth " << BitWidth
+                 << "\n";
+    return Maybe<llvm::APInt>();
   }
 
-  llvm::errs() << "readAPIntFromMemory: unsupported bitwidth " << BitWidth
-               << "\n";
-  return Maybe<llvm::APInt>();
+  auto const SwapBytes =
+    AST.getTargetInfo().isBigEndian() != llvm::sys::IsBigEndianHost;
+
+  auto const MaybeValue = readUIntFromMemory(Address,
+                                             unsigned(BitWidth / 8),
+                                             SwapBytes,
+                                             Memory);
+  if (!MaybeValue.assigned())
+    return Maybe<llvm::APInt>();
+
+  return llvm::APInt(unsigned(BitWidth), MaybeValue.get<uint64_t>());
 }
 
 
@@ -213,6 +868,98 @@ Maybe<llvm::APInt> readAPIntFromMemory(clang::ASTContext const &AST,
 // getScalarValueAsString() - from memory
 //===----------------------------------------------------------------------===//
 
+/// \brief Get a string describing the value of a plain char.
+///
+std::string getCharValueAsString(char const Value, bool const IsSigned)
+{
+  if ((static_cast<uint8_t>(Value) & 128) == 0) {
+    static char const * const FormattedASCII[] = {
+      "\\0", "SOH", "STX", "ETX", "EOT", "ENQ", "ACK", "BEL",  "BS", "\\t",
+      "\\n",  "VT", "\\f", "\\r",  "SO",  "SI", "DLE", "DC1", "DC2", "DC3",
+      "DC4", "NAK", "SYN", "ETB", "CAN",  "EM", "SUB", "ESC",  "FS",  "GS",
+       "RS",  "US",   " ",   "!",  "\"",   "#",   "$",   "%",   "&",   "'",
+        "(",   ")",   "*",   "+",   ",",   "-",   ".",   "/",   "0",   "1",
+        "2",   "3",   "4",   "5",   "6",   "7",   "8",   "9",   ":",   ";",
+        "<",   "=",   ">",   "?",   "@",   "A",   "B",   "C",   "D",   "E",
+        "F",   "G",   "H",   "I",   "J",   "K",   "L",   "M",   "N",   "O",
+        "P",   "Q",   "R",   "S",   "T",   "U",   "V",   "W",   "X",   "Y",
+        "Z",   "[",  "\\",   "]",   "^",   "_",   "`",   "a",   "b",   "c",
+        "d",   "e",   "f",   "g",   "h",   "i",   "j",   "k",   "l",   "m",
+        "n",   "o",   "p",   "q",   "r",   "s",   "t",   "u",   "v",   "w",
+        "x",   "y",   "z",   "{",   "|",   "}",   "~", "DEL" };
+
+    return FormattedASCII[static_cast<unsigned>(Value)];
+  }
+  else if (IsSigned) {
+    return std::to_string(static_cast<signed char>(Value));
+  }
+  else {
+    return std::to_string(static_cast<unsigned char>(Value));
+  }
+}
+
+/// \brief Get a string describing the value of a scalar that can be decoded
+///        to a native type (i.e. Layout.Kind is not ScalarKind::None).
+///
+std::string
+getScalarValueAsString(TypeLayout const &Layout,
+                       stateptr_ty const Address,
+                       seec::trace::MemoryState const &Memory)
+{
+  auto const Size = unsigned(Layout.Size.getQuantity());
+  auto const MaybeBits = readUIntFromMemory(Address,
+                                            Size,
+                                            Layout.SwapBytes,
+                                            Memory);
+  if (!MaybeBits.assigned())
+    return std::string{"<unallocated or uninitialized>"};
+
+  auto const Bits = MaybeBits.get<uint64_t>();
+
+  switch (Layout.Kind) {
+    case ScalarKind::CharSigned:
+      return getCharValueAsString(static_cast<char>(Bits), true);
+
+    case ScalarKind::CharUnsigned:
+      return getCharValueAsString(static_cast<char>(Bits), false);
+
+    case ScalarKind::Signed:
+    {
+      // Sign-extend from the width of the type.
+      auto const Shift = 64 - (Size * CHAR_BIT);
+      auto const Value = static_cast<int64_t>(Bits << Shift) >> Shift;
+      return std::to_string(Value);
+    }
+
+    case ScalarKind::Unsigned:
+      return std::to_string(Bits);
+
+    case ScalarKind::Pointer:
+      return std::string{"0x"} + llvm::utohexstr(Bits);
+
+    case ScalarKind::Float:
+    {
+      float Value;
+      auto const Raw = static_cast<uint32_t>(Bits);
+      std::memcpy(&Value, &Raw, sizeof(Value));
+      return std::to_string(Value);
+    }
+
+    case ScalarKind::Double:
+    {
+      double Value;
+      std::memcpy(&Value, &Bits, sizeof(Value));
+      return std::to_string(Value);
+    }
+
+    case ScalarKind::None:
+      break;
+  }
+
+  llvm_unreachable("scalar can not be decoded natively");
+  return std::string{};
+}
+
 std::string
 getScalarValueAsString(clang::ASTContext const &AST,
                        clang::BuiltinType const *Type,
@@ -227,35 +974,8 @@ getScalarValueAsString(clang::ASTContext const &AST,
     if (!Region.isAllocated() || !Region.isCompletelyInitialized())
       return std::string{"<uninitialized>"};
 
-    auto const Value = Region.getByteValues()[0];
-    std::string Printed;
-
-    if ((static_cast<uint8_t>(Value) & 128) == 0) {
-      static char const * const FormattedASCII[] = {
-        "\\0", "SOH", "STX", "ETX", "EOT", "ENQ", "ACK", "BEL",  "BS", "\\t",
-        "\\n",  "VT", "\\f", "\\r",  "SO",  "SI", "DLE", "DC1", "DC2", "DC3",
-        "DC4", "NAK", "SYN", "ETB", "CAN",  "EM", "SUB", "ESC",  "FS",  "GS",
-         "RS",  "US",   " ",   "!",  "\"",   "#",   "$",   "%",   "&",   "'",
-          "(",   ")",   "*",   "+",   ",",   "-",   ".",   "/",   "0",   "1",
-          "2",   "3",   "4",   "5",   "6",   "7",   "8",   "9",   ":",   ";",
-          "<",   "=",   ">",   "?",   "@",   "A",   "B",   "C",   "D",   "E",
-          "F",   "G",   "H",   "I",   "J",   "K",   "L",   "M",   "N",   "O",
-          "P",   "Q",   "R",   "S",   "T",   "U",   "V",   "W",   "X",   "Y",
-          "Z",   "[",  "\\",   "]",   "^",   "_",   "`",   "a",   "b",   "c",
-          "d",   "e",   "f",   "g",   "h",   "i",   "j",   "k",   "l",   "m",
-          "n",   "o",   "p",   "q",   "r",   "s",   "t",   "u",   "v",   "w",
-          "x",   "y",   "z",   "{",   "|",   "}",   "~", "DEL" };
-
-      Printed = FormattedASCII[static_cast<unsigned>(Value)];
-    }
-    else if (Type->getKind() == clang::BuiltinType::Char_S) {
-      Printed = std::to_string(static_cast<signed char>(Value));
-    }
-    else {
-      Printed = std::to_string(static_cast<unsigned char>(Value));
-    }
-
-    return Printed;
+    return getCharValueAsString(Region.getByteValues()[0],
+                                Type->getKind() == clang::BuiltinType::Char_S);
   }
   else if (Type->isInteger()) {
     auto const Size     = AST.getTypeSizeInChars(Type);
@@ -466,6 +1186,9 @@ class ValueByMemoryForScalar final : public ValueOfScalar {
   
   /// The size of the value.
   ::clang::CharUnits Size;
+
+  /// The layout of this value's type.
+  std::shared_ptr<TypeLayout const> Layout;
   
   /// The state of recorded memory.
   seec::trace::MemoryState const &Memory;
@@ -501,14 +1224,15 @@ public:
   ///
   ValueByMemoryForScalar(::clang::Type const *WithCanonicalType,
                          stateptr_ty WithAddress,
-                         ::clang::CharUnits WithSize,
+                         std::shared_ptr<TypeLayout const> WithLayout,
                          seec::trace::ProcessState const &ForProcessState,
                          clang::ASTContext const &WithAST)
   : ValueOfScalar(),
     AST(WithAST),
     CanonicalType(WithCanonicalType),
     Address(WithAddress),
-    Size(WithSize),
+    Size(WithLayout->Size),
+    Layout(std::move(WithLayout)),
     Memory(ForProcessState.getMemory())
   {}
   
@@ -555,6 +1279,9 @@ public:
     if (!isCompletelyInitialized())
       return std::string("<uninitialized>");
 
+    if (Layout->Kind != ScalarKind::None)
+      return getScalarValueAsString(*Layout, Address, Memory);
+
     return getScalarValueAsString(AST, CanonicalType, Address, Memory);
   }
   
@@ -583,6 +1310,9 @@ class ValueByMemoryForComplex final : public ValueOfComplex {
   /// The size of the value.
   ::clang::CharUnits Size;
 
+  /// The layout of the element type.
+  std::shared_ptr<TypeLayout const> ElementLayout;
+
   /// The state of recorded memory.
   seec::trace::MemoryState const &Memory;
 
@@ -605,6 +1335,7 @@ public:
   ValueByMemoryForComplex(::clang::ComplexType const *WithCanonicalType,
                           stateptr_ty WithAddress,
                           ::clang::CharUnits WithSize,
+                          std::shared_ptr<TypeLayout const> WithElementLayout,
                           seec::trace::ProcessState const &ForProcessState,
                           clang::ASTContext const &WithAST)
   : ValueOfComplex(),
@@ -612,6 +1343,7 @@ public:
     CanonicalType(WithCanonicalType),
     Address(WithAddress),
     Size(WithSize),
+    ElementLayout(std::move(WithElementLayout)),
     Memory(ForProcessState.getMemory())
   {}
 
@@ -661,13 +1393,18 @@ public:
       llvm::dyn_cast<clang::BuiltinType>
                     (CanonicalType->getElementType().getTypePtr());
 
-    auto const ElemSize = AST.getTypeSizeInChars(ElemTy);
-
+    // The imaginary part follows the real part (including any padding).
     auto const RealAddr = Address;
-    auto const ImagAddr = RealAddr + ElemSize.getQuantity();
+    auto const ImagAddr = RealAddr + Size.getQuantity() / 2;
 
-    Ret = getScalarValueAsString(AST, ElemTy, RealAddr, Memory);
-    auto const ImagStr = getScalarValueAsString(AST, ElemTy, ImagAddr, Memory);
+    auto const GetPart = [&] (stateptr_ty const PartAddr) {
+      return ElementLayout->Kind != ScalarKind::None
+           ? getScalarValueAsString(*ElementLayout, PartAddr, Memory)
+           : getScalarValueAsString(AST, ElemTy, PartAddr, Memory);
+    };
+
+    Ret = GetPart(RealAddr);
+    auto const ImagStr = GetPart(ImagAddr);
 
     if (ImagStr.size() == 0 || ImagStr[0] != '-')
       Ret.push_back('+');
@@ -697,6 +1434,9 @@ class ValueByMemoryForPointer final : public ValueOfPointer {
   
   /// The address of this pointer (not the value of the pointer).
   stateptr_ty Address;
+
+  /// The size of the pointer.
+  ::clang::CharUnits Size;
   
   /// The size of the pointee type.
   ::clang::CharUnits PointeeSize;
@@ -713,6 +1453,7 @@ class ValueByMemoryForPointer final : public ValueOfPointer {
                           ::clang::ASTContext const &WithASTContext,
                           ::clang::Type const *WithCanonicalType,
                           stateptr_ty WithAddress,
+                          ::clang::CharUnits WithSize,
                           ::clang::CharUnits WithPointeeSize,
                           stateptr_ty WithRawValue,
                           seec::trace::ProcessState const &ForProcessState)
@@ -720,6 +1461,7 @@ class ValueByMemoryForPointer final : public ValueOfPointer {
     ASTContext(WithASTContext),
     CanonicalType(WithCanonicalType),
     Address(WithAddress),
+    Size(WithSize),
     PointeeSize(WithPointeeSize),
     RawValue(WithRawValue),
     ProcessState(ForProcessState)
@@ -737,7 +1479,7 @@ class ValueByMemoryForPointer final : public ValueOfPointer {
   /// \brief Get the size of the value's type.
   ///
   virtual ::clang::CharUnits getTypeSizeInCharsImpl() const override {
-    return ASTContext.getTypeSizeInChars(CanonicalType);
+    return Size;
   }
   
   /// \brief Check if this is a valid opaque pointer (e.g. a DIR *).
@@ -769,34 +1511,42 @@ public:
          stateptr_ty Address,
          seec::trace::ProcessState const &ProcessState)
   {
-    // Get the size of pointee type.
-    auto const Type = CanonicalType->getAs< ::clang::PointerType>();
-    assert(Type && "Expected PointerType");
-    
-    auto const PointeeQType = Type->getPointeeType().getCanonicalType();
-    auto const PointeeSize = PointeeQType->isIncompleteType()
-                           ? ::clang::CharUnits::fromQuantity(0)
-                           : ASTContext.getTypeSizeInChars(PointeeQType);
-    
-    // Get the raw pointer value.
-    auto const MaybeValue = readAPIntFromMemory(ASTContext,
-                                                Type,
-                                                Address,
-                                                ProcessState.getMemory());
+    auto const StorePtr = Store.lock();
+    if (!StorePtr)
+      return std::shared_ptr<ValueByMemoryForPointer const>();
+
+    // Get the size of the pointer and its pointee type.
+    assert(CanonicalType->getAs< ::clang::PointerType>()
+           && "Expected PointerType");
 
-    auto const PtrValue = MaybeValue.assigned<llvm::APInt>()
-                        ? MaybeValue.get<llvm::APInt>().getLimitedValue()
-                        : 0;
+    auto const Layout = StorePtr->getImpl().getTypeLayout(ASTContext,
+                                                          CanonicalType);
+
+    // Get the raw pointer value.
+    auto const MaybeValue =
+      Layout->Kind == ScalarKind::Pointer
+        ? readUIntFromMemory(Address,
+                             unsigned(Layout->Size.getQuantity()),
+                             Layout->SwapBytes,
+                             ProcessState.getMemory())
+        : Maybe<uint64_t>();
+
+    auto const PtrValue = MaybeValue.assigned()
+                        ? stateptr_ty(MaybeValue.get<uint64_t>())
+                        : stateptr_ty(0);
 
     // Create the object.
-    return std::shared_ptr<ValueByMemoryForPointer const>
-                          (new ValueByMemoryForPointer(Store,
-                                                       ASTContext,
-                                                       CanonicalType,
-                                                       Address,
-                                                       PointeeSize,
-                                                       PtrValue,
-                                                       ProcessState));
+    return makeValueInArena<ValueByMemoryForPointer>(*StorePtr, Address,
+      [&] (void *Memory) {
+        return new (Memory) ValueByMemoryForPointer(Store,
+                                                     ASTContext,
+                                                     CanonicalType,
+                                                     Address,
+                                                     Layout->Size,
+                                                     Layout->PointeeSize,
+                                                     PtrValue,
+                                                     ProcessState);
+      });
   }
   
   /// \brief Get the canonical type of this Value.
@@ -927,7 +1677,7 @@ class ValueByMemoryForRecord final : public ValueOfRecord {
   ::clang::ASTContext const &ASTContext;
   
   /// The layout information for this Record.
-  ::clang::ASTRecordLayout const &Layout;
+  std::shared_ptr<TypeLayout const> Layout;
   
   /// The canonical Type of this value.
   ::clang::Type const *CanonicalType;
@@ -942,13 +1692,13 @@ class ValueByMemoryForRecord final : public ValueOfRecord {
   ///
   ValueByMemoryForRecord(std::weak_ptr<ValueStore const> InStore,
                          ::clang::ASTContext const &WithASTContext,
-                         ::clang::ASTRecordLayout const &WithLayout,
+                         std::shared_ptr<TypeLayout const> WithLayout,
                          ::clang::Type const *WithCanonicalType,
                          stateptr_ty WithAddress,
                          seec::trace::ProcessState const &ForProcessState)
   : Store(InStore),
     ASTContext(WithASTContext),
-    Layout(WithLayout),
+    Layout(std::move(WithLayout)),
     CanonicalType(WithCanonicalType),
     Address(WithAddress),
     ProcessState(ForProcessState)
@@ -966,7 +1716,7 @@ class ValueByMemoryForRecord final : public ValueOfRecord {
   /// \brief Get the size of the value's type.
   ///
   virtual ::clang::CharUnits getTypeSizeInCharsImpl() const override {
-    return ASTContext.getTypeSizeInChars(CanonicalType);
+    return Layout->Size;
   }
 
 public:
@@ -979,20 +1729,27 @@ public:
          stateptr_ty Address,
          seec::trace::ProcessState const &ProcessState)
   {
+    auto const StorePtr = Store.lock();
+    if (!StorePtr)
+      return std::shared_ptr<ValueByMemoryForRecord>();
+
     auto const RecordTy = llvm::cast< ::clang::RecordType>(CanonicalType);
     auto const Decl = RecordTy->getDecl()->getDefinition();
     if (!Decl)
       return std::shared_ptr<ValueByMemoryForRecord>();
     
-    auto const &Layout = ASTContext.getASTRecordLayout(Decl);
+    auto const Layout = StorePtr->getImpl().getTypeLayout(ASTContext,
+                                                          CanonicalType);
     
-    return std::shared_ptr<ValueByMemoryForRecord>
-                          (new ValueByMemoryForRecord(Store,
-                                                      ASTContext,
-                                                      Layout,
-                                                      CanonicalType,
-                                                      Address,
-                                                      ProcessState));
+    return makeValueInArena<ValueByMemoryForRecord>(*StorePtr, Address,
+      [&] (void *Memory) {
+        return new (Memory) ValueByMemoryForRecord(Store,
+                                                    ASTContext,
+                                                    Layout,
+                                                    CanonicalType,
+                                                    Address,
+                                                    ProcessState);
+      });
   }
   
   /// \brief Get the canonical type of this Value.
@@ -1096,23 +1853,17 @@ public:
   /// \brief Get the number of members of this record.
   ///
   virtual unsigned getChildCount() const override {
-    return Layout.getFieldCount();
+    return Layout->Fields.size();
   }
   
   /// \brief Get the FieldDecl for the given child.
   ///
   virtual ::clang::FieldDecl const *
   getChildField(unsigned Index) const override {
-    if (Index > Layout.getFieldCount())
+    if (Index >= Layout->Fields.size())
       return nullptr;
     
-    auto const RecordTy = llvm::cast< ::clang::RecordType>(CanonicalType);
-    auto const Decl = RecordTy->getDecl()->getDefinition();
-    
-    auto FieldIt = Decl->field_begin();
-    std::advance(FieldIt, Index);
-    
-    return *FieldIt;
+    return Layout->Fields[Index].Decl;
   }
   
   /// \brief Get the Value of a member of this record.
@@ -1127,27 +1878,19 @@ public:
       return std::shared_ptr<Value const>();
     
     // Get information about the Index-th field.
-    auto const RecordTy = llvm::cast< ::clang::RecordType>(CanonicalType);
-    auto const Decl = RecordTy->getDecl()->getDefinition();
-    
-    auto FieldIt = Decl->field_begin();
-    for (auto FieldEnd = Decl->field_end(); ; ++FieldIt) {
-      if (FieldIt == FieldEnd)
-        return std::shared_ptr<Value const>();
-      
-      if (FieldIt->getFieldIndex() == Index)
-        break;
-    }
+    if (Index >= Layout->Fields.size())
+      return std::shared_ptr<Value const>();
+
+    auto const &Field = Layout->Fields[Index];
     
     // TODO: We don't support bitfields yet!
-    auto const BitOffset = Layout.getFieldOffset(Index);
-    if (BitOffset % CHAR_BIT != 0)
+    if (Field.IsUnaligned)
       return std::shared_ptr<Value const>();
     
     return getValue(StorePtr,
-                    FieldIt->getType(),
+                    Field.Decl->getType(),
                     ASTContext,
-                    Address + (BitOffset / CHAR_BIT),
+                    Address + Field.Offset,
                     ProcessState,
                     /* OwningFunction */ nullptr);
   }
@@ -1172,6 +1915,9 @@ class ValueByMemoryForArray final : public ValueOfArray {
   
   /// The memory address of this Value.
   stateptr_ty Address;
+
+  /// The size of the array's type (zero if not statically known).
+  ::clang::CharUnits Size;
   
   /// The size of an element.
   unsigned ElementSize;
@@ -1191,6 +1937,7 @@ class ValueByMemoryForArray final : public ValueOfArray {
                         ::clang::ASTContext const &WithASTContext,
                         ::clang::ArrayType const *WithCanonicalType,
                         stateptr_ty WithAddress,
+                        ::clang::CharUnits WithSize,
                         unsigned WithElementSize,
                         unsigned WithElementCount,
                         seec::trace::ProcessState const &ForProcessState,
@@ -1199,6 +1946,7 @@ class ValueByMemoryForArray final : public ValueOfArray {
     ASTContext(WithASTContext),
     CanonicalType(WithCanonicalType),
     Address(WithAddress),
+    Size(WithSize),
     ElementSize(WithElementSize),
     ElementCount(WithElementCount),
     ProcessState(ForProcessState),
@@ -1216,7 +1964,7 @@ class ValueByMemoryForArray final : public ValueOfArray {
   /// \brief Get the size of the value's type.
   ///
   virtual ::clang::CharUnits getTypeSizeInCharsImpl() const override {
-    return ASTContext.getTypeSizeInChars(CanonicalType);
+    return Size;
   }
 
   /// \brief Get the size of each child in this value.
@@ -1302,8 +2050,10 @@ public:
     auto const ArrayTy = llvm::cast< ::clang::ArrayType>(CanonicalType);
     auto const ElementTy = ArrayTy->getElementType();
 
-    unsigned ElementSize = ASTContext.getTypeSizeInChars(ElementTy)
-                                     .getQuantity();
+    auto const Layout = StorePtr->getImpl().getTypeLayout(ASTContext,
+                                                          CanonicalType);
+
+    unsigned ElementSize = Layout->ElementSize.getQuantity();
     
     if (!ElementSize) {
       if (OwningFunction) {
@@ -1369,15 +2119,18 @@ public:
         return std::shared_ptr<ValueByMemoryForArray const>();
     }
     
-    return std::shared_ptr<ValueByMemoryForArray const>
-                          (new ValueByMemoryForArray(Store,
-                                                     ASTContext,
-                                                     ArrayTy,
-                                                     Address,
-                                                     ElementSize,
-                                                     ElementCount,
-                                                     ProcessState,
-                                                     OwningFunction));
+    return makeValueInArena<ValueByMemoryForArray>(*StorePtr, Address,
+      [&] (void *Memory) {
+        return new (Memory) ValueByMemoryForArray(Store,
+                                                   ASTContext,
+                                                   ArrayTy,
+                                                   Address,
+                                                   Layout->Size,
+                                                   ElementSize,
+                                                   ElementCount,
+                                                   ProcessState,
+                                                   OwningFunction);
+      });
   }
   
   /// \brief Get the canonical type of this Value.
@@ -2391,43 +3144,44 @@ createValue(std::shared_ptr<ValueStore const> Store,
     return std::shared_ptr<Value const>(); // No values for incomplete types.
   }
   
-  auto TypeSize = ASTContext.getTypeSizeInChars(CanonicalType);
+  auto const &StoreImpl = Store->getImpl();
   
   switch (CanonicalType->getTypeClass()) {
     // Scalar values.
-    case ::clang::Type::Builtin:
-    {
-      // Correct the size of long double to only consider the used bytes.
-      auto const BT = llvm::dyn_cast< ::clang::BuiltinType >(CanonicalType);
-      if (BT->getKind() == clang::BuiltinType::LongDouble) {
-        auto const &Semantics = ASTContext.getFloatTypeSemantics(CanonicalType);
-        if (&Semantics == &llvm::APFloat::x87DoubleExtended()) {
-          TypeSize = ::clang::CharUnits::fromQuantity(10);
-        }
-      }
-
-      SEEC_FALLTHROUGH;
-    }
+    case ::clang::Type::Builtin: SEEC_FALLTHROUGH;
     case ::clang::Type::Atomic:  SEEC_FALLTHROUGH;
     case ::clang::Type::Enum:
     {
-      return std::make_shared<ValueByMemoryForScalar>
-                             (CanonicalType.getTypePtr(),
-                              Address,
-                              TypeSize,
-                              ProcessState,
-                              ASTContext);
+      auto const Layout = StoreImpl.getTypeLayout(ASTContext,
+                                                  CanonicalType.getTypePtr());
+
+      return makeValueInArena<ValueByMemoryForScalar>(*Store, Address,
+        [&] (void *Memory) {
+          return new (Memory) ValueByMemoryForScalar(CanonicalType.getTypePtr(),
+                                                     Address,
+                                                     Layout,
+                                                     ProcessState,
+                                                     ASTContext);
+        });
     }
 
     case ::clang::Type::Complex:
     {
       auto const CT = llvm::dyn_cast< ::clang::ComplexType>(CanonicalType);
-      return std::make_shared<ValueByMemoryForComplex>
-                             (CT,
-                              Address,
-                              TypeSize,
-                              ProcessState,
-                              ASTContext);
+      auto const Layout = StoreImpl.getTypeLayout(ASTContext, CT);
+      auto const ElementTy = CT->getElementType().getCanonicalType();
+      auto const ElementLayout = StoreImpl.getTypeLayout(ASTContext,
+                                                         ElementTy.getTypePtr());
+
+      return makeValueInArena<ValueByMemoryForComplex>(*Store, Address,
+        [&] (void *Memory) {
+          return new (Memory) ValueByMemoryForComplex(CT,
+                                                      Address,
+                                                      Layout->Size,
+                                                      ElementLayout,
+                                                      ProcessState,
+                                                      ASTContext);
+        });
     }
     
     case ::clang::Type::Pointer:
@@ -2526,29 +3280,78 @@ ValueStoreImpl::getValue(std::shared_ptr<ValueStore const> StorePtr,
     return std::shared_ptr<Value const>();
   }
 
-  // Lock the Store.
-  std::lock_guard<std::mutex> LockStore(StoreAccess);
+  auto const Matcher = MatchType(ASTContext, *CanonicalType, &TypeMatches);
+  auto &S = getShard(Address);
+
+  // The Values already at this address. They are compared to Matcher without
+  // the shard's lock, because matching types from different ASTContexts
+  // queries both contexts, which takes their locks.
+  llvm::SmallVector<TypedValueSet::ItemTy, 4> Candidates;
+
+  {
+    std::lock_guard<std::mutex> LockShard(S.Access);
 
-  // Get (or create) the lookup table for this memory address.
-  auto &TypeMap = Store[Address];
+    auto const It = S.Store.find(Address);
+    if (It != S.Store.end())
+      It->second.getItems(Candidates);
+  }
+
+  for (auto const &Candidate : Candidates)
+    if (Matcher == Candidate.first)
+      return Candidate.second;
+
+  // We must create a new Value. This queries (and lazily fills) the
+  // ASTContext's caches, so it holds the context's lock, but not the shard's
+  // lock, so that lookups in this shard can proceed.
+  std::shared_ptr<Value const> SharedPtr;
+
+  {
+    std::lock_guard<std::recursive_mutex>
+      LockAST(TypeMatches.getContextAccess(ASTContext));
 
-  auto const Matcher = MatchType(ASTContext, *CanonicalType);
-  auto const Existing = TypeMap.getShared(Matcher);
-  if (Existing)
-    return Existing;
+    SharedPtr = createValue(StorePtr,
+                            QualType,
+                            ASTContext,
+                            Address,
+                            ProcessState,
+                            OwningFunction);
+  }
 
-  // We must create a new Value.
-  auto SharedPtr = createValue(StorePtr,
-                                QualType,
-                                ASTContext,
-                                Address,
-                                ProcessState,
-                                OwningFunction);
   if (!SharedPtr)
     return SharedPtr;
 
+  // Another thread may have created the same Value in the meantime, in which
+  // case we use theirs so that all users share a single object. If Values
+  // were added while we compared the candidates, then compare them again.
+  std::unique_lock<std::mutex> LockShard(S.Access);
+
+  while (true) {
+    auto &TypeMap = S.Store[Address];
+    if (TypeMap.size() == Candidates.size())
+      break;
+
+    Candidates.clear();
+    TypeMap.getItems(Candidates);
+    LockShard.unlock();
+
+    for (auto const &Candidate : Candidates)
+      if (Matcher == Candidate.first)
+        return Candidate.second;
+
+    LockShard.lock();
+  }
+
   // Store a shared_ptr for this Value in the lookup table.
-  TypeMap.add(Matcher, SharedPtr);
+  S.Store[Address].add(Matcher, SharedPtr);
+  ++S.ValueCount;
+
+  // Record the extent of the Value, so that it can be invalidated when its
+  // memory changes.
+  auto const Size = std::max<std::size_t>(
+                      SharedPtr->getTypeSizeInChars().getQuantity(), 1);
+  auto &Extent = S.StoreExtents[Address];
+  Extent = std::max<stateptr_ty>(Extent, Address + Size);
+  S.MaxValueSize = std::max(S.MaxValueSize, Size);
 
   return SharedPtr;
 }
@@ -2558,8 +3361,9 @@ ValueStoreImpl::getValue(std::shared_ptr<ValueStore const> StorePtr,
 // ValueStore
 //===----------------------------------------------------------------------===//
 
-ValueStore::ValueStore(seec::seec_clang::MappedModule const &WithMapping)
-: Impl(new ValueStoreImpl(WithMapping))
+ValueStore::ValueStore(seec::seec_clang::MappedModule const &WithMapping,
+                       TypeMatchCache &WithTypeMatches)
+: Impl(new ValueStoreImpl(WithMapping, WithTypeMatches))
 {}
 
 ValueStore::~ValueStore() = default;
@@ -2575,6 +3379,11 @@ ValueStore::findFromAddressAndType(stateptr_ty Address,
   return Impl->findFromAddressAndType(Address, TypeString);
 }
 
+void ValueStore::invalidate(llvm::ArrayRef<MemoryArea> Areas) const
+{
+  Impl->invalidate(Areas);
+}
+
 
 //===----------------------------------------------------------------------===//
 // getValue() from a type and address.
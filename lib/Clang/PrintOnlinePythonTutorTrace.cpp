@@ -34,6 +34,11 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 using namespace seec::runtime_errors;
 using namespace seec::util;
 
@@ -70,7 +75,108 @@ llvm::StringRef GetSingularMainFileContents(ProcessTrace const &Trace)
   return FI->getContents().getBuffer();
 }
 
+/// \brief Writes the encoded states to the output stream on a second thread,
+///        so that the next state can be encoded while the current one is
+///        written.
+///
+/// At most a few states are held at once, so memory use does not grow with
+/// the length of the trace.
+///
+class OPTStateWriter {
+  /// The maximum number of states waiting to be written.
+  static constexpr std::size_t MaxPending = 4;
+
+  /// The output stream.
+  llvm::raw_ostream &Stream;
+
+  /// Control access to Pending and Finished.
+  std::mutex Access;
+
+  /// Notified when Pending or Finished changes.
+  std::condition_variable Changed;
+
+  /// States waiting to be written.
+  std::deque<std::string> Pending;
+
+  /// Set when no more states will be added.
+  bool Finished;
+
+  /// Writes the pending states.
+  std::thread Worker;
+
+  void run() {
+    std::unique_lock<std::mutex> Lock(Access);
+
+    while (true) {
+      Changed.wait(Lock, [this] () { return Finished || !Pending.empty(); });
+      if (Pending.empty())
+        return;
+
+      auto State = std::move(Pending.front());
+      Pending.pop_front();
+      Changed.notify_all();
+
+      Lock.unlock();
+      Stream << State;
+      Lock.lock();
+    }
+  }
+
+public:
+  OPTStateWriter(llvm::raw_ostream &ToStream)
+  : Stream(ToStream),
+    Access(),
+    Changed(),
+    Pending(),
+    Finished(false),
+    Worker()
+  {
+    Worker = std::thread([this] () { run(); });
+  }
+
+  ~OPTStateWriter() {
+    finish();
+  }
+
+  /// \brief Queue an encoded state to be written.
+  ///
+  void write(std::string State) {
+    std::unique_lock<std::mutex> Lock(Access);
+    Changed.wait(Lock, [this] () { return Pending.size() < MaxPending; });
+    Pending.emplace_back(std::move(State));
+    Changed.notify_all();
+  }
+
+  /// \brief Write all queued states and stop the second thread.
+  ///
+  void finish() {
+    {
+      std::lock_guard<std::mutex> Lock(Access);
+      Finished = true;
+    }
+
+    Changed.notify_all();
+
+    if (Worker.joinable())
+      Worker.join();
+  }
+};
+
 class OPTPrinter {
+  /// \brief A previously encoded aggregate value.
+  ///
+  struct EncodedValue {
+    /// The encoded value (held so that its address is not reused).
+    std::shared_ptr<Value const> Encoded;
+
+    /// The indentation that the encoding was written at.
+    std::size_t Indentation;
+
+    /// The encoding.
+    std::string Encoding;
+  };
+
+
   OPTSettings const &Settings;
 
   llvm::raw_ostream &Stream;
@@ -93,6 +199,20 @@ class OPTPrinter {
 
   unsigned PreviousExprWidth;
 
+  /// The next frame ID to assign.
+  uint32_t NextFrameID;
+
+  /// Number of pointers encoded so far.
+  uint64_t PointersEncoded;
+
+  /// Encodings of pointer-free aggregates from the previous state. A Value
+  /// object is discarded by the ValueStore when its memory changes, so if
+  /// the same object is found again its encoding can be reused.
+  llvm::DenseMap<Value const *, EncodedValue> PreviousEncodings;
+
+  /// Encodings of pointer-free aggregates from the current state.
+  llvm::DenseMap<Value const *, EncodedValue> CurrentEncodings;
+
   OPTPrinter(OPTSettings const &WithSettings,
              llvm::raw_ostream &ToStream,
              ProcessTrace const &FromTrace)
@@ -106,7 +226,11 @@ class OPTPrinter {
     FrameIDMap(),
     PreviousLine(1),
     PreviousExprColumn(1),
-    PreviousExprWidth(0)
+    PreviousExprWidth(0),
+    NextFrameID(1),
+    PointersEncoded(0),
+    PreviousEncodings(),
+    CurrentEncodings()
   {}
 
   uint32_t getFrameID(FunctionState const &Function);
@@ -153,7 +277,7 @@ class OPTPrinter {
                             clang::SourceLocation End,
                             clang::ASTContext const &AST);
 
-  bool printAndMoveState();
+  bool printAndMoveState(OPTStateWriter &Writer);
 
   bool printAllStates();
 
@@ -171,7 +295,9 @@ uint32_t OPTPrinter::getFrameID(FunctionState const &Function)
 {
   auto const &Trace = Function.getUnmappedState().getTrace();
   auto const Result = FrameIDMap.insert(std::make_pair(Trace.getEventStart(),
-                                                       FrameIDMap.size() + 1));
+                                                       NextFrameID));
+  if (Result.second)
+    ++NextFrameID;
   return Result.first->second;
 }
 
@@ -238,6 +364,8 @@ void OPTPrinter::printRecord(ValueOfRecord const &V)
 
 void OPTPrinter::printPointer(ValueOfPointer const &PV)
 {
+  ++PointersEncoded;
+
   Out << "[\n";
   Indent.indent();
   Out << Indent.getString() << "\"C_DATA\",\n"
@@ -313,11 +441,44 @@ void OPTPrinter::printValue(Value const &V)
 
 void OPTPrinter::printPossibleNullValue(std::shared_ptr<Value const> const &V)
 {
-  if (V) {
+  if (!V) {
+    Out << "null";
+    return;
+  }
+
+  // Scalars are cheap to encode, so only aggregates are reused.
+  if (V->getKind() != Value::Kind::Array && V->getKind() != Value::Kind::Record)
+  {
     printValue(*V);
+    return;
   }
-  else {
-    Out << "null";
+
+  auto const Indentation = Indent.getIndentation();
+
+  for (auto const Encodings : {&CurrentEncodings, &PreviousEncodings}) {
+    auto const It = Encodings->find(V.get());
+    if (It != Encodings->end() && It->second.Indentation == Indentation) {
+      Out << It->second.Encoding;
+      if (Encodings != &CurrentEncodings)
+        CurrentEncodings.insert(std::make_pair(It->first,
+                                               std::move(It->second)));
+      return;
+    }
+  }
+
+  Out.flush();
+  auto const Start = StateString.size();
+  auto const PointersBefore = PointersEncoded;
+
+  printValue(*V);
+
+  // The encoding of a pointer depends on the allocations that exist, and
+  // not only on the pointer's memory, so those encodings are not reused.
+  if (PointersEncoded == PointersBefore) {
+    Out.flush();
+    CurrentEncodings[V.get()] = EncodedValue{V,
+                                             Indentation,
+                                             StateString.substr(Start)};
   }
 }
 
@@ -528,6 +689,19 @@ void OPTPrinter::printThread(ThreadState const &Thread)
       printFunction(Fn, &Fn.get() == &Active);
     }
 
+    // Functions that have returned will never be printed again, so forget
+    // their frame IDs.
+    if (FrameIDMap.size() > Stack.size()) {
+      decltype(FrameIDMap) ActiveFrameIDs;
+      for (auto const &Fn : Stack) {
+        auto const &FnTrace = Fn.get().getUnmappedState().getTrace();
+        auto const It = FrameIDMap.find(FnTrace.getEventStart());
+        if (It != FrameIDMap.end())
+          ActiveFrameIDs.insert(*It);
+      }
+      FrameIDMap = std::move(ActiveFrameIDs);
+    }
+
     Indent.unindent();
     Out << "\n" << Indent.getString() << "],\n";
   }
@@ -727,7 +901,7 @@ void OPTPrinter::setPreviousPositions(clang::SourceLocation Start,
   }
 }
 
-bool OPTPrinter::printAndMoveState()
+bool OPTPrinter::printAndMoveState(OPTStateWriter &Writer)
 {
   Out << Indent.getString() << "{\n";
   Indent.indent();
@@ -793,18 +967,22 @@ bool OPTPrinter::printAndMoveState()
 
   if (Settings.getPyCrazyMode()) {
     // In pyCrazyMode our default movement is suitable.
-    Stream << StateString;
+    Writer.write(std::move(StateString));
   }
   else {
     // If the line moves at the next state, then print this state. This models
     // the behaviour expected by OnlinePythonTutor (each step represents the
     // complete execution of one line).
     if (OldPreviousLine != PreviousLine || Thread.isAtEnd())
-      Stream << StateString;
+      Writer.write(std::move(StateString));
   }
 
   StateString.clear();
 
+  // Only keep the encodings that were used by this state.
+  PreviousEncodings = std::move(CurrentEncodings);
+  CurrentEncodings.clear();
+
   return Moved != seec::cm::MovementResult::Unmoved;
 }
 
@@ -834,7 +1012,10 @@ bool OPTPrinter::printAllStates()
   Stream << Indent.getString() << "\"trace\": [\n";
   Indent.indent();
 
-  while (printAndMoveState()) {}
+  {
+    OPTStateWriter Writer(Stream);
+    while (printAndMoveState(Writer)) {}
+  }
 
   Indent.unindent();
   Stream << Indent.getString() << "]\n";
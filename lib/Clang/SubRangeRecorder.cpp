@@ -400,79 +400,69 @@ static FormattedStmt prettyPrintFallback(clang::Stmt const *S,
   return FormattedStmt{std::move(Print), std::move(FormattedRanges)};
 }
 
-class FormattedStmtCacheForAST
+FormattedStmtCacheForAST::
+FormattedStmtCacheForAST(seec::seec_clang::MappedAST const &ForMappedAST)
+: MappedAST(ForMappedAST),
+  Clang(makeCompilerInstance(MappedAST)),
+  PreprocessedTokens(),
+  RawTokens(),
+  Formatted(),
+  Mutex()
 {
-  seec::seec_clang::MappedAST const &MappedAST;
-
-  std::unique_ptr<clang::CompilerInstance> Clang;
-
-  std::vector<clang::Token> PreprocessedTokens;
+  if (!Clang)
+    return;
 
-  std::map<clang::FileID, std::vector<clang::Token>> RawTokens;
-
-public:
-  FormattedStmtCacheForAST(seec::seec_clang::MappedAST const &ForMappedAST)
-  : MappedAST(ForMappedAST),
-    Clang(makeCompilerInstance(MappedAST)),
-    PreprocessedTokens(),
-    RawTokens()
-  {
-    // Generate all the preprocessed tokens. The raw tokens will be generated
-    // lazily.
-    auto &PP = Clang->getPreprocessor();
-
-    PP.EnterMainSourceFile();
-    clang::Token PPTok;
-
-    do {
-      PP.Lex(PPTok);
-      PreprocessedTokens.push_back(PPTok);
-    } while (PPTok.isNot(clang::tok::eof));
-  }
+  // Generate all the preprocessed tokens. The raw tokens will be generated
+  // lazily.
+  auto &PP = Clang->getPreprocessor();
 
-  seec::seec_clang::MappedAST const &getMappedAST() const { return MappedAST; }
+  PP.EnterMainSourceFile();
+  clang::Token PPTok;
 
-  bool hasCompilerInstance() const { return Clang != nullptr; }
+  do {
+    PP.Lex(PPTok);
+    PreprocessedTokens.push_back(PPTok);
+  } while (PPTok.isNot(clang::tok::eof));
+}
 
-  clang::Preprocessor const &getPreprocessor() const {
-    return Clang->getPreprocessor();
-  }
+FormattedStmtCacheForAST::~FormattedStmtCacheForAST() = default;
 
-  std::vector<clang::Token> const &getPreprocessedTokens() const {
-    return PreprocessedTokens;
-  }
+clang::Preprocessor const &FormattedStmtCacheForAST::getPreprocessor() const
+{
+  return Clang->getPreprocessor();
+}
 
-  std::vector<clang::Token> const *getRawTokens(clang::FileID const FID)
-  {
-    auto const It = RawTokens.lower_bound(FID);
-    if (It != RawTokens.end() && It->first == FID)
-      return &(It->second);
+std::vector<clang::Token> const *
+FormattedStmtCacheForAST::getRawTokens(clang::FileID const FID)
+{
+  auto const It = RawTokens.lower_bound(FID);
+  if (It != RawTokens.end() && It->first == FID)
+    return &(It->second);
 
-    // Generate the raw tokens now.
-    auto &PP = Clang->getPreprocessor();
-    auto &SM = PP.getSourceManager();
+  // Generate the raw tokens now.
+  auto &PP = Clang->getPreprocessor();
+  auto &SM = PP.getSourceManager();
 
-    bool BufferError = false;
-    auto const Buffer = SM.getBuffer(FID, &BufferError);
-    if (BufferError)
-      return nullptr;
+  bool BufferError = false;
+  auto const Buffer = SM.getBuffer(FID, &BufferError);
+  if (BufferError)
+    return nullptr;
 
-    std::vector<clang::Token> Tokens;
-    clang::Lexer RawLex(FID, Buffer, SM, PP.getLangOpts());
+  std::vector<clang::Token> Tokens;
+  clang::Lexer RawLex(FID, Buffer, SM, PP.getLangOpts());
 
-    clang::Token RawTok;
+  clang::Token RawTok;
 
-    do {
-      RawLex.LexFromRawLexer(RawTok);
-      if (RawTok.is(clang::tok::raw_identifier))
-        PP.LookUpIdentifierInfo(RawTok);
-      Tokens.push_back(RawTok);
-    } while (RawTok.isNot(clang::tok::eof));
-
-    auto const Inserted = RawTokens.emplace_hint(It, FID, std::move(Tokens));
-    return &(Inserted->second);
-  }
-};
+  do {
+    RawLex.LexFromRawLexer(RawTok);
+    if (RawTok.is(clang::tok::raw_identifier))
+      PP.LookUpIdentifierInfo(RawTok);
+    Tokens.push_back(RawTok);
+  } while (RawTok.isNot(clang::tok::eof));
+
+  auto const Inserted = RawTokens.emplace_hint(It, FID, std::move(Tokens));
+  return &(Inserted->second);
+}
 
 static clang::Token const *getNextToken(std::vector<clang::Token> const &Tokens,
                                         std::size_t &TokenIndex)
@@ -537,16 +527,22 @@ bool formatMacro(FormattedStmtBuilder &Builder,
   return true;
 }
 
-FormattedStmt formatStmtSource(clang::Stmt const *S,
-                               seec::seec_clang::MappedAST const &MappedAST)
+/// \brief Generate a formatted \c clang::Stmt using the tokens in
+///        \c CacheForAST, which must be locked by the caller.
+///
+static FormattedStmt formatStmtSourceUncached(clang::Stmt const *S,
+                                              FormattedStmtCacheForAST
+                                                &CacheForAST)
 {
+  auto const &MappedAST = CacheForAST.getMappedAST();
+
   auto LocStart = S->getLocStart();
   auto LocEnd   = S->getLocEnd();
-  if (!LocStart.isValid() || !LocEnd.isValid())
+  if (!LocStart.isValid() || !LocEnd.isValid()
+      || !CacheForAST.hasCompilerInstance())
     return prettyPrintFallback(S, MappedAST.getASTUnit().getASTContext());
 
   FormattedStmtBuilder Builder{S, MappedAST};
-  FormattedStmtCacheForAST CacheForAST{MappedAST};
 
   auto &PP = CacheForAST.getPreprocessor();
   auto &SM = PP.getSourceManager();
@@ -583,4 +579,16 @@ FormattedStmt formatStmtSource(clang::Stmt const *S,
   return Builder.finish();
 }
 
+FormattedStmt formatStmtSource(clang::Stmt const *S,
+                               seec::seec_clang::MappedAST const &MappedAST)
+{
+  auto &CacheForAST = MappedAST.getFormattedStmtCache();
+  std::lock_guard<std::mutex> Lock(CacheForAST.getLock());
+
+  if (auto const Cached = CacheForAST.getFormatted(S))
+    return *Cached;
+
+  return CacheForAST.addFormatted(S, formatStmtSourceUncached(S, CacheForAST));
+}
+
 } // namespace seec
@@ -16,30 +16,51 @@
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/Type.h"
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
 
-#include <algorithm>
+#include <mutex>
+#include <utility>
 
 namespace seec {
 
 namespace cm {
 
-using HistoryTy = std::vector<clang::Type const *>;
+/// \brief State shared by all comparisons made for a single call to
+///        matchImpl().
+///
+struct MatchState {
+  using KeyTy = std::pair< ::clang::Type const *, ::clang::Type const *>;
 
-bool matchImpl(::clang::ASTContext const &AContext,
-               HistoryTy &AHistory,
-               ::clang::Type const *AType,
-               ::clang::ASTContext const &BContext,
-               HistoryTy &BHistory,
-               ::clang::Type const *BType);
+  /// The shared cache of completed matches (may be null).
+  TypeMatchCache *Cache;
+
+  /// Pairs of canonical types that are currently being compared.
+  llvm::DenseSet<KeyTy> InProgress;
+
+  /// The result of each comparison completed during this call.
+  llvm::DenseMap<KeyTy, bool> Results;
+
+  MatchState(TypeMatchCache *WithCache)
+  : Cache(WithCache),
+    InProgress(),
+    Results()
+  {}
+};
+
+static bool matchImpl(::clang::ASTContext const &AContext,
+                      ::clang::Type const *AType,
+                      ::clang::ASTContext const &BContext,
+                      ::clang::Type const *BType,
+                      MatchState &State);
 
 static bool matchType(::clang::ASTContext const &AContext,
-                      HistoryTy &AHistory,
                       ::clang::BuiltinType const *A,
                       ::clang::ASTContext const &BContext,
-                      HistoryTy &BHistory,
-                      ::clang::BuiltinType const *B)
+                      ::clang::BuiltinType const *B,
+                      MatchState &State)
 {
   auto const ATypeInfo = AContext.getTypeInfo(A);
   auto const BTypeInfo = BContext.getTypeInfo(B);
@@ -50,11 +71,10 @@ static bool matchType(::clang::ASTContext const &AContext,
 }
 
 static bool matchType(::clang::ASTContext const &AContext,
-                      HistoryTy &AHistory,
                       ::clang::ComplexType const *A,
                       ::clang::ASTContext const &BContext,
-                      HistoryTy &BHistory,
-                      ::clang::ComplexType const *B)
+                      ::clang::ComplexType const *B,
+                      MatchState &State)
 {
   auto const ATypeInfo = AContext.getTypeInfo(A);
   auto const BTypeInfo = BContext.getTypeInfo(B);
@@ -62,19 +82,17 @@ static bool matchType(::clang::ASTContext const &AContext,
     return false;
   
   return matchImpl(AContext,
-                   AHistory,
                    A->getElementType().getTypePtr(),
                    BContext,
-                   BHistory,
-                   B->getElementType().getTypePtr());
+                   B->getElementType().getTypePtr(),
+                   State);
 }
 
 static bool matchType(::clang::ASTContext const &AContext,
-                      HistoryTy &AHistory,
                       ::clang::PointerType const *A,
                       ::clang::ASTContext const &BContext,
-                      HistoryTy &BHistory,
-                      ::clang::PointerType const *B)
+                      ::clang::PointerType const *B,
+                      MatchState &State)
 {
   auto const ATypeInfo = AContext.getTypeInfo(A);
   auto const BTypeInfo = BContext.getTypeInfo(B);
@@ -82,19 +100,17 @@ static bool matchType(::clang::ASTContext const &AContext,
     return false;
   
   return matchImpl(AContext,
-                   AHistory,
                    A->getPointeeType().getTypePtr(),
                    BContext,
-                   BHistory,
-                   B->getPointeeType().getTypePtr());
+                   B->getPointeeType().getTypePtr(),
+                   State);
 }
 
 static bool matchType(::clang::ASTContext const &AContext,
-                      HistoryTy &AHistory,
                       ::clang::BlockPointerType const *A,
                       ::clang::ASTContext const &BContext,
-                      HistoryTy &BHistory,
-                      ::clang::BlockPointerType const *B)
+                      ::clang::BlockPointerType const *B,
+                      MatchState &State)
 {
   auto const ATypeInfo = AContext.getTypeInfo(A);
   auto const BTypeInfo = BContext.getTypeInfo(B);
@@ -102,22 +118,20 @@ static bool matchType(::clang::ASTContext const &AContext,
     return false;
   
   return matchImpl(AContext,
-                   AHistory,
                    A->getPointeeType().getTypePtr(),
                    BContext,
-                   BHistory,
-                   B->getPointeeType().getTypePtr());
+                   B->getPointeeType().getTypePtr(),
+                   State);
 }
 
 // This will handle \c LValueReferenceType and \c RValueReferenceType. Note: A
 // and B will be the same derived type, as that is checked in \c matchImpl().
 //
 static bool matchType(::clang::ASTContext const &AContext,
-                      HistoryTy &AHistory,
                       ::clang::ReferenceType const *A,
                       ::clang::ASTContext const &BContext,
-                      HistoryTy &BHistory,
-                      ::clang::ReferenceType const *B)
+                      ::clang::ReferenceType const *B,
+                      MatchState &State)
 {
   auto const ATypeInfo = AContext.getTypeInfo(A);
   auto const BTypeInfo = BContext.getTypeInfo(B);
@@ -125,19 +139,17 @@ static bool matchType(::clang::ASTContext const &AContext,
     return false;
   
   return matchImpl(AContext,
-                   AHistory,
                    A->getPointeeType().getTypePtr(),
                    BContext,
-                   BHistory,
-                   B->getPointeeType().getTypePtr());
+                   B->getPointeeType().getTypePtr(),
+                   State);
 }
 
 static bool matchType(::clang::ASTContext const &AContext,
-                      HistoryTy &AHistory,
                       ::clang::MemberPointerType const *A,
                       ::clang::ASTContext const &BContext,
-                      HistoryTy &BHistory,
-                      ::clang::MemberPointerType const *B)
+                      ::clang::MemberPointerType const *B,
+                      MatchState &State)
 {
   auto const ATypeInfo = AContext.getTypeInfo(A);
   auto const BTypeInfo = BContext.getTypeInfo(B);
@@ -145,36 +157,32 @@ static bool matchType(::clang::ASTContext const &AContext,
     return false;
   
   return matchImpl(AContext,
-                   AHistory,
                    A->getPointeeType().getTypePtr(),
                    BContext,
-                   BHistory,
-                   B->getPointeeType().getTypePtr());
+                   B->getPointeeType().getTypePtr(),
+                   State);
 }
 
 // This handles ConstantArrayType, IncompleteArrayType, VariableArrayType.
 //
 static bool matchType(::clang::ASTContext const &AContext,
-                      HistoryTy &AHistory,
                       ::clang::ArrayType const *A,
                       ::clang::ASTContext const &BContext,
-                      HistoryTy &BHistory,
-                      ::clang::ArrayType const *B)
+                      ::clang::ArrayType const *B,
+                      MatchState &State)
 {
   return matchImpl(AContext,
-                   AHistory,
                    A->getElementType().getTypePtr(),
                    BContext,
-                   BHistory,
-                   B->getElementType().getTypePtr());
+                   B->getElementType().getTypePtr(),
+                   State);
 }
 
 static bool matchType(::clang::ASTContext const &AContext,
-                      HistoryTy &AHistory,
                       ::clang::VectorType const *A,
                       ::clang::ASTContext const &BContext,
-                      HistoryTy &BHistory,
-                      ::clang::VectorType const *B)
+                      ::clang::VectorType const *B,
+                      MatchState &State)
 {
   assert(A && B);
   
@@ -185,19 +193,17 @@ static bool matchType(::clang::ASTContext const &AContext,
     return false;
   
   return matchImpl(AContext,
-                   AHistory,
                    A->getElementType().getTypePtr(),
                    BContext,
-                   BHistory,
-                   B->getElementType().getTypePtr());
+                   B->getElementType().getTypePtr(),
+                   State);
 }
 
 static bool matchType(::clang::ASTContext const &AContext,
-                      HistoryTy &AHistory,
                       ::clang::FunctionProtoType const *A,
                       ::clang::ASTContext const &BContext,
-                      HistoryTy &BHistory,
-                      ::clang::FunctionProtoType const *B)
+                      ::clang::FunctionProtoType const *B,
+                      MatchState &State)
 {
   // TODO.
   
@@ -205,30 +211,27 @@ static bool matchType(::clang::ASTContext const &AContext,
 }
 
 static bool matchType(::clang::ASTContext const &AContext,
-                      HistoryTy &AHistory,
                       ::clang::FunctionNoProtoType const *A,
                       ::clang::ASTContext const &BContext,
-                      HistoryTy &BHistory,
-                      ::clang::FunctionNoProtoType const *B)
+                      ::clang::FunctionNoProtoType const *B,
+                      MatchState &State)
 {
   if ((A->getCallConv() != B->getCallConv())
       || (A->isConst() != B->isConst()))
     return false;
   
   return matchImpl(AContext,
-                   AHistory,
                    A->getReturnType().getTypePtr(),
                    BContext,
-                   BHistory,
-                   B->getReturnType().getTypePtr());
+                   B->getReturnType().getTypePtr(),
+                   State);
 }
 
 static bool matchType(::clang::ASTContext const &AContext,
-                      HistoryTy &AHistory,
                       ::clang::RecordType const *A,
                       ::clang::ASTContext const &BContext,
-                      HistoryTy &BHistory,
-                      ::clang::RecordType const *B)
+                      ::clang::RecordType const *B,
+                      MatchState &State)
 {
   auto const ADecl = A->getDecl();
   auto const BDecl = B->getDecl();
@@ -263,7 +266,7 @@ static bool matchType(::clang::ASTContext const &AContext,
     auto const AFieldType = AIt->getType().getTypePtr();
     auto const BFieldType = BIt->getType().getTypePtr();
     
-    if (!matchImpl(AContext,AHistory,AFieldType,BContext,BHistory,BFieldType))
+    if (!matchImpl(AContext, AFieldType, BContext, BFieldType, State))
       return false;
   }
   
@@ -271,11 +274,10 @@ static bool matchType(::clang::ASTContext const &AContext,
 }
 
 static bool matchType(::clang::ASTContext const &AContext,
-                      HistoryTy &AHistory,
                       ::clang::EnumType const *A,
                       ::clang::ASTContext const &BContext,
-                      HistoryTy &BHistory,
-                      ::clang::EnumType const *B)
+                      ::clang::EnumType const *B,
+                      MatchState &State)
 {
   auto const ADecl = A->getDecl();
   auto const BDecl = B->getDecl();
@@ -299,7 +301,7 @@ static bool matchType(::clang::ASTContext const &AContext,
   auto const AEnumType = ADef->getIntegerType().getTypePtr();
   auto const BEnumType = BDef->getIntegerType().getTypePtr();
     
-  if (!matchImpl(AContext,AHistory,AEnumType,BContext,BHistory,BEnumType))
+  if (!matchImpl(AContext, AEnumType, BContext, BEnumType, State))
     return false;
   
   // Check that the enums have the same values.
@@ -323,22 +325,20 @@ static bool matchType(::clang::ASTContext const &AContext,
 }
 
 static bool matchType(::clang::ASTContext const &AContext,
-                      HistoryTy &AHistory,
                       ::clang::AutoType const *A,
                       ::clang::ASTContext const &BContext,
-                      HistoryTy &BHistory,
-                      ::clang::AutoType const *B)
+                      ::clang::AutoType const *B,
+                      MatchState &State)
 {
   llvm_unreachable("matchType: AutoType not supported.");
   return false;
 }
 
 static bool matchType(::clang::ASTContext const &AContext,
-                      HistoryTy &AHistory,
                       ::clang::DeducedTemplateSpecializationType const *A,
                       ::clang::ASTContext const &BContext,
-                      HistoryTy &BHistory,
-                      ::clang::DeducedTemplateSpecializationType const *B)
+                      ::clang::DeducedTemplateSpecializationType const *B,
+                      MatchState &State)
 {
   llvm_unreachable(
     "matchType: DeducedTemplateSpecializationType not supported.");
@@ -346,89 +346,61 @@ static bool matchType(::clang::ASTContext const &AContext,
 }
 
 static bool matchType(::clang::ASTContext const &AContext,
-                      HistoryTy &AHistory,
                       ::clang::ObjCObjectType const *A,
                       ::clang::ASTContext const &BContext,
-                      HistoryTy &BHistory,
-                      ::clang::ObjCObjectType const *B)
+                      ::clang::ObjCObjectType const *B,
+                      MatchState &State)
 {
   llvm_unreachable("matchType: ObjCObjectType not supported.");
   return false;
 }
 
 static bool matchType(::clang::ASTContext const &AContext,
-                      HistoryTy &AHistory,
                       ::clang::ObjCInterfaceType const *A,
                       ::clang::ASTContext const &BContext,
-                      HistoryTy &BHistory,
-                      ::clang::ObjCInterfaceType const *B)
+                      ::clang::ObjCInterfaceType const *B,
+                      MatchState &State)
 {
   llvm_unreachable("matchType: ObjCInterfaceType not supported.");
   return false;
 }
 
 static bool matchType(::clang::ASTContext const &AContext,
-                      HistoryTy &AHistory,
                       ::clang::ObjCObjectPointerType const *A,
                       ::clang::ASTContext const &BContext,
-                      HistoryTy &BHistory,
-                      ::clang::ObjCObjectPointerType const *B)
+                      ::clang::ObjCObjectPointerType const *B,
+                      MatchState &State)
 {
   llvm_unreachable("matchType: ObjCObjectPointerType not supported.");
   return false;
 }
 
 static bool matchType(::clang::ASTContext const &AContext,
-                      HistoryTy &AHistory,
                       ::clang::PipeType const *A,
                       ::clang::ASTContext const &BContext,
-                      HistoryTy &BHistory,
-                      ::clang::PipeType const *B)
+                      ::clang::PipeType const *B,
+                      MatchState &State)
 {
   llvm_unreachable("matchType: PipeType not supported.");
   return false;
 }
 
 static bool matchType(::clang::ASTContext const &AContext,
-                      HistoryTy &AHistory,
                       ::clang::AtomicType const *A,
                       ::clang::ASTContext const &BContext,
-                      HistoryTy &BHistory,
-                      ::clang::AtomicType const *B)
+                      ::clang::AtomicType const *B,
+                      MatchState &State)
 {
   llvm_unreachable("matchType: AtomicType not supported.");
   return false;
 }
 
-bool matchImpl(::clang::ASTContext const &AContext,
-               HistoryTy &AHistory,
-               ::clang::Type const *AType,
-               ::clang::ASTContext const &BContext,
-               HistoryTy &BHistory,
-               ::clang::Type const *BType)
+static bool matchTypeClass(::clang::ASTContext const &AContext,
+                           ::clang::Type const *ACanon,
+                           ::clang::ASTContext const &BContext,
+                           ::clang::Type const *BCanon,
+                           MatchState &State)
 {
-  // Ensure that the types are non-null.
-  if (!AType || !BType)
-    return false;
-
-  auto const ACanon = AType->getCanonicalTypeInternal().getTypePtr();
-  auto const BCanon = BType->getCanonicalTypeInternal().getTypePtr();
-
-  if (ACanon->getTypeClass() != BCanon->getTypeClass())
-    return false;
-
-  auto AHistIt = find(AHistory.begin(), AHistory.end(), AType);
-  auto BHistIt = find(BHistory.begin(), BHistory.end(), BType);
-
-  if (distance(AHistory.begin(), AHistIt)
-      != distance(BHistory.begin(), BHistIt))
-    return false;
-  else if (AHistIt != AHistory.end())
-    return true;
-
-  AHistory.push_back(AType);
-  BHistory.push_back(BType);
-
   switch (ACanon->getTypeClass()) {
 #define ABSTRACT_TYPE(CLASS, BASE)
 #define NON_CANONICAL_TYPE(CLASS, BASE) // Ignore non canonical types.
@@ -437,11 +409,10 @@ bool matchImpl(::clang::ASTContext const &AContext,
 #define TYPE(CLASS, BASE)                                                      \
     case ::clang::Type::CLASS:                                                 \
       return matchType(AContext,                                               \
-                       AHistory,                                               \
                        llvm::dyn_cast< ::clang::CLASS ## Type >(ACanon),       \
                        BContext,                                               \
-                       BHistory,                                               \
-                       llvm::dyn_cast< ::clang::CLASS ## Type >(BCanon));
+                       llvm::dyn_cast< ::clang::CLASS ## Type >(BCanon),       \
+                       State);
 #include "clang/AST/TypeNodes.def"
     default:
       break;
@@ -451,14 +422,93 @@ bool matchImpl(::clang::ASTContext const &AContext,
   return false;
 }
 
+static bool matchImpl(::clang::ASTContext const &AContext,
+                      ::clang::Type const *AType,
+                      ::clang::ASTContext const &BContext,
+                      ::clang::Type const *BType,
+                      MatchState &State)
+{
+  // Ensure that the types are non-null.
+  if (!AType || !BType)
+    return false;
+
+  auto const ACanon = AType->getCanonicalTypeInternal().getTypePtr();
+  auto const BCanon = BType->getCanonicalTypeInternal().getTypePtr();
+
+  if (ACanon->getTypeClass() != BCanon->getTypeClass())
+    return false;
+
+  auto const Key = MatchState::KeyTy(ACanon, BCanon);
+
+  // If we are already comparing these types then they are part of a
+  // recursive type. Assume that they match: if they do not, then the
+  // comparison that is in progress will find the difference.
+  if (State.InProgress.count(Key))
+    return true;
+
+  auto const Known = State.Results.find(Key);
+  if (Known != State.Results.end())
+    return Known->second;
+
+  if (State.Cache) {
+    auto const Cached = State.Cache->find(ACanon, BCanon);
+    if (Cached.assigned())
+      return Cached.get<bool>();
+  }
+
+  State.InProgress.insert(Key);
+  auto const Result = matchTypeClass(AContext, ACanon, BContext, BCanon, State);
+  State.InProgress.erase(Key);
+
+  State.Results[Key] = Result;
+
+  // A mismatch can't depend on the assumptions made for recursive types, so
+  // it is cached immediately. Matches are cached by the outermost call.
+  if (!Result && State.Cache)
+    State.Cache->add(ACanon, BCanon, false);
+
+  return Result;
+}
+
 bool matchImpl(::clang::ASTContext const &AContext,
                ::clang::Type const *AType,
                ::clang::ASTContext const &BContext,
-               ::clang::Type const *BType)
+               ::clang::Type const *BType,
+               TypeMatchCache *Cache)
 {
-  HistoryTy AHistory, BHistory;
+  MatchState State(Cache);
+
+  if (!Cache)
+    return matchImpl(AContext, AType, BContext, BType, State);
+
+  // Check for a previous match before locking the contexts.
+  if (AType && BType) {
+    auto const Cached =
+      Cache->find(AType->getCanonicalTypeInternal().getTypePtr(),
+                  BType->getCanonicalTypeInternal().getTypePtr());
+    if (Cached.assigned())
+      return Cached.get<bool>();
+  }
+
+  std::unique_lock<std::recursive_mutex>
+    LockA(Cache->getContextAccess(AContext), std::defer_lock);
+  std::unique_lock<std::recursive_mutex>
+    LockB(Cache->getContextAccess(BContext), std::defer_lock);
+
+  if (&AContext == &BContext)
+    LockA.lock();
+  else
+    std::lock(LockA, LockB);
+
+  auto const Result = matchImpl(AContext, AType, BContext, BType, State);
+
+  // If the outermost types match then so did every pair that was assumed to
+  // match while they were being compared, so all results are valid.
+  if (Result && Cache)
+    for (auto const &Entry : State.Results)
+      Cache->add(Entry.first.first, Entry.first.second, Entry.second);
 
-  return matchImpl(AContext, AHistory, AType, BContext, BHistory, BType);
+  return Result;
 }
 
 } // namespace cm
@@ -18,6 +18,7 @@
 #include "seec/ICU/Resources.hpp"
 #include "seec/Runtimes/MangleFunction.h"
 #include "seec/Trace/TraceFormat.hpp"
+#include "seec/Trace/TraceHookCounts.hpp"
 #include "seec/Trace/TraceStorage.hpp"
 #include "seec/Trace/TraceThreadMemCheck.hpp"
 #include "seec/Util/IndexTypesForLLVMObjects.hpp"
@@ -33,6 +34,7 @@
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Threading.h"
@@ -62,6 +64,10 @@ static constexpr char const *getTraceSizeLimitEnvVar() {
   return "SEEC_TRACE_LIMIT";
 }
 
+static constexpr char const *getHookCountsEnvVar() {
+  return "SEEC_HOOK_COUNTS";
+}
+
 
 //------------------------------------------------------------------------------
 // ThreadEnvironment
@@ -352,10 +358,45 @@ ProcessEnvironment::ProcessEnvironment()
 #undef SEEC__STR
 }
 
+/// \brief Write the notification counts of all threads to the file named by
+///        SEEC_HOOK_COUNTS, if it is set.
+///
+/// Each line of the file holds a name and a count, separated by a space.
+///
+/// NOTE: This function uses std::getenv() and thus is not thread-safe.
+///
+static void writeHookCounts(TraceProcessListener const &Listener,
+                            OutputStreamAllocator const &Allocator)
+{
+  auto const Path = std::getenv(getHookCountsEnvVar());
+  if (!Path)
+    return;
+
+  std::error_code EC;
+  llvm::raw_fd_ostream Out(Path, EC, llvm::sys::fs::OpenFlags::F_Text);
+  if (EC) {
+    llvm::errs() << "\nSeeC: Failed to write hook counts to '" << Path
+                 << "': " << EC.message() << "\n";
+    return;
+  }
+
+  auto const Counts = Listener.getHookCounts();
+
+  Out << "events " << Counts.getEvents() << "\n";
+  Out << "trace-bytes " << Allocator.getTotalSize() << "\n";
+
+  for (std::size_t i = 0; i < TraceHookCounts::NumHooks; ++i) {
+    auto const Hook = static_cast<TraceHook>(i);
+    Out << "hook-" << getTraceHookName(Hook) << " " << Counts.get(Hook)
+        << "\n";
+  }
+}
+
 ProcessEnvironment::~ProcessEnvironment()
 {
   // Finalize the trace.
   ThreadLookup.clear();
+  writeHookCounts(*ProcessTracer, *StreamAllocator);
   ProcessTracer.reset();
 }
 
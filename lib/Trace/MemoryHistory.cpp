@@ -0,0 +1,656 @@
+//===- lib/Trace/MemoryHistory.cpp ----------------------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#include "seec/Trace/MemoryHistory.hpp"
+#include "seec/Trace/TraceSearch.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace seec {
+
+namespace trace {
+
+
+namespace {
+
+/// Number of indexed events between each entry in a thread's time index.
+constexpr std::size_t TimeIndexInterval = 1024;
+
+/// Maximum number of intervals used to summarize the areas touched by the
+/// events of each entry in a thread's time index.
+constexpr std::size_t MaxTouchedAreas = 8;
+
+/// \brief The kinds of change that can determine the state of a \c char.
+///
+enum class ChangeKind : uint8_t {
+  None,  ///< No change found.
+  Value, ///< Set to a recorded value.
+  Clear, ///< Set to be uninitialized.
+  Copy   ///< Copied from elsewhere in memory.
+};
+
+/// \brief The most recent change found for a single \c char.
+///
+struct CharChange {
+  /// Orders changes. An event at process time T has key 2T, and the creation
+  /// of a thread-local allocation that follows that event in its thread has
+  /// key 2T+1.
+  uint64_t Key;
+
+  /// The kind of change.
+  ChangeKind Kind;
+
+  /// The StateMemmove that copied this \c char (for ChangeKind::Copy).
+  EventRecord<EventType::StateMemmove> const *Copy;
+
+  CharChange()
+  : Key(0),
+    Kind(ChangeKind::None),
+    Copy(nullptr)
+  {}
+};
+
+/// \brief Accumulates the most recent changes to each \c char in an area.
+///
+class AreaChanges {
+  MemoryArea const Area;
+
+  llvm::MutableArrayRef<char> Data;
+
+  llvm::MutableArrayRef<unsigned char> Init;
+
+  std::vector<CharChange> Changes;
+
+  /// The number of \c chars with no change found.
+  std::size_t Unchanged;
+
+  /// The lowest key of any \c char's change (if valid).
+  uint64_t MinKey;
+
+  /// Indicates whether \c MinKey is valid.
+  bool MinKeyValid;
+
+  /// \brief Apply a change to the \c chars in the intersection of \c Area
+  ///        and \c With, if it is more recent than their current change.
+  /// \tparam FnT type of the callback.
+  /// \param Fn called with the offset of each \c char that was changed.
+  ///
+  template<typename FnT>
+  void apply(MemoryArea const &With,
+             uint64_t const Key,
+             ChangeKind const Kind,
+             FnT Fn)
+  {
+    if (!Area.intersects(With))
+      return;
+
+    auto const Overlap = Area.intersection(With);
+    auto const Begin = Overlap.start() - Area.start();
+    auto const End = Begin + Overlap.length();
+
+    for (auto Offset = Begin; Offset < End; ++Offset) {
+      auto &Change = Changes[Offset];
+      if (Change.Kind != ChangeKind::None && Change.Key >= Key)
+        continue;
+
+      if (Change.Kind == ChangeKind::None)
+        --Unchanged;
+
+      Change.Key = Key;
+      Change.Kind = Kind;
+      Change.Copy = nullptr;
+      Fn(Offset, Change);
+    }
+
+    MinKeyValid = false;
+  }
+
+public:
+  AreaChanges(MemoryArea const &ForArea,
+              llvm::MutableArrayRef<char> WithData,
+              llvm::MutableArrayRef<unsigned char> WithInit)
+  : Area(ForArea),
+    Data(WithData),
+    Init(WithInit),
+    Changes(ForArea.length()),
+    Unchanged(ForArea.length()),
+    MinKey(0),
+    MinKeyValid(false)
+  {}
+
+  MemoryArea const &getArea() const { return Area; }
+
+  std::vector<CharChange> const &getChanges() const { return Changes; }
+
+  /// \brief Check if no change with the given key (or lower) could affect
+  ///        the state of this area.
+  ///
+  bool isComplete(uint64_t const Key) {
+    if (Unchanged)
+      return false;
+
+    if (!MinKeyValid) {
+      MinKey = std::numeric_limits<uint64_t>::max();
+      for (auto const &Change : Changes)
+        MinKey = std::min(MinKey, Change.Key);
+      MinKeyValid = true;
+    }
+
+    return Key < MinKey;
+  }
+
+  void setValue(stateptr_ty const Address,
+                llvm::ArrayRef<char> Value,
+                uint64_t const Key)
+  {
+    auto const Complete = std::numeric_limits<unsigned char>::max();
+
+    apply(MemoryArea(Address, Value.size()), Key, ChangeKind::Value,
+          [&] (std::size_t const Offset, CharChange &) {
+            Data[Offset] = Value[(Area.start() + Offset) - Address];
+            Init[Offset] = Complete;
+          });
+  }
+
+  void setClear(MemoryArea const &With, uint64_t const Key)
+  {
+    apply(With, Key, ChangeKind::Clear,
+          [&] (std::size_t const Offset, CharChange &) {
+            Data[Offset] = 0;
+            Init[Offset] = 0;
+          });
+  }
+
+  void setCopy(EventRecord<EventType::StateMemmove> const &Ev,
+               uint64_t const Key)
+  {
+    apply(MemoryArea(Ev.getDestinationAddress(), Ev.getSize()),
+          Key, ChangeKind::Copy,
+          [&] (std::size_t const, CharChange &Change) {
+            Change.Copy = &Ev;
+          });
+  }
+};
+
+/// \brief Find the address of the allocation created by a Malloc or Alloca
+///        event, which is held by the preceding InstructionWithPtr event.
+///
+stateptr_ty getAllocationAddress(ThreadTrace const &Thread,
+                                 EventReference const &Ev)
+{
+  auto const MaybeInstrRef = rfind<EventType::InstructionWithPtr>
+                                  (rangeBefore(Thread.events(), Ev));
+
+  assert(MaybeInstrRef.assigned() && "Malformed event trace");
+
+  auto const &InstrRef = MaybeInstrRef.get<0>();
+  return InstrRef.get<EventType::InstructionWithPtr>().getValue();
+}
+
+/// \brief Get the area changed or created by an event, if any.
+/// \param LastPtr the value of the most recent InstructionWithPtr event,
+///        which holds the address of Malloc and Alloca allocations.
+///
+MemoryArea getTouchedArea(EventReference const &Ev,
+                          stateptr_ty const LastPtr)
+{
+  switch (Ev->getType()) {
+    case EventType::Alloca:
+    {
+      auto const &Record = Ev.get<EventType::Alloca>();
+      return MemoryArea(LastPtr,
+                        Record.getElementSize() * Record.getElementCount());
+    }
+    case EventType::ByValRegionAdd:
+    {
+      auto const &Record = Ev.get<EventType::ByValRegionAdd>();
+      return MemoryArea(Record.getAddress(), Record.getSize());
+    }
+    case EventType::KnownRegionAdd:
+    {
+      auto const &Record = Ev.get<EventType::KnownRegionAdd>();
+      return MemoryArea(Record.getAddress(), Record.getSize());
+    }
+    case EventType::Malloc:
+      return MemoryArea(LastPtr, Ev.get<EventType::Malloc>().getSize());
+    case EventType::Realloc:
+    {
+      auto const &Record = Ev.get<EventType::Realloc>();
+      return MemoryArea(Record.getAddress(),
+                        std::max(Record.getOldSize(), Record.getNewSize()));
+    }
+    case EventType::StateUntypedSmall:
+    {
+      auto const &Record = Ev.get<EventType::StateUntypedSmall>();
+      return MemoryArea(Record.getAddress(), Record.getSize());
+    }
+    case EventType::StateUntyped:
+    {
+      auto const &Record = Ev.get<EventType::StateUntyped>();
+      return MemoryArea(Record.getAddress(), Record.getDataSize());
+    }
+    case EventType::StateMemmove:
+    {
+      auto const &Record = Ev.get<EventType::StateMemmove>();
+      return MemoryArea(Record.getDestinationAddress(), Record.getSize());
+    }
+    case EventType::StateClear:
+    {
+      auto const &Record = Ev.get<EventType::StateClear>();
+      return MemoryArea(Record.getAddress(), Record.getClearSize());
+    }
+    default:
+      return MemoryArea();
+  }
+}
+
+/// \brief Find the most recent changes to an area by a single thread.
+/// \param Thread the thread to search.
+/// \param Index the thread's time index.
+/// \param StartEntry the search starts from this entry's event (or from the
+///        end of the thread, if this is \c Index.size()). All events prior
+///        to the process time must precede this position.
+/// \param ProcessTime only changes prior to this process time are found.
+/// \param Changes accumulates the changes that are found.
+///
+void findChangesInThread(ProcessTrace const &Trace,
+                         ThreadTrace const &Thread,
+                         llvm::ArrayRef<MemoryHistoryRebuilder::TimeIndexEntry>
+                           Index,
+                         std::size_t const StartEntry,
+                         uint64_t const ProcessTime,
+                         AreaChanges &Changes)
+{
+  auto const Begin = Thread.events().begin();
+  auto It = StartEntry < Index.size() ? Index[StartEntry].Event
+                                      : Thread.events().end();
+
+  // Thread-local allocations that were created since the most recent event
+  // with a process time (in this search's reverse order, the next event).
+  // Only allocations that intersect the area are held.
+  std::vector<MemoryArea> Created;
+
+  auto const applyCreated = [&] (uint64_t const Time) {
+    for (auto const &Area : Created)
+      Changes.setClear(Area, (2 * Time) + 1);
+    Created.clear();
+  };
+
+  // Search the events of each entry in reverse order, and then the events
+  // preceding the first entry. Entries whose events cannot have changed the
+  // area are skipped, unless an allocation is waiting to be applied, as that
+  // requires the time of the next event.
+  for (auto Entry = StartEntry; ; --Entry) {
+    auto const EntryBegin = Entry ? Index[Entry - 1].Event : Begin;
+
+    if (Entry
+        && Created.empty()
+        && !Index[Entry - 1].mayTouch(Changes.getArea()))
+    {
+      It = EntryBegin;
+    }
+
+    while (It != EntryBegin) {
+      --It;
+
+      switch (It->getType()) {
+        case EventType::Alloca:
+        {
+          auto const &Ev = It.get<EventType::Alloca>();
+          auto const Area = MemoryArea(getAllocationAddress(Thread, It),
+                                       Ev.getElementSize()
+                                       * Ev.getElementCount());
+          if (Area.intersects(Changes.getArea()))
+            Created.emplace_back(Area);
+          continue;
+        }
+
+        case EventType::ByValRegionAdd:
+        {
+          auto const &Ev = It.get<EventType::ByValRegionAdd>();
+          auto const Area = MemoryArea(Ev.getAddress(), Ev.getSize());
+          if (Area.intersects(Changes.getArea()))
+            Created.emplace_back(Area);
+          continue;
+        }
+
+        case EventType::KnownRegionAdd:
+        {
+          auto const &Ev = It.get<EventType::KnownRegionAdd>();
+          auto const Area = MemoryArea(Ev.getAddress(), Ev.getSize());
+          if (Area.intersects(Changes.getArea()))
+            Created.emplace_back(Area);
+          continue;
+        }
+
+        default:
+          break;
+      }
+
+      auto const MaybeTime = It->getProcessTime();
+      if (!MaybeTime.hasValue())
+        continue;
+
+      auto const Time = MaybeTime.getValue();
+
+      // Allocations created after an event at or beyond the process time
+      // must also have been created after the process time.
+      if (Time >= ProcessTime) {
+        Created.clear();
+        continue;
+      }
+
+      // Neither this event, nor any that precede it, can change the area.
+      if (Changes.isComplete((2 * Time) + 1))
+        return;
+
+      applyCreated(Time);
+
+      auto const Key = 2 * Time;
+
+      switch (It->getType()) {
+        case EventType::Malloc:
+        {
+          auto const &Ev = It.get<EventType::Malloc>();
+          Changes.setClear(MemoryArea(getAllocationAddress(Thread, It),
+                                      Ev.getSize()),
+                           Key);
+          break;
+        }
+
+        case EventType::Realloc:
+        {
+          auto const &Ev = It.get<EventType::Realloc>();
+          auto const Lower = std::min(Ev.getOldSize(), Ev.getNewSize());
+          auto const Upper = std::max(Ev.getOldSize(), Ev.getNewSize());
+          Changes.setClear(MemoryArea(Ev.getAddress() + Lower,
+                                      Upper - Lower),
+                           Key);
+          break;
+        }
+
+        case EventType::StateUntypedSmall:
+        {
+          auto const &Ev = It.get<EventType::StateUntypedSmall>();
+          auto const DataPtr = reinterpret_cast<char const *>
+                                               (&(Ev.getData()));
+          Changes.setValue(Ev.getAddress(),
+                           llvm::ArrayRef<char>(DataPtr, Ev.getSize()),
+                           Key);
+          break;
+        }
+
+        case EventType::StateUntyped:
+        {
+          auto const &Ev = It.get<EventType::StateUntyped>();
+          Changes.setValue(Ev.getAddress(),
+                           Trace.getData(Ev.getDataOffset(),
+                                         Ev.getDataSize()),
+                           Key);
+          break;
+        }
+
+        case EventType::StateMemmove:
+          Changes.setCopy(It.get<EventType::StateMemmove>(), Key);
+          break;
+
+        case EventType::StateClear:
+        {
+          auto const &Ev = It.get<EventType::StateClear>();
+          Changes.setClear(MemoryArea(Ev.getAddress(), Ev.getClearSize()),
+                           Key);
+          break;
+        }
+
+        default:
+          break;
+      }
+    }
+
+    if (!Entry)
+      break;
+  }
+
+  // Allocations created before the thread's first event with a process time.
+  applyCreated(0);
+}
+
+} // anonymous namespace
+
+
+//------------------------------------------------------------------------------
+// MemoryHistoryRebuilder
+//------------------------------------------------------------------------------
+
+MemoryHistoryRebuilder::MemoryHistoryRebuilder(ProcessTrace const &ForTrace,
+                                               MemoryState WithInitialMemory)
+: Trace(ForTrace),
+  InitialMemory(std::move(WithInitialMemory)),
+  TimeIndex(ForTrace.getNumThreads()),
+  TimeIndexCreated(ForTrace.getNumThreads(), false)
+{}
+
+void
+MemoryHistoryRebuilder::TimeIndexEntry::addTouched(stateptr_ty const Address,
+                                                   std::size_t const Length)
+{
+  if (!Length)
+    return;
+
+  auto const Area = Interval<stateptr_ty>::withStartLength(Address, Length);
+
+  // Merge the new area with any that it overlaps or adjoins.
+  auto It = std::lower_bound(Touched.begin(), Touched.end(), Area,
+              [] (Interval<stateptr_ty> const &A,
+                  Interval<stateptr_ty> const &B) {
+                return A.end() < B.start();
+              });
+
+  auto Start = Area.start();
+  auto End = Area.end();
+
+  auto MergeEnd = It;
+  while (MergeEnd != Touched.end() && MergeEnd->start() <= End) {
+    Start = std::min(Start, MergeEnd->start());
+    End = std::max(End, MergeEnd->end());
+    ++MergeEnd;
+  }
+
+  It = Touched.erase(It, MergeEnd);
+  Touched.insert(It, Interval<stateptr_ty>::withStartEnd(Start, End));
+
+  if (Touched.size() <= MaxTouchedAreas)
+    return;
+
+  // Too many areas: join the two that are closest together.
+  std::size_t Closest = 0;
+  for (std::size_t i = 1; i + 1 < Touched.size(); ++i)
+    if (Touched[i + 1].start() - Touched[i].end()
+        < Touched[Closest + 1].start() - Touched[Closest].end())
+      Closest = i;
+
+  Touched[Closest] = Interval<stateptr_ty>::withStartEnd
+                       (Touched[Closest].start(), Touched[Closest + 1].end());
+  Touched.erase(Touched.begin() + Closest + 1);
+}
+
+bool
+MemoryHistoryRebuilder::TimeIndexEntry::mayTouch(MemoryArea const &Area) const
+{
+  auto const It = std::lower_bound(Touched.begin(), Touched.end(),
+                                   Area.start(),
+                    [] (Interval<stateptr_ty> const &Existing,
+                        stateptr_ty const Address) {
+                      return Existing.end() <= Address;
+                    });
+
+  return It != Touched.end() && It->start() < Area.end();
+}
+
+std::vector<MemoryHistoryRebuilder::TimeIndexEntry> const &
+MemoryHistoryRebuilder::getTimeIndex(ThreadTrace const &Thread)
+{
+  auto const Position = Thread.getThreadID() - 1;
+  auto &Index = TimeIndex[Position];
+
+  if (TimeIndexCreated[Position])
+    return Index;
+
+  auto const Indexed = makeEventTypeSet<EventType::NewProcessTime,
+                                        EventType::Malloc,
+                                        EventType::Free,
+                                        EventType::Realloc,
+                                        EventType::StateUntypedSmall,
+                                        EventType::StateUntyped,
+                                        EventType::StateMemmove,
+                                        EventType::StateClear>();
+
+  std::size_t Count = 0;
+  stateptr_ty LastPtr = 0;
+
+  for (auto It = Thread.events().begin(), End = Thread.events().end();
+       It != End;
+       ++It)
+  {
+    if (It->getType() == EventType::InstructionWithPtr) {
+      LastPtr = It.get<EventType::InstructionWithPtr>().getValue();
+      continue;
+    }
+
+    if (Indexed.contains(It->getType()) && Count++ % TimeIndexInterval == 0)
+      Index.emplace_back(It->getProcessTime().getValue(), It);
+
+    // Events preceding the first entry are always searched.
+    if (Index.empty())
+      continue;
+
+    auto const Area = getTouchedArea(It, LastPtr);
+    Index.back().addTouched(Area.start(), Area.length());
+  }
+
+  TimeIndexCreated[Position] = true;
+  return Index;
+}
+
+void MemoryHistoryRebuilder::getAreaBefore(MemoryArea const &Area,
+                                           uint64_t const ProcessTime,
+                                           llvm::MutableArrayRef<char> Data,
+                                           llvm::MutableArrayRef<unsigned char>
+                                            Init)
+{
+  assert(Data.size() == Area.length() && Init.size() == Area.length());
+
+  /// An area waiting to be rebuilt into part of \c Data and \c Init.
+  struct PendingArea {
+    MemoryArea Area;
+    uint64_t ProcessTime;
+    llvm::MutableArrayRef<char> Data;
+    llvm::MutableArrayRef<unsigned char> Init;
+  };
+
+  // Each copy adds its source to this list, rather than being rebuilt
+  // recursively, because programs can build long chains of copies.
+  std::vector<PendingArea> Pending;
+  Pending.push_back(PendingArea{Area, ProcessTime, Data, Init});
+
+  while (!Pending.empty()) {
+    auto const Current = Pending.back();
+    Pending.pop_back();
+
+    AreaChanges Changes(Current.Area, Current.Data, Current.Init);
+
+    for (uint32_t ThreadID = 1; ThreadID <= Trace.getNumThreads(); ++ThreadID)
+    {
+      auto const &Thread = Trace.getThreadTrace(ThreadID);
+      auto const &Index = getTimeIndex(Thread);
+
+      // Start from the first entry at or after the process time.
+      auto const StartIt =
+        std::lower_bound(Index.begin(), Index.end(), Current.ProcessTime,
+          [] (TimeIndexEntry const &Entry, uint64_t const Time) {
+            return Entry.ProcessTime < Time;
+          });
+
+      findChangesInThread(Trace,
+                          Thread,
+                          Index,
+                          std::distance(Index.begin(), StartIt),
+                          Current.ProcessTime,
+                          Changes);
+    }
+
+    auto const &CharChanges = Changes.getChanges();
+    auto const Length = CharChanges.size();
+    auto const AreaStart = Current.Area.start();
+
+    for (std::size_t Offset = 0; Offset < Length; ) {
+      auto const &Change = CharChanges[Offset];
+
+      // Find the run of chars that share this change.
+      auto End = Offset + 1;
+      while (End < Length
+             && CharChanges[End].Kind == Change.Kind
+             && CharChanges[End].Copy == Change.Copy)
+        ++End;
+
+      auto const RunAddress = AreaStart + Offset;
+      auto const RunLength = End - Offset;
+
+      if (Change.Kind == ChangeKind::Copy) {
+        // Rebuild the source of the copy, as it was when the copy occurred.
+        auto const &Ev = *Change.Copy;
+        auto const Source = Ev.getSourceAddress()
+                            + (RunAddress - Ev.getDestinationAddress());
+
+        Pending.push_back(PendingArea{MemoryArea(Source, RunLength),
+                                      Ev.getProcessTime(),
+                                      Current.Data.slice(Offset, RunLength),
+                                      Current.Init.slice(Offset, RunLength)});
+      }
+      else if (Change.Kind == ChangeKind::None) {
+        // Unchanged chars have their initial state, which is uninitialized
+        // for anything other than global variables.
+        for (auto Address = RunAddress; Address < RunAddress + RunLength; ) {
+          auto const Alloc = InitialMemory.findAllocation(Address);
+          if (!Alloc) {
+            Current.Data[Address - AreaStart] = 0;
+            Current.Init[Address - AreaStart] = 0;
+            ++Address;
+            continue;
+          }
+
+          auto const AllocEnd = Alloc->getAddress() + Alloc->getSize();
+          auto const PartEnd = std::min(AllocEnd, RunAddress + RunLength);
+          auto const Part = MemoryArea(Address, PartEnd - Address);
+          auto const PartData = Alloc->getAreaData(Part);
+          auto const PartInit = Alloc->getAreaInitialization(Part);
+
+          std::copy(PartData.begin(), PartData.end(),
+                    Current.Data.begin() + (Address - AreaStart));
+          std::copy(PartInit.begin(), PartInit.end(),
+                    Current.Init.begin() + (Address - AreaStart));
+
+          Address = Part.end();
+        }
+      }
+
+      Offset = End;
+    }
+  }
+}
+
+
+} // namespace trace (in seec)
+
+} // namespace seec
@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "seec/Trace/MemoryState.hpp"
+#include "seec/Util/Fallthrough.hpp"
 #include "seec/Util/Printing.hpp"
 #include "seec/Util/Range.hpp"
 
@@ -29,13 +30,31 @@ static constexpr bool debugPrintStateChanges() { return false; }
 // MemoryAllocation Mutators
 //------------------------------------------------------------------------------
 
+MemoryAllocation::Contents &MemoryAllocation::modifyContents()
+{
+  if (Current.use_count() != 1)
+    Current = std::make_shared<Contents>(*Current);
+
+  return *Current;
+}
+
+MemoryAllocation::History &MemoryAllocation::modifyHistory()
+{
+  if (!Previous)
+    Previous = std::make_shared<History>();
+  else if (Previous.use_count() != 1)
+    Previous = std::make_shared<History>(*Previous);
+
+  return *Previous;
+}
+
 llvm::ArrayRef<char>
 MemoryAllocation::getAreaData(MemoryArea const &Area) const
 {
   assert(MemoryArea(Address, Size).contains(Area));
 
   auto const Offset = Area.address() - Address;
-  return llvm::ArrayRef<char>(Data.data() + Offset, Area.length());
+  return llvm::ArrayRef<char>(Current->Data.data() + Offset, Area.length());
 }
 
 llvm::ArrayRef<unsigned char>
@@ -44,12 +63,14 @@ MemoryAllocation::getAreaInitialization(MemoryArea const &Area) const
   assert(MemoryArea(Address, Size).contains(Area));
 
   auto const Offset = Area.address() - Address;
-  return llvm::ArrayRef<unsigned char>(Init.data() + Offset, Area.length());
+  return llvm::ArrayRef<unsigned char>(Current->Init.data() + Offset,
+                                       Area.length());
 }
 
 bool MemoryAllocation::isCompletelyInitialized() const
 {
   auto const Complete = std::numeric_limits<unsigned char>::max();
+  auto const &Init = Current->Init;
   if (Init.empty())
     return false;
 
@@ -59,6 +80,7 @@ bool MemoryAllocation::isCompletelyInitialized() const
 
 bool MemoryAllocation::isPartiallyInitialized() const
 {
+  auto const &Init = Current->Init;
   if (Init.empty())
     return false;
 
@@ -68,6 +90,7 @@ bool MemoryAllocation::isPartiallyInitialized() const
 
 bool MemoryAllocation::isUninitialized() const
 {
+  auto const &Init = Current->Init;
   return std::all_of(Init.cbegin(), Init.cend(),
                      [] (unsigned char const C) { return C == 0; });
 }
@@ -82,11 +105,12 @@ void MemoryAllocation::addBlock(MappedMemoryBlock const &Block)
 
   clearArea(Block.area());
 
+  auto &C = modifyContents();
   auto const Offset = Block.address() - Address;
 
-  std::memcpy(Data.data() + Offset, Block.data(), Block.length());
+  std::memcpy(C.Data.data() + Offset, Block.data(), Block.length());
 
-  std::memset(Init.data() + Offset,
+  std::memset(C.Init.data() + Offset,
               std::numeric_limits<unsigned char>::max(),
               Block.length());
 }
@@ -105,13 +129,14 @@ void MemoryAllocation::addArea(stateptr_ty const AtAddress,
 
   clearArea(MemoryArea(AtAddress, WithData.size()));
 
+  auto &C = modifyContents();
   auto const Offset = AtAddress - Address;
 
-  std::memcpy(Data.data() + Offset,
+  std::memcpy(C.Data.data() + Offset,
               WithData.data(),
               WithData.size());
 
-  std::memcpy(Init.data() + Offset,
+  std::memcpy(C.Init.data() + Offset,
               WithInitialization.data(),
               WithInitialization.size());
 }
@@ -132,7 +157,7 @@ void MemoryAllocation::clearArea(MemoryArea const &Area)
   auto const Offset = Area.address() - Address;
   auto const Length = Area.length();
 
-  auto const InitBegin = Init.begin() + Offset;
+  auto const InitBegin = Current->Init.cbegin() + Offset;
   auto const InitEnd   = InitBegin + Length;
 
   // Determine this area's initialization.
@@ -149,24 +174,29 @@ void MemoryAllocation::clearArea(MemoryArea const &Area)
     Type = EPreviousAreaType::Complete;
   }
 
-  PreviousType.push_back(Type);
+  auto &H = modifyHistory();
+
+  H.PreviousType.push_back(Type);
+  H.PreviousLength.push_back(Length);
 
   // This is the only case in which we need to save the initialization.
   if (Type == EPreviousAreaType::Partial)
-    PreviousInit.insert(PreviousInit.end(), InitBegin, InitEnd);
+    H.PreviousInit.insert(H.PreviousInit.end(), InitBegin, InitEnd);
 
   // This is the only case in which we need to save the data. This is also the
   // only case in which "clearing" the area requires us to do anything (set the
   // initialization of the bytes to zero).
   if (Type != EPreviousAreaType::Uninitialized) {
-    PreviousData.insert(PreviousData.end(),
-                        Data.begin() + Offset,
-                        Data.begin() + Offset + Length);
-    std::fill(InitBegin, InitEnd, 0);
+    H.PreviousData.insert(H.PreviousData.end(),
+                          Current->Data.cbegin() + Offset,
+                          Current->Data.cbegin() + Offset + Length);
+
+    auto &C = modifyContents();
+    std::fill_n(C.Init.begin() + Offset, Length, 0);
   }
 }
 
-void MemoryAllocation::rewindArea(MemoryArea const &Area)
+bool MemoryAllocation::rewindArea(MemoryArea const &Area)
 {
   if (debugPrintStateChanges()) {
     llvm::errs() << "@" << Address
@@ -182,11 +212,24 @@ void MemoryAllocation::rewindArea(MemoryArea const &Area)
   auto const Offset = Area.address() - Address;
   auto const Length = Area.length();
 
-  auto const InitBegin = Init.begin() + Offset;
+  auto &H = modifyHistory();
+
+  // If the saved state was discarded then the caller must restore the area.
+  if (H.PreviousType.empty()) {
+    assert(H.Discarded && "No saved state for area!");
+    --H.Discarded;
+    return false;
+  }
+
+  auto &C = modifyContents();
 
-  assert(!PreviousType.empty());
-  auto const Type = PreviousType.back();
-  PreviousType.pop_back();
+  auto const InitBegin = C.Init.begin() + Offset;
+
+  auto const Type = H.PreviousType.back();
+  H.PreviousType.pop_back();
+
+  assert(H.PreviousLength.back() == Length);
+  H.PreviousLength.pop_back();
 
   if (debugPrintStateChanges()) {
     switch (Type) {
@@ -205,10 +248,10 @@ void MemoryAllocation::rewindArea(MemoryArea const &Area)
 
   // Restore initialization of area.
   if (Type == EPreviousAreaType::Partial) {
-    assert(PreviousInit.size() >= Length);
-    auto const PrevInitIt = PreviousInit.end() - Length;
-    std::copy(PrevInitIt, PreviousInit.end(), InitBegin);
-    PreviousInit.erase(PrevInitIt, PreviousInit.end());
+    assert(H.PreviousInit.size() >= Length);
+    auto const PrevInitIt = H.PreviousInit.end() - Length;
+    std::copy(PrevInitIt, H.PreviousInit.end(), InitBegin);
+    H.PreviousInit.erase(PrevInitIt, H.PreviousInit.end());
   }
 
   // Set area as completely initialized.
@@ -217,11 +260,110 @@ void MemoryAllocation::rewindArea(MemoryArea const &Area)
 
   // Restore data of area.
   if (Type != EPreviousAreaType::Uninitialized) {
-    assert(PreviousData.size() >= Length);
-    auto const PrevDataIt = PreviousData.end() - Length;
-    std::copy(PrevDataIt, PreviousData.end(), Data.begin() + Offset);
-    PreviousData.erase(PrevDataIt, PreviousData.end());
+    assert(H.PreviousData.size() >= Length);
+    auto const PrevDataIt = H.PreviousData.end() - Length;
+    std::copy(PrevDataIt, H.PreviousData.end(), C.Data.begin() + Offset);
+    H.PreviousData.erase(PrevDataIt, H.PreviousData.end());
+  }
+
+  return true;
+}
+
+void
+MemoryAllocation::restoreArea(stateptr_ty const AtAddress,
+                               llvm::ArrayRef<char> WithData,
+                               llvm::ArrayRef<unsigned char> WithInitialization)
+{
+  if (debugPrintStateChanges()) {
+    llvm::errs() << "@" << Address
+                 << " : restoreArea @" << AtAddress
+                 << " (" << WithData.size() << ")\n";
   }
+
+  assert(MemoryArea(Address, Size).contains(MemoryArea(AtAddress,
+                                                       WithData.size())));
+  assert(WithData.size() == WithInitialization.size());
+
+  auto &C = modifyContents();
+  auto const Offset = AtAddress - Address;
+
+  std::copy(WithData.begin(), WithData.end(), C.Data.begin() + Offset);
+  std::copy(WithInitialization.begin(), WithInitialization.end(),
+            C.Init.begin() + Offset);
+}
+
+void MemoryAllocation::discardHistory(std::size_t const Limit)
+{
+  if (!Previous || Previous->getSavedSize() <= Limit)
+    return;
+
+  auto &H = modifyHistory();
+
+  // Find the oldest areas that must be discarded to leave half of the limit.
+  auto const Target = Limit / 2;
+  auto SavedSize = H.getSavedSize();
+
+  std::size_t Count = 0;
+  std::size_t DataCount = 0;
+  std::size_t InitCount = 0;
+
+  while (SavedSize > Target && Count < H.PreviousType.size()) {
+    auto const Length = H.PreviousLength[Count];
+
+    switch (H.PreviousType[Count]) {
+      case EPreviousAreaType::Uninitialized:
+        break;
+      case EPreviousAreaType::Partial:
+        InitCount += Length;
+        SavedSize -= Length;
+        SEEC_FALLTHROUGH;
+      case EPreviousAreaType::Complete:
+        DataCount += Length;
+        SavedSize -= Length;
+        break;
+    }
+
+    ++Count;
+  }
+
+  if (debugPrintStateChanges()) {
+    llvm::errs() << "@" << Address
+                 << " : discardHistory (" << Count << " areas)\n";
+  }
+
+  H.PreviousType.erase(H.PreviousType.begin(),
+                       H.PreviousType.begin() + Count);
+  H.PreviousLength.erase(H.PreviousLength.begin(),
+                         H.PreviousLength.begin() + Count);
+  H.PreviousData.erase(H.PreviousData.begin(),
+                       H.PreviousData.begin() + DataCount);
+  H.PreviousInit.erase(H.PreviousInit.begin(),
+                       H.PreviousInit.begin() + InitCount);
+  H.Discarded += Count;
+}
+
+void MemoryAllocation::discardContents()
+{
+  if (debugPrintStateChanges())
+    llvm::errs() << "@" << Address << " : discardContents\n";
+
+  Current.reset();
+  Previous.reset();
+}
+
+void MemoryAllocation::resetDiscardedContents()
+{
+  assert(hasDiscardedContents());
+
+  Current = std::make_shared<Contents>(Size);
+  Previous = std::make_shared<History>();
+  Previous->Discarded = std::numeric_limits<std::size_t>::max();
+}
+
+std::size_t MemoryAllocation::getRetainedSize() const
+{
+  return (Current ? Current->Data.size() + Current->Init.size() : 0)
+         + (Previous ? Previous->getSavedSize() : 0);
 }
 
 void MemoryAllocation::resize(std::size_t const NewSize)
@@ -231,8 +373,9 @@ void MemoryAllocation::resize(std::size_t const NewSize)
                  << " : resize from " << Size << " to " << NewSize << "\n";
   }
 
-  Data.resize(NewSize);
-  Init.resize(NewSize);
+  auto &C = modifyContents();
+  C.Data.resize(NewSize);
+  C.Init.resize(NewSize);
   Size = NewSize;
 }
 
@@ -298,56 +441,126 @@ llvm::ArrayRef<char> MemoryStateRegion::getByteValues() const
 // MemoryState
 //------------------------------------------------------------------------------
 
-MemoryAllocation &MemoryState::getAllocation(MemoryArea const &ForArea)
+std::size_t MemoryState::findPreceding(stateptr_ty const Address) const
 {
-  assert(!Allocations.empty() && "No allocations available!");
+  auto const It = std::upper_bound(AllocationStarts.begin(),
+                                   AllocationStarts.end(),
+                                   Address);
+  if (It == AllocationStarts.begin())
+    return Allocations.size();
 
-  auto It = Allocations.upper_bound(ForArea.start());
-  assert(It != Allocations.begin() && "Allocation not found!");
+  return std::distance(AllocationStarts.begin(), It) - 1;
+}
+
+std::size_t MemoryState::findContaining(MemoryArea const &Area) const
+{
+  auto const Index = findPreceding(Area.start());
+  if (Index == Allocations.size())
+    return Index;
 
-  --It;
-  auto const AllocStart = It->second.getAddress();
-  auto const AllocSize  = It->second.getSize();
-  assert(MemoryArea(AllocStart, AllocSize).contains(ForArea)
-          && "Allocation does not contain block!");
+  auto const &Alloc = Allocations[Index];
+  if (!MemoryArea(Alloc.getAddress(), Alloc.getSize()).contains(Area))
+    return Allocations.size();
 
-  return It->second;
+  return Index;
 }
 
-MemoryAllocation const &
-MemoryState::getAllocation(MemoryArea const &ForArea) const
+MemoryAllocation &MemoryState::getAllocation(MemoryArea const &ForArea)
 {
-  assert(!Allocations.empty() && "No allocations available!");
+  auto const Index = findContaining(ForArea);
+  assert(Index != Allocations.size() && "Allocation not found!");
 
-  auto It = Allocations.upper_bound(ForArea.start());
-  assert(It != Allocations.begin() && "Allocation not found!");
+  return Allocations[Index];
+}
 
-  --It;
-  auto const AllocStart = It->second.getAddress();
-  auto const AllocSize  = It->second.getSize();
-  assert(MemoryArea(AllocStart, AllocSize).contains(ForArea)
-          && "Allocation does not contain block!");
+MemoryAllocation const &
+MemoryState::getAllocation(MemoryArea const &ForArea) const
+{
+  auto const Index = findContaining(ForArea);
+  assert(Index != Allocations.size() && "Allocation not found!");
 
-  return It->second;
+  return Allocations[Index];
 }
 
 MemoryAllocation const *
 MemoryState::findAllocation(stateptr_ty const ForAddress) const
 {
-  if (Allocations.empty())
+  auto const Index = findPreceding(ForAddress);
+  if (Index == Allocations.size())
     return nullptr;
 
-  auto It = Allocations.upper_bound(ForAddress);
-  if (It == Allocations.begin())
+  auto const &Alloc = Allocations[Index];
+  if (!MemoryArea(Alloc.getAddress(), Alloc.getSize()).contains(ForAddress))
     return nullptr;
 
-  --It;
-  auto const AllocStart = It->second.getAddress();
-  auto const AllocSize  = It->second.getSize();
-  if (!MemoryArea(AllocStart, AllocSize).contains(ForAddress))
-    return nullptr;
+  return &Alloc;
+}
+
+/// Change tracking stops recording areas after this many changes, and
+/// reports that everything may have changed.
+constexpr std::size_t MaxTrackedChanges = 1u << 16;
+
+void MemoryState::recordChange(stateptr_ty const Address,
+                               std::size_t const Size)
+{
+  if (!TrackChanges || ChangesOverflowed)
+    return;
+
+  if (ChangedAreas.size() == MaxTrackedChanges) {
+    ChangesOverflowed = true;
+    ChangedAreas.clear();
+    return;
+  }
 
-  return &(It->second);
+  ChangedAreas.emplace_back(Address, Size);
+}
+
+void MemoryState::discardPreviousAllocations()
+{
+  if (!HistoryLimit || PreviousAllocationsSize <= HistoryLimit)
+    return;
+
+  // Discard enough to leave half of the limit, as in discardHistory().
+  auto const Target = HistoryLimit / 2;
+
+  while (PreviousAllocationsSize > Target
+         && PreviousAllocationsDiscarded < PreviousAllocations.size())
+  {
+    auto &Alloc = PreviousAllocations[PreviousAllocationsDiscarded++];
+    PreviousAllocationsSize -= Alloc.getRetainedSize();
+    Alloc.discardContents();
+  }
+}
+
+void MemoryState::setHistoryLimit(std::size_t const Limit)
+{
+  HistoryLimit = Limit;
+
+  if (HistoryLimit) {
+    for (auto &Alloc : Allocations)
+      Alloc.discardHistory(HistoryLimit);
+
+    discardPreviousAllocations();
+  }
+}
+
+void MemoryState::setChangeTracking(bool const Enable)
+{
+  TrackChanges = Enable;
+  ChangesOverflowed = false;
+  ChangedAreas.clear();
+}
+
+bool MemoryState::takeChangedAreas(std::vector<MemoryArea> &Areas)
+{
+  if (ChangesOverflowed) {
+    ChangesOverflowed = false;
+    return false;
+  }
+
+  Areas.insert(Areas.end(), ChangedAreas.begin(), ChangedAreas.end());
+  ChangedAreas.clear();
+  return true;
 }
 
 void MemoryState::allocationAdd(stateptr_ty const Address,
@@ -356,10 +569,17 @@ void MemoryState::allocationAdd(stateptr_ty const Address,
   if (Size == 0)
     return;
 
-  auto const Result = Allocations.emplace(std::piecewise_construct,
-                                          std::forward_as_tuple(Address),
-                                          std::forward_as_tuple(Address, Size));
-  assert(Result.second && "Allocation already exists!");
+  recordChange(Address, Size);
+
+  auto const It = std::lower_bound(AllocationStarts.begin(),
+                                   AllocationStarts.end(),
+                                   Address);
+  assert((It == AllocationStarts.end() || *It != Address)
+         && "Allocation already exists!");
+
+  auto const Index = std::distance(AllocationStarts.begin(), It);
+  AllocationStarts.insert(It, Address);
+  Allocations.emplace(Allocations.begin() + Index, Address, Size);
 }
 
 void MemoryState::allocationRemove(stateptr_ty const Address,
@@ -368,11 +588,23 @@ void MemoryState::allocationRemove(stateptr_ty const Address,
   if (Size == 0)
     return;
 
-  auto const It = Allocations.find(Address);
-  assert(It != Allocations.end() && "Allocation does not exist!");
+  recordChange(Address, Size);
+
+  auto const It = std::lower_bound(AllocationStarts.begin(),
+                                   AllocationStarts.end(),
+                                   Address);
+  assert(It != AllocationStarts.end() && *It == Address
+         && "Allocation does not exist!");
+
+  auto const AllocIt = Allocations.begin()
+                       + std::distance(AllocationStarts.begin(), It);
 
-  PreviousAllocations.emplace(std::move(It->second));
-  Allocations.erase(It);
+  PreviousAllocations.emplace_back(std::move(*AllocIt));
+  PreviousAllocationsSize += PreviousAllocations.back().getRetainedSize();
+  Allocations.erase(AllocIt);
+  AllocationStarts.erase(It);
+
+  discardPreviousAllocations();
 }
 
 void MemoryState::allocationResize(stateptr_ty const Address,
@@ -390,31 +622,55 @@ void MemoryState::allocationResize(stateptr_ty const Address,
 
   auto &Alloc = getAllocation(MemoryArea(Address, CurrentSize));
   assert(Alloc.getSize() == CurrentSize);
+  recordChange(Address, std::max(CurrentSize, NewSize));
 
   // If the allocation is shrinking, then "clear" the disappearing area so that
   // we can rewind it in the Unresize.
-  if (NewSize < CurrentSize)
+  if (NewSize < CurrentSize) {
     Alloc.clearArea(MemoryArea(Address + NewSize,
                                CurrentSize - NewSize));
 
+    if (HistoryLimit)
+      Alloc.discardHistory(HistoryLimit);
+  }
+
   Alloc.resize(NewSize);
 }
 
-void MemoryState::allocationUnremove(stateptr_ty const Address,
+bool MemoryState::allocationUnremove(stateptr_ty const Address,
                                      std::size_t const Size)
 {
   if (Size == 0)
-    return;
+    return true;
+
+  recordChange(Address, Size);
 
   assert(!PreviousAllocations.empty() && "No previous allocations!");
 
-  auto &Top = PreviousAllocations.top();
+  auto &Top = PreviousAllocations.back();
   assert(Top.getAddress() == Address && "Previous allocation does not match!");
 
-  auto const Result = Allocations.emplace(Address, std::move(Top));
-  assert(Result.second && "Allocation already exists!");
+  auto const Restored = !Top.hasDiscardedContents();
+  if (Restored)
+    PreviousAllocationsSize -= Top.getRetainedSize();
+  else {
+    --PreviousAllocationsDiscarded;
+    Top.resetDiscardedContents();
+  }
+
+  auto const It = std::lower_bound(AllocationStarts.begin(),
+                                   AllocationStarts.end(),
+                                   Address);
+  assert((It == AllocationStarts.end() || *It != Address)
+         && "Allocation already exists!");
+
+  auto const Index = std::distance(AllocationStarts.begin(), It);
+  AllocationStarts.insert(It, Address);
+  Allocations.emplace(Allocations.begin() + Index, std::move(Top));
+
+  PreviousAllocations.pop_back();
 
-  PreviousAllocations.pop();
+  return Restored;
 }
 
 void MemoryState::allocationUnadd(stateptr_ty const Address,
@@ -423,51 +679,69 @@ void MemoryState::allocationUnadd(stateptr_ty const Address,
   if (Size == 0)
     return;
 
-  auto const It = Allocations.find(Address);
-  assert(It != Allocations.end() && "Allocation does not exist!");
+  recordChange(Address, Size);
 
-  Allocations.erase(It);
+  auto const It = std::lower_bound(AllocationStarts.begin(),
+                                   AllocationStarts.end(),
+                                   Address);
+  assert(It != AllocationStarts.end() && *It == Address
+         && "Allocation does not exist!");
+
+  Allocations.erase(Allocations.begin()
+                    + std::distance(AllocationStarts.begin(), It));
+  AllocationStarts.erase(It);
 }
 
-void MemoryState::allocationUnresize(stateptr_ty const Address,
+bool MemoryState::allocationUnresize(stateptr_ty const Address,
                                      std::size_t const CurrentSize,
                                      std::size_t const NewSize)
 {
   if (CurrentSize == 0) {
-    allocationUnremove(Address, NewSize);
-    return;
+    return allocationUnremove(Address, NewSize);
   }
   else if (NewSize == 0) {
     allocationUnadd(Address, CurrentSize);
-    return;
+    return true;
   }
 
   auto &Alloc = getAllocation(MemoryArea(Address, CurrentSize));
   assert(Alloc.getSize() == CurrentSize);
+  recordChange(Address, std::max(CurrentSize, NewSize));
 
   Alloc.resize(NewSize);
 
   // If this resize (originally) shrank the allocation, then rewind the area
   // that we have just restored.
   if (NewSize > CurrentSize)
-    Alloc.rewindArea(MemoryArea(Address + CurrentSize,
-                                NewSize - CurrentSize));
+    return Alloc.rewindArea(MemoryArea(Address + CurrentSize,
+                                       NewSize - CurrentSize));
+
+  return true;
 }
 
 void MemoryState::addBlock(MappedMemoryBlock const &Block)
 {
-  getAllocation(Block.area()).addBlock(Block);
+  recordChange(Block.start(), Block.length());
+
+  auto &Alloc = getAllocation(Block.area());
+  Alloc.addBlock(Block);
+
+  if (HistoryLimit)
+    Alloc.discardHistory(HistoryLimit);
 }
 
-void MemoryState::removeBlock(MemoryArea Area)
+bool MemoryState::removeBlock(MemoryArea Area)
 {
-  getAllocation(Area).rewindArea(Area);
+  recordChange(Area.address(), Area.length());
+  return getAllocation(Area).rewindArea(Area);
 }
 
 void MemoryState::addCopy(stateptr_ty const Source,
                           stateptr_ty const Destination,
                           std::size_t const Size)
 {
+  recordChange(Destination, Size);
+
   auto const SArea = MemoryArea(Source, Size);
 
   auto &SAlloc = getAllocation(SArea);
@@ -476,66 +750,61 @@ void MemoryState::addCopy(stateptr_ty const Source,
   DAlloc.addArea(Destination,
                  SAlloc.getAreaData(SArea),
                  SAlloc.getAreaInitialization(SArea));
+
+  if (HistoryLimit)
+    DAlloc.discardHistory(HistoryLimit);
 }
 
-void MemoryState::removeCopy(stateptr_ty const Source,
+bool MemoryState::removeCopy(stateptr_ty const Source,
                              stateptr_ty const Destination,
                              std::size_t const Size)
 {
   auto const DArea = MemoryArea(Destination, Size);
-  getAllocation(DArea).rewindArea(DArea);
+  recordChange(Destination, Size);
+  return getAllocation(DArea).rewindArea(DArea);
 }
 
 void MemoryState::addClear(MemoryArea Area)
 {
   // TODO: This is temporary until we ensure that clears don't occur on
   //       unallocated regions.
-  if (Allocations.empty()) {
-    // llvm::errs() << "addClear(): no allocations available.\n";
-    return;
-  }
-
-  auto It = Allocations.upper_bound(Area.start());
-  if (It == Allocations.begin()) {
+  auto const Index = findContaining(Area);
+  if (Index == Allocations.size()) {
     // llvm::errs() << "addClear(): allocation not found.\n";
     return;
   }
 
-  --It;
-  auto const AllocStart = It->second.getAddress();
-  auto const AllocSize  = It->second.getSize();
-  if (!MemoryArea(AllocStart, AllocSize).contains(Area)) {
-    // llvm::errs() << "addClear(): allocation does not contain block!\n";
-    return;
-  }
+  recordChange(Area.address(), Area.length());
 
-  It->second.clearArea(Area);
+  auto &Alloc = Allocations[Index];
+  Alloc.clearArea(Area);
+
+  if (HistoryLimit)
+    Alloc.discardHistory(HistoryLimit);
 }
 
-void MemoryState::removeClear(MemoryArea Area)
+bool MemoryState::removeClear(MemoryArea Area)
 {
   // TODO: This is temporary until we ensure that clears don't occur on
   //       unallocated regions.
-  if (Allocations.empty()) {
-    // llvm::errs() << "addClear(): no allocations available.\n";
-    return;
+  auto const Index = findContaining(Area);
+  if (Index == Allocations.size()) {
+    // llvm::errs() << "removeClear(): allocation not found.\n";
+    return true;
   }
 
-  auto It = Allocations.upper_bound(Area.start());
-  if (It == Allocations.begin()) {
-    // llvm::errs() << "addClear(): allocation not found.\n";
-    return;
-  }
-
-  --It;
-  auto const AllocStart = It->second.getAddress();
-  auto const AllocSize  = It->second.getSize();
-  if (!MemoryArea(AllocStart, AllocSize).contains(Area)) {
-    // llvm::errs() << "addClear(): allocation does not contain block!\n";
-    return;
-  }
+  recordChange(Area.address(), Area.length());
+  return Allocations[Index].rewindArea(Area);
+}
 
-  It->second.rewindArea(Area);
+void MemoryState::restoreArea(MemoryArea Area,
+                              llvm::ArrayRef<char> WithData,
+                              llvm::ArrayRef<unsigned char> WithInitialization)
+{
+  recordChange(Area.address(), Area.length());
+  getAllocation(Area).restoreArea(Area.address(),
+                                  WithData,
+                                  WithInitialization);
 }
 
 
@@ -548,10 +817,10 @@ llvm::raw_ostream &operator<<(llvm::raw_ostream &Out,
   Out << " MemoryState:\n";
 
   for (auto const &Alloc : State.getAllocations()) {
-    Out << "  @" << Alloc.first << " (" << Alloc.second.getSize() << "): ";
-    if (Alloc.second.isCompletelyInitialized())
+    Out << "  @" << Alloc.getAddress() << " (" << Alloc.getSize() << "): ";
+    if (Alloc.isCompletelyInitialized())
       Out << "initialized\n";
-    else if (Alloc.second.isPartiallyInitialized())
+    else if (Alloc.isPartiallyInitialized())
       Out << "partially initialized\n";
     else
       Out << "uninitialized\n";
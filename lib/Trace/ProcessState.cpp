@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "seec/Trace/BlockValueStore.hpp"
+#include "seec/Trace/MemoryHistory.hpp"
 #include "seec/Trace/ProcessState.hpp"
 #include "seec/Trace/TraceReader.hpp"
 #include "seec/Util/Fallthrough.hpp"
@@ -19,6 +20,7 @@
 
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <thread>
 #include <functional>
@@ -31,32 +33,21 @@ namespace trace {
 // ProcessState
 //------------------------------------------------------------------------------
 
-ProcessState::ProcessState(std::shared_ptr<ProcessTrace const> TracePtr,
-                           std::shared_ptr<ModuleIndex const> ModIndexPtr)
-: Trace(std::move(TracePtr)),
-  Module(std::move(ModIndexPtr)),
-  ValueStoreModuleInfo(llvm::make_unique<value_store::ModuleInfo>
-                                        (Module->getModule(), *Module)),
-  DL(&(Module->getModule())),
-  ProcessTime(0),
-  ThreadStates(Trace->getNumThreads()),
-  Mallocs(),
-  PreviousMallocs(),
-  Memory(),
-  KnownMemory(),
-  Streams(),
-  StreamsClosed(),
-  Dirs()
+/// \brief Add the initial state of all global variables to a \c MemoryState.
+///
+static void addGlobalVariables(MemoryState &Memory,
+                               ProcessTrace const &Trace,
+                               ModuleIndex const &Module,
+                               llvm::DataLayout const &DL)
 {
-  // Setup initial memory state for global variables.
-  for (std::size_t i = 0; i < Module->getGlobalCount(); ++i) {
-    auto const Global = Module->getGlobal(i);
+  for (std::size_t i = 0; i < Module.getGlobalCount(); ++i) {
+    auto const Global = Module.getGlobal(i);
     assert(Global);
     
     auto const ElemTy = Global->getType()->getElementType();
     auto const Size = DL.getTypeStoreSize(ElemTy);
-    auto const Data = Trace->getGlobalVariableInitialData(i, Size);
-    auto const Start = Trace->getGlobalVariableAddress(i);
+    auto const Data = Trace.getGlobalVariableInitialData(i, Size);
+    auto const Start = Trace.getGlobalVariableAddress(i);
     
     auto const PriorAlloc = Memory.findAllocation(Start);
     if (PriorAlloc) {
@@ -76,7 +67,53 @@ ProcessState::ProcessState(std::shared_ptr<ProcessTrace const> TracePtr,
     Memory.allocationAdd(Start, Size);
     Memory.addBlock(MappedMemoryBlock(Start, Size, Data.data()));
   }
-  
+}
+
+ProcessState::ProcessState(std::shared_ptr<ProcessTrace const> TracePtr,
+                           std::shared_ptr<ModuleIndex const> ModIndexPtr)
+: Trace(std::move(TracePtr)),
+  Module(std::move(ModIndexPtr)),
+  ValueStoreModuleInfo(llvm::make_unique<value_store::ModuleInfo>
+                                        (Module->getModule(), *Module)),
+  DL(&(Module->getModule())),
+  GlobalAreas(),
+  GlobalAreasReach(),
+  ProcessTime(0),
+  ThreadStates(Trace->getNumThreads()),
+  Mallocs(),
+  PreviousMallocs(),
+  Memory(),
+  MemoryRebuilder(),
+  KnownMemory(),
+  Streams(),
+  StreamsClosed(),
+  Dirs()
+{
+  // Index the areas occupied by global variables.
+  for (uint32_t Index = 0; Index < Module->getGlobalCount(); ++Index) {
+    auto const Global = Module->getGlobal(Index);
+    auto const Size = DL.getTypeStoreSize(Global->getType()->getElementType());
+    auto const Permission = Global->isConstant() ? MemoryPermission::ReadOnly
+                                                 : MemoryPermission::ReadWrite;
+
+    GlobalAreas.emplace_back(Trace->getGlobalVariableAddress(Index),
+                             Size,
+                             Permission);
+  }
+
+  std::stable_sort(GlobalAreas.begin(), GlobalAreas.end(),
+                   [] (MemoryArea const &LHS, MemoryArea const &RHS) {
+                     return LHS.start() < RHS.start();
+                   });
+
+  for (auto const &Area : GlobalAreas)
+    GlobalAreasReach.push_back(GlobalAreasReach.empty()
+                               ? Area.end()
+                               : std::max(GlobalAreasReach.back(), Area.end()));
+
+  // Setup initial memory state for global variables.
+  addGlobalVariables(Memory, *Trace, *Module, DL);
+
   // Setup initial open streams.
   auto const &StreamsInitial = Trace->getStreamsInitial();
   
@@ -110,6 +147,30 @@ ProcessState::ProcessState(std::shared_ptr<ProcessTrace const> TracePtr,
 
 ProcessState::~ProcessState() = default;
 
+void ProcessState::setMemoryHistoryLimit(std::size_t const Limit)
+{
+  if (Limit && !MemoryRebuilder) {
+    MemoryState InitialMemory;
+    addGlobalVariables(InitialMemory, *Trace, *Module, DL);
+    MemoryRebuilder = llvm::make_unique<MemoryHistoryRebuilder>
+                                       (*Trace, std::move(InitialMemory));
+  }
+
+  Memory.setHistoryLimit(Limit);
+}
+
+void ProcessState::rebuildMemoryArea(MemoryArea const &Area,
+                                     uint64_t const BeforeProcessTime)
+{
+  assert(MemoryRebuilder && "Memory history is not limited!");
+
+  std::vector<char> Data(Area.length());
+  std::vector<unsigned char> Init(Area.length());
+  MemoryRebuilder->getAreaBefore(Area, BeforeProcessTime, Data, Init);
+
+  Memory.restoreArea(Area, Data, Init);
+}
+
 void ProcessState::addMalloc(stateptr_ty const Address,
                              std::size_t const Size,
                              llvm::Instruction const *Allocator)
@@ -145,46 +206,39 @@ void ProcessState::unremoveMalloc(stateptr_ty const Address)
   PreviousMallocs.pop_back();
 }
 
-bool ProcessState::isContainedByGlobalVariable(stateptr_ty const Address) const
+MemoryArea const *
+ProcessState::findGlobalVariableArea(stateptr_ty const Address) const
 {
-  // Check global variables.
-  for (uint32_t Index = 0; Index < Module->getGlobalCount(); ++Index) {
-    auto const Begin = Trace->getGlobalVariableAddress(Index);
-    if (Address < Begin)
-      continue;
+  auto It = std::upper_bound(GlobalAreas.begin(), GlobalAreas.end(), Address,
+                             [] (stateptr_ty const Addr, MemoryArea const &A) {
+                               return Addr < A.start();
+                             });
 
-    auto const Global = Module->getGlobal(Index);
-    auto const Size = DL.getTypeStoreSize(Global->getType()->getElementType());
-    auto const Permission = Global->isConstant() ? MemoryPermission::ReadOnly
-                                                 : MemoryPermission::ReadWrite;
+  // Global variables may be nested, so check preceding areas until none of
+  // them could reach the address.
+  while (It != GlobalAreas.begin()) {
+    --It;
 
-    auto const Area = MemoryArea(Begin, Size, Permission);
+    if (It->contains(Address))
+      return &*It;
 
-    if (Area.contains(Address))
-      return true;
+    if (GlobalAreasReach[It - GlobalAreas.begin()] <= Address)
+      break;
   }
 
-  return false;
+  return nullptr;
+}
+
+bool ProcessState::isContainedByGlobalVariable(stateptr_ty const Address) const
+{
+  return findGlobalVariableArea(Address) != nullptr;
 }
 
 seec::Maybe<MemoryArea>
 ProcessState::getContainingMemoryArea(stateptr_ty Address) const {
   // Check global variables.
-  for (uint32_t Index = 0; Index < Module->getGlobalCount(); ++Index) {
-    auto const Begin = Trace->getGlobalVariableAddress(Index);
-    if (Address < Begin)
-      continue;
-    
-    auto const Global = Module->getGlobal(Index);
-    auto const Size = DL.getTypeStoreSize(Global->getType()->getElementType());
-    auto const Permission = Global->isConstant() ? MemoryPermission::ReadOnly
-                                                 : MemoryPermission::ReadWrite;
-    
-    auto const Area = MemoryArea(Begin, Size, Permission);
-    
-    if (Area.contains(Address))
-      return Area;
-  }
+  if (auto const Area = findGlobalVariableArea(Address))
+    return *Area;
   
   // Check dynamic memory allocations.
   {
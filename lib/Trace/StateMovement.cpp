@@ -16,9 +16,15 @@
 #include "seec/Trace/ThreadState.hpp"
 #include "seec/Trace/TraceSearch.hpp"
 
+#include "llvm/ADT/SmallVector.h"
+
+#include <algorithm>
 #include <condition_variable>
+#include <deque>
 #include <initializer_list>
+#include <limits>
 #include <map>
+#include <set>
 #include <thread>
 #include <vector>
 
@@ -27,9 +33,116 @@ namespace seec {
 namespace trace {
 
 
+/// \brief Find the allocations that a shared event reads or writes.
+/// \param Ev the event.
+/// \param Memory the current state of memory.
+/// \param Touched receives the start addresses of the allocations.
+/// \return true iff the event only reads and writes the contents of existing
+///         allocations, so that it is independent of any event that does not
+///         use the same allocations.
+///
+static bool getTouchedAllocations(EventReference const &Ev,
+                                  MemoryState const &Memory,
+                                  llvm::SmallVectorImpl<stateptr_ty> &Touched)
+{
+  auto const Touch = [&] (stateptr_ty const Address) -> bool {
+    auto const Alloc = Memory.findAllocation(Address);
+    if (!Alloc)
+      return false;
+    Touched.push_back(Alloc->getAddress());
+    return true;
+  };
+
+  switch (Ev->getType()) {
+    case EventType::StateTyped:
+      return Touch(Ev.get<EventType::StateTyped>().getAddress());
+    case EventType::StateUntypedSmall:
+      return Touch(Ev.get<EventType::StateUntypedSmall>().getAddress());
+    case EventType::StateUntyped:
+      return Touch(Ev.get<EventType::StateUntyped>().getAddress());
+    case EventType::StateClear:
+      return Touch(Ev.get<EventType::StateClear>().getAddress());
+    case EventType::StateMemmove:
+    {
+      auto const &Move = Ev.get<EventType::StateMemmove>();
+      return Touch(Move.getSourceAddress())
+          && Touch(Move.getDestinationAddress());
+    }
+    default:
+      // Malloc, Free, Realloc, and the stream and directory events change
+      // the structure of the shared state, so they conflict with everything.
+      return false;
+  }
+}
+
+
+/// \brief Check if an event adds or removes allocations in the MemoryState
+///        without being a shared event.
+///
+/// Such events are otherwise applied without holding the ProcessState's
+/// lock, but other threads search the MemoryState's allocations while they
+/// hold the lock (e.g. to check if events are independent).
+///
+static bool changesLocalAllocations(EventRecordBase const &Ev)
+{
+  switch (Ev.getType()) {
+    case EventType::FunctionEnd:
+    case EventType::Alloca:
+    case EventType::StackRestore:
+    case EventType::KnownRegionAdd:
+    case EventType::KnownRegionRemove:
+    case EventType::ByValRegionAdd:
+      return true;
+    default:
+      return false;
+  }
+}
+
+
 /// \brief Implements state movement logic.
 ///
 class ThreadedStateMovementHelper {
+  /// \brief A shared event that a thread has yet to move over.
+  ///
+  struct PendingEvent {
+    /// The event.
+    EventReference Event;
+
+    /// The process time of the event.
+    uint64_t ProcessTime;
+
+    PendingEvent(EventReference WithEvent, uint64_t const WithProcessTime)
+    : Event(WithEvent),
+      ProcessTime(WithProcessTime)
+    {}
+  };
+
+  /// \brief The shared events that a thread will move over next, found by
+  ///        scanning the thread's trace ahead of its movement.
+  ///
+  struct ThreadLookahead {
+    /// Shared events found so far, in the order they will be moved over.
+    std::deque<PendingEvent> Events;
+
+    /// Scanning resumes from this event (forward movement), or from the event
+    /// preceding it (backward movement).
+    EventReference ScanFrom;
+
+    /// Set when the scan has reached the end (or beginning) of the trace.
+    bool Exhausted;
+
+    ThreadLookahead(EventReference WithScanFrom)
+    : Events(),
+      ScanFrom(WithScanFrom),
+      Exhausted(false)
+    {}
+  };
+
+  /// The lookahead is limited to this many events per thread. If another
+  /// thread has more pending events than this, then an event will wait for
+  /// its process time rather than checking if it is independent.
+  static constexpr std::size_t MaxLookahead = 64;
+
   /// Controls access to the ProcessState.
   std::mutex ProcessStateMutex;
   
@@ -38,7 +151,242 @@ class ThreadedStateMovementHelper {
   
   /// Indicates that the movement has satisfied a predicate.
   std::atomic<bool> MovementComplete;
-  
+
+  /// \name Out-of-order movement
+  /// @{
+
+  /// Allow threads to move over shared events that are independent of all
+  /// pending events in other threads without waiting for their process time.
+  bool MoveOutOfOrder;
+
+  /// Lookahead for each thread, indexed by (ThreadID - 1).
+  std::vector<ThreadLookahead> Lookahead;
+
+  /// Process times of shared events that have been moved over out of order,
+  /// which the ProcessState's time has not yet reached.
+  std::set<uint64_t> OutOfOrderTimes;
+
+  /// The number of shared events that have been moved over. Other threads'
+  /// pending events only change when this does, so a waiting thread only
+  /// needs to check if it is independent again when this changes.
+  uint64_t SharedEventsMoved;
+
+  /// @} (Out-of-order movement)
+
+  /// \brief Ensure that a thread's lookahead covers all of its pending events
+  ///        that precede (or, when moving backward, follow) a process time.
+  /// \return false if the lookahead limit was reached.
+  ///
+  bool extendLookahead(ThreadState const &Thread,
+                       uint64_t const ProcessTime,
+                       bool const Forward)
+  {
+    auto &Ahead = Lookahead[Thread.getThreadID() - 1];
+    auto const Events = Thread.getTrace().events();
+
+    auto const Covered = [&] () -> bool {
+      if (Ahead.Exhausted || Ahead.Events.empty())
+        return Ahead.Exhausted;
+      auto const LastTime = Ahead.Events.back().ProcessTime;
+      return Forward ? LastTime >= ProcessTime : LastTime <= ProcessTime;
+    };
+
+    while (!Covered()) {
+      if (Ahead.Events.size() >= MaxLookahead)
+        return false;
+
+      if (Forward ? Ahead.ScanFrom == Events.end()
+                  : Ahead.ScanFrom == Events.begin()) {
+        Ahead.Exhausted = true;
+        break;
+      }
+
+      auto const Ev = Forward ? Ahead.ScanFrom : --Ahead.ScanFrom;
+      if (Forward)
+        ++Ahead.ScanFrom;
+
+      if (Ev->modifiesSharedState())
+        if (auto const MaybeTime = Ev->getProcessTime())
+          Ahead.Events.emplace_back(Ev, *MaybeTime);
+    }
+
+    return true;
+  }
+
+  /// \brief Check if the remainder of an event block can be moved over
+  ///        before its process time is reached.
+  /// \param State the thread that is moving.
+  /// \param Event the first (when moving forward) or last (when moving
+  ///        backward) event of the remainder of the block.
+  /// \return true iff every shared event in the remainder of the block uses
+  ///         only allocations that are not used by any pending event, in
+  ///         another thread, that would otherwise be moved over first.
+  ///
+  bool isIndependent(ThreadState const &State,
+                     EventReference Event,
+                     bool const Forward)
+  {
+    auto const &ProcState = State.getParent();
+    auto const &Memory = ProcState.getMemory();
+    auto const Events = State.getTrace().events();
+
+    // Find the allocations used by the shared events in the block.
+    llvm::SmallVector<stateptr_ty, 4> Touched;
+    uint64_t MinTime = std::numeric_limits<uint64_t>::max();
+    uint64_t MaxTime = 0;
+
+    while (true) {
+      if (Event->modifiesSharedState()) {
+        if (auto const MaybeTime = Event->getProcessTime()) {
+          if (!getTouchedAllocations(Event, Memory, Touched))
+            return false;
+          MinTime = std::min(MinTime, *MaybeTime);
+          MaxTime = std::max(MaxTime, *MaybeTime);
+        }
+      }
+
+      if (Forward) {
+        ++Event;
+        if (Event == Events.end() || Event->isBlockStart())
+          break;
+      }
+      else {
+        if (Event->isBlockStart() || Event == Events.begin())
+          break;
+        --Event;
+      }
+    }
+
+    if (Touched.empty())
+      return false;
+
+    // Check the other threads' events that precede (or follow) the block.
+    llvm::SmallVector<stateptr_ty, 4> OtherTouched;
+
+    for (auto const &OtherPtr : ProcState.getThreadStates()) {
+      if (OtherPtr.get() == &State)
+        continue;
+
+      if (!extendLookahead(*OtherPtr, Forward ? MaxTime : MinTime, Forward))
+        return false;
+
+      for (auto const &Pending : Lookahead[OtherPtr->getThreadID() - 1].Events)
+      {
+        if (Forward ? Pending.ProcessTime >= MaxTime
+                    : Pending.ProcessTime <= MinTime)
+          break;
+
+        OtherTouched.clear();
+        if (!getTouchedAllocations(Pending.Event, Memory, OtherTouched))
+          return false;
+
+        for (auto const Address : OtherTouched)
+          if (std::find(Touched.begin(), Touched.end(), Address)
+              != Touched.end())
+            return false;
+      }
+    }
+
+    return true;
+  }
+
+  /// \brief Update the ProcessState's time after a thread has moved over a
+  ///        shared event.
+  ///
+  /// The ProcessState's time remains the latest time at which all shared
+  /// events have been moved over (or, when moving backward, the earliest time
+  /// that all following shared events have been moved over).
+  ///
+  /// \param EventTime the process time of the event.
+  /// \param TimeBefore the ProcessState's time before the event was moved
+  ///        over (moving over the event sets the ProcessState's time to the
+  ///        event's own time, which this replaces).
+  ///
+  void movedOverSharedEvent(ThreadState &State,
+                            EventReference const &Event,
+                            uint64_t const EventTime,
+                            uint64_t const TimeBefore,
+                            bool const Forward)
+  {
+    ++SharedEventsMoved;
+
+    auto &Ahead = Lookahead[State.getThreadID() - 1];
+    if (!Ahead.Events.empty()) {
+      assert(Ahead.Events.front().Event == Event);
+      Ahead.Events.pop_front();
+    }
+    else {
+      Ahead.ScanFrom = State.getNextEvent();
+    }
+
+    auto &ProcState = State.getParent();
+    auto Time = TimeBefore;
+
+    if (Forward) {
+      if (EventTime == Time + 1) {
+        ++Time;
+        while (OutOfOrderTimes.erase(Time + 1))
+          ++Time;
+      }
+      else {
+        OutOfOrderTimes.insert(EventTime);
+      }
+    }
+    else {
+      if (EventTime == Time) {
+        --Time;
+        while (OutOfOrderTimes.erase(Time))
+          --Time;
+      }
+      else {
+        OutOfOrderTimes.insert(EventTime);
+      }
+    }
+
+    ProcState.ProcessTime = Time;
+  }
+
+  /// \brief Wait until a thread may move over the remainder of an event block.
+  ///
+  /// When moving out of order, the block is checked for independence when the
+  /// wait begins, and again only when another thread has moved over a shared
+  /// event (rather than every time that the ProcessState is updated).
+  ///
+  /// \param Reached checks if the ProcessState has reached the time required
+  ///        to move over the block in order.
+  ///
+  template<typename PredT>
+  void waitToMoveOver(ThreadState const &State,
+                      EventReference const &Event,
+                      bool const Forward,
+                      std::unique_lock<std::mutex> &UpdateLock,
+                      PredT Reached)
+  {
+    if (MovementComplete || Reached())
+      return;
+
+    if (!MoveOutOfOrder) {
+      ProcessStateCV.wait(UpdateLock,
+                          [&] () { return MovementComplete || Reached(); });
+      return;
+    }
+
+    if (isIndependent(State, Event, Forward))
+      return;
+
+    auto CheckedAt = SharedEventsMoved;
+
+    ProcessStateCV.wait(UpdateLock,
+                        [&] () {
+                          if (MovementComplete || Reached())
+                            return true;
+                          if (CheckedAt == SharedEventsMoved)
+                            return false;
+                          CheckedAt = SharedEventsMoved;
+                          return isIndependent(State, Event, Forward);
+                        });
+  }
+
 public:
   /// \name Constructors
   /// @{
@@ -47,7 +395,11 @@ public:
   ThreadedStateMovementHelper()
   : ProcessStateMutex(),
     ProcessStateCV(),
-    MovementComplete(false)
+    MovementComplete(false),
+    MoveOutOfOrder(false),
+    Lookahead(),
+    OutOfOrderTimes(),
+    SharedEventsMoved(0)
   {}
   
   ThreadedStateMovementHelper(ThreadedStateMovementHelper const &) = delete;
@@ -55,6 +407,22 @@ public:
   ThreadedStateMovementHelper(ThreadedStateMovementHelper &&) = delete;
   
   /// @}
+
+  /// \brief Allow independent shared events to be moved over out of order.
+  ///
+  /// This must only be used for movements that have no predicates, because
+  /// the ProcessState is not consistent with its process time until the
+  /// movement completes.
+  ///
+  void enableOutOfOrderMovement(ProcessState const &State) {
+    if (State.getThreadStateCount() < 2)
+      return;
+
+    MoveOutOfOrder = true;
+
+    for (auto const &ThreadStatePtr : State.getThreadStates())
+      Lookahead.emplace_back(ThreadStatePtr->getNextEvent());
+  }
   
   bool addNextEventBlock(ThreadState &State,
                          std::unique_lock<std::mutex> &UpdateLock) {
@@ -72,38 +440,57 @@ public:
       // wait until the ProcessState has reached this time. If the event will
       // set the ProcessState's time, then we must wait until the ProcessState
       // is at the time immediately prior to this new time.
+      // When moving out of order, the local process time is not observed,
+      // so there is no need to wait for it.
       if (!UpdateLock) {
         auto MaybeNewProcessTime = NextEvent->getProcessTime();
-        if (MaybeNewProcessTime) {
+        if (MaybeNewProcessTime
+            && (!MoveOutOfOrder || NextEvent->modifiesSharedState())) {
           auto const &ProcState = State.getParent();
           auto const WaitUntil = NextEvent->modifiesSharedState()
                                ? *MaybeNewProcessTime - 1
                                : *MaybeNewProcessTime;
           
           UpdateLock.lock();
-          ProcessStateCV.wait(UpdateLock,
-                              [=, &ProcState](){
-                                return MovementComplete ||
-                                       ProcState.getProcessTime() >= WaitUntil;
-                              });
+          waitToMoveOver(State, NextEvent, true, UpdateLock,
+                         [=, &ProcState](){
+                           return ProcState.getProcessTime() >= WaitUntil;
+                         });
           
           if (MovementComplete) {
-            // We can release the lock, because we'll only be rewinding local
-            // changes. (If there were non-local changes in our rewinding area,
-            // then we would already have owned the lock from applying them,
-            // and thus would not be in this branch)
-            UpdateLock.unlock();
-            
-            // Rewind changes.
+            // We are only rewinding local changes. (If there were non-local
+            // changes in our rewinding area, then we would already have owned
+            // the lock from applying them, and thus would not be in this
+            // branch.) The lock is still held while rewinding, because local
+            // changes may add or remove allocations.
             while (State.getNextEvent() != RewindNextEvent)
               State.removePreviousEvent();
+
+            UpdateLock.unlock();
             
             return false;
           }
         }
       }
       
-      State.addNextEvent();
+      // Shared events are applied with the lock held, so the ProcessState's
+      // time can only be read for them.
+      auto const TimeBefore = NextEvent->modifiesSharedState()
+                            ? State.getParent().getProcessTime()
+                            : uint64_t(0);
+
+      if (!UpdateLock && changesLocalAllocations(*NextEvent)) {
+        std::lock_guard<std::mutex> AllocationsLock(ProcessStateMutex);
+        State.addNextEvent();
+      }
+      else {
+        State.addNextEvent();
+      }
+
+      if (MoveOutOfOrder && NextEvent->modifiesSharedState())
+        if (auto const MaybeTime = NextEvent->getProcessTime())
+          movedOverSharedEvent(State, NextEvent, *MaybeTime, TimeBefore,
+                               true);
       
       NextEvent = State.getNextEvent();
       if (NextEvent->isBlockStart() || NextEvent == LastEvent)
@@ -137,36 +524,49 @@ public:
       // will then cause the ProcessState to go to the next earliest time).
       if (!UpdateLock) {
         auto MaybeNewProcessTime = PreviousEvent->getProcessTime();
-        if (MaybeNewProcessTime) {
+        if (MaybeNewProcessTime
+            && (!MoveOutOfOrder || PreviousEvent->modifiesSharedState())) {
           auto const &ProcState = State.getParent();
           auto const WaitUntil = PreviousEvent->modifiesSharedState()
                                ? *MaybeNewProcessTime
                                : *MaybeNewProcessTime - 1;
           
           UpdateLock.lock();
-          ProcessStateCV.wait(UpdateLock,
-                              [=, &ProcState](){
-                                return MovementComplete ||
-                                       ProcState.getProcessTime() <= WaitUntil;
-                              });
+          waitToMoveOver(State, PreviousEvent, false, UpdateLock,
+                         [=, &ProcState](){
+                           return ProcState.getProcessTime() <= WaitUntil;
+                         });
           
           if (MovementComplete) {
-            // We can release the lock, because we'll only be rewinding local
-            // changes. (If there were non-local changes in our rewinding area,
-            // then we would already have owned the lock from applying them,
-            // and thus would not be in this branch)
-            UpdateLock.unlock();
-            
-            // Rewind changes.
+            // We are only rewinding local changes (see addNextEventBlock()).
             while (State.getNextEvent() != RewindNextEvent)
               State.addNextEvent();
+
+            UpdateLock.unlock();
             
             return false;
           }
         }
       }
       
-      State.removePreviousEvent();
+      // Shared events are applied with the lock held, so the ProcessState's
+      // time can only be read for them.
+      auto const TimeBefore = PreviousEvent->modifiesSharedState()
+                            ? State.getParent().getProcessTime()
+                            : uint64_t(0);
+
+      if (!UpdateLock && changesLocalAllocations(*PreviousEvent)) {
+        std::lock_guard<std::mutex> AllocationsLock(ProcessStateMutex);
+        State.removePreviousEvent();
+      }
+      else {
+        State.removePreviousEvent();
+      }
+
+      if (MoveOutOfOrder && PreviousEvent->modifiesSharedState())
+        if (auto const MaybeTime = PreviousEvent->getProcessTime())
+          movedOverSharedEvent(State, PreviousEvent, *MaybeTime, TimeBefore,
+                               false);
       
       if (PreviousEvent->isBlockStart() || PreviousEvent == FirstEvent)
         return true;
@@ -230,6 +630,13 @@ public:
             ProcessStateCV.notify_all();
             break;
           }
+
+          // If we updated the ProcessState, then wake the other workers so
+          // that they can check if they may continue.
+          if (Lock) {
+            Lock.unlock();
+            ProcessStateCV.notify_all();
+          }
         }
       });
     }
@@ -297,6 +704,13 @@ public:
             ProcessStateCV.notify_all();
             break;
           }
+
+          // If we updated the ProcessState, then wake the other workers so
+          // that they can check if they may continue.
+          if (Lock) {
+            Lock.unlock();
+            ProcessStateCV.notify_all();
+          }
         }
       });
     }
@@ -332,6 +746,20 @@ MovementResult moveBackwardUntil(ProcessState &State, ProcessPredTy Predicate)
   return Mover.moveBackward(State, Predicate, ThreadPredMapTy{});
 }
 
+MovementResult moveForwardToEnd(ProcessState &State)
+{
+  ThreadedStateMovementHelper Mover;
+  Mover.enableOutOfOrderMovement(State);
+  return Mover.moveForward(State, ProcessPredTy{}, ThreadPredMapTy{});
+}
+
+MovementResult moveBackwardToStart(ProcessState &State)
+{
+  ThreadedStateMovementHelper Mover;
+  Mover.enableOutOfOrderMovement(State);
+  return Mover.moveBackward(State, ProcessPredTy{}, ThreadPredMapTy{});
+}
+
 MovementResult moveForward(ProcessState &State)
 {
   auto const ProcessTime = State.getProcessTime();
@@ -773,6 +773,24 @@ void ThreadState::setPreviousViewOfProcessTime(EventRecordBase const &PriorTo)
   setPreviousViewOfProcessTime(EvRef);
 }
 
+void ThreadState::unremoveAllocation(stateptr_ty const Address,
+                                     std::size_t const Size,
+                                     uint64_t const BeforeProcessTime)
+{
+  if (!Parent.Memory.allocationUnremove(Address, Size))
+    Parent.rebuildMemoryArea(MemoryArea(Address, Size), BeforeProcessTime);
+}
+
+void ThreadState::unremoveAllocation(stateptr_ty const Address,
+                                     std::size_t const Size)
+{
+  // The allocation can't have been written after it was removed, so its
+  // contents are those produced by all events up to the current process time.
+  // This thread's view of the process time may precede writes made by other
+  // threads, which are already applied to the current state.
+  unremoveAllocation(Address, Size, Parent.getProcessTime() + 1);
+}
+
 void ThreadState::removeEvent(EventRecord<EventType::None> const &Ev) {}
 
 // It's OK to find this Event in the middle of a trace, because the trace has
@@ -855,13 +873,11 @@ void ThreadState::removeEvent(EventRecord<EventType::FunctionEnd> const &Ev) {
 
   // Restore alloca allocations (reverse order):
   for (auto const &Alloca : seec::reverse(StateRef.getAllocas()))
-    Parent.Memory.allocationUnremove(Alloca.getAddress(),
-                                     Alloca.getTotalSize());
+    unremoveAllocation(Alloca.getAddress(), Alloca.getTotalSize());
 
   // Restore byval areas (reverse order):
   for (auto const &ByVal : seec::reverse(StateRef.getParamByValStates()))
-    Parent.Memory.allocationUnremove(ByVal.getArea().address(),
-                                     ByVal.getArea().length());
+    unremoveAllocation(ByVal.getArea().address(), ByVal.getArea().length());
 
   // Set the thread time to the value that it had prior to this event.
   ThreadTime = TraceRef.getThreadTimeExited() - 1;
@@ -1008,8 +1024,7 @@ void ThreadState::removeEvent(EventRecord<EventType::StackRestore> const &Ev) {
   for (auto const &Alloca : range(CRIterTy(PreAllocas.end()),
                                   CRIterTy(Diff.second)))
   {
-    Parent.Memory.allocationUnremove(Alloca.getAddress(),
-                                     Alloca.getTotalSize());
+    unremoveAllocation(Alloca.getAddress(), Alloca.getTotalSize());
   }
 }
 
@@ -1054,7 +1069,7 @@ void ThreadState::removeEvent(EventRecord<EventType::Free> const &Ev) {
 
   // Restore the allocation in the memory state.
   auto const Size = Parent.Mallocs.find(Address)->second.getSize();
-  Parent.Memory.allocationUnremove(Address, Size);
+  unremoveAllocation(Address, Size, Ev.getProcessTime());
 
   Parent.ProcessTime = Ev.getProcessTime() - 1;
   setPreviousViewOfProcessTime(Ev);
@@ -1065,9 +1080,14 @@ void ThreadState::removeEvent(EventRecord<EventType::Realloc> const &Ev) {
   assert(It != Parent.Mallocs.end());
 
   It->second.setSize(Ev.getOldSize());
-  Parent.Memory.allocationUnresize(Ev.getAddress(),
-                                   Ev.getNewSize(),
-                                   Ev.getOldSize());
+  if (!Parent.Memory.allocationUnresize(Ev.getAddress(),
+                                        Ev.getNewSize(),
+                                        Ev.getOldSize()))
+  {
+    Parent.rebuildMemoryArea(MemoryArea(Ev.getAddress() + Ev.getNewSize(),
+                                        Ev.getOldSize() - Ev.getNewSize()),
+                             Ev.getProcessTime());
+  }
 
   Parent.ProcessTime = Ev.getProcessTime() - 1;
   setPreviousViewOfProcessTime(Ev);
@@ -1081,29 +1101,40 @@ void ThreadState::removeEvent(EventRecord<EventType::StateTyped> const &Ev)
 void ThreadState::removeEvent(
         EventRecord<EventType::StateUntypedSmall> const &Ev)
 {
-  Parent.Memory.removeBlock(MemoryArea(Ev.getAddress(), Ev.getSize()));
+  auto const Area = MemoryArea(Ev.getAddress(), Ev.getSize());
+  if (!Parent.Memory.removeBlock(Area))
+    Parent.rebuildMemoryArea(Area, Ev.getProcessTime());
   Parent.ProcessTime = Ev.getProcessTime() - 1;
   setPreviousViewOfProcessTime(Ev);
 }
 
 void ThreadState::removeEvent(EventRecord<EventType::StateUntyped> const &Ev)
 {
-  Parent.Memory.removeBlock(MemoryArea(Ev.getAddress(), Ev.getDataSize()));
+  auto const Area = MemoryArea(Ev.getAddress(), Ev.getDataSize());
+  if (!Parent.Memory.removeBlock(Area))
+    Parent.rebuildMemoryArea(Area, Ev.getProcessTime());
   Parent.ProcessTime = Ev.getProcessTime() - 1;
   setPreviousViewOfProcessTime(Ev);
 }
 
 void ThreadState::removeEvent(EventRecord<EventType::StateMemmove> const &Ev)
 {
-  Parent.Memory.removeCopy(Ev.getSourceAddress(),
-                           Ev.getDestinationAddress(),
-                           Ev.getSize());
+  if (!Parent.Memory.removeCopy(Ev.getSourceAddress(),
+                                Ev.getDestinationAddress(),
+                                Ev.getSize()))
+  {
+    Parent.rebuildMemoryArea(MemoryArea(Ev.getDestinationAddress(),
+                                        Ev.getSize()),
+                             Ev.getProcessTime());
+  }
   Parent.ProcessTime = Ev.getProcessTime() - 1;
   setPreviousViewOfProcessTime(Ev);
 }
 
 void ThreadState::removeEvent(EventRecord<EventType::StateClear> const &Ev) {
-  Parent.Memory.removeClear(MemoryArea(Ev.getAddress(), Ev.getClearSize()));
+  auto const Area = MemoryArea(Ev.getAddress(), Ev.getClearSize());
+  if (!Parent.Memory.removeClear(Area))
+    Parent.rebuildMemoryArea(Area, Ev.getProcessTime());
   Parent.ProcessTime = Ev.getProcessTime() - 1;
   setPreviousViewOfProcessTime(Ev);
 }
@@ -1124,7 +1155,7 @@ ThreadState::removeEvent(EventRecord<EventType::KnownRegionRemove> const &Ev)
                                          : MemoryPermission::None);
   
   Parent.addKnownMemory(Ev.getAddress(), Ev.getSize(), Access);
-  Parent.Memory.allocationUnremove(Ev.getAddress(), Ev.getSize());
+  unremoveAllocation(Ev.getAddress(), Ev.getSize());
 }
 
 void ThreadState::removeEvent(EventRecord<EventType::ByValRegionAdd> const &Ev)
@@ -51,6 +51,8 @@ TraceProcessListener::TraceProcessListener(llvm::Module &Module,
   Time(0),
   NextThreadID(1),
   ActiveThreadCount(0),
+  FinishedHookCounts(),
+  FinishedHookCountsMutex(),
   EnvironSetupOnceFlag(),
   GlobalMemoryMutex(),
   TraceMemoryMutex(),
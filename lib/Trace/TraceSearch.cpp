@@ -0,0 +1,225 @@
+//===- lib/Trace/TraceSearch.cpp ------------------------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#include "seec/Trace/TraceSearch.hpp"
+
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
+
+#include <array>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace seec {
+
+namespace trace {
+
+
+//------------------------------------------------------------------------------
+// Event size table
+//------------------------------------------------------------------------------
+
+namespace {
+
+/// Runs of records that are larger than this are checked one at a time.
+constexpr unsigned MaxVectorStride = 32;
+
+/// \brief Scanning information for a single event type.
+///
+struct EventScanInfo {
+  /// Size of the event's record (zero for unknown event types).
+  unsigned Size;
+
+  /// Number of 16-byte vectors checked in each step through a run of these
+  /// records (zero if runs are checked one at a time). This is a multiple of
+  /// the period at which the record type bytes repeat their alignment.
+  unsigned Chunks;
+
+  /// For each vector in a step, the positions of record type bytes.
+  std::array<uint16_t, MaxVectorStride> Masks;
+
+  EventScanInfo()
+  : Size(0),
+    Chunks(0),
+    Masks()
+  {}
+
+  void setSize(unsigned RecordSize) {
+    Size = RecordSize;
+
+    if (Size > MaxVectorStride)
+      return;
+
+    // The type bytes of a run of records occur every Size bytes, so the
+    // pattern repeats every lcm(Size, 16) bytes. Check at least four vectors
+    // in each step, so that small records are not checked two at a time.
+    auto const Period = (Size * 16) / llvm::GreatestCommonDivisor64(Size, 16);
+    auto const PeriodChunks = unsigned(Period / 16);
+    Chunks = PeriodChunks * ((4 + PeriodChunks - 1) / PeriodChunks);
+
+    for (unsigned Offset = 0; Offset < Chunks * 16; Offset += Size)
+      Masks[Offset / 16] |= uint16_t(1u << (Offset % 16));
+  }
+};
+
+/// \brief Get the scanning information for all event types, indexed by the
+///        value of the event's type byte.
+///
+std::array<EventScanInfo, 256> const &getScanInfoTable() {
+  static std::array<EventScanInfo, 256> const Table = [] () {
+    std::array<EventScanInfo, 256> Info;
+
+#define SEEC_TRACE_EVENT(NAME, MEMBERS, TRAITS)                                \
+    Info[static_cast<uint8_t>(EventType::NAME)]                                \
+      .setSize(sizeof(EventRecord<EventType::NAME>));
+#include "seec/Trace/Events.def"
+
+    return Info;
+  }();
+
+  return Table;
+}
+
+/// \brief Skip a run of records that share a type.
+/// \param Run a record in the run.
+/// \param Stop the first byte following the final record to check.
+/// \param Info scanning information for the run's event type.
+/// \return the first record following Run whose type differs from Run's, or
+///         Stop if there is no such record.
+///
+char const *skipRun(char const *Run, char const *Stop, EventScanInfo const &Info)
+{
+  auto const Type = *Run;
+  auto Next = Run + Info.Size;
+
+#if defined(__SSE2__)
+  if (Info.Chunks) {
+    // Each window starts on a record in the run, and its type bytes are at
+    // the positions given by Info.Masks. Any earlier type bytes in the window
+    // all matched, so the first mismatch is the end of the run.
+    auto const Step = static_cast<std::ptrdiff_t>(Info.Chunks * 16);
+    auto const Splat = _mm_set1_epi8(Type);
+    auto Window = Run;
+
+    while (Stop - Window >= Step) {
+      for (unsigned Chunk = 0; Chunk < Info.Chunks; ++Chunk) {
+        auto const Data = _mm_loadu_si128(
+                            reinterpret_cast<__m128i const *>(Window
+                                                              + Chunk * 16));
+        auto const Equal = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(Data,
+                                                                     Splat)));
+        auto const Mismatch = ~Equal & Info.Masks[Chunk];
+        if (Mismatch)
+          return Window + Chunk * 16 + llvm::countTrailingZeros(Mismatch);
+      }
+
+      Window += Step;
+    }
+
+    Next = Window;
+  }
+#endif
+
+  while (Next < Stop && *Next == Type)
+    Next += Info.Size;
+
+  return Next;
+}
+
+} // anonymous namespace
+
+
+//------------------------------------------------------------------------------
+// scanForEventTypes()
+//------------------------------------------------------------------------------
+
+char const *scanForEventTypes(char const *First,
+                              char const *Stop,
+                              EventTypeSet const &Types)
+{
+  auto const &Table = getScanInfoTable();
+
+  auto It = First;
+
+  while (It < Stop) {
+    auto const Type = static_cast<uint8_t>(*It);
+    if (Types.contains(static_cast<EventType>(Type)))
+      return It;
+
+    auto const &Info = Table[Type];
+    if (!Info.Size)
+      llvm_unreachable("Reference to unknown event type!");
+
+    auto const Next = It + Info.Size;
+    if (Next < Stop && *Next == *It)
+      It = skipRun(Next, Stop, Info);
+    else
+      It = Next;
+  }
+
+  return Stop;
+}
+
+
+//------------------------------------------------------------------------------
+// findFirstOf()
+//------------------------------------------------------------------------------
+
+seec::Maybe<EventReference> findFirstOf(EventRange Range,
+                                        EventTypeSet const &Types)
+{
+  auto It = Range.begin();
+  auto const End = Range.end();
+
+  while (It != End) {
+    auto const &Block = It.getBlock();
+    auto const EndInBlock = &End.getBlock() == &Block;
+
+    // Search to the end of the range, or to the end of this block.
+    char const *Stop = nullptr;
+
+    if (EndInBlock && !End.isPastEnd()) {
+      Stop = reinterpret_cast<char const *>(&*End);
+    }
+    else {
+      Stop = reinterpret_cast<char const *>(Block.end())
+             + Block.end()->getEventSize();
+    }
+
+    auto const Found = scanForEventTypes(reinterpret_cast<char const *>(&*It),
+                                         Stop,
+                                         Types);
+
+    if (Found != Stop)
+      return seec::Maybe<EventReference>(EventReference(Found, Block));
+
+    if (EndInBlock)
+      break;
+
+    auto const NextBlock = Block.getNext();
+    if (!NextBlock)
+      break;
+
+    It = EventReference(*NextBlock->begin(), *NextBlock);
+  }
+
+  return seec::Maybe<EventReference>();
+}
+
+
+} // namespace trace (in seec)
+
+} // namespace seec
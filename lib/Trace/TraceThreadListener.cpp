@@ -538,7 +538,8 @@ TraceThreadListener::TraceThreadListener(TraceProcessListener &ProcessListener,
   GlobalMemoryLock(),
   DynamicMemoryLock(),
   StreamsLock(),
-  DirsLock()
+  DirsLock(),
+  HookCounts()
 {
   EventsOut.open(StreamAllocator.getThreadEventStream(ThreadID));
   OutputEnabled = true;
@@ -564,6 +565,9 @@ TraceThreadListener::TraceThreadListener(TraceProcessListener &ProcessListener,
 TraceThreadListener::~TraceThreadListener()
 {
   traceClose();
+
+  HookCounts.addEvents(EventsOut.getEventCount());
+  ProcessListener.addHookCounts(HookCounts);
   
   ProcessListener.deregisterThreadListener(ThreadID);
 }
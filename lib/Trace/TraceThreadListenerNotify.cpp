@@ -72,6 +72,8 @@ void TraceThreadListener::exitPostNotification() {
 
 void TraceThreadListener::notifyFunctionBegin(uint32_t Index,
                                               llvm::Function const *F) {
+  HookCounts.count(TraceHook::FunctionBegin);
+
   // Handle common behaviour when entering and exiting notifications.
   enterNotification();
   auto OnExit = scopeExit([=](){exitPostNotification();});
@@ -164,6 +166,8 @@ void TraceThreadListener::notifyFunctionBegin(uint32_t Index,
 void TraceThreadListener::notifyArgumentByVal(uint32_t Index,
                                               llvm::Argument const *Arg,
                                               void const *Address) {
+  HookCounts.count(TraceHook::ArgumentByVal);
+
   // Handle common behaviour when entering and exiting notifications.
   enterNotification();
   auto OnExit = scopeExit([=](){exitNotification();});
@@ -235,6 +239,8 @@ void TraceThreadListener::notifyArgumentByVal(uint32_t Index,
 }
 
 void TraceThreadListener::notifyArgs(uint64_t ArgC, char **ArgV) {
+  HookCounts.count(TraceHook::Args);
+
   // Handle common behaviour when entering and exiting notifications.
   // Note thatnotifyArgs has the exit behaviour of a post-notification, because
   // it effectively ends the FunctionStart block for main().
@@ -325,6 +331,8 @@ void TraceThreadListener::setupEnvironTable(char **Environ)
 }
 
 void TraceThreadListener::notifyEnv(char **EnvP) {
+  HookCounts.count(TraceHook::Env);
+
   // Handle common behaviour when entering and exiting notifications.
   enterNotification();
   auto OnExit = scopeExit([=](){exitNotification();});
@@ -350,6 +358,8 @@ void TraceThreadListener::notifyFunctionEnd(uint32_t const Index,
                                             InstrIndexInFn const InstrIndex,
                                             llvm::Instruction const *Terminator)
 {
+  HookCounts.count(TraceHook::FunctionEnd);
+
   assert(!FunctionStack.empty() && "notifyFunctionEnd with empty stack.");
 
   // Handle common behaviour when entering and exiting notifications.
@@ -446,6 +456,8 @@ void TraceThreadListener::notifyFunctionEnd(uint32_t const Index,
 void TraceThreadListener::notifyPreCall(InstrIndexInFn Index,
                                         llvm::CallInst const *CallInst,
                                         void const *Address) {
+  HookCounts.count(TraceHook::PreCall);
+
   using namespace seec::trace::detect_calls;
 
   // Handle common behaviour when entering and exiting notifications.
@@ -463,6 +475,8 @@ void TraceThreadListener::notifyPreCall(InstrIndexInFn Index,
 void TraceThreadListener::notifyPostCall(InstrIndexInFn Index,
                                          llvm::CallInst const *CallInst,
                                          void const *Address) {
+  HookCounts.count(TraceHook::PostCall);
+
   using namespace seec::trace::detect_calls;
 
   // Handle common behaviour when entering and exiting notifications.
@@ -474,6 +488,8 @@ void TraceThreadListener::notifyPostCall(InstrIndexInFn Index,
 
 void TraceThreadListener::notifyPreCallIntrinsic(InstrIndexInFn Index,
                                                  llvm::CallInst const *CI) {
+  HookCounts.count(TraceHook::PreCallIntrinsic);
+
   using namespace seec::trace::detect_calls;
 
   // Handle common behaviour when entering and exiting notifications.
@@ -500,6 +516,8 @@ void TraceThreadListener::notifyPreCallIntrinsic(InstrIndexInFn Index,
 
 void TraceThreadListener::notifyPostCallIntrinsic(InstrIndexInFn Index,
                                                   llvm::CallInst const *CI) {
+  HookCounts.count(TraceHook::PostCallIntrinsic);
+
   using namespace seec::trace::detect_calls;
 
   // Handle common behaviour when entering and exiting notifications.
@@ -566,6 +584,8 @@ void TraceThreadListener::notifyPreAlloca(InstrIndexInFn const Index,
                                           uint64_t const ElemSize,
                                           uint64_t const ElemCount)
 {
+  HookCounts.count(TraceHook::PreAlloca);
+
   auto const Remaining = getRemainingStack();
   if (Remaining / ElemSize < ElemCount) {
     handleRunError(
@@ -581,6 +601,8 @@ void TraceThreadListener::notifyPreLoad(InstrIndexInFn Index,
                                         void const *Data,
                                         std::size_t Size)
 {
+  HookCounts.count(TraceHook::PreLoad);
+
   // Handle common behaviour when entering and exiting notifications.
   enterNotification();
   auto OnExit = scopeExit([=](){exitPreNotification();});
@@ -634,6 +656,8 @@ void TraceThreadListener::notifyPostLoad(InstrIndexInFn Index,
                                          llvm::LoadInst const *Load,
                                          void const *Address,
                                          std::size_t Size) {
+  HookCounts.count(TraceHook::PostLoad);
+
   // Handle common behaviour when entering and exiting notifications.
   enterNotification();
   auto OnExit = scopeExit([=](){exitPostNotification();});
@@ -650,6 +674,8 @@ void TraceThreadListener::notifyPreStore(InstrIndexInFn Index,
                                          llvm::StoreInst const *Store,
                                          void const *Data,
                                          std::size_t Size) {
+  HookCounts.count(TraceHook::PreStore);
+
   // Handle common behaviour when entering and exiting notifications.
   enterNotification();
   auto OnExit = scopeExit([=](){exitPreNotification();});
@@ -673,6 +699,8 @@ void TraceThreadListener::notifyPostStore(InstrIndexInFn Index,
                                           llvm::StoreInst const *Store,
                                           void const *Address,
                                           std::size_t Size) {
+  HookCounts.count(TraceHook::PostStore);
+
   // Handle common behaviour when entering and exiting notifications.
   enterNotification();
   auto OnExit = scopeExit([=](){exitPostNotification();});
@@ -790,6 +818,8 @@ void checkFloatDivision(TraceThreadListener &Listener,
 void TraceThreadListener::notifyPreDivide(
                             InstrIndexInFn Index,
                             llvm::BinaryOperator const *Instruction) {
+  HookCounts.count(TraceHook::PreDivide);
+
   // Handle common behaviour when entering and exiting notifications.
   enterNotification();
   auto OnExit = scopeExit([=](){exitPreNotification();});
@@ -816,6 +846,8 @@ void TraceThreadListener::notifyPreDivide(
 void TraceThreadListener::notifyValue(InstrIndexInFn const Index,
                                       llvm::Instruction const * const Instr)
 {
+  HookCounts.count(TraceHook::ValueVoid);
+
   enterNotification();
   auto OnExit = scopeExit([this](){exitNotification();});
 
@@ -828,6 +860,8 @@ void TraceThreadListener::notifyValue(InstrIndexInFn const Index,
 void TraceThreadListener::notifyValue(InstrIndexInFn Index,
                                       llvm::Instruction const *Instruction,
                                       void *Value) {
+  HookCounts.count(TraceHook::ValuePointer);
+
   // Handle common behaviour when entering and exiting notifications.
   enterNotification();
   auto OnExit = scopeExit([=](){exitNotification();});
@@ -970,6 +1004,8 @@ void TraceThreadListener::notifyValue(InstrIndexInFn Index,
 void TraceThreadListener::notifyValue(InstrIndexInFn Index,
                                       llvm::Instruction const *Instruction,
                                       uint64_t Value) {
+  HookCounts.count(TraceHook::ValueInt64);
+
   // Handle common behaviour when entering and exiting notifications.
   enterNotification();
   auto OnExit = scopeExit([=](){exitNotification();});
@@ -994,6 +1030,8 @@ void TraceThreadListener::notifyValue(InstrIndexInFn Index,
 void TraceThreadListener::notifyValue(InstrIndexInFn Index,
                                       llvm::Instruction const *Instruction,
                                       uint32_t Value) {
+  HookCounts.count(TraceHook::ValueInt32);
+
   // Handle common behaviour when entering and exiting notifications.
   enterNotification();
   auto OnExit = scopeExit([=](){exitNotification();});
@@ -1018,6 +1056,8 @@ void TraceThreadListener::notifyValue(InstrIndexInFn Index,
 void TraceThreadListener::notifyValue(InstrIndexInFn Index,
                                       llvm::Instruction const *Instruction,
                                       uint16_t Value) {
+  HookCounts.count(TraceHook::ValueInt16);
+
   // Handle common behaviour when entering and exiting notifications.
   enterNotification();
   auto OnExit = scopeExit([=](){exitNotification();});
@@ -1042,6 +1082,8 @@ void TraceThreadListener::notifyValue(InstrIndexInFn Index,
 void TraceThreadListener::notifyValue(InstrIndexInFn Index,
                                       llvm::Instruction const *Instruction,
                                       uint8_t Value) {
+  HookCounts.count(TraceHook::ValueInt8);
+
   // Handle common behaviour when entering and exiting notifications.
   enterNotification();
   auto OnExit = scopeExit([=](){exitNotification();});
@@ -1066,6 +1108,8 @@ void TraceThreadListener::notifyValue(InstrIndexInFn Index,
 void TraceThreadListener::notifyValue(InstrIndexInFn Index,
                                       llvm::Instruction const *Instruction,
                                       float Value) {
+  HookCounts.count(TraceHook::ValueFloat);
+
   // Handle common behaviour when entering and exiting notifications.
   enterNotification();
   auto OnExit = scopeExit([=](){exitNotification();});
@@ -1090,6 +1134,8 @@ void TraceThreadListener::notifyValue(InstrIndexInFn Index,
 void TraceThreadListener::notifyValue(InstrIndexInFn Index,
                                       llvm::Instruction const *Instruction,
                                       double Value) {
+  HookCounts.count(TraceHook::ValueDouble);
+
   // Handle common behaviour when entering and exiting notifications.
   enterNotification();
   auto OnExit = scopeExit([=](){exitNotification();});
@@ -1114,6 +1160,8 @@ void TraceThreadListener::notifyValue(InstrIndexInFn Index,
 void TraceThreadListener::notifyValue(InstrIndexInFn Index,
                                       llvm::Instruction const *Instruction,
                                       long double Value) {
+  HookCounts.count(TraceHook::ValueX86FP80);
+
   // Handle common behaviour when entering and exiting notifications.
   enterNotification();
   auto OnExit = scopeExit([=](){exitNotification();});
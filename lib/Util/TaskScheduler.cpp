@@ -0,0 +1,217 @@
+//===- lib/Util/TaskScheduler.cpp -----------------------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#include "seec/Util/TaskScheduler.hpp"
+
+#include <algorithm>
+
+namespace seec {
+
+
+/// \brief The tasks submitted by a single call to \c parallelFor().
+///
+struct TaskScheduler::Group {
+  /// The task to run for each index.
+  std::function<void (std::size_t)> const &Task;
+
+  /// If not null, chunks are skipped once this becomes false.
+  std::atomic_bool const *CancelIfFalse;
+
+  /// Number of chunks that have not finished. Only modified while holding
+  /// \c Access, so that \c Finished is not missed.
+  std::size_t Remaining;
+
+  /// Set if any chunk was skipped.
+  std::atomic_bool Skipped;
+
+  /// Control access to \c Remaining.
+  std::mutex Access;
+
+  /// Notified when \c Remaining reaches zero.
+  std::condition_variable Finished;
+
+  Group(std::function<void (std::size_t)> const &WithTask,
+        std::atomic_bool const *WithCancelIfFalse,
+        std::size_t const ChunkCount)
+  : Task(WithTask),
+    CancelIfFalse(WithCancelIfFalse),
+    Remaining(ChunkCount),
+    Skipped(false),
+    Access(),
+    Finished()
+  {}
+};
+
+TaskScheduler::TaskScheduler(unsigned WorkerCount)
+: Workers(),
+  Queues(),
+  Queued(0),
+  NextQueue(0),
+  IdleAccess(),
+  IdleCV(),
+  Stopping(false)
+{
+  WorkerCount = std::max(1u, WorkerCount);
+
+  for (unsigned i = 0; i < WorkerCount; ++i)
+    Queues.emplace_back(new WorkerQueue());
+
+  for (unsigned i = 0; i < WorkerCount; ++i)
+    Workers.emplace_back([this, i] () { work(i); });
+}
+
+TaskScheduler::~TaskScheduler()
+{
+  {
+    std::lock_guard<std::mutex> Lock(IdleAccess);
+    Stopping = true;
+  }
+
+  IdleCV.notify_all();
+
+  for (auto &Worker : Workers)
+    Worker.join();
+}
+
+TaskScheduler &TaskScheduler::getShared()
+{
+  static TaskScheduler Shared(std::thread::hardware_concurrency());
+  return Shared;
+}
+
+bool TaskScheduler::take(std::size_t Preferred, Chunk &Out)
+{
+  auto const QueueCount = Queues.size();
+
+  // Take the most recently queued chunk from our own queue.
+  if (Preferred < QueueCount) {
+    auto &Queue = *Queues[Preferred];
+    std::lock_guard<std::mutex> Lock(Queue.Access);
+
+    if (!Queue.Chunks.empty()) {
+      Out = Queue.Chunks.back();
+      Queue.Chunks.pop_back();
+      --Queued;
+      return true;
+    }
+  }
+
+  // Otherwise steal the oldest chunk from another queue.
+  auto const Start = Preferred < QueueCount ? Preferred + 1 : 0;
+
+  for (std::size_t i = 0; i < QueueCount; ++i) {
+    auto &Queue = *Queues[(Start + i) % QueueCount];
+    std::lock_guard<std::mutex> Lock(Queue.Access);
+
+    if (!Queue.Chunks.empty()) {
+      Out = Queue.Chunks.front();
+      Queue.Chunks.pop_front();
+      --Queued;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void TaskScheduler::run(Chunk const &C)
+{
+  auto &G = *C.ForGroup;
+
+  if (G.CancelIfFalse && *G.CancelIfFalse == false) {
+    G.Skipped = true;
+  }
+  else {
+    for (auto i = C.Begin; i < C.End; ++i)
+      G.Task(i);
+  }
+
+  // The group may be destroyed as soon as Remaining reaches zero and Access
+  // is released, so nothing can touch it after this.
+  std::lock_guard<std::mutex> Lock(G.Access);
+  if (--G.Remaining == 0)
+    G.Finished.notify_all();
+}
+
+void TaskScheduler::work(std::size_t Index)
+{
+  while (true) {
+    Chunk C;
+
+    if (take(Index, C)) {
+      run(C);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> Lock(IdleAccess);
+    IdleCV.wait(Lock, [this] () { return Stopping || Queued != 0; });
+    if (Stopping)
+      return;
+  }
+}
+
+bool TaskScheduler::parallelFor(std::size_t Count,
+                                std::size_t ChunkSize,
+                                std::function<void (std::size_t)> const &Task,
+                                std::atomic_bool const *CancelIfFalse)
+{
+  if (Count == 0)
+    return true;
+
+  if (ChunkSize == 0)
+    ChunkSize = std::max(std::size_t(1), Count / (Workers.size() * 4));
+
+  auto const ChunkCount = (Count + ChunkSize - 1) / ChunkSize;
+
+  Group G(Task, CancelIfFalse, ChunkCount);
+
+  // Distribute the chunks between the workers' queues. Queued is incremented
+  // first, so that it never understates the number of queued chunks.
+  for (std::size_t Begin = 0; Begin < Count; Begin += ChunkSize) {
+    auto &Queue = *Queues[NextQueue++ % Queues.size()];
+    std::lock_guard<std::mutex> Lock(Queue.Access);
+    ++Queued;
+    Queue.Chunks.push_back(Chunk{&G, Begin, std::min(Begin + ChunkSize, Count)});
+  }
+
+  {
+    std::lock_guard<std::mutex> Lock(IdleAccess);
+  }
+
+  IdleCV.notify_all();
+
+  // Help to run chunks until this group is finished. If there are no chunks
+  // left to take, then the remainder of this group is already running.
+  while (true) {
+    {
+      std::lock_guard<std::mutex> Lock(G.Access);
+      if (G.Remaining == 0)
+        break;
+    }
+
+    Chunk C;
+    if (take(Queues.size(), C)) {
+      run(C);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> Lock(G.Access);
+    G.Finished.wait(Lock, [&] () { return G.Remaining == 0; });
+    break;
+  }
+
+  return !G.Skipped;
+}
+
+
+} // namespace seec
@@ -13,6 +13,7 @@
 
 #include "seec/wxWidgets/CallbackFSHandler.hpp"
 
+#include <wx/mstream.h>
 #include <wx/sstream.h>
 #include <wx/tokenzr.h>
 #include <wx/uri.h>
@@ -55,6 +56,20 @@ std::string CallbackBase::call(wxString const &Right) const
 }
 
 
+/// \brief Reads from a shared string, which is kept alive by the stream.
+///
+class SharedStringInputStream final : public wxMemoryInputStream
+{
+  std::shared_ptr<std::string const> Data;
+  
+public:
+  SharedStringInputStream(std::shared_ptr<std::string const> WithData)
+  : wxMemoryInputStream(WithData->data(), WithData->size()),
+    Data(std::move(WithData))
+  {}
+};
+
+
 } // namespace callbackfs (in seec)
 
 
@@ -73,11 +88,47 @@ addCallback(wxString const &Identifier,
   return Added.second;
 }
 
+CallbackFSHandler::ContentInfo
+CallbackFSHandler::getContent(wxString const &Location)
+{
+  auto Path = GetRightLocation(Location);
+  
+  if (Path.StartsWith("//"))
+    Path.erase(0, 2);
+  
+  auto const QueryPos = Path.find('?');
+  if (QueryPos != wxString::npos)
+    Path.erase(QueryPos);
+  
+  std::lock_guard<std::mutex> Lock(ContentsAccess);
+  
+  auto const It = Contents.find(Path);
+  if (It == Contents.end())
+    return ContentInfo{};
+  
+  return It->second;
+}
+
+void CallbackFSHandler::setContent(wxString const &Path,
+                                   std::shared_ptr<std::string const> Data,
+                                   wxString const &MimeType)
+{
+  std::lock_guard<std::mutex> Lock(ContentsAccess);
+  
+  if (Data)
+    Contents[Path] = ContentInfo{std::move(Data), MimeType};
+  else
+    Contents.erase(Path);
+}
+
 bool CallbackFSHandler::CanOpen(wxString const &Location)
 {
   if (Protocol != GetProtocol(Location))
     return false;
   
+  if (getContent(Location).Data)
+    return true;
+  
   // Check the callback (first part of the path).
   auto const Right = GetRightLocation(Location);
   
@@ -92,6 +143,17 @@ bool CallbackFSHandler::CanOpen(wxString const &Location)
 wxFSFile *CallbackFSHandler::OpenFile(wxFileSystem &Parent,
                                        wxString const &Location)
 {
+  // Serve fixed content directly from the shared string.
+  auto Content = getContent(Location);
+  if (Content.Data) {
+    return new wxFSFile(new callbackfs::SharedStringInputStream
+                                         (std::move(Content.Data)),
+                        Location,
+                        Content.MimeType,
+                        wxString(),
+                        wxDateTime::Now());
+  }
+  
   auto const Right = GetRightLocation(Location).ToStdString();
   
   // Get the callback (first part of the path).
@@ -0,0 +1,38 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// seec-cc embeds this file's AST in the module. Replaying the trace with the
+// Clang mapping (seec-print -C) loads the embedded AST instead of reparsing.
+
+struct point {
+  int x;
+  int y;
+};
+
+static int sum(struct point const *points, size_t count)
+{
+  int total = 0;
+  for (size_t i = 0; i < count; ++i)
+    total += points[i].x * points[i].y;
+  return total;
+}
+
+int main(int argc, char *argv[])
+{
+  struct point *points = malloc(4 * sizeof(struct point));
+  if (!points)
+    return EXIT_FAILURE;
+
+  for (int i = 0; i < 4; ++i) {
+    points[i].x = i;
+    points[i].y = i + 1;
+  }
+
+  char name[16];
+  strcpy(name, "points");
+  printf("%s: %d\n", name, sum(points, 4));
+
+  free(points);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,33 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+char global[32] = "a global string";
+
+// Copies between buffers repeatedly, so that rebuilding the state of either
+// buffer from the trace must follow a long chain of copies back to global.
+int main(int argc, char *argv[])
+{
+  int n = atoi(argv[1]);
+  char a[32];
+  char b[32];
+
+  memcpy(a, global, sizeof(a));
+
+  for (int i = 0; i < n; ++i) {
+    char *p = malloc(sizeof(a));
+    if (!p)
+      return EXIT_FAILURE;
+
+    memcpy(p, a, sizeof(a));
+    memcpy(b, p, sizeof(b));
+    free(p);
+
+    b[i % sizeof(b)] = 'x';
+    memcpy(a, b, sizeof(a));
+  }
+
+  printf("%.*s\n", (int)sizeof(a), a);
+
+  return 0;
+}
@@ -0,0 +1,45 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define THREADS 4
+#define ITERATIONS 16
+
+// Worker threads repeatedly write into an array on the main thread's stack.
+// When the function that owns the array is rewound, the array's discarded
+// history must be rebuilt including the workers' writes, which come after
+// the main thread's own most recent process time.
+static void *work(void *arg)
+{
+  int *slice = arg;
+
+  for (int i = 0; i < ITERATIONS; ++i)
+    slice[i] += i + 1;
+
+  return NULL;
+}
+
+static long sum_of_writes(void)
+{
+  int values[THREADS * ITERATIONS] = {0};
+  pthread_t threads[THREADS];
+
+  for (int i = 0; i < THREADS; ++i)
+    if (pthread_create(&threads[i], NULL, work, &values[i * ITERATIONS]))
+      exit(EXIT_FAILURE);
+
+  for (int i = 0; i < THREADS; ++i)
+    pthread_join(threads[i], NULL);
+
+  long sum = 0;
+  for (int i = 0; i < THREADS * ITERATIONS; ++i)
+    sum += values[i];
+
+  return sum;
+}
+
+int main(int argc, char *argv[])
+{
+  printf("%ld\n", sum_of_writes());
+  return 0;
+}
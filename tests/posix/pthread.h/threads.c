@@ -0,0 +1,54 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define THREADS 4
+#define ITERATIONS 32
+
+// Each thread writes its own slice of this shared array, so that replay must
+// interleave the threads' stores with each other's allocations.
+static int shared[THREADS * ITERATIONS];
+
+static void *work(void *arg)
+{
+  int id = *(int *)arg;
+  int local[8];
+
+  for (int i = 0; i < ITERATIONS; ++i) {
+    local[i % 8] = id * ITERATIONS + i;
+
+    char *scratch = malloc(16 + id);
+    if (!scratch)
+      return NULL;
+
+    memset(scratch, 'a' + id, 16 + id);
+    shared[id * ITERATIONS + i] = local[i % 8] + scratch[i % 16];
+    free(scratch);
+  }
+
+  return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+  pthread_t threads[THREADS];
+  int ids[THREADS];
+
+  for (int i = 0; i < THREADS; ++i) {
+    ids[i] = i;
+    if (pthread_create(&threads[i], NULL, work, &ids[i]))
+      return EXIT_FAILURE;
+  }
+
+  for (int i = 0; i < THREADS; ++i)
+    pthread_join(threads[i], NULL);
+
+  long sum = 0;
+  for (int i = 0; i < THREADS * ITERATIONS; ++i)
+    sum += shared[i];
+
+  printf("%ld\n", sum);
+
+  return 0;
+}
@@ -19,3 +19,4 @@ shift
 "$program"    -R          $* 1>/dev/null
 "$program"    -S -reverse $* 1>/dev/null
 "$program" -C -S -reverse $* 1>/dev/null
+"$program"    -test-movement $* 1>/dev/null
@@ -0,0 +1,87 @@
+//===- tools/seec-bench/BenchReport.cpp -----------------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#include "seec/Util/Printing.hpp"
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "BenchReport.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <system_error>
+
+void BenchReport::add(llvm::StringRef Benchmark,
+                      llvm::StringRef Subject,
+                      llvm::StringRef Metric,
+                      double Value,
+                      llvm::StringRef Unit)
+{
+  Measurements.emplace_back(Measurement{Benchmark.str(),
+                                        Subject.str(),
+                                        Metric.str(),
+                                        Value,
+                                        Unit.str()});
+}
+
+void BenchReport::writeJSON(llvm::raw_ostream &Out) const
+{
+  using seec::util::writeJSONStringLiteral;
+
+  Out << "{\n  \"measurements\": [";
+
+  bool First = true;
+
+  for (auto const &M : Measurements) {
+    Out << (First ? "\n" : ",\n") << "    {\"benchmark\": ";
+    First = false;
+
+    writeJSONStringLiteral(M.Benchmark, Out);
+    Out << ", \"subject\": ";
+    writeJSONStringLiteral(M.Subject, Out);
+    Out << ", \"metric\": ";
+    writeJSONStringLiteral(M.Metric, Out);
+    Out << ", \"value\": ";
+
+    // Write counts exactly, and JSON has no representation for infinities or
+    // NaNs.
+    if (!std::isfinite(M.Value))
+      Out << "null";
+    else if (std::trunc(M.Value) == M.Value && std::fabs(M.Value) < 1e15)
+      Out << static_cast<int64_t>(M.Value);
+    else
+      Out << llvm::format("%.6g", M.Value);
+
+    Out << ", \"unit\": ";
+    writeJSONStringLiteral(M.Unit, Out);
+    Out << "}";
+  }
+
+  Out << "\n  ]\n}\n";
+}
+
+bool BenchReport::writeJSON(llvm::StringRef Path) const
+{
+  std::error_code EC;
+  llvm::raw_fd_ostream Stream {Path, EC, llvm::sys::fs::OpenFlags::F_Text};
+
+  if (EC) {
+    llvm::errs() << "couldn't open " << Path << ": " << EC.message() << "\n";
+    return false;
+  }
+
+  writeJSON(Stream);
+  return true;
+}
@@ -0,0 +1,75 @@
+//===- tools/seec-bench/BenchReport.hpp -----------------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef SEEC_BENCH_BENCHREPORT_HPP
+#define SEEC_BENCH_BENCHREPORT_HPP
+
+#include "llvm/ADT/StringRef.h"
+
+#include <string>
+#include <vector>
+
+namespace llvm {
+  class raw_ostream;
+}
+
+/// \brief Collects the measurements taken by benchmarks, so that they can be
+///        written as JSON and compared between releases.
+///
+class BenchReport {
+public:
+  /// \brief A single measurement.
+  ///
+  struct Measurement {
+    /// The benchmark that took this measurement (e.g. "trace").
+    std::string Benchmark;
+
+    /// What was measured (e.g. the name of a trace).
+    std::string Subject;
+
+    /// The quantity that was measured (e.g. "open-time").
+    std::string Metric;
+
+    double Value;
+
+    /// The unit of Value (e.g. "ms").
+    std::string Unit;
+  };
+
+private:
+  std::vector<Measurement> Measurements;
+
+public:
+  /// \brief Add a measurement.
+  ///
+  void add(llvm::StringRef Benchmark,
+           llvm::StringRef Subject,
+           llvm::StringRef Metric,
+           double Value,
+           llvm::StringRef Unit);
+
+  std::vector<Measurement> const &getMeasurements() const {
+    return Measurements;
+  }
+
+  /// \brief Write all measurements as a JSON document.
+  ///
+  void writeJSON(llvm::raw_ostream &Out) const;
+
+  /// \brief Write all measurements as a JSON document to a file.
+  /// \return true iff the file was written.
+  ///
+  bool writeJSON(llvm::StringRef Path) const;
+};
+
+#endif // SEEC_BENCH_BENCHREPORT_HPP
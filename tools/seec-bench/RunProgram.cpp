@@ -0,0 +1,244 @@
+//===- tools/seec-bench/RunProgram.cpp ------------------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/None.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/Support/Program.h"
+
+#include "RunProgram.hpp"
+
+#include <chrono>
+#include <vector>
+
+#if (defined(__unix__) || (defined(__APPLE__) && defined(__MACH__)))
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+extern "C" {
+  extern char **environ;
+}
+#endif
+
+/// \brief Get a null-terminated array of pointers to the given strings.
+///
+static std::vector<char const *>
+getPointers(llvm::ArrayRef<std::string> Strings)
+{
+  std::vector<char const *> Pointers;
+  Pointers.reserve(Strings.size() + 1);
+
+  for (auto const &String : Strings)
+    Pointers.push_back(String.c_str());
+
+  Pointers.push_back(nullptr);
+  return Pointers;
+}
+
+/// \brief Find the program to execute, searching PATH if \c Program is just a
+///        name (neither execve() nor ExecuteAndWait() search PATH).
+/// \return true iff the program was found.
+///
+static bool resolveProgram(llvm::StringRef Program,
+                           std::string &Resolved,
+                           std::string &Error)
+{
+  auto MaybePath = llvm::sys::findProgramByName(Program);
+  if (!MaybePath) {
+    Error = "couldn't find " + Program.str() + ": "
+            + MaybePath.getError().message();
+    return false;
+  }
+
+  Resolved = std::move(*MaybePath);
+  return true;
+}
+
+#if (defined(__unix__) || (defined(__APPLE__) && defined(__MACH__)))
+
+/// \brief Close a file descriptor when the program is executed.
+///
+static bool setCloseOnExec(int const FD)
+{
+  auto const Flags = fcntl(FD, F_GETFD);
+  return Flags != -1 && fcntl(FD, F_SETFD, Flags | FD_CLOEXEC) != -1;
+}
+
+// llvm::sys::ExecuteAndWait() doesn't report the child's resource usage, so
+// we fork and wait for the child ourselves.
+bool RunProgram(llvm::StringRef Program,
+                llvm::ArrayRef<std::string> Arguments,
+                llvm::ArrayRef<std::string> Environment,
+                ProgramUsage &Usage,
+                std::string &Error)
+{
+  std::string ProgramString;
+  if (!resolveProgram(Program, ProgramString, Error))
+    return false;
+
+  std::vector<std::string> AllArguments {Program.str()};
+  AllArguments.insert(AllArguments.end(), Arguments.begin(), Arguments.end());
+
+  auto const Args = getPointers(AllArguments);
+  auto const Env = getPointers(Environment);
+
+  // If execve() fails then the child writes errno to this pipe. Otherwise the
+  // pipe is closed by the successful execve(), and the parent reads nothing.
+  int ExecPipe[2];
+  if (pipe(ExecPipe) == -1) {
+    Error = std::strerror(errno);
+    return false;
+  }
+
+  if (!setCloseOnExec(ExecPipe[0]) || !setCloseOnExec(ExecPipe[1])) {
+    Error = std::strerror(errno);
+    close(ExecPipe[0]);
+    close(ExecPipe[1]);
+    return false;
+  }
+
+  auto const Start = std::chrono::steady_clock::now();
+
+  auto const Pid = fork();
+  if (Pid == -1) {
+    Error = std::strerror(errno);
+    close(ExecPipe[0]);
+    close(ExecPipe[1]);
+    return false;
+  }
+
+  if (Pid == 0) {
+    // Only async-signal-safe functions may be used in the child.
+    close(ExecPipe[0]);
+
+    auto const NullIn = open("/dev/null", O_RDONLY);
+    if (NullIn != -1) {
+      dup2(NullIn, STDIN_FILENO);
+      close(NullIn);
+    }
+
+    auto const NullOut = open("/dev/null", O_WRONLY);
+    if (NullOut != -1) {
+      dup2(NullOut, STDOUT_FILENO);
+      close(NullOut);
+    }
+
+    execve(ProgramString.c_str(),
+           const_cast<char * const *>(Args.data()),
+           Environment.empty() ? environ
+                               : const_cast<char * const *>(Env.data()));
+
+    int const ExecErrno = errno;
+    while (write(ExecPipe[1], &ExecErrno, sizeof(ExecErrno)) == -1
+           && errno == EINTR)
+      ;
+    _exit(127);
+  }
+
+  close(ExecPipe[1]);
+
+  int ExecErrno = 0;
+  ssize_t ExecRead;
+  while ((ExecRead = read(ExecPipe[0], &ExecErrno, sizeof(ExecErrno))) == -1
+         && errno == EINTR)
+    ;
+  close(ExecPipe[0]);
+
+  int Status = 0;
+  struct rusage ChildUsage;
+
+  while (wait4(Pid, &Status, 0, &ChildUsage) == -1) {
+    if (errno != EINTR) {
+      Error = std::strerror(errno);
+      return false;
+    }
+  }
+
+  if (ExecRead == sizeof(ExecErrno)) {
+    Error = "couldn't execute " + ProgramString + ": "
+            + std::strerror(ExecErrno);
+    return false;
+  }
+
+  auto const End = std::chrono::steady_clock::now();
+
+  Usage.Seconds = std::chrono::duration<double>(End - Start).count();
+
+#if defined(__APPLE__)
+  Usage.PeakRSS = ChildUsage.ru_maxrss; // bytes
+#else
+  Usage.PeakRSS = static_cast<uint64_t>(ChildUsage.ru_maxrss) * 1024;
+#endif
+
+  if (WIFSIGNALED(Status)) {
+    Error = "terminated by signal " + std::to_string(WTERMSIG(Status));
+    return false;
+  }
+
+  if (!WIFEXITED(Status) || WEXITSTATUS(Status) != 0) {
+    Error = "exited with status " + std::to_string(WEXITSTATUS(Status));
+    return false;
+  }
+
+  return true;
+}
+
+#else
+
+bool RunProgram(llvm::StringRef Program,
+                llvm::ArrayRef<std::string> Arguments,
+                llvm::ArrayRef<std::string> Environment,
+                ProgramUsage &Usage,
+                std::string &Error)
+{
+  std::string ProgramString;
+  if (!resolveProgram(Program, ProgramString, Error))
+    return false;
+
+  std::vector<std::string> AllArguments {Program.str()};
+  AllArguments.insert(AllArguments.end(), Arguments.begin(), Arguments.end());
+
+  auto Args = getPointers(AllArguments);
+  auto Env = getPointers(Environment);
+
+  // An empty path redirects to the null device.
+  llvm::Optional<llvm::StringRef> const Redirects[] = {
+    llvm::StringRef(""), llvm::StringRef(""), llvm::None
+  };
+
+  auto const Start = std::chrono::steady_clock::now();
+  auto const Result =
+    llvm::sys::ExecuteAndWait(ProgramString,
+                              Args.data(),
+                              Environment.empty() ? nullptr : Env.data(),
+                              Redirects,
+                              /* SecondsToWait */ 0,
+                              /* MemoryLimit */ 0,
+                              &Error);
+  auto const End = std::chrono::steady_clock::now();
+
+  Usage.Seconds = std::chrono::duration<double>(End - Start).count();
+  Usage.PeakRSS = 0;
+
+  if (Result != 0 && Error.empty())
+    Error = "exited with status " + std::to_string(Result);
+
+  return Result == 0;
+}
+
+#endif
@@ -0,0 +1,49 @@
+//===- tools/seec-bench/RunProgram.hpp ------------------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef SEEC_BENCH_RUNPROGRAM_HPP
+#define SEEC_BENCH_RUNPROGRAM_HPP
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <cstdint>
+#include <string>
+
+/// \brief Resources used by a program run.
+///
+struct ProgramUsage {
+  /// Wall time taken by the program.
+  double Seconds;
+
+  /// Peak resident set size of the program, in bytes, or zero if it could not
+  /// be measured on this platform.
+  uint64_t PeakRSS;
+};
+
+/// \brief Run a program to completion, with its standard input read from the
+///        null device and its standard output discarded.
+/// \param Program path to the program, or a name to search for in PATH.
+/// \param Arguments arguments for the program (not including the name).
+/// \param Environment the program's environment, or empty to inherit ours.
+/// \param Usage receives the resources used by the program.
+/// \param Error receives a description of any failure.
+/// \return true iff the program ran and exited with status zero.
+///
+bool RunProgram(llvm::StringRef Program,
+                llvm::ArrayRef<std::string> Arguments,
+                llvm::ArrayRef<std::string> Environment,
+                ProgramUsage &Usage,
+                std::string &Error);
+
+#endif // SEEC_BENCH_RUNPROGRAM_HPP
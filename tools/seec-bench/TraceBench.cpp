@@ -0,0 +1,326 @@
+//===- tools/seec-bench/TraceBench.cpp ------------------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#include "seec/Clang/GraphExpansion.hpp"
+#include "seec/Clang/GraphLayout.hpp"
+#include "seec/Clang/MappedProcessState.hpp"
+#include "seec/Clang/MappedProcessTrace.hpp"
+#include "seec/Clang/MappedStateMovement.hpp"
+#include "seec/ICU/Output.hpp"
+#include "seec/Trace/TraceReader.hpp"
+#include "seec/Util/Error.hpp"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "unicode/locid.h"
+
+#include "BenchReport.hpp"
+#include "RunProgram.hpp"
+#include "TraceBench.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point const Start)
+{
+  return std::chrono::duration<double>(Clock::now() - Start).count();
+}
+
+/// \brief Print a measurement and add it to the report.
+///
+void record(BenchReport &Report,
+            llvm::StringRef Subject,
+            llvm::StringRef Metric,
+            double const Value,
+            llvm::StringRef Unit)
+{
+  llvm::outs() << llvm::format("  %-24s %14.3f %s\n",
+                               Metric.str().c_str(),
+                               Value,
+                               Unit.str().c_str());
+
+  Report.add("trace", Subject, Metric, Value, Unit);
+}
+
+/// \brief Print a rate, unless no time was taken.
+///
+void recordRate(BenchReport &Report,
+                llvm::StringRef Subject,
+                llvm::StringRef Metric,
+                double const Count,
+                double const Seconds,
+                llvm::StringRef Unit)
+{
+  if (Seconds > 0)
+    record(Report, Subject, Metric, Count / Seconds, Unit);
+}
+
+void printError(seec::Error Error)
+{
+  UErrorCode Status = U_ZERO_ERROR;
+  llvm::errs() << "trace: " << Error.getMessage(Status, Locale()) << "\n";
+}
+
+/// \brief Times taken by repeated runs of an operation.
+///
+class Timings {
+  std::vector<double> Seconds;
+
+public:
+  void add(double const Value) { Seconds.push_back(Value); }
+
+  /// \brief Add the mean and maximum times (in milliseconds) to the report.
+  ///
+  void report(BenchReport &Report,
+              llvm::StringRef Subject,
+              llvm::StringRef Metric) const
+  {
+    if (Seconds.empty())
+      return;
+
+    double Total = 0;
+    for (auto const Value : Seconds)
+      Total += Value;
+
+    auto const Max = *std::max_element(Seconds.begin(), Seconds.end());
+
+    record(Report, Subject, (Metric + "-mean").str(),
+           Total / Seconds.size() * 1000.0, "ms");
+    record(Report, Subject, (Metric + "-max").str(), Max * 1000.0, "ms");
+  }
+};
+
+} // anonymous namespace
+
+bool RecordTrace(BenchReport &Report,
+                 llvm::StringRef Program,
+                 llvm::StringRef NativeProgram,
+                 llvm::ArrayRef<std::string> Arguments,
+                 llvm::StringRef TracePath,
+                 char const * const *Envp)
+{
+  auto const Subject = llvm::sys::path::stem(TracePath);
+
+  // Run the native build first, so that its time is the baseline.
+  ProgramUsage NativeUsage {};
+
+  if (!NativeProgram.empty()) {
+    llvm::outs() << "trace: running " << NativeProgram << "\n";
+
+    std::string Error;
+    if (!RunProgram(NativeProgram, Arguments, {}, NativeUsage, Error)) {
+      llvm::errs() << "trace: " << NativeProgram << " failed: " << Error
+                   << "\n";
+      return false;
+    }
+
+    record(Report, Subject, "native-time", NativeUsage.Seconds * 1000.0, "ms");
+    if (NativeUsage.PeakRSS)
+      record(Report, Subject, "native-peak-rss", NativeUsage.PeakRSS, "bytes");
+  }
+
+  llvm::outs() << "trace: recording " << TracePath << "\n";
+
+  // A relative SEEC_TRACE_NAME loses its directory, so use the absolute path.
+  llvm::SmallString<256> FullPath {TracePath};
+  llvm::sys::fs::make_absolute(FullPath);
+  llvm::sys::fs::remove(FullPath);
+
+  llvm::SmallString<256> CountsPath {FullPath};
+  CountsPath.append(".counts");
+  llvm::sys::fs::remove(CountsPath);
+
+  std::vector<std::string> Environment;
+  for (auto Var = Envp; Var && *Var; ++Var) {
+    llvm::StringRef const VarRef {*Var};
+    if (!VarRef.startswith("SEEC_TRACE_NAME=")
+        && !VarRef.startswith("SEEC_HOOK_COUNTS="))
+      Environment.emplace_back(VarRef.str());
+  }
+
+  Environment.emplace_back("SEEC_TRACE_NAME=" + FullPath.str().str());
+  Environment.emplace_back("SEEC_HOOK_COUNTS=" + CountsPath.str().str());
+
+  ProgramUsage Usage {};
+  std::string Error;
+
+  if (!RunProgram(Program, Arguments, Environment, Usage, Error)) {
+    llvm::errs() << "trace: " << Program << " failed: " << Error << "\n";
+    return false;
+  }
+
+  uint64_t Size = 0;
+  if (auto const EC = llvm::sys::fs::file_size(FullPath, Size)) {
+    llvm::errs() << "trace: couldn't read size of " << FullPath << ": "
+                 << EC.message() << "\n";
+    return false;
+  }
+
+  // The run time includes the program's own work, so this is the effective
+  // throughput seen by a user, rather than the raw speed of the writer.
+  record(Report, Subject, "record-time", Usage.Seconds * 1000.0, "ms");
+  if (Usage.PeakRSS)
+    record(Report, Subject, "record-peak-rss", Usage.PeakRSS, "bytes");
+  record(Report, Subject, "trace-size", Size, "bytes");
+  recordRate(Report, Subject, "write-throughput",
+             Size / 1e6, Usage.Seconds, "MB/s");
+
+  if (!NativeProgram.empty()) {
+    recordRate(Report, Subject, "slowdown",
+               Usage.Seconds, NativeUsage.Seconds, "x");
+    if (NativeUsage.PeakRSS && Usage.PeakRSS)
+      record(Report, Subject, "memory-overhead",
+             double(Usage.PeakRSS) / NativeUsage.PeakRSS, "x");
+  }
+
+  // Read the counts written by the tracer, which are "name count" lines.
+  auto MaybeCounts = llvm::MemoryBuffer::getFile(CountsPath);
+  if (!MaybeCounts) {
+    llvm::errs() << "trace: couldn't read " << CountsPath << ": "
+                 << MaybeCounts.getError().message() << "\n";
+    return false;
+  }
+
+  llvm::SmallVector<llvm::StringRef, 32> Lines;
+  (*MaybeCounts)->getBuffer().split(Lines, '\n', -1, false);
+
+  for (auto const Line : Lines) {
+    auto const Split = Line.split(' ');
+
+    uint64_t Count = 0;
+    if (Split.second.getAsInteger(10, Count))
+      continue;
+
+    record(Report, Subject, Split.first, Count,
+           Split.first == "trace-bytes" ? "bytes" : "count");
+
+    if (Split.first == "events")
+      recordRate(Report, Subject, "events-per-second",
+                 Count, Usage.Seconds, "events/s");
+  }
+
+  return true;
+}
+
+bool BenchTrace(BenchReport &Report,
+                llvm::StringRef TracePath,
+                unsigned const LayoutSamples)
+{
+  auto const Subject = llvm::sys::path::stem(TracePath);
+
+  llvm::outs() << "trace: " << TracePath << "\n";
+
+  // Open the trace. This includes the SeeC-Clang mapping, which must parse
+  // the program's source files.
+  auto const OpenStart = Clock::now();
+
+  auto MaybeIBA = seec::trace::InputBufferAllocator::createFor(TracePath);
+  if (MaybeIBA.assigned<seec::Error>()) {
+    printError(MaybeIBA.move<seec::Error>());
+    return false;
+  }
+
+  using seec::trace::InputBufferAllocator;
+  auto IBA = llvm::make_unique<InputBufferAllocator>
+                              (MaybeIBA.move<InputBufferAllocator>());
+
+  auto MaybeTrace = seec::cm::ProcessTrace::load(std::move(IBA));
+  if (MaybeTrace.assigned<seec::Error>()) {
+    printError(MaybeTrace.move<seec::Error>());
+    return false;
+  }
+
+  auto const Trace = MaybeTrace.move<0>();
+
+  record(Report, Subject, "open-time", secondsSince(OpenStart) * 1000.0, "ms");
+
+  // Construct the initial state.
+  auto const StateStart = Clock::now();
+  auto const State = llvm::make_unique<seec::cm::ProcessState>(*Trace);
+  record(Report, Subject, "state-construction",
+         secondsSince(StateStart) * 1000.0, "ms");
+
+  // Replay the whole trace in each direction.
+  uint64_t ForwardSteps = 0;
+  auto const ForwardStart = Clock::now();
+  while (seec::cm::moveForwardOneStep(*State)
+         != seec::cm::MovementResult::Unmoved)
+    ++ForwardSteps;
+  auto const ForwardSeconds = secondsSince(ForwardStart);
+
+  uint64_t BackwardSteps = 0;
+  auto const BackwardStart = Clock::now();
+  while (seec::cm::moveBackwardOneStep(*State)
+         != seec::cm::MovementResult::Unmoved)
+    ++BackwardSteps;
+  auto const BackwardSeconds = secondsSince(BackwardStart);
+
+  record(Report, Subject, "steps", ForwardSteps, "steps");
+  recordRate(Report, Subject, "forward-rate",
+             ForwardSteps, ForwardSeconds, "steps/s");
+  recordRate(Report, Subject, "backward-rate",
+             BackwardSteps, BackwardSeconds, "steps/s");
+
+  if (!LayoutSamples)
+    return true;
+
+  // Expand and lay out states evenly spaced through the trace. The layouts
+  // share a single handler, as they would when stepping in seec-view.
+  seec::cm::graph::LayoutHandler Handler;
+  Handler.addBuiltinLayoutEngines();
+
+  auto const Stride = std::max<uint64_t>(1, ForwardSteps / LayoutSamples);
+
+  Timings ExpansionTimes;
+  Timings LayoutTimes;
+  Timings LayeredLayoutTimes;
+  uint64_t Step = 0;
+
+  do {
+    if (Step++ % Stride != 0)
+      continue;
+
+    auto const ExpansionStart = Clock::now();
+    seec::cm::graph::Expansion::from(*State);
+    ExpansionTimes.add(secondsSince(ExpansionStart));
+
+    auto const LayoutStart = Clock::now();
+    Handler.doLayout(*State);
+    LayoutTimes.add(secondsSince(LayoutStart));
+
+    auto const LayeredLayoutStart = Clock::now();
+    Handler.doLayeredLayout(*State);
+    LayeredLayoutTimes.add(secondsSince(LayeredLayoutStart));
+  } while (seec::cm::moveForwardOneStep(*State)
+           != seec::cm::MovementResult::Unmoved);
+
+  ExpansionTimes.report(Report, Subject, "expansion");
+  LayoutTimes.report(Report, Subject, "layout");
+  LayeredLayoutTimes.report(Report, Subject, "layered-layout");
+
+  return true;
+}
@@ -0,0 +1,54 @@
+//===- tools/seec-bench/TraceBench.hpp ------------------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef SEEC_BENCH_TRACEBENCH_HPP
+#define SEEC_BENCH_TRACEBENCH_HPP
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <string>
+
+class BenchReport;
+
+/// \brief Record a trace by running an instrumented program, and measure the
+///        rate at which the trace was written and the notification counts
+///        reported by the tracer.
+/// \param Program path to the instrumented program.
+/// \param NativeProgram path to an uninstrumented build of the same program,
+///        which is run first to measure the tracing overhead, or empty.
+/// \param Arguments arguments for the programs.
+/// \param TracePath the trace file to write (any existing file is removed).
+/// \param Envp the environment for the instrumented program (SEEC_TRACE_NAME
+///        and SEEC_HOOK_COUNTS are replaced).
+/// \return true iff the programs ran successfully and the trace was written.
+///
+bool RecordTrace(BenchReport &Report,
+                 llvm::StringRef Program,
+                 llvm::StringRef NativeProgram,
+                 llvm::ArrayRef<std::string> Arguments,
+                 llvm::StringRef TracePath,
+                 char const * const *Envp);
+
+/// \brief Benchmark opening a trace, replaying it with SeeC-Clang mapped
+///        states, and the expansion and layout of graphs of its states.
+/// \param TracePath the trace file.
+/// \param LayoutSamples the number of states (evenly spaced through the
+///        trace) to expand and lay out, or zero to skip graph benchmarks.
+/// \return true iff the trace was opened and replayed.
+///
+bool BenchTrace(BenchReport &Report,
+                llvm::StringRef TracePath,
+                unsigned LayoutSamples);
+
+#endif // SEEC_BENCH_TRACEBENCH_HPP
@@ -0,0 +1,282 @@
+//===- tools/seec-bench/TraceSearchBench.cpp ------------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#include "seec/Trace/TraceFormat.hpp"
+#include "seec/Trace/TraceReader.hpp"
+#include "seec/Trace/TraceSearch.hpp"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "BenchReport.hpp"
+#include "TraceSearchBench.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <random>
+#include <vector>
+
+using namespace seec::trace;
+
+namespace {
+
+/// \brief Relative frequency and maximum run length of an event type in the
+///        synthetic stream.
+///
+struct EventMix {
+  EventType Type;
+  unsigned Weight;
+  unsigned MaxRun;
+};
+
+/// Approximates the event mix of a trace that frequently writes memory, so
+/// that runs of a single event type are short.
+EventMix const MemoryHeavyMix[] = {
+  {EventType::Instruction,           40, 16},
+  {EventType::InstructionWithUInt32, 15,  4},
+  {EventType::InstructionWithUInt64, 15,  4},
+  {EventType::InstructionWithPtr,    10,  2},
+  {EventType::StateTyped,            15,  1},
+  {EventType::StateUntypedSmall,      5,  1}
+};
+
+/// Approximates the event mix of a trace dominated by computation on values
+/// that do not need to be recorded, giving long runs of Instruction events.
+EventMix const ComputeHeavyMix[] = {
+  {EventType::Instruction,           70, 256},
+  {EventType::InstructionWithUInt64, 15,  64},
+  {EventType::InstructionWithUInt32,  5,   4},
+  {EventType::StateTyped,            10,   1}
+};
+
+/// Number of events in each block of the synthetic stream.
+constexpr uint64_t EventsPerBlock = 1u << 20;
+
+/// On average, one run in this many is replaced by a FunctionStart.
+constexpr unsigned CallFrequency = 4096;
+
+/// \brief Append a zeroed event record to a block buffer.
+///
+void appendRecord(std::vector<char> &Buffer,
+                  EventType const Type,
+                  uint8_t &PreviousSize)
+{
+  auto const Size = EventRecordBase(Type, 0).getEventSize();
+  auto const Offset = Buffer.size();
+
+  Buffer.resize(Offset + Size);
+  new (&Buffer[Offset]) EventRecordBase(Type, PreviousSize);
+
+  PreviousSize = static_cast<uint8_t>(Size);
+}
+
+/// \brief A thread event stream generated in memory.
+///
+class SyntheticEventStream {
+  /// Backing storage for each block (thread ID header followed by records).
+  std::vector<std::vector<char>> Buffers;
+
+  /// The blocks of the stream.
+  std::unique_ptr<ThreadEventBlockSequence> Sequence;
+
+public:
+  SyntheticEventStream(llvm::ArrayRef<EventMix> Mixes,
+                       uint64_t EventCount,
+                       uint64_t Seed)
+  : Buffers(),
+    Sequence()
+  {
+    std::mt19937_64 Random(Seed);
+
+    unsigned TotalWeight = 0;
+    for (auto const &Mix : Mixes)
+      TotalWeight += Mix.Weight;
+
+    uint32_t const ThreadID = 1;
+
+    while (EventCount) {
+      Buffers.emplace_back(sizeof(ThreadID));
+      auto &Buffer = Buffers.back();
+      std::memcpy(Buffer.data(), &ThreadID, sizeof(ThreadID));
+
+      auto InBlock = std::min(EventCount, EventsPerBlock);
+      EventCount -= InBlock;
+
+      uint8_t PreviousSize = 0;
+
+      while (InBlock) {
+        if (Random() % CallFrequency == 0) {
+          appendRecord(Buffer, EventType::FunctionStart, PreviousSize);
+          --InBlock;
+          continue;
+        }
+
+        auto Pick = static_cast<unsigned>(Random() % TotalWeight);
+        auto Mix = Mixes.begin();
+        while (Pick >= Mix->Weight)
+          Pick -= (Mix++)->Weight;
+
+        auto Run = std::min<uint64_t>(1 + Random() % Mix->MaxRun, InBlock);
+        InBlock -= Run;
+
+        while (Run--)
+          appendRecord(Buffer, Mix->Type, PreviousSize);
+      }
+    }
+
+    std::vector<InputBlock> Blocks;
+    for (auto const &Buffer : Buffers)
+      Blocks.emplace_back(BlockType::ThreadEvents,
+                          Buffer.data(),
+                          Buffer.data() + Buffer.size());
+
+    Sequence = llvm::make_unique<ThreadEventBlockSequence>(Blocks);
+  }
+
+  EventRange events() const { return *getRange(*Sequence); }
+};
+
+/// \brief Find all FunctionStart events using the given search function.
+/// \return the referenced events, in order.
+///
+template<typename FindFnT>
+std::vector<EventRecordBase const *>
+findAllCalls(EventRange const Range, FindFnT Find)
+{
+  std::vector<EventRecordBase const *> Found;
+  auto Remaining = Range;
+
+  while (true) {
+    auto const MaybeEv = Find(Remaining);
+    if (!MaybeEv.assigned())
+      break;
+
+    auto const &Ev = MaybeEv.template get<0>();
+    Found.push_back(&*Ev);
+    Remaining = rangeAfter(Remaining, Ev);
+  }
+
+  return Found;
+}
+
+/// \brief Time a function, printing the time taken and event throughput, and
+///        adding the throughput to the report.
+/// \return the result of the function.
+///
+template<typename FnT>
+auto timeBench(BenchReport &Report,
+               llvm::StringRef Subject,
+               llvm::StringRef Name,
+               uint64_t const EventCount,
+               FnT Fn)
+-> decltype(Fn())
+{
+  auto const Start = std::chrono::steady_clock::now();
+  auto Result = Fn();
+  auto const End = std::chrono::steady_clock::now();
+
+  auto const Seconds = std::chrono::duration<double>(End - Start).count();
+
+  llvm::outs() << llvm::format("  %-24s %10.3f ms %10.1f Mevents/s\n",
+                               Name.str().c_str(),
+                               Seconds * 1000.0,
+                               (EventCount / Seconds) / 1e6);
+
+  Report.add("trace-search", Subject, Name, (EventCount / Seconds) / 1e6,
+             "Mevents/s");
+
+  return Result;
+}
+
+/// \brief Benchmark searches over a synthetic stream with the given mix.
+/// \return true iff both searches gave identical results.
+///
+bool benchMix(BenchReport &Report,
+              llvm::StringRef Name,
+              llvm::ArrayRef<EventMix> Mixes,
+              uint64_t const EventCount,
+              uint64_t const Seed)
+{
+  llvm::outs() << "trace-search: generating " << EventCount << " events ("
+               << Name << ")\n";
+
+  SyntheticEventStream const Stream(Mixes, EventCount, Seed);
+  auto const Range = Stream.events();
+
+  bool Identical = true;
+
+  // Search for an event that does not occur, which scans the whole stream.
+  llvm::outs() << "trace-search: absent event type\n";
+
+  auto const Absent = (Name + "-absent").str();
+
+  auto const LinearAbsent =
+    timeBench(Report, Absent, "findLinear", EventCount, [=] () {
+      return findLinear<EventType::RuntimeError>(Range).assigned();
+    });
+
+  auto const ScanAbsent =
+    timeBench(Report, Absent, "find", EventCount, [=] () {
+      return find<EventType::RuntimeError>(Range).assigned();
+    });
+
+  if (LinearAbsent || ScanAbsent)
+    Identical = false;
+
+  // Find each of the sparse FunctionStart events in turn.
+  llvm::outs() << "trace-search: sparse event type\n";
+
+  auto const Sparse = (Name + "-sparse").str();
+
+  auto const LinearCalls =
+    timeBench(Report, Sparse, "findLinear", EventCount, [=] () {
+      return findAllCalls(Range, [] (EventRange R) {
+        return findLinear<EventType::FunctionStart>(R);
+      });
+    });
+
+  auto const ScanCalls =
+    timeBench(Report, Sparse, "find", EventCount, [=] () {
+      return findAllCalls(Range, [] (EventRange R) {
+        return find<EventType::FunctionStart>(R);
+      });
+    });
+
+  if (LinearCalls != ScanCalls)
+    Identical = false;
+
+  llvm::outs() << "trace-search: found " << ScanCalls.size() << " calls, "
+               << (Identical ? "results identical" : "RESULTS DIFFER") << "\n";
+
+  return Identical;
+}
+
+} // anonymous namespace
+
+bool BenchTraceSearch(BenchReport &Report,
+                      uint64_t const EventCount,
+                      uint64_t const Seed)
+{
+  bool Identical = true;
+
+  Identical &= benchMix(Report, "memory-heavy", MemoryHeavyMix,
+                        EventCount, Seed);
+  Identical &= benchMix(Report, "compute-heavy", ComputeHeavyMix,
+                        EventCount, Seed);
+
+  return Identical;
+}
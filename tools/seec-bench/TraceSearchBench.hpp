@@ -0,0 +1,29 @@
+//===- tools/seec-bench/TraceSearchBench.hpp ------------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef SEEC_BENCH_TRACESEARCHBENCH_HPP
+#define SEEC_BENCH_TRACESEARCHBENCH_HPP
+
+#include <cstdint>
+
+class BenchReport;
+
+/// \brief Benchmark seec::trace::find() against seec::trace::findLinear() on a
+///        synthetic thread event stream.
+/// \param EventCount the number of events in the synthetic stream.
+/// \param Seed seed for generating the synthetic stream.
+/// \return true iff both searches gave identical results.
+///
+bool BenchTraceSearch(BenchReport &Report, uint64_t EventCount, uint64_t Seed);
+
+#endif // SEEC_BENCH_TRACESEARCHBENCH_HPP
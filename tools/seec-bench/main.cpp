@@ -0,0 +1,157 @@
+//===- tools/seec-bench/main.cpp ------------------------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#include "seec/ICU/Resources.hpp"
+#include "seec/Util/Resources.hpp"
+#include "seec/wxWidgets/Config.hpp"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/Signals.h"
+
+#include "BenchReport.hpp"
+#include "TraceBench.hpp"
+#include "TraceSearchBench.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+
+using namespace llvm;
+
+namespace seec {
+  namespace bench {
+    cl::opt<bool>
+    TraceSearch("trace-search", cl::desc("benchmark searching event streams"));
+
+    cl::opt<unsigned long long>
+    SyntheticEvents("synthetic-events",
+                    cl::desc("number of events in synthetic event streams"),
+                    cl::init(100000000));
+
+    cl::opt<unsigned long long>
+    Seed("seed", cl::desc("seed for generating synthetic data"),
+         cl::init(0x5eec));
+
+    cl::list<std::string>
+    Traces(cl::Positional, cl::desc("<traces to benchmark>"));
+
+    cl::opt<std::string>
+    RecordProgram("record",
+                  cl::desc("record the trace by running this instrumented "
+                           "program"));
+
+    cl::list<std::string>
+    RecordArguments("record-args", cl::CommaSeparated,
+                    cl::desc("arguments for the -record program"));
+
+    cl::opt<std::string>
+    NativeProgram("native",
+                  cl::desc("run this native build of the -record program "
+                           "first, to measure tracing overhead"));
+
+    cl::opt<bool>
+    Replay("replay",
+           cl::desc("benchmark replaying the traces (default: true)"),
+           cl::init(true));
+
+    cl::opt<unsigned>
+    LayoutSamples("layout-samples",
+                  cl::desc("number of states in each trace to lay out "
+                           "(0 to skip graph benchmarks)"),
+                  cl::init(50));
+
+    cl::opt<std::string>
+    JSONOutput("json", cl::desc("write all measurements to this JSON file"));
+  }
+}
+
+using namespace seec::bench;
+
+// From clang's driver.cpp:
+std::string GetExecutablePath(const char *Argv0, bool CanonicalPrefixes) {
+  if (!CanonicalPrefixes)
+    return Argv0;
+
+  // This just needs to be some symbol in the binary; C++ doesn't
+  // allow taking the address of ::main however.
+  void *P = (void*) (intptr_t) GetExecutablePath;
+  return llvm::sys::fs::getMainExecutable(Argv0, P);
+}
+
+int main(int argc, char **argv, char * const *envp) {
+  sys::PrintStackTraceOnErrorSignal(argv[0]);
+  PrettyStackTraceProgram X(argc, argv);
+
+  atexit(llvm_shutdown);
+
+  cl::ParseCommandLineOptions(argc, argv, "seec benchmarks\n");
+
+  if (!RecordProgram.empty() && Traces.size() != 1) {
+    llvm::errs() << "-record requires a single trace to write\n";
+    return EXIT_FAILURE;
+  }
+
+  if (!NativeProgram.empty() && RecordProgram.empty()) {
+    llvm::errs() << "-native requires -record\n";
+    return EXIT_FAILURE;
+  }
+
+  BenchReport Report;
+  bool Success = true;
+
+  if (TraceSearch) {
+    Success &= BenchTraceSearch(Report, SyntheticEvents, Seed);
+  }
+
+  if (!Traces.empty()) {
+    // Setup resource loading, which is required to read traces.
+    auto const ExecutablePath = GetExecutablePath(argv[0], true);
+    auto const ResourcePath = seec::getResourceDirectory(ExecutablePath);
+    seec::ResourceLoader Resources(ResourcePath);
+
+    std::array<char const *, 3> ResourceList {
+      {"RuntimeErrors", "SeeCClang", "Trace"}
+    };
+
+    if (!Resources.loadResources(ResourceList)) {
+      llvm::errs() << "failed to load resources\n";
+      return EXIT_FAILURE;
+    }
+
+    // Setup a dummy wxApp to enable reading trace archives.
+    seec::setupDummyAppConsole();
+
+    bool Recorded = true;
+
+    if (!RecordProgram.empty()) {
+      Recorded = RecordTrace(Report, RecordProgram, NativeProgram,
+                             RecordArguments, Traces.front(), envp);
+      Success &= Recorded;
+    }
+
+    if (Recorded && Replay) {
+      for (auto const &Trace : Traces)
+        Success &= BenchTrace(Report, Trace, LayoutSamples);
+    }
+  }
+
+  if (!JSONOutput.empty()) {
+    Success &= Report.writeJSON(JSONOutput);
+  }
+
+  return Success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,495 @@
+//===- tools/seec-trace-print/BatchRender.cpp -----------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#include "seec/Clang/GraphLayout.hpp"
+#include "seec/Clang/MappedProcessState.hpp"
+#include "seec/Clang/MappedProcessTrace.hpp"
+#include "seec/Clang/MappedStateMovement.hpp"
+#include "seec/Util/ScopeExit.hpp"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "BatchRender.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace seec;
+using namespace llvm;
+
+namespace seec {
+  namespace trace_print {
+    extern cl::opt<bool> Quiet;
+
+    extern cl::opt<std::string> OutputDirectoryForRender;
+
+    extern cl::opt<std::string> RenderFormat;
+
+    extern cl::opt<bool> RenderWithBuiltinLayout;
+
+    extern cl::opt<unsigned> RenderJobs;
+  }
+}
+
+using namespace seec::trace_print;
+
+namespace {
+
+/// \brief A state that has been laid out, waiting to be rendered.
+///
+struct Frame {
+  /// Number of this frame (starting at 1, in replay order).
+  long Number;
+
+  /// The graph in dot format (if it must be rendered by dot).
+  std::string DotString;
+
+  /// The rendered graph (if it was rendered by the builtin layout engine).
+  std::string SVGString;
+
+  /// Time taken to move to this state.
+  std::chrono::nanoseconds ReplayTime;
+
+  /// Time taken to lay out this state.
+  std::chrono::nanoseconds LayoutTime;
+};
+
+/// \brief The result of rendering a single frame.
+///
+struct FrameResult {
+  std::chrono::nanoseconds ReplayTime;
+
+  std::chrono::nanoseconds LayoutTime;
+
+  std::chrono::nanoseconds RenderTime;
+
+  /// A description of the failure, or empty if the frame was rendered.
+  std::string Error;
+};
+
+/// \brief Frames that have been laid out but not yet rendered.
+///
+/// The queue is bounded so that replay can't get far ahead of rendering (each
+/// queued frame holds a complete graph).
+///
+class FrameQueue {
+  std::deque<Frame> Frames;
+
+  std::size_t const Limit;
+
+  bool Closed;
+
+  std::mutex Access;
+
+  std::condition_variable NotEmpty;
+
+  std::condition_variable NotFull;
+
+public:
+  FrameQueue(std::size_t const WithLimit)
+  : Frames(),
+    Limit(WithLimit),
+    Closed(false),
+    Access(),
+    NotEmpty(),
+    NotFull()
+  {}
+
+  /// \brief Add a frame, waiting until there is space in the queue.
+  ///
+  void push(Frame F) {
+    std::unique_lock<std::mutex> Lock(Access);
+    NotFull.wait(Lock, [this] () { return Frames.size() < Limit; });
+    Frames.emplace_back(std::move(F));
+    NotEmpty.notify_one();
+  }
+
+  /// \brief Indicate that no more frames will be added.
+  ///
+  void close() {
+    std::lock_guard<std::mutex> Lock(Access);
+    Closed = true;
+    NotEmpty.notify_all();
+  }
+
+  /// \brief Take the oldest frame, waiting until one is available.
+  /// \return false iff the queue is closed and empty.
+  ///
+  bool pop(Frame &Out) {
+    std::unique_lock<std::mutex> Lock(Access);
+    NotEmpty.wait(Lock, [this] () { return Closed || !Frames.empty(); });
+
+    if (Frames.empty())
+      return false;
+
+    Out = std::move(Frames.front());
+    Frames.pop_front();
+    NotFull.notify_one();
+    return true;
+  }
+};
+
+/// \brief Reports the results of frames in order, as they are completed.
+///
+class FrameReporter {
+  /// Completed frames that can't be reported until earlier frames are done.
+  std::map<long, FrameResult> Pending;
+
+  /// The next frame to report.
+  long Next;
+
+  /// Totals for all reported frames.
+  FrameResult Total;
+
+  /// Number of frames that failed.
+  long Failures;
+
+  std::mutex Access;
+
+  static double toMilliseconds(std::chrono::nanoseconds const Time) {
+    return std::chrono::duration<double, std::milli>(Time).count();
+  }
+
+  void report(long const Number, FrameResult const &Result) {
+    Total.ReplayTime += Result.ReplayTime;
+    Total.LayoutTime += Result.LayoutTime;
+    Total.RenderTime += Result.RenderTime;
+
+    if (!Result.Error.empty()) {
+      ++Failures;
+      llvm::errs() << "state " << Number << ": " << Result.Error << "\n";
+    }
+
+    if (Quiet)
+      return;
+
+    llvm::outs() << "state " << Number << ": replay "
+                 << format("%.1f", toMilliseconds(Result.ReplayTime))
+                 << " ms, layout "
+                 << format("%.1f", toMilliseconds(Result.LayoutTime))
+                 << " ms, render "
+                 << format("%.1f", toMilliseconds(Result.RenderTime))
+                 << " ms\n";
+  }
+
+public:
+  FrameReporter()
+  : Pending(),
+    Next(1),
+    Total(),
+    Failures(0),
+    Access()
+  {}
+
+  /// \brief Record the result of a frame, and report all frames that are now
+  ///        complete.
+  ///
+  void complete(long const Number, FrameResult Result) {
+    std::lock_guard<std::mutex> Lock(Access);
+
+    Pending.insert(std::make_pair(Number, std::move(Result)));
+
+    for (auto It = Pending.begin();
+         It != Pending.end() && It->first == Next;
+         It = Pending.erase(It), ++Next)
+    {
+      report(It->first, It->second);
+    }
+  }
+
+  /// \brief Report the totals for all frames.
+  ///
+  void summarize(std::chrono::nanoseconds const WallTime,
+                 unsigned const Workers)
+  {
+    std::lock_guard<std::mutex> Lock(Access);
+
+    auto const Frames = Next - 1;
+
+    llvm::outs() << "rendered " << (Frames - Failures) << " of " << Frames
+                 << " states with " << Workers << " workers in "
+                 << format("%.1f", toMilliseconds(WallTime)) << " ms\n"
+                 << "  replay: "
+                 << format("%.1f", toMilliseconds(Total.ReplayTime)) << " ms\n"
+                 << "  layout: "
+                 << format("%.1f", toMilliseconds(Total.LayoutTime)) << " ms\n"
+                 << "  render: "
+                 << format("%.1f", toMilliseconds(Total.RenderTime))
+                 << " ms (total of all workers)\n";
+  }
+
+  /// \brief Get the number of frames that failed.
+  ///
+  long getFailureCount() {
+    std::lock_guard<std::mutex> Lock(Access);
+    return Failures;
+  }
+};
+
+/// \brief Renders frames to files in the output directory.
+///
+class FrameRenderer {
+  /// The output directory.
+  std::string Directory;
+
+  /// The output format (and file extension).
+  std::string Format;
+
+  /// The location of the dot executable (if required).
+  std::string PathToDot;
+
+  /// \brief Get the path of an output file for a frame.
+  ///
+  std::string getPath(long const Number, llvm::StringRef Extension) const {
+    llvm::SmallString<256> Path (Directory);
+    llvm::sys::path::append(Path,
+                            "state." + std::to_string(Number) + "."
+                            + Extension.str());
+    return Path.str().str();
+  }
+
+  /// \brief Write a string to a file.
+  /// \return a description of the failure, or an empty string.
+  ///
+  static std::string writeFile(std::string const &Path,
+                               std::string const &Contents)
+  {
+    std::error_code EC;
+    llvm::raw_fd_ostream Stream {Path, EC, llvm::sys::fs::OpenFlags::F_Text};
+
+    if (EC)
+      return "couldn't open " + Path + ": " + EC.message();
+
+    Stream << Contents;
+    Stream.close();
+
+    if (Stream.has_error()) {
+      Stream.clear_error();
+      return "couldn't write " + Path;
+    }
+
+    return std::string{};
+  }
+
+  /// \brief Render a dot graph using the dot executable.
+  /// \return a description of the failure, or an empty string.
+  ///
+  std::string renderWithDot(Frame const &F) const {
+    // Write the graph to a temporary file.
+    llvm::SmallString<256> GraphPath;
+
+    {
+      int GraphFD;
+      auto const GraphErr =
+        llvm::sys::fs::createTemporaryFile("seecgraph", "dot",
+                                           GraphFD,
+                                           GraphPath);
+
+      if (GraphErr)
+        return "couldn't create temporary dot file: " + GraphErr.message();
+
+      llvm::raw_fd_ostream GraphStream(GraphFD, true);
+      GraphStream << F.DotString;
+    }
+
+    auto const RemoveGraph = seec::scopeExit([&] () {
+                                bool Existed = false;
+                                llvm::sys::fs::remove(GraphPath.str(),
+                                                      Existed);
+                              });
+
+    auto const OutputPath = getPath(F.Number, Format);
+    auto const FormatArg = "-T" + Format;
+
+    char const *Args[] = {
+      "dot",
+      "-Gfontnames=svg",
+      "-o",
+      OutputPath.c_str(),
+      FormatArg.c_str(),
+      GraphPath.c_str(),
+      nullptr
+    };
+
+    std::string ErrorMsg;
+    auto const Result = llvm::sys::ExecuteAndWait(PathToDot, Args,
+                                                  /* env */ nullptr,
+                                                  /* redirects */ {},
+                                                  /* wait */ 0,
+                                                  /* mem */ 0,
+                                                  &ErrorMsg);
+
+    if (!ErrorMsg.empty())
+      return "dot failed: " + ErrorMsg;
+
+    if (Result)
+      return "dot returned " + std::to_string(Result);
+
+    return std::string{};
+  }
+
+public:
+  FrameRenderer(std::string WithDirectory,
+                std::string WithFormat,
+                std::string WithPathToDot)
+  : Directory(std::move(WithDirectory)),
+    Format(std::move(WithFormat)),
+    PathToDot(std::move(WithPathToDot))
+  {}
+
+  /// \brief Render a single frame.
+  /// \return a description of the failure, or an empty string.
+  ///
+  std::string render(Frame const &F) const {
+    if (!F.SVGString.empty())
+      return writeFile(getPath(F.Number, "svg"), F.SVGString);
+
+    // An empty layout would make dot render an empty file, and the builtin
+    // layout has no dot to fall back to.
+    if (F.DotString.empty() || PathToDot.empty())
+      return "layout produced no graph";
+
+    return renderWithDot(F);
+  }
+};
+
+} // anonymous namespace
+
+/// \brief Get the time elapsed since \c Start.
+///
+static std::chrono::nanoseconds
+getTimeSince(std::chrono::steady_clock::time_point const Start)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>
+                                   (std::chrono::steady_clock::now() - Start);
+}
+
+long RenderClangMappedStates(seec::cm::ProcessTrace const &Trace)
+{
+  typedef std::chrono::steady_clock Clock;
+
+  // Check the rendering settings.
+  std::string PathToDot;
+
+  if (RenderWithBuiltinLayout) {
+    if (RenderFormat != "svg") {
+      llvm::errs() << "The builtin layout engine only renders svg.\n";
+      exit(EXIT_FAILURE);
+    }
+  }
+  else {
+    auto MaybeDot = llvm::sys::findProgramByName("dot");
+    if (!MaybeDot) {
+      llvm::errs() << "Couldn't find dot: " << MaybeDot.getError().message()
+                   << "\n";
+      exit(EXIT_FAILURE);
+    }
+
+    PathToDot = std::move(*MaybeDot);
+  }
+
+  bool Existed = false;
+  auto const Err =
+    llvm::sys::fs::create_directories(OutputDirectoryForRender.getValue(),
+                                      Existed);
+
+  if (Err) {
+    llvm::errs() << "Couldn't create output directory: "
+                 << Err.message() << "\n";
+    exit(EXIT_FAILURE);
+  }
+
+  auto const WorkerCount = RenderJobs ? RenderJobs.getValue()
+                                      : std::max(1u,
+                                          std::thread::hardware_concurrency());
+
+  FrameRenderer const Renderer(OutputDirectoryForRender,
+                               RenderFormat,
+                               PathToDot);
+  FrameQueue Queue(WorkerCount * 2);
+  FrameReporter Reporter;
+
+  auto const TimeStart = Clock::now();
+
+  // Start the rendering workers.
+  std::vector<std::thread> Workers;
+
+  for (unsigned i = 0; i < WorkerCount; ++i) {
+    Workers.emplace_back([&] () {
+      Frame F;
+
+      while (Queue.pop(F)) {
+        auto const RenderStart = Clock::now();
+        auto Error = Renderer.render(F);
+
+        Reporter.complete(F.Number,
+                          FrameResult{F.ReplayTime,
+                                      F.LayoutTime,
+                                      getTimeSince(RenderStart),
+                                      std::move(Error)});
+      }
+    });
+  }
+
+  // Replay and layout each state on this thread. Layout is internally
+  // parallel, and only the state being laid out needs to exist. The builtin
+  // engine also renders the SVG here, because it places each state's nodes
+  // relative to the previous state, so the workers only write those files.
+  seec::cm::ProcessState State(Trace);
+  seec::cm::graph::LayoutHandler Handler;
+  Handler.addBuiltinLayoutEngines();
+
+  long Number = 1;
+  auto ReplayStart = Clock::now();
+
+  while (true) {
+    auto const ReplayTime = getTimeSince(ReplayStart);
+
+    auto Layout = RenderWithBuiltinLayout ? Handler.doLayeredLayout(State)
+                                          : Handler.doLayout(State);
+
+    Queue.push(Frame{Number++,
+                     Layout.getDotString(),
+                     Layout.getSVGString(),
+                     ReplayTime,
+                     Layout.getTimeTaken()});
+
+    ReplayStart = Clock::now();
+    auto const Moved = seec::cm::moveForwardOneStep(State);
+    if (Moved == seec::cm::MovementResult::Unmoved)
+      break;
+  }
+
+  Queue.close();
+
+  for (auto &Worker : Workers)
+    Worker.join();
+
+  Reporter.summarize(getTimeSince(TimeStart), WorkerCount);
+
+  return Reporter.getFailureCount();
+}
@@ -0,0 +1,33 @@
+//===- tools/seec-trace-print/BatchRender.hpp -----------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef SEEC_TRACE_PRINT_BATCHRENDER_HPP
+#define SEEC_TRACE_PRINT_BATCHRENDER_HPP
+
+namespace seec {
+  namespace cm {
+    class ProcessTrace;
+  }
+}
+
+/// \brief Render graphs of every state in a trace to image files.
+///
+/// States are replayed (and laid out) by the calling thread, and rendered by
+/// a pool of worker threads. The frames are numbered in replay order, and the
+/// timing of each frame is reported in that order.
+///
+/// \return the number of frames that failed to render.
+///
+long RenderClangMappedStates(seec::cm::ProcessTrace const &Trace);
+
+#endif // SEEC_TRACE_PRINT_BATCHRENDER_HPP
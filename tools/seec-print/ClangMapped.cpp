@@ -53,6 +53,7 @@
 
 #include "unicode/unistr.h"
 
+#include "BatchRender.hpp"
 #include "Unmapped.hpp"
 
 #include <array>
@@ -73,6 +74,8 @@ namespace seec {
 
     extern cl::opt<bool> TestGraphGeneration;
 
+    extern cl::opt<std::string> OutputDirectoryForRender;
+
     extern cl::opt<bool> ShowCounts;
 
     extern cl::opt<bool> ShowRawEvents;
@@ -106,22 +109,6 @@ void WriteDotGraph(seec::cm::ProcessState const &State,
   Stream << DotString;
 }
 
-namespace {
-
-seec::cm::MovementResult moveForwardOneStep(seec::cm::ProcessState &State) {
-  return State.getThreadCount() == 1
-    ? seec::cm::moveForward(State.getThread(0))
-    : seec::cm::moveForward(State);
-}
-
-seec::cm::MovementResult moveBackwardOneStep(seec::cm::ProcessState &State) {
-  return State.getThreadCount() == 1
-    ? seec::cm::moveBackward(State.getThread(0))
-    : seec::cm::moveBackward(State);
-}
-
-}
-
 void PrintClangMappedStates(seec::cm::ProcessTrace const &Trace,
                             seec::AugmentationCollection const &Augmentations)
 {
@@ -183,10 +170,12 @@ void PrintClangMappedStates(seec::cm::ProcessTrace const &Trace,
         llvm::sys::path::remove_filename(OutputForDot);
       }
     }
-  } while (moveForwardOneStep(State) != seec::cm::MovementResult::Unmoved);
+  } while (seec::cm::moveForwardOneStep(State)
+           != seec::cm::MovementResult::Unmoved);
 
   if (ReverseStates) {
-    while (moveBackwardOneStep(State) != seec::cm::MovementResult::Unmoved)
+    while (seec::cm::moveBackwardOneStep(State)
+           != seec::cm::MovementResult::Unmoved)
     {
       llvm::outs() << State << "\n";
     }
@@ -220,7 +209,11 @@ void PrintClangMapped(seec::AugmentationCollection const &Augmentations,
 
   auto CMProcessTrace = CMProcessTraceLoad.move<0>();
 
-  if (ShowStates) {
+  if (!OutputDirectoryForRender.empty()) {
+    if (RenderClangMappedStates(*CMProcessTrace) > 0)
+      exit(EXIT_FAILURE);
+  }
+  else if (ShowStates) {
     PrintClangMappedStates(*CMProcessTrace, Augmentations);
   }
   else if (OnlinePythonTutor) {
@@ -16,6 +16,7 @@
 #include "seec/Clang/MappedProcessState.hpp"
 #include "seec/Clang/MappedProcessTrace.hpp"
 #include "seec/Clang/MappedStateMovement.hpp"
+#include "seec/DSA/MemoryArea.hpp"
 #include "seec/ICU/Output.hpp"
 #include "seec/ICU/Resources.hpp"
 #include "seec/RuntimeErrors/RuntimeErrors.hpp"
@@ -35,6 +36,7 @@
 #include "clang/Basic/SourceManager.h"
 #include "clang/Frontend/TextDiagnosticPrinter.h"
 
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
@@ -57,6 +59,7 @@
 #include <memory>
 #include <system_error>
 #include <type_traits>
+#include <vector>
 
 using namespace seec;
 using namespace llvm;
@@ -86,6 +89,8 @@ namespace seec {
     extern cl::opt<bool> Quiet;
 
     extern cl::opt<bool> TestMovement;
+
+    extern cl::opt<unsigned> MemoryHistoryLimit;
   }
 }
 
@@ -105,6 +110,106 @@ void PrintUnmappedState(seec::trace::ProcessState const &State)
   }
 }
 
+/// \brief Get a hash of a state, including the contents of memory.
+///
+/// This is used to check that different kinds of movement recreate the same
+/// states.
+///
+static llvm::hash_code
+HashUnmappedState(seec::trace::ProcessState const &State)
+{
+  std::string Comparable;
+  {
+    llvm::raw_string_ostream Stream(Comparable);
+    seec::trace::printComparable(Stream, State);
+  }
+
+  auto Hash = llvm::hash_value(Comparable);
+
+  for (auto const &Alloc : State.getMemory().getAllocations()) {
+    auto const Area = MemoryArea(Alloc.getAddress(), Alloc.getSize());
+    auto const Data = Alloc.getAreaData(Area);
+    auto const Init = Alloc.getAreaInitialization(Area);
+    Hash = llvm::hash_combine(Hash,
+                              Alloc.getAddress(),
+                              Alloc.getSize(),
+                              llvm::hash_combine_range(Data.begin(),
+                                                       Data.end()),
+                              llvm::hash_combine_range(Init.begin(),
+                                                       Init.end()));
+  }
+
+  return Hash;
+}
+
+/// \brief Exit with an error if a movement did not recreate the state that
+///        serial movement recreated.
+///
+static void CheckMovement(seec::trace::ProcessState const &State,
+                          llvm::hash_code const Expected,
+                          char const * const Movement)
+{
+  if (HashUnmappedState(State) == Expected)
+    return;
+
+  llvm::errs() << "test-movement: " << Movement
+               << " recreated a different state at process time "
+               << State.getProcessTime() << "\n";
+  exit(EXIT_FAILURE);
+}
+
+/// \brief Check bulk movement against serial movement.
+///
+static void TestUnmappedMovement(std::shared_ptr<trace::ProcessTrace> Trace,
+                                 std::shared_ptr<ModuleIndex> ModIndexPtr)
+{
+  // Recreate the reference states by moving one process time at a time.
+  trace::ProcessState Serial{Trace, ModIndexPtr};
+  std::vector<llvm::hash_code> States { HashUnmappedState(Serial) };
+
+  while (moveForward(Serial) != trace::MovementResult::Unmoved)
+    States.push_back(HashUnmappedState(Serial));
+
+  auto const Start = States.front();
+  auto const End = States.back();
+
+  while (moveBackward(Serial) != trace::MovementResult::Unmoved)
+    continue;
+  CheckMovement(Serial, Start, "moveBackward");
+
+  trace::ProcessState ProcState{Trace, ModIndexPtr};
+  if (MemoryHistoryLimit)
+    ProcState.setMemoryHistoryLimit(MemoryHistoryLimit);
+
+  moveForwardUntil(ProcState,
+                   [] (trace::ProcessState const &) { return false; });
+  CheckMovement(ProcState, End, "moveForwardUntil");
+
+  moveBackwardUntil(ProcState,
+                    [] (trace::ProcessState const &) { return false; });
+  CheckMovement(ProcState, Start, "moveBackwardUntil");
+
+  moveForwardToEnd(ProcState);
+  CheckMovement(ProcState, End, "moveForwardToEnd");
+
+  moveBackwardToStart(ProcState);
+  CheckMovement(ProcState, Start, "moveBackwardToStart");
+
+  // States that were discarded to stay within the history limit are rebuilt
+  // from the trace, so check every state when moving one step at a time.
+  if (MemoryHistoryLimit) {
+    for (std::size_t i = 1; i < States.size(); ++i) {
+      moveForward(ProcState);
+      CheckMovement(ProcState, States[i], "moveForward");
+    }
+
+    for (std::size_t i = States.size() - 1; i > 0; --i) {
+      moveBackward(ProcState);
+      CheckMovement(ProcState, States[i - 1], "moveBackward");
+    }
+  }
+}
+
 void PrintUnmapped(seec::AugmentationCollection const &Augmentations)
 {
   llvm::LLVMContext Context{};
@@ -211,6 +316,9 @@ void PrintUnmapped(seec::AugmentationCollection const &Augmentations)
     outs() << "Recreating states:\n";
 
     trace::ProcessState ProcState{Trace, ModIndexPtr};
+    if (MemoryHistoryLimit)
+      ProcState.setMemoryHistoryLimit(MemoryHistoryLimit);
+
     PrintUnmappedState(ProcState);
 
     while (ProcState.getProcessTime() != Trace->getFinalProcessTime()) {
@@ -227,14 +335,8 @@ void PrintUnmapped(seec::AugmentationCollection const &Augmentations)
   }
 
   // Test state movement only.
-  if (TestMovement) {
-    trace::ProcessState ProcState{Trace, ModIndexPtr};
-    moveForwardUntil(ProcState,
-                     [] (trace::ProcessState const &) { return false; });
-
-    moveBackwardUntil(ProcState,
-                      [] (trace::ProcessState const &) { return false; });
-  }
+  if (TestMovement)
+    TestUnmappedMovement(Trace, ModIndexPtr);
 
   // Print basic descriptions of all run-time errors.
   if (ShowErrors) {
@@ -76,6 +76,18 @@ namespace seec {
     cl::opt<bool>
     TestGraphGeneration("graph-test", cl::desc("generate dot graphs (but do not write them)"));
 
+    cl::opt<std::string>
+    OutputDirectoryForRender("render", cl::desc("render graphs of all states to this directory"));
+
+    cl::opt<std::string>
+    RenderFormat("render-format", cl::desc("image format for -render (svg or png)"), cl::init("svg"));
+
+    cl::opt<bool>
+    RenderWithBuiltinLayout("render-builtin", cl::desc("use the builtin layout engine for -render (svg only)"));
+
+    cl::opt<unsigned>
+    RenderJobs("render-jobs", cl::desc("number of workers for -render (default: one per core)"), cl::init(0));
+
     cl::opt<bool>
     ShowCounts("counts", cl::desc("show event counts"));
 
@@ -105,6 +117,9 @@ namespace seec {
 
     cl::opt<bool>
     TestMovement("test-movement", cl::desc("test movement only"));
+
+    cl::opt<unsigned>
+    MemoryHistoryLimit("memory-history-limit", cl::desc("limit the memory used to rewind each allocation (in chars), and rebuild discarded states from the trace"), cl::init(0));
   }
 }
 
@@ -157,7 +172,8 @@ int main(int argc, char **argv, char * const *envp) {
   Augmentations.loadFromResources(ResourcePath);
   Augmentations.loadFromUserLocalDataDir();
 
-  if (UseClangMapping || OnlinePythonTutor) {
+  if (UseClangMapping || OnlinePythonTutor
+      || !OutputDirectoryForRender.empty()) {
     PrintClangMapped(Augmentations, OPTVariableName);
   }
   else {
@@ -0,0 +1,145 @@
+//===- tools/seec-trace-view/GraphvizContext.cpp --------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#include "GraphvizContext.hpp"
+
+#if defined(SEEC_HAVE_LIBGVC)
+#include <gvc.h>
+#endif
+
+#include <cstddef>
+#include <mutex>
+
+
+#if defined(SEEC_HAVE_LIBGVC)
+
+/// \brief Call gvRenderData(), which takes either an unsigned int * or a
+///        size_t * for the length, depending on the version of Graphviz.
+///
+template<typename LengthT>
+static int renderData(int (*Render)(GVC_t *, graph_t *, char const *,
+                                    char **, LengthT *),
+                      GVC_t *Context,
+                      graph_t *Graph,
+                      char const *Format,
+                      char **Result,
+                      std::size_t &Length)
+{
+  LengthT RenderedLength = 0;
+  auto const Status = Render(Context, Graph, Format, Result, &RenderedLength);
+  Length = RenderedLength;
+  return Status;
+}
+
+/// \brief Get the mutex that serializes all use of libgvc.
+///
+/// libgvc's contexts, graph reader and error reporting share global state,
+/// so contexts can't be used concurrently even if each thread has its own.
+///
+static std::mutex &getGraphvizMutex()
+{
+  static std::mutex Mutex;
+  return Mutex;
+}
+
+GraphvizContext::~GraphvizContext()
+{
+  std::lock_guard<std::mutex> Lock(getGraphvizMutex());
+  gvFreeContext(Context);
+}
+
+std::unique_ptr<GraphvizContext> GraphvizContext::create()
+{
+  std::lock_guard<std::mutex> Lock(getGraphvizMutex());
+
+  auto const Context = gvContext();
+  if (!Context)
+    return nullptr;
+
+  return std::unique_ptr<GraphvizContext>(new GraphvizContext(Context));
+}
+
+bool GraphvizContext::renderSVG(llvm::StringRef Dot,
+                                std::string &SVG,
+                                std::string &Error)
+{
+  // agmemread() requires a null-terminated string.
+  std::string const DotString = Dot.str();
+
+  std::lock_guard<std::mutex> Lock(getGraphvizMutex());
+
+  auto const Graph = agmemread(const_cast<char *>(DotString.c_str()));
+  if (!Graph) {
+    auto const Message = aglasterr();
+    Error = Message ? Message : "couldn't read graph";
+    return false;
+  }
+
+  // Match the options that we pass to the dot executable.
+  agattr(Graph, AGRAPH, const_cast<char *>("fontnames"),
+         const_cast<char *>("svg"));
+
+#if defined(__APPLE__)
+  if (!agattr(Graph, AGNODE, const_cast<char *>("fontname"), nullptr))
+    agattr(Graph, AGNODE, const_cast<char *>("fontname"),
+           const_cast<char *>("Times-Roman"));
+#endif
+
+  auto Result = false;
+
+  if (gvLayout(Context, Graph, "dot") == 0) {
+    char *Data = nullptr;
+    std::size_t Length = 0;
+
+    if (renderData(&gvRenderData, Context, Graph, "svg", &Data, Length) == 0
+        && Data)
+    {
+      SVG.assign(Data, Length);
+      Result = true;
+    }
+    else {
+      Error = "couldn't render graph";
+    }
+
+    if (Data)
+      gvFreeRenderData(Data);
+
+    gvFreeLayout(Context, Graph);
+  }
+  else {
+    auto const Message = aglasterr();
+    Error = Message ? Message : "couldn't layout graph";
+  }
+
+  agclose(Graph);
+  return Result;
+}
+
+#else // !defined(SEEC_HAVE_LIBGVC)
+
+GraphvizContext::~GraphvizContext() = default;
+
+std::unique_ptr<GraphvizContext> GraphvizContext::create()
+{
+  return nullptr;
+}
+
+bool GraphvizContext::renderSVG(llvm::StringRef,
+                                std::string &,
+                                std::string &Error)
+{
+  Error = "seec-view was built without libgvc";
+  return false;
+}
+
+#endif // defined(SEEC_HAVE_LIBGVC)
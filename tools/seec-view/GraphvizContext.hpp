@@ -0,0 +1,66 @@
+//===- tools/seec-trace-view/GraphvizContext.hpp --------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef SEEC_TRACE_VIEW_GRAPHVIZCONTEXT_HPP
+#define SEEC_TRACE_VIEW_GRAPHVIZCONTEXT_HPP
+
+#include "llvm/ADT/StringRef.h"
+
+#include <memory>
+#include <string>
+
+struct GVC_s;
+
+
+/// \brief Lays out and renders dot graphs in-process using Graphviz's libgvc.
+///
+/// The libgvc context (and the plugins that it loads) are kept for the life of
+/// this object, so that each render only pays for the layout itself. This is
+/// only functional if seec-view was built with libgvc (SEEC_HAVE_LIBGVC).
+/// libgvc is not thread-safe, so all contexts in the process share a mutex:
+/// renders from different threads run one at a time.
+///
+class GraphvizContext final {
+  /// The libgvc context.
+  GVC_s *Context;
+
+  /// \brief Constructor.
+  ///
+  GraphvizContext(GVC_s *WithContext)
+  : Context(WithContext)
+  {}
+
+public:
+  GraphvizContext(GraphvizContext const &) = delete;
+
+  GraphvizContext &operator=(GraphvizContext const &) = delete;
+
+  /// \brief Destructor.
+  ///
+  ~GraphvizContext();
+
+  /// \brief Create a context.
+  /// \return the context, or nullptr if libgvc is not available.
+  ///
+  static std::unique_ptr<GraphvizContext> create();
+
+  /// \brief Layout a graph using dot and render it to SVG.
+  /// \param Dot the graph, in the dot language.
+  /// \param SVG receives the rendered SVG.
+  /// \param Error receives a description of any failure.
+  /// \return true iff the graph was rendered.
+  ///
+  bool renderSVG(llvm::StringRef Dot, std::string &SVG, std::string &Error);
+};
+
+#endif // SEEC_TRACE_VIEW_GRAPHVIZCONTEXT_HPP
@@ -52,7 +52,6 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/ToolOutputFile.h"
 
-#include <cctype>
 #include <chrono>
 #include <memory>
 #include <string>
@@ -61,6 +60,7 @@
 #include "ActionReplay.hpp"
 #include "ColourSchemeSettings.hpp"
 #include "CommonMenus.hpp"
+#include "GraphvizContext.hpp"
 #include "HiddenExecuteAndWait.hpp"
 #include "LocaleSettings.hpp"
 #include "NotifyContext.hpp"
@@ -172,7 +172,9 @@ class GraphRenderedEvent : public wxEvent
 {
   std::shared_ptr<std::string const> RawSVG;
 
-  std::shared_ptr<wxString const> SetStateScript;
+  std::shared_ptr<std::string const> SetStateScript;
+
+  uint64_t Version;
   
 public:
   wxDECLARE_CLASS(GraphRenderedEvent);
@@ -182,10 +184,12 @@ public:
   GraphRenderedEvent(wxEventType EventType,
                      int WinID,
                      std::shared_ptr<std::string const> WithRawSVG,
-                     std::shared_ptr<wxString const> WithSetStateScript)
+                     std::shared_ptr<std::string const> WithSetStateScript,
+                     uint64_t WithVersion)
   : wxEvent(WinID, EventType),
     RawSVG(std::move(WithRawSVG)),
-    SetStateScript(std::move(WithSetStateScript))
+    SetStateScript(std::move(WithSetStateScript)),
+    Version(WithVersion)
   {}
   
   /// \brief wxEvent::Clone().
@@ -203,13 +207,23 @@ public:
 
   /// \brief Get the SetState() script.
   ///
-  wxString const &getSetStateScript() const { return *SetStateScript; }
+  std::shared_ptr<std::string const> const &getSetStateScript() const {
+    return SetStateScript;
+  }
+
+  /// \brief Get the version passed to SetState() by the script.
+  ///
+  uint64_t getVersion() const { return Version; }
   
   /// @} (Accessors.)
 };
 
 IMPLEMENT_CLASS(GraphRenderedEvent, wxEvent)
 
+/// Path of the SetState() script for the current graph, in the panel's virtual
+/// file system.
+char const * const cGraphScriptPath = "state_graph.js";
+
 wxDEFINE_EVENT(SEEC_EV_GRAPH_RENDERED, GraphRenderedEvent);
 
 
@@ -277,152 +291,224 @@ std::string StateGraphViewerPanel::workerGenerateDot()
   return GraphString;
 }
 
-void StateGraphViewerPanel::workerTaskLoop()
+std::string StateGraphViewerPanel::workerGenerateSVG()
 {
-  while (true)
-  {
-    std::unique_lock<std::mutex> Lock{TaskMutex};
+  // Lock the current state while we read from it.
+  auto Lock = TaskAccess->getAccess();
+  if (!Lock || !TaskProcess || !ContinueGraphGeneration)
+    return std::string();
 
-    // Wait until the main thread gives us a task.
-    TaskCV.wait(Lock);
+  std::lock_guard<std::mutex> LockLayoutHandler (LayoutHandlerMutex);
+  auto const Layout = LayoutHandler->doLayeredLayout(*TaskProcess,
+                                                     ContinueGraphGeneration);
+  return Layout.getSVGString();
+}
 
-    // This indicates that we should end the worker thread because the panel is
-    // being destroyed.
-    if (!TaskAccess && !TaskProcess)
-      return;
+bool StateGraphViewerPanel::workerRenderWithDot(std::string const &GraphString,
+                                                std::string &SVG)
+{
+  // Write the graph to a temporary file.
+  llvm::SmallString<256> GraphPath;
 
-    // Create a graph of the process state in dot format.
-    auto const GraphString = workerGenerateDot();
-    if (GraphString.empty()) {
-      wxLogDebug("GraphString.empty()");
-      continue;
+  {
+    int GraphFD;
+    auto const GraphErr =
+      llvm::sys::fs::createTemporaryFile("seecgraph", "dot",
+                                         GraphFD,
+                                         GraphPath);
+
+    if (GraphErr) {
+      wxLogDebug("Couldn't create temporary dot file: %s",
+                 wxString(GraphErr.message()));
+      return false;
     }
 
-    // The remainder of the graph generation does not use the state, so we can
-    // release access to the task information.
-    Lock.unlock();
-
-    // Write the graph to a temporary file.
-    llvm::SmallString<256> GraphPath;
-
-    {
-      int GraphFD;
-      auto const GraphErr =
-        llvm::sys::fs::createTemporaryFile("seecgraph", "dot",
-                                           GraphFD,
-                                           GraphPath);
-
-      if (GraphErr) {
-        wxLogDebug("Couldn't create temporary dot file: %s",
-                   wxString(GraphErr.message()));
-        continue;
-      }
-
-      llvm::raw_fd_ostream GraphStream(GraphFD, true);
-      GraphStream << GraphString;
-    }
+    llvm::raw_fd_ostream GraphStream(GraphFD, true);
+    GraphStream << GraphString;
+  }
 
-    // Remove the temporary file when we exit this function.
-    auto const RemoveGraph = seec::scopeExit([&] () {
-                                bool Existed = false;
-                                llvm::sys::fs::remove(GraphPath.str(), Existed);
-                              });
+  // Remove the temporary file when we exit this function.
+  auto const RemoveGraph = seec::scopeExit([&] () {
+                              bool Existed = false;
+                              llvm::sys::fs::remove(GraphPath.str(), Existed);
+                            });
 
-    // Create a temporary filename for the dot result.
-    llvm::SmallString<256> SVGPath;
-    auto const SVGErr =
-      llvm::sys::fs::createTemporaryFile("seecgraph", "svg", SVGPath);
+  // Create a temporary filename for the dot result.
+  llvm::SmallString<256> SVGPath;
+  auto const SVGErr =
+    llvm::sys::fs::createTemporaryFile("seecgraph", "svg", SVGPath);
 
-    if (SVGErr) {
-      wxLogDebug("Couldn't create temporary svg file: %s",
-                 wxString(SVGErr.message()));
-      continue;
-    }
+  if (SVGErr) {
+    wxLogDebug("Couldn't create temporary svg file: %s",
+               wxString(SVGErr.message()));
+    return false;
+  }
 
-    auto const RemoveSVG = seec::scopeExit([&] () {
-                              bool Existed = false;
-                              llvm::sys::fs::remove(SVGPath.str(), Existed);
-                            });
+  auto const RemoveSVG = seec::scopeExit([&] () {
+                            bool Existed = false;
+                            llvm::sys::fs::remove(SVGPath.str(), Existed);
+                          });
 
-    // Run dot using the temporary input/output files.
-    char const *Args[] = {
-      "dot",
-      "-Gfontnames=svg",
+  // Run dot using the temporary input/output files.
+  char const *Args[] = {
+    "dot",
+    "-Gfontnames=svg",
 #if defined(__APPLE__)
-      "-Nfontname=\"Times-Roman\"",
+    "-Nfontname=\"Times-Roman\"",
 #endif
-      "-o",
-      SVGPath.c_str(),
-      "-Tsvg",
-      GraphPath.c_str(),
-      nullptr
-    };
+    "-o",
+    SVGPath.c_str(),
+    "-Tsvg",
+    GraphPath.c_str(),
+    nullptr
+  };
 
-    std::vector<char const *> Environment;
+  std::vector<char const *> Environment;
 
 #if !defined(_WIN32)
-    Environment.emplace_back(PathToGraphvizLibraries.c_str());
-    Environment.emplace_back(PathToGraphvizPlugins.c_str());
+  Environment.emplace_back(PathToGraphvizLibraries.c_str());
+  Environment.emplace_back(PathToGraphvizPlugins.c_str());
 #endif
 
-    Environment.emplace_back(nullptr);
-    char const **EnvPtr = Environment.size() > 1 ? Environment.data()
-                                                 : nullptr;
+  Environment.emplace_back(nullptr);
+  char const **EnvPtr = Environment.size() > 1 ? Environment.data()
+                                               : nullptr;
 
-    std::string ErrorMsg;
+  std::string ErrorMsg;
 
-    bool ExecFailed = false;
-    auto const Result = HiddenExecuteAndWait(PathToDot, Args, EnvPtr, &ErrorMsg,
-                                             &ExecFailed);
+  bool ExecFailed = false;
+  auto const Result = HiddenExecuteAndWait(PathToDot, Args, EnvPtr, &ErrorMsg,
+                                           &ExecFailed);
 
-    if (!ErrorMsg.empty()) {
-      wxLogDebug("Dot failed: %s", ErrorMsg);
-      continue;
-    }
+  if (!ErrorMsg.empty()) {
+    wxLogDebug("Dot failed: %s", ErrorMsg);
+    return false;
+  }
 
-    if (Result) {
-      // TODO: send a message to the user - possibly they have selected the
-      // wrong executable?
-      wxLogDebug("Dot returned non-zero.");
-      continue;
-    }
+  if (Result) {
+    // TODO: send a message to the user - possibly they have selected the
+    // wrong executable?
+    wxLogDebug("Dot returned non-zero.");
+    return false;
+  }
+
+  // Read the dot-generated SVG from the temporary file.
+  auto ErrorOrSVGData = llvm::MemoryBuffer::getFile(SVGPath.str());
+  if (!ErrorOrSVGData) {
+    wxLogDebug("Couldn't read temporary svg file: %s",
+               wxString(ErrorOrSVGData.getError().message()));
+    return false;
+  }
 
-    // Read the dot-generated SVG from the temporary file.
-    auto ErrorOrSVGData = llvm::MemoryBuffer::getFile(SVGPath.str());
-    if (!ErrorOrSVGData) {
-      wxLogDebug("Couldn't read temporary svg file: %s",
-                 wxString(ErrorOrSVGData.getError().message()));
+  auto &SVGData = *ErrorOrSVGData;
+  SVG.assign(SVGData->getBufferStart(), SVGData->getBufferEnd());
+  return true;
+}
+
+/// \brief Create a script that calls SetState() with an SVG.
+///
+/// Control characters are removed from the SVG, and quotes and backslashes are
+/// escaped. Runs of characters that need no change are appended as a whole.
+///
+static void buildSetStateScript(std::string const &SVG,
+                                uint64_t const Version,
+                                std::string &Script)
+{
+  Script.reserve(SVG.size() + 64);
+  Script += "SetState(\"";
+
+  auto RunStart = SVG.data();
+  auto const End = SVG.data() + SVG.size();
+
+  for (auto It = RunStart; It != End; ++It) {
+    auto const Ch = static_cast<unsigned char>(*It);
+    if (Ch >= 0x20 && Ch != '\\' && Ch != '"' && Ch != 0x7F)
       continue;
+
+    Script.append(RunStart, It);
+    RunStart = It + 1;
+
+    if (Ch == '\\' || Ch == '"') {
+      Script += '\\';
+      Script += static_cast<char>(Ch);
     }
+  }
+
+  Script.append(RunStart, End);
+
+  Script += "\", ";
+  Script += std::to_string(Version);
+  Script += ");";
+}
 
-    auto &SVGData = *ErrorOrSVGData;
-    auto SharedSVG = std::make_shared<std::string>(SVGData->getBufferStart(),
-                                                   SVGData->getBufferEnd());
+void StateGraphViewerPanel::workerTaskLoop()
+{
+  while (true)
+  {
+    std::unique_lock<std::mutex> Lock{TaskMutex};
 
-    // Remove all non-print characters from the SVG and prepare it to be sent to
-    // the WebView via javascript.
-    auto SharedScript = std::make_shared<wxString>();
-    auto &Script = *SharedScript;
+    // Wait until the main thread gives us a task.
+    TaskCV.wait(Lock);
 
-    Script.reserve(SVGData->getBufferSize() + 256);
-    Script << "SetState(\"";
+    // This indicates that we should end the worker thread because the panel is
+    // being destroyed.
+    if (!TaskAccess && !TaskProcess)
+      return;
 
-    for (auto const Ch : *SharedSVG)
-    {
-      if (std::isprint(Ch)) {
-        if (Ch == '\\' || Ch == '"')
-          Script << '\\';
-        Script << Ch;
+    auto SharedSVG = std::make_shared<std::string>();
+
+    if (UseBuiltinLayout) {
+      // Create and render a graph of the process state.
+      *SharedSVG = workerGenerateSVG();
+      if (SharedSVG->empty()) {
+        wxLogDebug("SVG.empty()");
+        continue;
       }
+
+      Lock.unlock();
+    }
+    else {
+      // Create a graph of the process state in dot format.
+      auto const GraphString = workerGenerateDot();
+      if (GraphString.empty()) {
+        wxLogDebug("GraphString.empty()");
+        continue;
+      }
+
+      // The remainder of the graph generation does not use the state, so we
+      // can release access to the task information.
+      Lock.unlock();
+
+      // Render the graph in-process if possible, otherwise (or if that fails)
+      // use dot.
+      auto Rendered = false;
+      
+      if (Graphviz) {
+        std::string ErrorMsg;
+        Rendered = Graphviz->renderSVG(GraphString, *SharedSVG, ErrorMsg);
+        if (!Rendered)
+          wxLogDebug("libgvc failed: %s", ErrorMsg);
+      }
+      
+      if (!Rendered && !PathToDot.empty())
+        Rendered = workerRenderWithDot(GraphString, *SharedSVG);
+      
+      if (!Rendered)
+        continue;
     }
 
-    Script << "\");";
+    // Prepare the SetState() script, which the WebView will load from our
+    // virtual file system.
+    auto const Version = ++WorkerGraphVersion;
+    auto SharedScript = std::make_shared<std::string>();
+    buildSetStateScript(*SharedSVG, Version, *SharedScript);
 
     auto EvPtr = llvm::make_unique<GraphRenderedEvent>
                                   (SEEC_EV_GRAPH_RENDERED,
                                    this->GetId(),
                                    std::move(SharedSVG),
-                                   std::move(SharedScript));
+                                   std::move(SharedScript),
+                                   Version);
 
     EvPtr->SetEventObject(this);
 
@@ -497,6 +583,8 @@ StateGraphViewerPanel::StateGraphViewerPanel()
   PathToDot(),
   PathToGraphvizLibraries(),
   PathToGraphvizPlugins(),
+  Graphviz(),
+  UseBuiltinLayout(false),
   CurrentAccess(),
   CurrentProcess(nullptr),
   CurrentGraphSVG(),
@@ -506,6 +594,7 @@ StateGraphViewerPanel::StateGraphViewerPanel()
   TaskAccess(),
   TaskProcess(nullptr),
   ContinueGraphGeneration(false),
+  WorkerGraphVersion(0),
   WebView(nullptr),
   LayoutHandler(),
   LayoutHandlerMutex(),
@@ -614,8 +703,13 @@ bool StateGraphViewerPanel::Create(wxWindow *Parent,
   Sizer->Add(WebView, wxSizerFlags(1).Expand());
   SetSizerAndFit(Sizer);
   
-  // Find the dot executable.
-  PathToDot = getPathForDotExecutable();
+  // Use the builtin layout engine if the user prefers it.
+  UseBuiltinLayout = getUseBuiltinLayout();
+  
+  // Find the dot executable. It is used if libgvc is not available, and as a
+  // fallback if libgvc fails to render a graph.
+  if (!UseBuiltinLayout)
+    PathToDot = getPathForDotExecutable();
   
   if (!PathToDot.empty())
   {
@@ -634,6 +728,23 @@ bool StateGraphViewerPanel::Create(wxWindow *Parent,
     PathToGraphvizPlugins = "GVBINDIR=";
     PathToGraphvizPlugins += PluginPath.str();
     
+    // libgvc reads GVBINDIR from our own environment when the context is
+    // created, so set it there too (unless the user has already set it).
+    if (llvm::sys::fs::is_directory(PluginPath.str())
+        && !wxGetEnv("GVBINDIR", nullptr))
+      wxSetEnv("GVBINDIR", wxString(PluginPath.str().str()));
+  }
+  
+  // Use libgvc to render graphs in-process, if we were built with it.
+  if (!UseBuiltinLayout)
+    Graphviz = GraphvizContext::create();
+  
+  // If Graphviz is not available then fall back to the builtin engine.
+  if (!Graphviz && PathToDot.empty())
+    UseBuiltinLayout = true;
+  
+  if (canRenderGraphs())
+  {
     // Setup the layout handler.
     {
       std::lock_guard<std::mutex> LockLayoutHandler (LayoutHandlerMutex);
@@ -706,7 +817,18 @@ bool StateGraphViewerPanel::Create(wxWindow *Parent,
 void StateGraphViewerPanel::OnGraphRendered(GraphRenderedEvent const &Ev)
 {
   CurrentGraphSVG = Ev.getRawSVG();
-  WebView->RunScript(Ev.getSetStateScript());
+
+  // Serve the script from our virtual file system, so that the WebView loads
+  // it directly, rather than passing the whole graph through RunScript().
+  CallbackFS->setContent(cGraphScriptPath,
+                         Ev.getSetStateScript(),
+                         "application/javascript");
+
+  wxString Script;
+  Script << "LoadState(\"" << cGraphScriptPath << "\", "
+         << std::to_string(Ev.getVersion()) << ");";
+
+  WebView->RunScript(Script);
 }
 
 void
@@ -1008,11 +1130,12 @@ void StateGraphViewerPanel::OnContextMenu(wxContextMenuEvent &Ev)
 
 void StateGraphViewerPanel::renderGraph()
 {
-  if (!WebView || PathToDot.empty())
+  if (!WebView || !canRenderGraphs())
     return;
 
   WebView->RunScript(wxString{"ClearState();"});
   CurrentGraphSVG.reset();
+  CallbackFS->setContent(cGraphScriptPath, nullptr, wxString{});
 
   // Send the rendering task to the worker thread.
   std::unique_lock<std::mutex> Lock{TaskMutex};
@@ -1034,7 +1157,7 @@ StateGraphViewerPanel::show(std::shared_ptr<StateAccessToken> Access,
   
   WebView->RunScript(wxString("InvalidateState();"));
   
-  if (!WebView || PathToDot.empty())
+  if (!WebView || !canRenderGraphs())
     return;
   
   renderGraph();
@@ -1071,11 +1194,14 @@ void StateGraphViewerPanel::clear()
   ContinueGraphGeneration = false;
 
   // Clear any existing graph from the WebView.
-  if (WebView && !PathToDot.empty())
+  if (WebView && canRenderGraphs())
     WebView->RunScript(wxString{"ClearState();"});
 
   CurrentGraphSVG.reset();
 
+  if (CallbackFS)
+    CallbackFS->setContent(cGraphScriptPath, nullptr, wxString{});
+
   MouseOver.reset();
 }
 
@@ -22,6 +22,7 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <thread>
@@ -51,6 +52,7 @@ class ActionReplayFrame;
 class ColourScheme;
 class ContextNotifier;
 class GraphRenderedEvent;
+class GraphvizContext;
 class MouseOverDisplayableEvent;
 class StateAccessToken;
 class wxWebView;
@@ -259,7 +261,8 @@ class StateGraphViewerPanel final : public wxPanel
   /// Used to record user interactions.
   ActionRecord *Recording;
 
-  /// The location of the dot executable.
+  /// The location of the dot executable. Used if libgvc is not available, or
+  /// if it fails to render a graph.
   std::string PathToDot;
   
   /// The location of the graphviz libraries.
@@ -268,6 +271,14 @@ class StateGraphViewerPanel final : public wxPanel
   /// The location of the graphviz plugins.
   std::string PathToGraphvizPlugins;
 
+  /// Renders graphs in-process, if seec-view was built with libgvc. Only used
+  /// by the worker thread.
+  std::unique_ptr<GraphvizContext> Graphviz;
+
+  /// Lay out and render graphs with LayoutHandler's builtin layered layout
+  /// engine, rather than Graphviz.
+  bool UseBuiltinLayout;
+
   /// Token for accessing the current state.
   std::shared_ptr<StateAccessToken> CurrentAccess;
   
@@ -295,6 +306,10 @@ class StateGraphViewerPanel final : public wxPanel
   /// Used to indicate that graph generation should be terminated.
   std::atomic_bool ContinueGraphGeneration;
 
+  /// Number of graphs rendered by the worker thread, which is used to version
+  /// the SetState() scripts.
+  uint64_t WorkerGraphVersion;
+
   /// The WebView used to display the rendered state graphs.
   wxWebView *WebView;
   
@@ -314,10 +329,26 @@ class StateGraphViewerPanel final : public wxPanel
   ///
   std::string workerGenerateDot();
 
+  /// \brief Generate the SVG graph for \c TaskProcess using the builtin
+  ///        layered layout engine.
+  ///
+  std::string workerGenerateSVG();
+
+  /// \brief Render a dot graph to SVG using the dot executable.
+  ///
+  bool workerRenderWithDot(std::string const &GraphString, std::string &SVG);
+
   /// \brief Implements the worker thread's task loop.
   ///
   void workerTaskLoop();
 
+  /// \brief Check if graphs can be rendered (using libgvc, dot, or the builtin
+  ///        layout engine).
+  ///
+  bool canRenderGraphs() const {
+    return UseBuiltinLayout || Graphviz || !PathToDot.empty();
+  }
+
   /// \brief Setup the given colour scheme.
   ///
   void setupColourScheme(ColourScheme const &Scheme);
@@ -14,6 +14,7 @@
 #include "seec/ICU/Resources.hpp"
 #include "seec/wxWidgets/StringConversion.hpp"
 
+#include <wx/checkbox.h>
 #include <wx/config.h>
 #include <wx/filepicker.h>
 #include <wx/log.h>
@@ -32,6 +33,9 @@ using namespace seec;
 
 char const * const cConfigKeyForDotPath = "/StateGraphViewer/DotPath";
 
+char const * const cConfigKeyForUseBuiltinLayout =
+  "/StateGraphViewer/UseBuiltinLayout";
+
 std::string getPathForDotExecutable()
 {
   auto const Config = wxConfig::Get();
@@ -53,6 +57,14 @@ std::string getPathForDotExecutable()
   return std::string{};
 }
 
+bool getUseBuiltinLayout()
+{
+  auto const Config = wxConfig::Get();
+  bool UseBuiltinLayout = false;
+  Config->Read(cConfigKeyForUseBuiltinLayout, &UseBuiltinLayout);
+  return UseBuiltinLayout;
+}
+
 namespace {
 
 bool setPathForDotExecutable(wxString const &Path)
@@ -71,26 +83,43 @@ bool setPathForDotExecutable(wxString const &Path)
   return true;
 }
 
+bool setUseBuiltinLayout(bool const UseBuiltinLayout)
+{
+  auto const Config = wxConfig::Get();
+  
+  if (!Config->Write(cConfigKeyForUseBuiltinLayout, UseBuiltinLayout))
+    return false;
+  
+  Config->Flush();
+  return true;
+}
+
 }
 
 bool StateGraphViewerPreferencesWindow::SaveValuesImpl()
 {
-  if (!m_DotFilePicker)
-    return true;
-
-  auto const Path = m_DotFilePicker->GetPath();
-  if (!Path.empty() && !llvm::sys::fs::can_execute(Path.ToStdString())) {
-    auto const ResText =
-      Resource("TraceViewer")["GUIText"]["StateGraphViewerPreferences"];
-
-    wxMessageDialog Dlg(this,
-                        towxString(ResText["DotNotExecutableMessage"]),
-                        towxString(ResText["DotNotExecutableCaption"]));
-    Dlg.ShowModal();
-    return false;
+  if (m_DotFilePicker) {
+    auto const Path = m_DotFilePicker->GetPath();
+    if (!Path.empty() && !llvm::sys::fs::can_execute(Path.ToStdString())) {
+      auto const ResText =
+        Resource("TraceViewer")["GUIText"]["StateGraphViewerPreferences"];
+
+      wxMessageDialog Dlg(this,
+                          towxString(ResText["DotNotExecutableMessage"]),
+                          towxString(ResText["DotNotExecutableCaption"]));
+      Dlg.ShowModal();
+      return false;
+    }
+
+    if (!setPathForDotExecutable(Path))
+      return false;
   }
 
-  return setPathForDotExecutable(m_DotFilePicker->GetPath());
+  if (m_UseBuiltinLayout
+      && !setUseBuiltinLayout(m_UseBuiltinLayout->GetValue()))
+    return false;
+
+  return true;
 }
 
 void StateGraphViewerPreferencesWindow::CancelChangesImpl() {}
@@ -102,7 +131,8 @@ wxString StateGraphViewerPreferencesWindow::GetDisplayNameImpl()
 }
 
 StateGraphViewerPreferencesWindow::StateGraphViewerPreferencesWindow()
-: m_DotFilePicker(nullptr)
+: m_DotFilePicker(nullptr),
+  m_UseBuiltinLayout(nullptr)
 {}
 
 StateGraphViewerPreferencesWindow
@@ -140,6 +170,10 @@ bool StateGraphViewerPreferencesWindow::Create(wxWindow *Parent)
       wxDefaultSize,
       wxFLP_DEFAULT_STYLE | wxFLP_USE_TEXTCTRL | wxFLP_FILE_MUST_EXIST);
 
+  m_UseBuiltinLayout =
+    new wxCheckBox(this, wxID_ANY, towxString(ResText["UseBuiltinLayout"]));
+  m_UseBuiltinLayout->SetValue(getUseBuiltinLayout());
+
   // Vertical sizer to hold each row of input.
   auto const ParentSizer = new wxBoxSizer(wxVERTICAL);
 
@@ -154,6 +188,9 @@ bool StateGraphViewerPreferencesWindow::Create(wxWindow *Parent)
   ParentSizer->Add(m_DotFilePicker,
                    wxSizerFlags().Expand().Border(BorderDir, BorderSize));
 
+  ParentSizer->Add(m_UseBuiltinLayout,
+                   wxSizerFlags().Border(BorderDir, BorderSize));
+
   ParentSizer->Add(RestartForEffectLabel,
                    wxSizerFlags().Border(BorderDir, BorderSize));
 
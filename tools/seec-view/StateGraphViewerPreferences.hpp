@@ -16,16 +16,24 @@
 
 #include "Preferences.hpp"
 
+class wxCheckBox;
 class wxFilePickerCtrl;
 
 std::string getPathForDotExecutable();
 
+/// \brief Check if the user has chosen to use the builtin layout engine rather
+///        than Graphviz.
+///
+bool getUseBuiltinLayout();
+
 /// \brief Allows the user to configure graph viewer preferences.
 ///
 class StateGraphViewerPreferencesWindow final : public PreferenceWindow
 {
   wxFilePickerCtrl *m_DotFilePicker;
 
+  wxCheckBox *m_UseBuiltinLayout;
+
 protected:
   /// \brief Save edited values back to the user's config file.
   ///
@@ -17,6 +17,7 @@
 #include "seec/Clang/PrintOnlinePythonTutorTrace.hpp"
 #include "seec/ICU/Format.hpp"
 #include "seec/ICU/Resources.hpp"
+#include "seec/Trace/ProcessState.hpp"
 #include "seec/Trace/TraceReader.hpp"
 #include "seec/Util/MakeFunction.hpp"
 #include "seec/wxWidgets/StringConversion.hpp"
@@ -64,6 +65,13 @@ char const * const cConfigKeyForPerspective = "/TraceViewerFrame/Perspective";
 char const * const cConfigKeyForViewVersion = "/TraceViewerFrame/ViewVersion";
 char const * const cConfigKeyForWidth       = "/TraceViewerFrame/Width";
 char const * const cConfigKeyForHeight      = "/TraceViewerFrame/Height";
+char const * const cConfigKeyForMemoryHistoryLimit =
+  "/TraceViewerFrame/MemoryHistoryLimit";
+
+/// Default limit on the rewind history held for each memory allocation (zero
+/// for no limit). The limit is opt-in, because rebuilding discarded history
+/// is only covered by the tests for a few multi-threaded programs.
+long const cDefaultMemoryHistoryLimit = 0;
 
 constexpr int32_t getViewVersion() { return 1; }
 
@@ -293,6 +301,13 @@ bool TraceViewerFrame::Create(wxWindow *Parent,
   
   // Create a new state at the beginning of the trace.
   State = llvm::make_unique<seec::cm::ProcessState>(Trace->getTrace());
+
+  // Limit the memory used to rewind the state, if the user has chosen to.
+  // Discarded history is rebuilt from the trace when moving backwards.
+  auto const HistoryLimit = Config->ReadLong(cConfigKeyForMemoryHistoryLimit,
+                                             cDefaultMemoryHistoryLimit);
+  if (HistoryLimit > 0)
+    State->getUnmappedProcessState().setMemoryHistoryLimit(HistoryLimit);
   
   // Create a new accessor token for this state.
   StateAccess = std::make_shared<StateAccessToken>();
@@ -0,0 +1,242 @@
+//===- unittests/Clang/LayeredLayoutTest.cpp ------------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#include "seec/Clang/GraphLayoutLayered.hpp"
+
+#include "UnitTest.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using namespace seec::cm::graph;
+
+/// \brief Get a label in the same form as the node labels made for dot.
+///
+static std::string makeLabel(std::string const &Text)
+{
+  return "<TABLE BORDER=\"1\" CELLSPACING=\"0\" CELLBORDER=\"1\">"
+         "<TR><TD PORT=\"left\">" + Text + "</TD>"
+         "<TD PORT=\"right\" HREF=\"link " + Text + "\">value</TD></TR>"
+         "</TABLE>";
+}
+
+/// \brief Get an edge from the right port of Tail to the left port of Head.
+///
+static LayeredEdge makeEdge(std::size_t const Tail, std::size_t const Head)
+{
+  return LayeredEdge{Tail, "right", Head, "left", LayeredAnchor::Side,
+                     LayeredArrowType::OpenDot, LayeredArrowType::Normal,
+                     "", "", false};
+}
+
+/// \brief Get the SVG group for the node with the given ID, or an empty string
+///        if there is no such node.
+///
+static std::string getNodeGroup(std::string const &SVG, std::string const &ID)
+{
+  auto const Title = "class=\"node\">\n<title>" + ID + "</title>";
+  auto const Start = SVG.find(Title);
+  if (Start == std::string::npos)
+    return std::string();
+
+  auto const End = SVG.find("</g>\n", Start);
+  return SVG.substr(Start, End - Start);
+}
+
+/// \brief Get the points of the first polygon (the border of the outermost
+///        table) in the SVG group for the node with the given ID.
+///
+static std::string getNodePosition(std::string const &SVG,
+                                   std::string const &ID)
+{
+  auto const Group = getNodeGroup(SVG, ID);
+  auto const Start = Group.find("points=\"");
+  if (Start == std::string::npos)
+    return std::string();
+
+  auto const End = Group.find('"', Start + 8);
+  return Group.substr(Start + 8, End - (Start + 8));
+}
+
+/// \brief Count the occurrences of Needle in Haystack.
+///
+static std::size_t count(std::string const &Haystack, std::string const &Needle)
+{
+  std::size_t Count = 0;
+
+  for (auto Pos = Haystack.find(Needle);
+       Pos != std::string::npos;
+       Pos = Haystack.find(Needle, Pos + Needle.size()))
+    ++Count;
+
+  return Count;
+}
+
+/// \brief An empty graph still produces a (blank) SVG document.
+///
+static void testEmptyGraph()
+{
+  LayeredLayoutEngine Engine;
+  auto const SVG = Engine.render(LayeredGraph{});
+
+  SEEC_CHECK(SVG.find("<svg ") != std::string::npos);
+  SEEC_CHECK(SVG.find("</svg>") != std::string::npos);
+  SEEC_CHECK(count(SVG, "class=\"node\"") == 0);
+  SEEC_CHECK(count(SVG, "class=\"edge\"") == 0);
+}
+
+/// \brief Every node and valid edge is rendered, with the labels' text and
+///        links, and edges that refer to non-existent nodes are ignored.
+///
+static void testNodesAndEdges()
+{
+  LayeredGraph Graph;
+  auto const A = Graph.addNode("a", makeLabel("first"));
+  auto const B = Graph.addNode("b", makeLabel("second"));
+  auto const C = Graph.addNode("c", makeLabel("third"));
+  Graph.addEdge(makeEdge(A, B));
+  Graph.addEdge(makeEdge(B, C));
+  Graph.addEdge(makeEdge(C, A)); // A cycle, which must be broken.
+  Graph.addEdge(makeEdge(A, 42));
+
+  LayeredLayoutEngine Engine;
+  auto const SVG = Engine.render(Graph);
+
+  SEEC_CHECK(count(SVG, "class=\"node\"") == 3);
+  SEEC_CHECK(count(SVG, "class=\"edge\"") == 3);
+
+  for (auto const &ID : {"a", "b", "c"})
+    SEEC_CHECK(!getNodePosition(SVG, ID).empty());
+
+  SEEC_CHECK(getNodeGroup(SVG, "b").find(">second</text>")
+             != std::string::npos);
+  SEEC_CHECK(getNodeGroup(SVG, "c").find("xlink:href=\"link third\"")
+             != std::string::npos);
+
+  SEEC_CHECK(SVG.find("<title>a&#45;&gt;b</title>") != std::string::npos);
+  SEEC_CHECK(SVG.find("<title>c&#45;&gt;a</title>") != std::string::npos);
+}
+
+/// \brief A node whose label can't be parsed shows its ID instead.
+///
+static void testInvalidLabel()
+{
+  LayeredGraph Graph;
+  Graph.addNode("broken", "<TABLE><TR><TD>unterminated");
+
+  LayeredLayoutEngine Engine;
+  auto const SVG = Engine.render(Graph);
+
+  SEEC_CHECK(getNodeGroup(SVG, "broken").find(">broken</text>")
+             != std::string::npos);
+}
+
+/// \brief Laying out the same graph again doesn't move anything, and adding a
+///        node doesn't move the existing nodes vertically.
+///
+static void testIncremental()
+{
+  LayeredGraph Graph;
+  auto const A = Graph.addNode("a", makeLabel("first"));
+  auto const B = Graph.addNode("b", makeLabel("second"));
+  auto const C = Graph.addNode("c", makeLabel("third"));
+  Graph.addEdge(makeEdge(A, B));
+  Graph.addEdge(makeEdge(A, C));
+
+  LayeredLayoutEngine Engine;
+  auto const First = Engine.render(Graph);
+  auto const Second = Engine.render(Graph);
+  SEEC_CHECK(!First.empty());
+  SEEC_CHECK(First == Second);
+
+  auto const D = Graph.addNode("d", makeLabel("fourth"));
+  Graph.addEdge(makeEdge(B, D));
+  auto const Third = Engine.render(Graph);
+
+  // Compare the Y coordinates of each node's top left corner.
+  auto const getY = [] (std::string const &SVG, std::string const &ID) {
+    auto const Points = getNodePosition(SVG, ID);
+    auto const Comma = Points.find(',');
+    auto const Space = Points.find(' ');
+    return Points.substr(Comma + 1, Space - (Comma + 1));
+  };
+
+  for (auto const &ID : {"a", "b", "c"}) {
+    SEEC_CHECK(!getY(Third, ID).empty());
+    SEEC_CHECK(getY(First, ID) == getY(Third, ID));
+  }
+
+  SEEC_CHECK(!getNodePosition(Third, "d").empty());
+
+  // After clearing, the layout doesn't depend on the previous graph.
+  Engine.clear();
+  LayeredLayoutEngine Fresh;
+  SEEC_CHECK(Engine.render(Graph) == Fresh.render(Graph));
+}
+
+/// \brief A layout that is cancelled before it starts produces nothing, and
+///        doesn't prevent later layouts.
+///
+static void testCancelled()
+{
+  LayeredGraph Graph;
+  auto const A = Graph.addNode("a", makeLabel("first"));
+  auto const B = Graph.addNode("b", makeLabel("second"));
+  Graph.addEdge(makeEdge(A, B));
+
+  LayeredLayoutEngine Engine;
+
+  std::atomic_bool CancelIfFalse(false);
+  SEEC_CHECK(Engine.render(Graph, &CancelIfFalse).empty());
+
+  CancelIfFalse = true;
+  auto const SVG = Engine.render(Graph, &CancelIfFalse);
+  SEEC_CHECK(count(SVG, "class=\"node\"") == 2);
+  SEEC_CHECK(count(SVG, "class=\"edge\"") == 1);
+}
+
+/// \brief A larger graph with many crossing edges is rendered completely.
+///
+static void testLargeGraph()
+{
+  std::size_t const NodeCount = 500;
+
+  LayeredGraph Graph;
+  for (std::size_t i = 0; i < NodeCount; ++i)
+    Graph.addNode("n" + std::to_string(i), makeLabel(std::to_string(i)));
+
+  for (std::size_t i = 0; i < NodeCount; ++i) {
+    Graph.addEdge(makeEdge(i, (i * 7 + 3) % NodeCount));
+    Graph.addEdge(makeEdge(i, (i * 13 + 1) % NodeCount));
+  }
+
+  LayeredLayoutEngine Engine;
+  auto const SVG = Engine.render(Graph);
+
+  SEEC_CHECK(count(SVG, "class=\"node\"") == NodeCount);
+  SEEC_CHECK(count(SVG, "class=\"edge\"") == NodeCount * 2);
+}
+
+int main()
+{
+  testEmptyGraph();
+  testNodesAndEdges();
+  testInvalidLabel();
+  testIncremental();
+  testCancelled();
+  testLargeGraph();
+
+  return seec::unittest::getExitStatus();
+}
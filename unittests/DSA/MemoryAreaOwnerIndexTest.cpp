@@ -0,0 +1,152 @@
+//===- unittests/DSA/MemoryAreaOwnerIndexTest.cpp -------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#include "seec/DSA/MemoryAreaOwnerIndex.hpp"
+
+#include "UnitTest.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace seec;
+
+/// \brief Find the first area that contains Address, by linear search.
+///
+static Maybe<std::size_t>
+linearFindContaining(std::vector<MemoryArea> const &A, uint64_t const Address)
+{
+  for (std::size_t i = 0; i < A.size(); ++i)
+    if (A[i].contains(Address))
+      return i;
+  return Maybe<std::size_t>();
+}
+
+/// \brief Find the first area that contains Address or is empty and starts at
+///        Address, by linear search.
+///
+static Maybe<std::size_t>
+linearFindContainingOrAt(std::vector<MemoryArea> const &A,
+                         uint64_t const Address)
+{
+  for (std::size_t i = 0; i < A.size(); ++i)
+    if (A[i].contains(Address)
+        || (A[i].length() == 0 && A[i].start() == Address))
+      return i;
+  return Maybe<std::size_t>();
+}
+
+/// \brief Check if two results are the same.
+///
+static bool same(Maybe<std::size_t> const &L, Maybe<std::size_t> const &R)
+{
+  if (L.assigned() != R.assigned())
+    return false;
+  return !L.assigned() || L.get<std::size_t>() == R.get<std::size_t>();
+}
+
+/// \brief Check every address in [Low, High) against the linear search.
+///
+static void checkAgainstLinear(std::vector<MemoryArea> const &Areas,
+                               uint64_t const Low,
+                               uint64_t const High)
+{
+  MemoryAreaOwnerIndex const Index(Areas);
+
+  for (auto Address = Low; Address < High; ++Address) {
+    SEEC_CHECK(same(Index.findContaining(Address),
+                    linearFindContaining(Areas, Address)));
+    SEEC_CHECK(same(Index.findContainingOrAt(Address),
+                    linearFindContainingOrAt(Areas, Address)));
+  }
+}
+
+/// \brief No areas means no owners.
+///
+static void testEmpty()
+{
+  MemoryAreaOwnerIndex const Index(std::vector<MemoryArea>{});
+  SEEC_CHECK(!Index.findContaining(0).assigned());
+  SEEC_CHECK(!Index.findContainingOrAt(100).assigned());
+}
+
+/// \brief Overlapping addresses belong to the first area that contains them,
+///        and empty areas only match at their start when no earlier area
+///        contains that address.
+///
+static void testFirstOwner()
+{
+  std::vector<MemoryArea> const Areas {
+    MemoryArea(100, 10),  // 0: [100, 110)
+    MemoryArea(90, 40),   // 1: [90, 130), overlaps 0 on both sides.
+    MemoryArea(105, 0),   // 2: empty, inside 0.
+    MemoryArea(130, 0),   // 3: empty, just after 1.
+    MemoryArea(130, 0),   // 4: empty, at the same address as 3.
+    MemoryArea(125, 10),  // 5: [125, 135), overlaps the end of 1.
+    MemoryArea(140, 0),   // 6: empty, before 7 in the list.
+    MemoryArea(140, 4)    // 7: [140, 144)
+  };
+
+  MemoryAreaOwnerIndex const Index(Areas);
+
+  SEEC_CHECK(!Index.findContaining(89).assigned());
+  SEEC_CHECK(Index.findContaining(90).get<std::size_t>() == 1);
+  SEEC_CHECK(Index.findContaining(100).get<std::size_t>() == 0);
+  SEEC_CHECK(Index.findContaining(109).get<std::size_t>() == 0);
+  SEEC_CHECK(Index.findContaining(110).get<std::size_t>() == 1);
+  SEEC_CHECK(Index.findContaining(129).get<std::size_t>() == 1);
+  SEEC_CHECK(Index.findContaining(130).get<std::size_t>() == 5);
+  SEEC_CHECK(!Index.findContaining(135).assigned());
+
+  SEEC_CHECK(Index.findContainingOrAt(105).get<std::size_t>() == 0);
+  SEEC_CHECK(Index.findContainingOrAt(130).get<std::size_t>() == 3);
+  SEEC_CHECK(Index.findContainingOrAt(140).get<std::size_t>() == 6);
+  SEEC_CHECK(Index.findContainingOrAt(141).get<std::size_t>() == 7);
+
+  checkAgainstLinear(Areas, 80, 150);
+}
+
+/// \brief Randomly generated overlapping and empty areas give the same results
+///        as a linear search.
+///
+static void testRandom()
+{
+  std::mt19937 Generator(46);
+  std::uniform_int_distribution<uint64_t> StartDist(0, 200);
+  std::uniform_int_distribution<std::size_t> LengthDist(0, 24);
+  std::uniform_int_distribution<std::size_t> CountDist(1, 40);
+
+  for (unsigned Round = 0; Round < 500; ++Round) {
+    std::vector<MemoryArea> Areas;
+
+    auto const Count = CountDist(Generator);
+    for (std::size_t i = 0; i < Count; ++i) {
+      auto const Start = StartDist(Generator);
+      // Make a quarter of the areas empty.
+      auto const Length = (Generator() % 4 == 0) ? 0 : LengthDist(Generator);
+      Areas.emplace_back(Start, Length);
+    }
+
+    checkAgainstLinear(Areas, 0, 230);
+  }
+}
+
+int main()
+{
+  testEmpty();
+  testFirstOwner();
+  testRandom();
+
+  return seec::unittest::getExitStatus();
+}
@@ -0,0 +1,183 @@
+//===- unittests/Trace/MemoryStateTest.cpp --------------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#include "seec/Trace/MemoryState.hpp"
+
+#include "UnitTest.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace seec;
+using namespace seec::trace;
+
+/// \brief The address, value and initialization of a single allocation.
+///
+typedef std::tuple<stateptr_ty,
+                   std::vector<char>,
+                   std::vector<unsigned char>> AllocationContents;
+
+/// \brief Get the contents of every allocation in a MemoryState.
+///
+static std::vector<AllocationContents> getContents(MemoryState const &State)
+{
+  std::vector<AllocationContents> Contents;
+
+  for (auto const &Alloc : State.getAllocations()) {
+    auto const Area = MemoryArea(Alloc.getAddress(), Alloc.getSize());
+    auto const Data = Alloc.getAreaData(Area);
+    auto const Init = Alloc.getAreaInitialization(Area);
+
+    Contents.emplace_back(Alloc.getAddress(),
+                          std::vector<char>(Data.begin(), Data.end()),
+                          std::vector<unsigned char>(Init.begin(), Init.end()));
+  }
+
+  return Contents;
+}
+
+/// \brief Write a string to memory.
+///
+static void write(MemoryState &State,
+                  stateptr_ty const Address,
+                  std::string const &Data)
+{
+  State.addBlock(MappedMemoryBlock(Address, Data.size(), Data.data()));
+}
+
+/// \brief Get a state with two allocations, one of which has been written
+///        twice (so that it has saved areas to rewind).
+///
+static MemoryState makeState()
+{
+  MemoryState State;
+
+  State.allocationAdd(100, 16);
+  State.allocationAdd(200, 8);
+
+  write(State, 100, "abcdefgh");
+  write(State, 104, "WXYZ");
+  write(State, 200, "01234567");
+
+  return State;
+}
+
+/// \brief Apply every kind of modification to a state: writes, clears,
+///        rewinds, copies, and changes to allocations.
+///
+static void modify(MemoryState &State)
+{
+  write(State, 108, "12345678");
+  State.addClear(MemoryArea(100, 2));
+  State.addCopy(200, 110, 4);
+
+  // Rewind the copy, the clear, and writes made before the state was copied.
+  SEEC_CHECK(State.removeCopy(200, 110, 4));
+  SEEC_CHECK(State.removeClear(MemoryArea(100, 2)));
+  SEEC_CHECK(State.removeBlock(MemoryArea(108, 8)));
+  SEEC_CHECK(State.removeBlock(MemoryArea(104, 4)));
+
+  State.allocationRemove(200, 8);
+  State.allocationAdd(300, 4);
+  write(State, 300, "zzzz");
+}
+
+/// \brief Modifying a copy leaves the original unchanged.
+///
+static void testCopyIsolatesOriginal()
+{
+  auto const Original = makeState();
+  auto const Before = getContents(Original);
+
+  MemoryState Copy(Original);
+  SEEC_CHECK(getContents(Copy) == Before);
+
+  modify(Copy);
+  SEEC_CHECK(getContents(Copy) != Before);
+  SEEC_CHECK(getContents(Original) == Before);
+}
+
+/// \brief Modifying the original leaves a copy unchanged.
+///
+static void testOriginalIsolatesCopy()
+{
+  auto Original = makeState();
+  auto const Before = getContents(Original);
+
+  MemoryState Copy;
+  Copy = Original;
+
+  modify(Original);
+  SEEC_CHECK(getContents(Original) != Before);
+  SEEC_CHECK(getContents(Copy) == Before);
+}
+
+/// \brief A copy and its original can rewind their shared saved areas
+///        independently, and get the same results.
+///
+static void testIndependentRewinds()
+{
+  auto Original = makeState();
+  MemoryState Copy(Original);
+
+  SEEC_CHECK(Copy.removeBlock(MemoryArea(104, 4)));
+  auto const Rewound = getContents(Copy);
+
+  // The original still has the second write.
+  auto const Data = Original.getRegion(MemoryArea(104, 4)).getByteValues();
+  SEEC_CHECK(std::string(Data.data(), Data.size()) == "WXYZ");
+
+  SEEC_CHECK(Original.removeBlock(MemoryArea(104, 4)));
+  SEEC_CHECK(getContents(Original) == Rewound);
+
+  // Rewind the first write in both, in opposite orders of modification.
+  SEEC_CHECK(Original.removeBlock(MemoryArea(100, 8)));
+  SEEC_CHECK(Copy.removeBlock(MemoryArea(100, 8)));
+  SEEC_CHECK(getContents(Original) == getContents(Copy));
+  SEEC_CHECK(Original.getRegion(MemoryArea(100, 16)).isUninitialized());
+}
+
+/// \brief A removed allocation can be restored in a copy without affecting
+///        the original, and vice versa.
+///
+static void testAllocationRemoval()
+{
+  auto Original = makeState();
+  auto const Before = getContents(Original);
+
+  MemoryState Copy(Original);
+  Copy.allocationRemove(100, 16);
+  SEEC_CHECK(getContents(Original) == Before);
+
+  Original.allocationRemove(200, 8);
+  SEEC_CHECK(Copy.findAllocation(200) != nullptr);
+
+  SEEC_CHECK(Copy.allocationUnremove(100, 16));
+  SEEC_CHECK(getContents(Copy) == Before);
+
+  SEEC_CHECK(Original.allocationUnremove(200, 8));
+  SEEC_CHECK(getContents(Original) == Before);
+}
+
+int main()
+{
+  testCopyIsolatesOriginal();
+  testOriginalIsolatesCopy();
+  testIndependentRewinds();
+  testAllocationRemoval();
+
+  return seec::unittest::getExitStatus();
+}
@@ -0,0 +1,172 @@
+//===- unittests/Trace/TraceSearchTest.cpp --------------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#include "seec/Trace/TraceFormat.hpp"
+#include "seec/Trace/TraceReader.hpp"
+#include "seec/Trace/TraceSearch.hpp"
+
+#include "UnitTest.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <random>
+#include <vector>
+
+using namespace seec::trace;
+
+/// \brief Get every valid EventType.
+///
+static std::vector<EventType> getAllEventTypes()
+{
+  return std::vector<EventType>{
+#define SEEC_TRACE_EVENT(NAME, MEMBERS, TRAITS) EventType::NAME,
+#include "seec/Trace/Events.def"
+  };
+}
+
+/// \brief Append a zeroed event record to a block buffer.
+///
+static void appendRecord(std::vector<char> &Buffer,
+                         EventType const Type,
+                         uint8_t &PreviousSize)
+{
+  auto const Size = EventRecordBase(Type, 0).getEventSize();
+  auto const Offset = Buffer.size();
+
+  Buffer.resize(Offset + Size);
+  new (&Buffer[Offset]) EventRecordBase(Type, PreviousSize);
+
+  PreviousSize = static_cast<uint8_t>(Size);
+}
+
+/// \brief Find the first Event in a range with a type in Types, checking each
+///        Event in turn (as findLinear() does).
+///
+static seec::Maybe<EventReference> findLinearIn(EventRange Range,
+                                                EventTypeSet const &Types)
+{
+  for (auto It = Range.begin(); It != Range.end(); ++It)
+    if (Types.contains(It->getType()))
+      return seec::Maybe<EventReference>(It);
+
+  return seec::Maybe<EventReference>();
+}
+
+/// \brief Check if findFirstOf() and the linear search agree for a range.
+///
+static bool agree(EventRange const Range, EventTypeSet const &Types)
+{
+  auto const Fast = findFirstOf(Range, Types);
+  auto const Slow = findLinearIn(Range, Types);
+
+  if (Fast.assigned() != Slow.assigned())
+    return false;
+
+  return !Fast.assigned()
+      || Fast.get<EventReference>() == Slow.get<EventReference>();
+}
+
+/// \brief Search a stream made of runs of RunType, separated by marker events,
+///        over many ranges.
+///
+static void testRunsOf(EventType const RunType, std::mt19937 &Random)
+{
+  // Marker events that separate the runs, excluding RunType.
+  std::vector<EventType> Markers;
+  for (auto const Type : {EventType::FunctionStart,
+                          EventType::Free,
+                          EventType::StateClear,
+                          EventType::Instruction})
+    if (Type != RunType)
+      Markers.push_back(Type);
+
+  // Build three blocks, each holding runs of up to 64 records (so that runs
+  // cross many 16-byte windows for every record size), and some single
+  // records.
+  std::vector<std::vector<char>> Buffers;
+  uint32_t const ThreadID = 1;
+
+  for (unsigned BlockNo = 0; BlockNo < 3; ++BlockNo) {
+    Buffers.emplace_back(sizeof(ThreadID));
+    auto &Buffer = Buffers.back();
+    std::memcpy(Buffer.data(), &ThreadID, sizeof(ThreadID));
+
+    uint8_t PreviousSize = 0;
+
+    for (unsigned RunNo = 0; RunNo < 6; ++RunNo) {
+      auto const Length = (RunNo % 3 == 0) ? 1 : 1 + Random() % 64;
+      for (unsigned i = 0; i < Length; ++i)
+        appendRecord(Buffer, RunType, PreviousSize);
+
+      appendRecord(Buffer, Markers[Random() % Markers.size()], PreviousSize);
+    }
+
+    // End every other block with a run.
+    if (BlockNo % 2 == 0)
+      for (unsigned i = 0; i < 20; ++i)
+        appendRecord(Buffer, RunType, PreviousSize);
+  }
+
+  std::vector<InputBlock> Blocks;
+  for (auto const &Buffer : Buffers)
+    Blocks.emplace_back(BlockType::ThreadEvents,
+                        Buffer.data(),
+                        Buffer.data() + Buffer.size());
+
+  ThreadEventBlockSequence const Sequence(Blocks);
+  auto const All = *getRange(Sequence);
+
+  std::vector<EventReference> Events;
+  for (auto It = All.begin(); It != All.end(); ++It)
+    Events.push_back(It);
+
+  EventTypeSet OnlyRun;
+  OnlyRun.insert(RunType);
+
+  EventTypeSet const TypeSets[] = {
+    EventTypeSet(),
+    OnlyRun,
+    makeEventTypeSet<EventType::FunctionStart>(),
+    makeEventTypeSet<EventType::Free, EventType::StateClear>(),
+    makeEventTypeSet<EventType::Instruction, EventType::FunctionEnd>()
+  };
+
+  auto const Count = Events.size();
+
+  for (std::size_t Begin = 0; Begin < Count; ++Begin) {
+    // Ends in the same block (including empty ranges), in later blocks, and
+    // past the final event.
+    std::vector<EventReference> Ends {All.end()};
+    for (std::size_t const Offset : {std::size_t(0), std::size_t(1),
+                                     std::size_t(5), std::size_t(33),
+                                     1 + Random() % (Count - Begin)})
+      if (Begin + Offset < Count)
+        Ends.push_back(Events[Begin + Offset]);
+
+    for (auto const &End : Ends)
+      for (auto const &Types : TypeSets)
+        SEEC_CHECK(agree(EventRange(Events[Begin], End), Types));
+  }
+}
+
+int main()
+{
+  std::mt19937 Random(26);
+
+  for (auto const Type : getAllEventTypes())
+    testRunsOf(Type, Random);
+
+  return seec::unittest::getExitStatus();
+}
@@ -0,0 +1,67 @@
+//===- unittests/UnitTest.hpp --------------------------------------- C++ -===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// Minimal checking support for the unit tests.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef SEEC_UNITTESTS_UNITTEST_HPP
+#define SEEC_UNITTESTS_UNITTEST_HPP
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace seec {
+
+namespace unittest {
+
+
+/// \brief Get the number of failed checks.
+///
+inline unsigned &getFailureCount() {
+  static unsigned Failures = 0;
+  return Failures;
+}
+
+/// \brief Record the result of a check, printing it if it failed.
+///
+inline void check(bool const Passed,
+                  char const * const Condition,
+                  char const * const File,
+                  unsigned const Line)
+{
+  if (Passed)
+    return;
+
+  ++getFailureCount();
+  std::fprintf(stderr, "%s:%u: check failed: %s\n", File, Line, Condition);
+}
+
+/// \brief Get the exit status for the test program.
+///
+inline int getExitStatus() {
+  if (getFailureCount() == 0)
+    return EXIT_SUCCESS;
+
+  std::fprintf(stderr, "%u checks failed\n", getFailureCount());
+  return EXIT_FAILURE;
+}
+
+
+} // namespace unittest (in seec)
+
+} // namespace seec
+
+/// \brief Check a condition, reporting it (and continuing) if it is false.
+///
+#define SEEC_CHECK(COND) \
+  ::seec::unittest::check((COND), #COND, __FILE__, __LINE__)
+
+#endif // SEEC_UNITTESTS_UNITTEST_HPP
@@ -0,0 +1,162 @@
+//===- unittests/Util/TaskSchedulerTest.cpp -------------------------------===//
+//
+//                                    SeeC
+//
+// This file is distributed under The MIT License (MIT). See LICENSE.TXT for
+// details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+///
+//===----------------------------------------------------------------------===//
+
+#include "seec/Util/TaskScheduler.hpp"
+
+#include "UnitTest.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+using namespace seec;
+
+/// \brief Every task runs exactly once, for any chunk size.
+///
+static void testEveryTaskRuns(TaskScheduler &Scheduler)
+{
+  std::size_t const Count = 1000;
+
+  for (std::size_t const ChunkSize : {0, 1, 7, 1000, 5000}) {
+    std::vector<std::atomic<unsigned>> Runs(Count);
+    for (auto &R : Runs)
+      R = 0;
+
+    auto const Completed =
+      Scheduler.parallelFor(Count, ChunkSize,
+                            [&] (std::size_t const i) { ++Runs[i]; });
+
+    SEEC_CHECK(Completed);
+
+    for (auto const &R : Runs)
+      SEEC_CHECK(R == 1);
+  }
+}
+
+/// \brief An empty loop runs nothing, and is complete.
+///
+static void testEmpty(TaskScheduler &Scheduler)
+{
+  std::atomic<unsigned> Runs(0);
+
+  SEEC_CHECK(Scheduler.parallelFor(0, 0, [&] (std::size_t) { ++Runs; }));
+  SEEC_CHECK(Runs == 0);
+}
+
+/// \brief Tasks can call parallelFor() on the same scheduler without
+///        deadlocking, even when every worker is running an outer task.
+///
+static void testNested(TaskScheduler &Scheduler)
+{
+  std::size_t const Outer = 16;
+  std::size_t const Inner = 64;
+
+  std::atomic<std::size_t> Runs(0);
+  std::atomic<unsigned> InnerIncomplete(0);
+
+  auto const Completed =
+    Scheduler.parallelFor(Outer, 1,
+      [&] (std::size_t) {
+        auto const InnerCompleted =
+          Scheduler.parallelFor(Inner, 4, [&] (std::size_t) { ++Runs; });
+
+        if (!InnerCompleted)
+          ++InnerIncomplete;
+      });
+
+  SEEC_CHECK(Completed);
+  SEEC_CHECK(InnerIncomplete == 0);
+  SEEC_CHECK(Runs == Outer * Inner);
+}
+
+/// \brief No tasks run if the loop is cancelled before it starts.
+///
+static void testCancelledBeforeStart(TaskScheduler &Scheduler)
+{
+  std::atomic_bool CancelIfFalse(false);
+  std::atomic<unsigned> Runs(0);
+
+  auto const Completed =
+    Scheduler.parallelFor(100, 1, [&] (std::size_t) { ++Runs; },
+                          &CancelIfFalse);
+
+  SEEC_CHECK(!Completed);
+  SEEC_CHECK(Runs == 0);
+}
+
+/// \brief Chunks that have not started are skipped once the loop is
+///        cancelled, and parallelFor() reports that it did not complete.
+///
+static void testCancelledDuring(TaskScheduler &Scheduler)
+{
+  std::size_t const Count = 1000;
+  std::atomic_bool CancelIfFalse(true);
+  std::atomic<std::size_t> Runs(0);
+
+  auto const Completed =
+    Scheduler.parallelFor(Count, 1,
+                          [&] (std::size_t) {
+                            if (Runs++ == 0)
+                              CancelIfFalse = false;
+                          },
+                          &CancelIfFalse);
+
+  SEEC_CHECK(!Completed);
+
+  // Only chunks that had already checked the flag when it was cleared can
+  // run: at most one per worker and one for the calling thread.
+  SEEC_CHECK(Runs <= Scheduler.getWorkerCount() + 1);
+}
+
+/// \brief Cancelling a nested loop does not cancel the loop that contains it.
+///
+static void testCancelledNested(TaskScheduler &Scheduler)
+{
+  std::size_t const Outer = 8;
+  std::atomic<unsigned> InnerIncomplete(0);
+  std::atomic<std::size_t> OuterRuns(0);
+
+  auto const Completed =
+    Scheduler.parallelFor(Outer, 1,
+      [&] (std::size_t) {
+        std::atomic_bool CancelIfFalse(false);
+
+        auto const InnerCompleted =
+          Scheduler.parallelFor(16, 1, [] (std::size_t) {}, &CancelIfFalse);
+
+        if (!InnerCompleted)
+          ++InnerIncomplete;
+
+        ++OuterRuns;
+      });
+
+  SEEC_CHECK(Completed);
+  SEEC_CHECK(OuterRuns == Outer);
+  SEEC_CHECK(InnerIncomplete == Outer);
+}
+
+int main()
+{
+  for (unsigned const WorkerCount : {1u, 4u}) {
+    TaskScheduler Scheduler(WorkerCount);
+
+    testEveryTaskRuns(Scheduler);
+    testEmpty(Scheduler);
+    testNested(Scheduler);
+    testCancelledBeforeStart(Scheduler);
+    testCancelledDuring(Scheduler);
+    testCancelledNested(Scheduler);
+  }
+
+  return seec::unittest::getExitStatus();
+}